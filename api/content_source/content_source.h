@@ -8,12 +8,14 @@
 #ifndef CONTENT_SOURCE_H
 #define CONTENT_SOURCE_H
 
+#include <cstring>
 #include <memory>
 
 #include "base/errors.h"
 
 #include "media/foundation/media_frame.h"
 #include "media/foundation/media_meta.h"
+#include "media/foundation/message.h"
 
 #include "api/player_interface.h"
 
@@ -145,6 +147,70 @@ class ContentSource {
       MediaType track_type,
       std::shared_ptr<ave::media::MediaFrame>& access_unit) = 0;
 
+  /**
+   * @brief Whether DequeueAccessUnitInto() reads the payload of the track
+   * straight into the caller's buffer rather than copying a dequeued access
+   * unit.
+   * @param track_type The media type of the track.
+   */
+  virtual bool SupportsDirectRead(MediaType /* track_type */) const {
+    return false;
+  }
+
+  /**
+   * @brief Dequeues an access unit with its payload placed in |buffer|,
+   * which the caller (typically a decoder lending a codec input buffer)
+   * owns.
+   *
+   * The default implementation dequeues with DequeueAccessUnit() and copies
+   * the payload. Sources that support direct reads have the payload read
+   * into |buffer| in place, and |access_unit| then carries only its timing
+   * and flags.
+   *
+   * @param track_type The media type of the track.
+   * @param buffer Destination of the payload.
+   * @param capacity Size of |buffer|.
+   * @param access_unit The output parameter to store the access unit.
+   * @param size The output parameter to store the payload size.
+   * @return The status of the operation; NO_MEMORY if the payload does not
+   * fit |buffer|. The access unit is dequeued all the same and |access_unit|
+   * carries it with its payload, for the caller to copy.
+   */
+  virtual status_t DequeueAccessUnitInto(
+      MediaType track_type,
+      uint8_t* buffer,
+      size_t capacity,
+      std::shared_ptr<ave::media::MediaFrame>& access_unit,
+      size_t* size) {
+    status_t err = DequeueAccessUnit(track_type, access_unit);
+    if (err != ave::OK) {
+      return err;
+    }
+    if (access_unit->size() > capacity) {
+      return ave::NO_MEMORY;
+    }
+    std::memcpy(buffer, access_unit->data(), access_unit->size());
+    *size = access_unit->size();
+    return ave::OK;
+  }
+
+  /**
+   * @brief Asks for |notify| to be posted once an access unit of
+   * |track_type| can be dequeued.
+   *
+   * Lets a consumer that got WOULD_BLOCK sleep until data arrives instead of
+   * polling. |notify| is posted once, right away if data is already waiting;
+   * a later request replaces one that has not been posted yet.
+   *
+   * @return INVALID_OPERATION if the source cannot notify, in which case the
+   * caller has to poll.
+   */
+  virtual status_t RequestDataAvailableNotify(
+      MediaType /* track_type */,
+      std::shared_ptr<ave::media::Message> /* notify */) {
+    return ave::INVALID_OPERATION;
+  }
+
   /**
    * @brief Retrieves the media format associated with the content source.
    *
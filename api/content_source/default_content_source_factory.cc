@@ -14,6 +14,8 @@
 #include "api/demuxer/demuxer_factory.h"
 #include "base/data_source/http_source.h"
 #include "base/net/http/http_provider.h"
+#include "content_source/data_source/async_file_source.h"
+#include "content_source/data_source/http_disk_cache.h"
 #include "content_source/generic_source.h"
 #include "content_source/http_live/http_live_source.h"
 #include "content_source/http_live/playlist_parser.h"
@@ -53,6 +55,18 @@ std::shared_ptr<ave::DataSource> CreateHttpDataSource(
   return source;
 }
 
+// Returns the file path of a local url, or an empty string for urls with
+// another scheme.
+std::string LocalFilePath(const std::string& url) {
+  if (ToLower(url).rfind("file://", 0) == 0) {
+    return url.substr(7);
+  }
+  if (url.find("://") == std::string::npos) {
+    return url;
+  }
+  return std::string();
+}
+
 }  // namespace
 
 std::shared_ptr<ContentSource> DefaultContentSourceFactory::CreateContentSource(
@@ -66,6 +80,19 @@ std::shared_ptr<ContentSource> DefaultContentSourceFactory::CreateContentSource(
     return source;
   }
 
+  if (url && IsHttpUrl(url) && http_cache_ && http_provider_) {
+    auto http_provider = http_provider_;
+    std::string uri = url;
+    auto data_source = std::make_shared<CachingHttpSource>(
+        uri, http_cache_->OpenEntry(uri),
+        [http_provider, uri, headers]() {
+          return CreateHttpDataSource(http_provider, uri.c_str(), headers);
+        });
+    auto source = std::make_shared<GenericSource>(demuxer_factory_);
+    source->SetDataSource(std::move(data_source));
+    return source;
+  }
+
   if (url && IsHttpUrl(url)) {
     auto data_source = CreateHttpDataSource(http_provider_, url, headers);
     if (!data_source) {
@@ -76,7 +103,21 @@ std::shared_ptr<ContentSource> DefaultContentSourceFactory::CreateContentSource(
     return source;
   }
 
+  if (url && async_read_engine_) {
+    const std::string path = LocalFilePath(url);
+    if (!path.empty()) {
+      auto data_source =
+          std::make_shared<AsyncFileSource>(path.c_str(), async_read_engine_);
+      if (data_source->InitCheck() == OK) {
+        auto source = std::make_shared<GenericSource>(demuxer_factory_);
+        source->SetDataSource(std::move(data_source));
+        return source;
+      }
+    }
+  }
+
   auto source = std::make_shared<GenericSource>(demuxer_factory_);
+  source->SetMmapLocalFiles(mmap_local_files_);
   source->SetDataSource(url);
   return source;
 }
@@ -86,6 +127,7 @@ std::shared_ptr<ContentSource> DefaultContentSourceFactory::CreateContentSource(
     int64_t offset,
     int64_t length) {
   auto source = std::make_shared<GenericSource>(demuxer_factory_);
+  source->SetMmapLocalFiles(mmap_local_files_);
   source->SetDataSource(fd, offset, length);
   return source;
 }
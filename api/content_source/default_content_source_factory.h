@@ -19,7 +19,9 @@ class HTTPProvider;
 namespace ave {
 namespace player {
 
+class AsyncReadEngine;
 class DemuxerFactory;
+class HttpDiskCache;
 
 // A concrete factory that produces GenericSource-backed ContentSource
 // and injects a DemuxerFactory so GenericSource can demux input.
@@ -32,6 +34,25 @@ class DefaultContentSourceFactory : public ContentSourceFactory {
         http_provider_(std::move(http_provider)) {}
   ~DefaultContentSourceFactory() override = default;
 
+  // Routes progressive HTTP sources through |cache| so repeated playback of
+  // the same url is served from disk. Pass nullptr to disable. The cache
+  // never revalidates: a resource changed on the server keeps being served
+  // from disk until it is evicted, see CachingHttpSource.
+  void SetHttpCache(std::shared_ptr<HttpDiskCache> cache) {
+    http_cache_ = std::move(cache);
+  }
+
+  // Reads local files through |engine| instead of blocking pread() calls on
+  // the source looper. One engine is meant to be shared by all players.
+  void SetAsyncReadEngine(std::shared_ptr<AsyncReadEngine> engine) {
+    async_read_engine_ = std::move(engine);
+  }
+
+  // Memory maps local files, see GenericSource::SetMmapLocalFiles(). Off by
+  // default; only for files that are not truncated or appended to while
+  // playing.
+  void SetMmapLocalFiles(bool enable) { mmap_local_files_ = enable; }
+
   std::shared_ptr<ContentSource> CreateContentSource(
       const char* url,
       const std::unordered_map<std::string, std::string>& headers) override;
@@ -46,6 +67,9 @@ class DefaultContentSourceFactory : public ContentSourceFactory {
  private:
   std::shared_ptr<DemuxerFactory> demuxer_factory_;
   std::shared_ptr<net::HTTPProvider> http_provider_;
+  std::shared_ptr<HttpDiskCache> http_cache_;
+  std::shared_ptr<AsyncReadEngine> async_read_engine_;
+  bool mmap_local_files_ = false;
 };
 
 }  // namespace player
@@ -9,9 +9,12 @@
 #define DEMUXER_H
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "api/player_interface.h"
 #include "base/data_source/data_source.h"
+#include "media/foundation/media_frame.h"
 #include "media/foundation/media_meta.h"
 #include "media/foundation/media_source.h"
 
@@ -21,6 +24,16 @@ namespace player {
 using ave::media::MediaMeta;
 using ave::media::MediaSource;
 
+// Flags demuxers set on video access units with MediaFrame::setFlags(), in
+// bits above the ones MediaFrame defines. Unmarked access units carry
+// neither.
+enum AccessUnitFlags : uint32_t {
+  // Decoding can start here: an IDR (or BLA) picture.
+  ACCESS_UNIT_FLAG_SYNC = 1u << 16,
+  // No later picture references it; it can be skipped without decoding.
+  ACCESS_UNIT_FLAG_DROPPABLE = 1u << 17,
+};
+
 class Demuxer {
  public:
   explicit Demuxer(std::shared_ptr<ave::DataSource>(data_source))
@@ -38,6 +51,33 @@ class Demuxer {
 
   virtual const char* name() = 0;
 
+  // Whether ReadSampleInto() is implemented.
+  virtual bool SupportsReadSampleInto() const { return false; }
+
+  // Reads the next sample of |trackIndex| straight into |buffer|, sharing
+  // the read position with the MediaSource of the track. |frame| receives
+  // the timing and flags of the sample but no payload; |size| the payload
+  // size. Returns NO_MEMORY without consuming the sample if it does not fit.
+  virtual status_t ReadSampleInto(
+      size_t /* trackIndex */,
+      uint8_t* /* buffer */,
+      size_t /* capacity */,
+      std::shared_ptr<media::MediaFrame>& /* frame */,
+      size_t* /* size */,
+      const MediaSource::ReadOptions* /* options */) {
+    return INVALID_OPERATION;
+  }
+
+  // Appends the (offset, size) data source ranges of the next |count|
+  // samples of |trackIndex| to |ranges|, without moving the read position,
+  // so they can be prefetched.
+  virtual status_t GetNextSampleRanges(
+      size_t /* trackIndex */,
+      size_t /* count */,
+      std::vector<std::pair<off64_t, size_t>>* /* ranges */) {
+    return INVALID_OPERATION;
+  }
+
  protected:
   std::shared_ptr<ave::DataSource> data_source_;
 };
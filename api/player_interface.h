@@ -95,6 +95,13 @@ class IAVSyncController {
    * @brief Reset the clock (e.g., on seek or stop).
    */
   virtual void Reset() = 0;
+
+  /**
+   * @brief Get the ratio the audio render resamples PCM by to correct
+   * audio clock drift: output samples per input sample.
+   * @return 1.0 when no correction is needed.
+   */
+  virtual double GetAudioResampleRatio() const { return 1.0; }
 };
 
 }  // namespace player
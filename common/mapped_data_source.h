@@ -0,0 +1,43 @@
+/*
+ * mapped_data_source.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef COMMON_MAPPED_DATA_SOURCE_H_
+#define COMMON_MAPPED_DATA_SOURCE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "base/data_source/data_source.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief DataSource whose bytes are addressable in memory.
+ *
+ * Demuxers reading one can hand out frames that point into the source
+ * instead of copying each sample out of it.
+ */
+class MappedDataSource : public ave::DataSource {
+ public:
+  ~MappedDataSource() override = default;
+
+  /**
+   * @brief Returns a pointer to |size| bytes at |offset| that keeps the
+   * memory behind it valid for as long as it is referenced, even after the
+   * source is destroyed. Returns nullptr if the range is not entirely inside
+   * the source.
+   */
+  virtual std::shared_ptr<const uint8_t> GetView(off64_t offset,
+                                                 size_t size) = 0;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // COMMON_MAPPED_DATA_SOURCE_H_
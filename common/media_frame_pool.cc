@@ -0,0 +1,232 @@
+/*
+ * media_frame_pool.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "common/media_frame_pool.h"
+
+#include <new>
+#include <utility>
+
+namespace ave {
+namespace player {
+
+using media::MediaFrame;
+
+namespace {
+
+// Idle control blocks kept for reuse; each is a few dozen bytes.
+constexpr size_t kMaxFreeControlBlocks = 256;
+
+}  // namespace
+
+// Free list of the shared_ptr control blocks of pooled frames. All of them
+// have the same size, that of the first one released.
+class MediaFramePool::ControlBlockCache {
+ public:
+  ControlBlockCache() { free_.reserve(kMaxFreeControlBlocks); }
+
+  ~ControlBlockCache() {
+    for (void* block : free_) {
+      ::operator delete(block);
+    }
+  }
+
+  void* Allocate(size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size == block_size_ && !free_.empty()) {
+        void* block = free_.back();
+        free_.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void Deallocate(void* block, size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (block_size_ == 0) {
+        block_size_ = size;
+      }
+      if (size == block_size_ && free_.size() < kMaxFreeControlBlocks) {
+        free_.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+  void Trim() {
+    std::vector<void*> blocks;
+    blocks.reserve(kMaxFreeControlBlocks);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocks.swap(free_);
+    }
+    for (void* block : blocks) {
+      ::operator delete(block);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  size_t block_size_ GUARDED_BY(mutex_) = 0;
+  std::vector<void*> free_ GUARDED_BY(mutex_);
+};
+
+// Allocator handed to the shared_ptr of a pooled frame, so its control block
+// comes from the ControlBlockCache.
+template <typename T>
+class MediaFramePool::ControlBlockAllocator {
+ public:
+  using value_type = T;
+
+  explicit ControlBlockAllocator(std::shared_ptr<ControlBlockCache> cache)
+      : cache_(std::move(cache)) {}
+  template <typename U>
+  ControlBlockAllocator(const ControlBlockAllocator<U>& other)  // NOLINT
+      : cache_(other.cache_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(cache_->Allocate(n * sizeof(T)));
+  }
+  void deallocate(T* p, size_t n) { cache_->Deallocate(p, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const ControlBlockAllocator<U>& other) const {
+    return cache_ == other.cache_;
+  }
+  template <typename U>
+  bool operator!=(const ControlBlockAllocator<U>& other) const {
+    return cache_ != other.cache_;
+  }
+
+ private:
+  template <typename U>
+  friend class ControlBlockAllocator;
+
+  std::shared_ptr<ControlBlockCache> cache_;
+};
+
+std::shared_ptr<MediaFramePool> MediaFramePool::Create(
+    media::MediaType type,
+    size_t max_free_per_class) {
+  return std::shared_ptr<MediaFramePool>(
+      new MediaFramePool(type, max_free_per_class));
+}
+
+MediaFramePool::MediaFramePool(media::MediaType type, size_t max_free_per_class)
+    : type_(type),
+      max_free_per_class_(max_free_per_class),
+      control_blocks_(std::make_shared<ControlBlockCache>()) {}
+
+MediaFramePool::~MediaFramePool() = default;
+
+int MediaFramePool::ClassForSize(size_t size) {
+  size_t capacity = size_t{1} << kMinClassShift;
+  for (size_t size_class = 0; size_class < kNumClasses; ++size_class) {
+    if (size <= capacity) {
+      return static_cast<int>(size_class);
+    }
+    capacity <<= 1;
+  }
+  return -1;
+}
+
+size_t MediaFramePool::ClassCapacity(int size_class) {
+  return size_t{1} << (kMinClassShift + static_cast<size_t>(size_class));
+}
+
+std::shared_ptr<MediaFrame> MediaFramePool::Acquire(size_t size) {
+  const int size_class = ClassForSize(size);
+
+  std::unique_ptr<MediaFrame> frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.acquired;
+    if (size_class < 0) {
+      ++stats_.oversized;
+    } else {
+      auto& free_list = free_[size_class];
+      if (!free_list.empty()) {
+        frame = std::move(free_list.back());
+        free_list.pop_back();
+        --stats_.free_frames;
+        stats_.free_bytes -= ClassCapacity(size_class);
+        ++stats_.reused;
+      } else {
+        ++stats_.allocated;
+      }
+      ++stats_.outstanding;
+    }
+  }
+
+  if (size_class < 0) {
+    auto oversized = MediaFrame::CreateShared(size, type_);
+    if (oversized) {
+      oversized->setRange(0, size);
+    }
+    return oversized;
+  }
+
+  if (!frame) {
+    frame = std::make_unique<MediaFrame>(
+        MediaFrame::Create(ClassCapacity(size_class)));
+    frame->SetStreamType(type_);
+  }
+  frame->setFlags(0);
+  frame->setRange(0, size);
+
+  std::weak_ptr<MediaFramePool> weak_pool = weak_from_this();
+  return std::shared_ptr<MediaFrame>(
+      frame.release(),
+      [weak_pool, size_class](MediaFrame* released) {
+        Release(weak_pool, size_class, released);
+      },
+      ControlBlockAllocator<MediaFrame>(control_blocks_));
+}
+
+void MediaFramePool::Release(std::weak_ptr<MediaFramePool> weak_pool,
+                             int size_class,
+                             MediaFrame* frame) {
+  std::unique_ptr<MediaFrame> owned(frame);
+  auto pool = weak_pool.lock();
+  if (!pool) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(pool->mutex_);
+  --pool->stats_.outstanding;
+  auto& free_list = pool->free_[size_class];
+  if (free_list.size() >= pool->max_free_per_class_) {
+    ++pool->stats_.discarded;
+    return;
+  }
+  free_list.push_back(std::move(owned));
+  ++pool->stats_.free_frames;
+  pool->stats_.free_bytes += ClassCapacity(size_class);
+}
+
+MediaFramePool::Stats MediaFramePool::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void MediaFramePool::Trim() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& free_list : free_) {
+      free_list.clear();
+    }
+    stats_.free_frames = 0;
+    stats_.free_bytes = 0;
+  }
+  control_blocks_->Trim();
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,110 @@
+/*
+ * media_frame_pool.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef COMMON_MEDIA_FRAME_POOL_H_
+#define COMMON_MEDIA_FRAME_POOL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base/thread_annotation.h"
+#include "media/foundation/media_frame.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Recycles MediaFrames of one track to avoid a heap allocation per
+ * access unit.
+ *
+ * Frames are grouped in power-of-two capacity classes. A frame handed out by
+ * Acquire() goes back to its class when the last reference to it drops, and
+ * the shared_ptr control block wrapping it is recycled too, so steady-state
+ * playback, where access unit sizes stay within the same few classes, does
+ * not touch the allocator. Requests larger than the biggest class are
+ * allocated directly and never pooled.
+ *
+ * Recycled frames keep the timing and codec fields of their previous use;
+ * callers are expected to set them, as demuxers do for every sample anyway.
+ * Frames may outlive the pool; they are then simply freed.
+ */
+class MediaFramePool : public std::enable_shared_from_this<MediaFramePool> {
+ public:
+  struct Stats {
+    // Total Acquire() calls.
+    uint64_t acquired = 0;
+    // Acquire() calls served by a recycled frame.
+    uint64_t reused = 0;
+    // Frames allocated because the class had no free frame.
+    uint64_t allocated = 0;
+    // Requests above the largest class, allocated without pooling.
+    uint64_t oversized = 0;
+    // Frames dropped on release because their class was full.
+    uint64_t discarded = 0;
+    // Frames currently handed out.
+    size_t outstanding = 0;
+    // Frames and payload bytes currently parked in the free lists.
+    size_t free_frames = 0;
+    size_t free_bytes = 0;
+  };
+
+  /**
+   * @param type Stream type stamped on every frame.
+   * @param max_free_per_class Upper bound of idle frames kept per class.
+   */
+  static std::shared_ptr<MediaFramePool> Create(
+      media::MediaType type,
+      size_t max_free_per_class = 32);
+
+  ~MediaFramePool();
+
+  /**
+   * @brief Returns a frame whose range is [0, size).
+   */
+  std::shared_ptr<media::MediaFrame> Acquire(size_t size) EXCLUDES(mutex_);
+
+  Stats GetStats() const EXCLUDES(mutex_);
+
+  // Drops all idle frames.
+  void Trim() EXCLUDES(mutex_);
+
+ private:
+  // Classes cover 256 B .. 8 MiB.
+  static constexpr size_t kMinClassShift = 8;
+  static constexpr size_t kNumClasses = 16;
+
+  class ControlBlockCache;
+  template <typename T>
+  class ControlBlockAllocator;
+
+  MediaFramePool(media::MediaType type, size_t max_free_per_class);
+
+  static int ClassForSize(size_t size);
+  static size_t ClassCapacity(int size_class);
+  static void Release(std::weak_ptr<MediaFramePool> pool,
+                      int size_class,
+                      media::MediaFrame* frame);
+
+  const media::MediaType type_;
+  const size_t max_free_per_class_;
+  // Shared with the control blocks, which may outlive the pool.
+  const std::shared_ptr<ControlBlockCache> control_blocks_;
+
+  mutable std::mutex mutex_;
+  std::array<std::vector<std::unique_ptr<media::MediaFrame>>, kNumClasses>
+      free_ GUARDED_BY(mutex_);
+  Stats stats_ GUARDED_BY(mutex_);
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // COMMON_MEDIA_FRAME_POOL_H_
@@ -0,0 +1,159 @@
+/*
+ * media_frame_pool_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "common/media_frame_pool.h"
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "test/gtest.h"
+
+namespace {
+
+// Heap allocations made by this thread while counting is on.
+thread_local bool g_count_allocations = false;
+thread_local size_t g_allocations = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (g_count_allocations) {
+    ++g_allocations;
+  }
+  if (void* p = std::malloc(size != 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t /* size */) noexcept {
+  std::free(p);
+}
+
+namespace ave {
+namespace player {
+namespace {
+
+using media::MediaFrame;
+using media::MediaType;
+
+// Counts the heap allocations of the current thread over its lifetime.
+class ScopedAllocationCounter {
+ public:
+  ScopedAllocationCounter() {
+    g_allocations = 0;
+    g_count_allocations = true;
+  }
+  ~ScopedAllocationCounter() { g_count_allocations = false; }
+
+  size_t allocations() const { return g_allocations; }
+};
+
+TEST(MediaFramePoolTest, AcquireSetsRange) {
+  auto pool = MediaFramePool::Create(MediaType::VIDEO);
+  auto frame = pool->Acquire(1000);
+  ASSERT_NE(frame, nullptr);
+  EXPECT_EQ(frame->size(), 1000u);
+  EXPECT_EQ(frame->stream_type(), MediaType::VIDEO);
+}
+
+TEST(MediaFramePoolTest, ReusesReleasedFrameOfSameClass) {
+  auto pool = MediaFramePool::Create(MediaType::AUDIO);
+  MediaFrame* first = nullptr;
+  {
+    auto frame = pool->Acquire(700);
+    first = frame.get();
+  }
+  auto stats = pool->GetStats();
+  EXPECT_EQ(stats.free_frames, 1u);
+  EXPECT_EQ(stats.outstanding, 0u);
+
+  // 900 bytes falls in the same 1 KiB class as 700.
+  auto frame = pool->Acquire(900);
+  EXPECT_EQ(frame.get(), first);
+  EXPECT_EQ(frame->size(), 900u);
+
+  stats = pool->GetStats();
+  EXPECT_EQ(stats.acquired, 2u);
+  EXPECT_EQ(stats.allocated, 1u);
+  EXPECT_EQ(stats.reused, 1u);
+  EXPECT_EQ(stats.outstanding, 1u);
+}
+
+TEST(MediaFramePoolTest, SteadyStateDoesNotAllocate) {
+  auto pool = MediaFramePool::Create(MediaType::VIDEO);
+  for (int i = 0; i < 100; ++i) {
+    auto frame = pool->Acquire(4000 + (i % 8) * 10);
+  }
+  auto stats = pool->GetStats();
+  EXPECT_EQ(stats.acquired, 100u);
+  EXPECT_EQ(stats.allocated, 1u);
+  EXPECT_EQ(stats.reused, 99u);
+}
+
+TEST(MediaFramePoolTest, SteadyStateMakesNoHeapAllocation) {
+  auto pool = MediaFramePool::Create(MediaType::VIDEO);
+  // The first frame of the class and its control block are allocated once.
+  pool->Acquire(4000).reset();
+
+  size_t allocations = 0;
+  {
+    ScopedAllocationCounter counter;
+    for (int i = 0; i < 100; ++i) {
+      auto frame = pool->Acquire(4000 + (i % 8) * 10);
+    }
+    allocations = counter.allocations();
+  }
+  EXPECT_EQ(allocations, 0u);
+  EXPECT_EQ(pool->GetStats().allocated, 1u);
+}
+
+TEST(MediaFramePoolTest, CapsIdleFramesPerClass) {
+  auto pool = MediaFramePool::Create(MediaType::AUDIO, 2);
+  {
+    auto a = pool->Acquire(100);
+    auto b = pool->Acquire(100);
+    auto c = pool->Acquire(100);
+  }
+  auto stats = pool->GetStats();
+  EXPECT_EQ(stats.free_frames, 2u);
+  EXPECT_EQ(stats.discarded, 1u);
+
+  pool->Trim();
+  EXPECT_EQ(pool->GetStats().free_frames, 0u);
+  EXPECT_EQ(pool->GetStats().free_bytes, 0u);
+}
+
+TEST(MediaFramePoolTest, OversizedFramesAreNotPooled) {
+  auto pool = MediaFramePool::Create(MediaType::VIDEO);
+  {
+    auto frame = pool->Acquire(16 * 1024 * 1024);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->size(), 16u * 1024 * 1024);
+  }
+  auto stats = pool->GetStats();
+  EXPECT_EQ(stats.oversized, 1u);
+  EXPECT_EQ(stats.free_frames, 0u);
+}
+
+TEST(MediaFramePoolTest, FramesMayOutlivePool) {
+  auto pool = MediaFramePool::Create(MediaType::VIDEO);
+  auto frame = pool->Acquire(512);
+  pool.reset();
+  ASSERT_NE(frame, nullptr);
+  EXPECT_EQ(frame->size(), 512u);
+  frame.reset();
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
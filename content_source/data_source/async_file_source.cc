@@ -0,0 +1,272 @@
+/*
+ * async_file_source.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/async_file_source.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include "base/logging.h"
+#include "media/foundation/media_errors.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+constexpr int64_t kBlockSize = 256 * 1024;
+// Number of blocks kept in flight ahead of a forward-moving cursor.
+constexpr int64_t kReadAheadBlocks = 4;
+// Number of blocks loaded by Prefetch() kept at most.
+constexpr size_t kMaxPrefetchedBlocks = 16;
+
+}  // namespace
+
+struct AsyncFileSource::Block {
+  explicit Block(off64_t offset) : offset(offset), data(kBlockSize) {}
+
+  const off64_t offset;
+  std::vector<uint8_t> data;
+  ssize_t valid = 0;
+  bool ready = false;
+  // Loaded by Prefetch(); kept when the read cursor moves elsewhere.
+  bool prefetched = false;
+};
+
+AsyncFileSource::AsyncFileSource(const char* path,
+                                 std::shared_ptr<AsyncReadEngine> engine)
+    : uri_(path ? path : ""), engine_(std::move(engine)) {
+  if (!engine_) {
+    return;
+  }
+  fd_ = open(uri_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    AVE_LOG(LS_ERROR) << "AsyncFileSource: cannot open " << uri_ << ": "
+                      << strerror(errno);
+    return;
+  }
+  struct stat st {};
+  if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+    size_ = st.st_size;
+  }
+}
+
+AsyncFileSource::~AsyncFileSource() {
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+status_t AsyncFileSource::InitCheck() const {
+  return fd_ >= 0 && size_ >= 0 ? OK : NO_INIT;
+}
+
+ssize_t AsyncFileSource::ReadAt(off64_t offset, void* data, size_t size) {
+  if (fd_ < 0) {
+    return NO_INIT;
+  }
+  if (offset < 0 || data == nullptr) {
+    return BAD_VALUE;
+  }
+  if (offset >= size_) {
+    return 0;
+  }
+  size = std::min<size_t>(size, static_cast<size_t>(size_ - offset));
+
+  auto* out = static_cast<uint8_t*>(data);
+  size_t done = 0;
+  std::vector<AsyncReadEngine::Request> read_ahead;
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (done < size) {
+      const off64_t pos = offset + static_cast<off64_t>(done);
+      auto it = blocks_.find(pos / kBlockSize);
+      if (it == blocks_.end()) {
+        break;
+      }
+      std::shared_ptr<Block> block = it->second;
+      // The block is already on its way; waiting for it is cheaper than
+      // issuing a second read for the same bytes.
+      cv_.wait(lock, [&block]() { return block->ready; });
+      const off64_t in_block = pos - block->offset;
+      if (block->valid <= in_block) {
+        break;
+      }
+      const size_t n = std::min<size_t>(
+          size - done, static_cast<size_t>(block->valid - in_block));
+      std::memcpy(out + done, block->data.data() + in_block, n);
+      done += n;
+    }
+    ScheduleReadAheadLocked(offset, size, &read_ahead);
+  }
+  SubmitBlockRequests(std::move(read_ahead));
+
+  while (done < size) {
+    const ssize_t n =
+        pread(fd_, out + done, size - done, offset + static_cast<off64_t>(done));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return done > 0 ? static_cast<ssize_t>(done)
+                      : static_cast<ssize_t>(media::ERROR_IO);
+    }
+    if (n == 0) {
+      break;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return static_cast<ssize_t>(done);
+}
+
+status_t AsyncFileSource::GetSize(off64_t* size) {
+  if (InitCheck() != OK) {
+    return NO_INIT;
+  }
+  if (!size) {
+    return BAD_VALUE;
+  }
+  *size = size_;
+  return OK;
+}
+
+status_t AsyncFileSource::Prefetch(
+    const std::vector<std::pair<off64_t, size_t>>& ranges) {
+  if (InitCheck() != OK) {
+    return NO_INIT;
+  }
+
+  std::vector<AsyncReadEngine::Request> requests;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (const auto& range : ranges) {
+      if (range.first < 0 || range.first >= size_ || range.second == 0) {
+        continue;
+      }
+      const off64_t end = std::min<off64_t>(
+          range.first + static_cast<off64_t>(range.second), size_);
+      CreateBlockRequestsLocked(range.first / kBlockSize,
+                                (end - 1) / kBlockSize, true, &requests);
+    }
+    while (prefetched_.size() > kMaxPrefetchedBlocks) {
+      auto it = blocks_.find(prefetched_.front());
+      if (it != blocks_.end() && it->second->prefetched) {
+        blocks_.erase(it);
+      }
+      prefetched_.pop_front();
+    }
+  }
+  // All ranges go out in one submission.
+  return SubmitBlockRequests(std::move(requests));
+}
+
+// Appends a read request for every block in [first_index, last_index] that is
+// neither cached nor in flight.
+void AsyncFileSource::CreateBlockRequestsLocked(
+    int64_t first_index,
+    int64_t last_index,
+    bool prefetch,
+    std::vector<AsyncReadEngine::Request>* requests) {
+  for (int64_t index = first_index; index <= last_index; ++index) {
+    if (index * kBlockSize >= size_) {
+      continue;
+    }
+    auto it = blocks_.find(index);
+    if (it != blocks_.end()) {
+      if (prefetch && !it->second->prefetched) {
+        it->second->prefetched = true;
+        prefetched_.push_back(index);
+      }
+      continue;
+    }
+    auto block = std::make_shared<Block>(index * kBlockSize);
+    block->prefetched = prefetch;
+    blocks_[index] = block;
+    if (prefetch) {
+      prefetched_.push_back(index);
+    }
+    ++pending_;
+
+    AsyncReadEngine::Request request;
+    request.fd = fd_;
+    request.offset = block->offset;
+    request.buffer = block->data.data();
+    request.size = block->data.size();
+    request.callback = [this, index, block](ssize_t result) {
+      std::lock_guard<std::mutex> lock(lock_);
+      block->valid = std::max<ssize_t>(result, 0);
+      block->ready = true;
+      if (result < 0) {
+        // Forget the block so later reads fall back to pread.
+        auto it = blocks_.find(index);
+        if (it != blocks_.end() && it->second == block) {
+          blocks_.erase(it);
+        }
+      }
+      --pending_;
+      cv_.notify_all();
+    };
+    requests->push_back(std::move(request));
+  }
+}
+
+// Must be called without lock_ held: the engine may wait for completions,
+// and completion callbacks take lock_. Blocks that fail to submit are
+// completed and forgotten by their callbacks.
+status_t AsyncFileSource::SubmitBlockRequests(
+    std::vector<AsyncReadEngine::Request> requests) {
+  if (requests.empty()) {
+    return OK;
+  }
+  status_t err = engine_->Submit(std::move(requests));
+  if (err != OK) {
+    AVE_LOG(LS_WARNING) << "AsyncFileSource: submit failed: " << err;
+  }
+  return err;
+}
+
+void AsyncFileSource::ScheduleReadAheadLocked(
+    off64_t offset,
+    size_t size,
+    std::vector<AsyncReadEngine::Request>* requests) {
+  const off64_t end = offset + static_cast<off64_t>(size);
+  // Interleaved tracks move forward in small jumps; treat anything within the
+  // read-ahead window as sequential and everything else as a seek.
+  const bool sequential =
+      last_read_end_ >= 0 && offset >= last_read_end_ - kBlockSize &&
+      offset <= last_read_end_ + kReadAheadBlocks * kBlockSize;
+  last_read_end_ = end;
+
+  const int64_t current = offset / kBlockSize;
+  // Drop read-ahead blocks behind the cursor, or all of them after a seek;
+  // blocks still in flight are kept alive by their callbacks and simply
+  // discarded when they complete. Prefetched blocks are left alone.
+  const auto stale_end =
+      sequential ? blocks_.lower_bound(current) : blocks_.end();
+  for (auto it = blocks_.begin(); it != stale_end;) {
+    it = it->second->prefetched ? std::next(it) : blocks_.erase(it);
+  }
+  if (!sequential) {
+    return;
+  }
+
+  CreateBlockRequestsLocked(current + 1, current + kReadAheadBlocks, false,
+                            requests);
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,92 @@
+/*
+ * async_file_source.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_FILE_SOURCE_H_
+#define AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_FILE_SOURCE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/data_source/data_source.h"
+#include "base/errors.h"
+#include "base/thread_annotation.h"
+#include "content_source/data_source/async_read_engine.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Local file DataSource whose I/O goes through a shared
+ * AsyncReadEngine.
+ *
+ * Reads block in ReadAt(); what goes through the engine asynchronously is
+ * the read-ahead: Prefetch() queues several ranges in one submission, and
+ * forward reads schedule the blocks after them, so a demuxer reading
+ * sequentially mostly finds its data in memory instead of blocking its
+ * looper in pread().
+ */
+class AsyncFileSource : public ave::DataSource {
+ public:
+  AsyncFileSource(const char* path, std::shared_ptr<AsyncReadEngine> engine);
+  // Waits for the outstanding read-ahead of this source.
+  ~AsyncFileSource() override;
+
+  status_t InitCheck() const override;
+  ssize_t ReadAt(off64_t offset, void* data, size_t size) override;
+  status_t GetSize(off64_t* size) override;
+  std::string GetUri() override { return uri_; }
+  int32_t Flags() override { return kSeekable; }
+
+  /**
+   * @brief Loads the given (offset, size) ranges into the read-ahead cache
+   * using a single batched submission. Prefetched blocks are not dropped by
+   * reads elsewhere in the file; the oldest go once more than a few
+   * megabytes are held.
+   */
+  status_t Prefetch(const std::vector<std::pair<off64_t, size_t>>& ranges);
+
+ private:
+  struct Block;
+
+  void CreateBlockRequestsLocked(
+      int64_t first_index,
+      int64_t last_index,
+      bool prefetch,
+      std::vector<AsyncReadEngine::Request>* requests) REQUIRES(lock_);
+  status_t SubmitBlockRequests(std::vector<AsyncReadEngine::Request> requests)
+      EXCLUDES(lock_);
+  void ScheduleReadAheadLocked(
+      off64_t offset,
+      size_t size,
+      std::vector<AsyncReadEngine::Request>* requests) REQUIRES(lock_);
+
+  const std::string uri_;
+  const std::shared_ptr<AsyncReadEngine> engine_;
+  int fd_ = -1;
+  int64_t size_ = -1;
+
+  std::mutex lock_;
+  std::condition_variable cv_;
+  // Read-ahead blocks keyed by block index.
+  std::map<int64_t, std::shared_ptr<Block>> blocks_ GUARDED_BY(lock_);
+  // Indices of the blocks loaded by Prefetch(), oldest first.
+  std::deque<int64_t> prefetched_ GUARDED_BY(lock_);
+  off64_t last_read_end_ GUARDED_BY(lock_) = -1;
+  int pending_ GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_FILE_SOURCE_H_
@@ -0,0 +1,192 @@
+/*
+ * async_file_source_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/async_file_source.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+constexpr size_t kBlockSize = 256 * 1024;
+
+// Runs every read on the submitting thread, so tests know when blocks are
+// loaded.
+class InlineEngine : public AsyncReadEngine {
+ public:
+  status_t Submit(std::vector<Request> requests) override {
+    for (auto& request : requests) {
+      ++reads;
+      const ssize_t result =
+          pread(request.fd, request.buffer, request.size, request.offset);
+      request.callback(result < 0 ? -errno : result);
+    }
+    return OK;
+  }
+
+  const char* name() const override { return "inline"; }
+
+  std::atomic<int> reads{0};
+};
+
+// Runs each submission on a thread of its own after a delay, so the reads
+// are still outstanding when the source goes away.
+class DelayedEngine : public AsyncReadEngine {
+ public:
+  ~DelayedEngine() override {
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  status_t Submit(std::vector<Request> requests) override {
+    submitted += static_cast<int>(requests.size());
+    threads_.emplace_back([this, requests = std::move(requests)]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      for (auto& request : requests) {
+        const ssize_t result =
+            pread(request.fd, request.buffer, request.size, request.offset);
+        ++completed;
+        request.callback(result < 0 ? -errno : result);
+      }
+    });
+    return OK;
+  }
+
+  const char* name() const override { return "delayed"; }
+
+  std::atomic<int> submitted{0};
+  std::atomic<int> completed{0};
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+class AsyncFileSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/async_file_source_test.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    path_ = path;
+
+    data_.resize(20 * kBlockSize + 321);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<uint8_t>(i * 31 + i / 4096);
+    }
+    ASSERT_EQ(write(fd, data_.data(), data_.size()),
+              static_cast<ssize_t>(data_.size()));
+    close(fd);
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  // Overwrites the file so reads served by pread no longer match data_.
+  void ScrambleFile() {
+    int fd = open(path_.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    std::vector<uint8_t> zeros(data_.size());
+    ASSERT_EQ(pwrite(fd, zeros.data(), zeros.size(), 0),
+              static_cast<ssize_t>(zeros.size()));
+    close(fd);
+  }
+
+  std::vector<uint8_t> Expected(size_t offset, size_t size) const {
+    return std::vector<uint8_t>(data_.begin() + offset,
+                                data_.begin() + offset + size);
+  }
+
+  std::string path_;
+  std::vector<uint8_t> data_;
+};
+
+TEST_F(AsyncFileSourceTest, ReadAtReturnsFileContents) {
+  AsyncFileSource source(path_.c_str(), AsyncReadEngine::CreateThreadPool(2));
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  // Sequential reads go through the read-ahead blocks.
+  std::vector<uint8_t> out(100 * 1024);
+  for (size_t offset = 0; offset + out.size() <= data_.size();
+       offset += out.size()) {
+    ASSERT_EQ(source.ReadAt(offset, out.data(), out.size()),
+              static_cast<ssize_t>(out.size()));
+    ASSERT_EQ(out, Expected(offset, out.size())) << "offset " << offset;
+  }
+}
+
+TEST_F(AsyncFileSourceTest, ShortReadAtEndOfFile) {
+  AsyncFileSource source(path_.c_str(), AsyncReadEngine::CreateThreadPool(2));
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  std::vector<uint8_t> out(1000);
+  ASSERT_EQ(source.ReadAt(data_.size() - 10, out.data(), out.size()), 10);
+  EXPECT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + 10),
+            Expected(data_.size() - 10, 10));
+  EXPECT_EQ(source.ReadAt(data_.size(), out.data(), out.size()), 0);
+}
+
+TEST_F(AsyncFileSourceTest, PrefetchedRangesAreServedFromMemory) {
+  auto engine = std::make_shared<InlineEngine>();
+  AsyncFileSource source(path_.c_str(), engine);
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  const size_t offset = 10 * kBlockSize + 500;
+  ASSERT_EQ(source.Prefetch({{offset, 1000}, {offset + 2 * kBlockSize, 10}}),
+            OK);
+  // Two blocks, one submission.
+  EXPECT_EQ(engine->reads, 2);
+
+  ScrambleFile();
+  std::vector<uint8_t> out(1000);
+  ASSERT_EQ(source.ReadAt(offset, out.data(), out.size()), 1000);
+  EXPECT_EQ(out, Expected(offset, 1000));
+  ASSERT_EQ(source.ReadAt(offset + 2 * kBlockSize, out.data(), 10), 10);
+  EXPECT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + 10),
+            Expected(offset + 2 * kBlockSize, 10));
+}
+
+TEST_F(AsyncFileSourceTest, PrefetchedBlocksSurviveReadsElsewhere) {
+  auto engine = std::make_shared<InlineEngine>();
+  AsyncFileSource source(path_.c_str(), engine);
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  ASSERT_EQ(source.Prefetch({{15 * kBlockSize, 64}}), OK);
+  // A read far away looks like a seek to the read-ahead.
+  std::vector<uint8_t> out(64);
+  ASSERT_EQ(source.ReadAt(0, out.data(), out.size()), 64);
+
+  ScrambleFile();
+  ASSERT_EQ(source.ReadAt(15 * kBlockSize, out.data(), out.size()), 64);
+  EXPECT_EQ(out, Expected(15 * kBlockSize, 64));
+}
+
+TEST_F(AsyncFileSourceTest, DestructionWaitsForOutstandingReadAhead) {
+  auto engine = std::make_shared<DelayedEngine>();
+  {
+    AsyncFileSource source(path_.c_str(), engine);
+    ASSERT_EQ(source.InitCheck(), OK);
+    ASSERT_EQ(source.Prefetch({{0, data_.size()}}), OK);
+    ASSERT_GT(engine->submitted, 0);
+  }
+  EXPECT_EQ(engine->completed, engine->submitted.load());
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,455 @@
+/*
+ * async_read_engine.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/async_read_engine.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/thread_annotation.h"
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define AVP_HAVE_IO_URING 1
+#else
+#define AVP_HAVE_IO_URING 0
+#endif
+
+namespace ave {
+namespace player {
+
+namespace {
+
+/****************************** ThreadPoolEngine ******************************/
+
+class ThreadPoolEngine : public AsyncReadEngine {
+ public:
+  explicit ThreadPoolEngine(size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+      workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+  }
+
+  ~ThreadPoolEngine() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  status_t Submit(std::vector<Request> requests) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!stopping_) {
+        for (auto& request : requests) {
+          queue_.push_back(std::move(request));
+        }
+        requests.clear();
+      }
+    }
+    if (!requests.empty()) {
+      for (auto& request : requests) {
+        request.callback(-ECANCELED);
+      }
+      return INVALID_OPERATION;
+    }
+    cv_.notify_all();
+    return OK;
+  }
+
+  const char* name() const override { return "threadpool"; }
+
+ private:
+  void WorkerLoop() {
+    while (true) {
+      Request request;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        request = std::move(queue_.front());
+        queue_.pop_front();
+      }
+
+      ssize_t result = 0;
+      do {
+        result = pread(request.fd, request.buffer, request.size,
+                       request.offset);
+      } while (result < 0 && errno == EINTR);
+      request.callback(result < 0 ? -errno : result);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ GUARDED_BY(mutex_) = false;
+  std::deque<Request> queue_ GUARDED_BY(mutex_);
+  std::vector<std::thread> workers_;
+};
+
+#if AVP_HAVE_IO_URING
+
+/******************************** IoUringEngine *******************************/
+
+int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd,
+                 unsigned to_submit,
+                 unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+// Talks to the kernel through the raw io_uring syscalls and ring mappings,
+// so no liburing dependency is needed. Requests are submitted as READV,
+// which is available since the first io_uring kernel (5.1).
+class IoUringEngine : public AsyncReadEngine {
+ public:
+  static std::unique_ptr<IoUringEngine> Create(unsigned entries) {
+    std::unique_ptr<IoUringEngine> engine(new IoUringEngine());
+    if (!engine->Init(entries)) {
+      return nullptr;
+    }
+    return engine;
+  }
+
+  ~IoUringEngine() override {
+    if (ring_fd_ < 0) {
+      return;
+    }
+    if (completion_thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(submit_lock_);
+        stopping_ = true;
+        // Wakes the completion thread; user_data 0 marks the wakeup.
+        io_uring_sqe* sqe = NextSqeLocked();
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_NOP;
+        FlushLocked(1);
+      }
+      completion_thread_.join();
+    }
+    Unmap();
+    close(ring_fd_);
+  }
+
+  status_t Submit(std::vector<Request> requests) override {
+    std::unique_lock<std::mutex> lock(submit_lock_);
+    if (stopping_) {
+      lock.unlock();
+      FailRequests(&requests, 0, -ECANCELED);
+      return INVALID_OPERATION;
+    }
+
+    size_t index = 0;
+    while (index < requests.size()) {
+      // Never have more reads in flight than the completion queue can hold.
+      space_cv_.wait(lock, [this]() { return inflight_ < cq_entries_; });
+
+      unsigned batch = 0;
+      while (index < requests.size() && batch < sq_entries_ &&
+             inflight_ < cq_entries_) {
+        auto* pending = new Pending{std::move(requests[index++]), {}};
+        pending->iov.iov_base = pending->request.buffer;
+        pending->iov.iov_len = pending->request.size;
+
+        io_uring_sqe* sqe = NextSqeLocked();
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = pending->request.fd;
+        sqe->off = static_cast<uint64_t>(pending->request.offset);
+        sqe->addr = reinterpret_cast<uint64_t>(&pending->iov);
+        sqe->len = 1;
+        sqe->user_data = reinterpret_cast<uint64_t>(pending);
+        ++batch;
+        ++inflight_;
+      }
+
+      unsigned submitted = 0;
+      const int error = FlushLocked(batch, &submitted);
+      if (error != 0) {
+        // The entries the kernel did not take will never complete: take
+        // them back and fail them along with the requests not queued yet.
+        std::vector<Pending*> withdrawn = WithdrawLocked(batch - submitted);
+        inflight_ -= static_cast<unsigned>(withdrawn.size());
+        lock.unlock();
+        space_cv_.notify_all();
+        for (Pending* pending : withdrawn) {
+          pending->request.callback(error);
+          delete pending;
+        }
+        FailRequests(&requests, index, error);
+        return UNKNOWN_ERROR;
+      }
+    }
+    return OK;
+  }
+
+  const char* name() const override { return "io_uring"; }
+
+ private:
+  struct Pending {
+    Request request;
+    struct iovec iov;
+  };
+
+  IoUringEngine() = default;
+
+  bool Init(unsigned entries) {
+    struct io_uring_params params {};
+    ring_fd_ = IoUringSetup(entries, &params);
+    if (ring_fd_ < 0) {
+      AVE_LOG(LS_INFO) << "io_uring unavailable: " << strerror(errno);
+      return false;
+    }
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes == MAP_FAILED) {
+      AVE_LOG(LS_WARNING) << "io_uring ring mmap failed";
+      if (sqes != MAP_FAILED) {
+        munmap(sqes, sqes_size_);
+      }
+      Unmap();
+      close(ring_fd_);
+      ring_fd_ = -1;
+      return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(sq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* cq = static_cast<uint8_t*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    // Keep one completion slot for the shutdown NOP.
+    cq_entries_ = params.cq_entries - 1;
+
+    completion_thread_ = std::thread([this]() { CompletionLoop(); });
+    AVE_LOG(LS_INFO) << "io_uring engine ready, sq=" << sq_entries_
+                     << " cq=" << params.cq_entries;
+    return true;
+  }
+
+  void Unmap() {
+    if (sq_ptr_ != nullptr && sq_ptr_ != MAP_FAILED) {
+      munmap(sq_ptr_, sq_size_);
+    }
+    if (cq_ptr_ != nullptr && cq_ptr_ != MAP_FAILED) {
+      munmap(cq_ptr_, cq_size_);
+    }
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    sq_ptr_ = cq_ptr_ = nullptr;
+    sqes_ = nullptr;
+  }
+
+  // The submission queue is drained by every FlushLocked(), and the kernel
+  // consumes all entries inside io_uring_enter() without SQPOLL (whatever it
+  // leaves is withdrawn), so slot |local tail| is always free here.
+  io_uring_sqe* NextSqeLocked() REQUIRES(submit_lock_) {
+    const unsigned index = local_sq_tail_ & sq_mask_;
+    sq_array_[index] = index;
+    ++local_sq_tail_;
+    return &sqes_[index];
+  }
+
+  // Hands the last |count| queued entries to the kernel. Returns 0, or
+  // -errno with |submitted| set to the number the kernel consumed.
+  int FlushLocked(unsigned count, unsigned* submitted = nullptr)
+      REQUIRES(submit_lock_) {
+    unsigned consumed = 0;
+    int error = 0;
+    if (count > 0) {
+      __atomic_store_n(sq_tail_, local_sq_tail_, __ATOMIC_RELEASE);
+    }
+    while (consumed < count) {
+      const int ret = IoUringEnter(ring_fd_, count - consumed, 0, 0);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        error = -errno;
+        AVE_LOG(LS_ERROR) << "io_uring_enter failed: " << strerror(errno);
+        break;
+      }
+      consumed += static_cast<unsigned>(ret);
+    }
+    if (submitted != nullptr) {
+      *submitted = consumed;
+    }
+    return error;
+  }
+
+  // Takes the last |count| entries back out of the submission queue. Safe
+  // because without SQPOLL the kernel only reads the queue inside
+  // io_uring_enter(), which is always called under submit_lock_.
+  std::vector<Pending*> WithdrawLocked(unsigned count)
+      REQUIRES(submit_lock_) {
+    std::vector<Pending*> withdrawn;
+    withdrawn.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+      --local_sq_tail_;
+      withdrawn.push_back(reinterpret_cast<Pending*>(
+          sqes_[local_sq_tail_ & sq_mask_].user_data));
+    }
+    __atomic_store_n(sq_tail_, local_sq_tail_, __ATOMIC_RELEASE);
+    return withdrawn;
+  }
+
+  static void FailRequests(std::vector<Request>* requests,
+                           size_t first,
+                           int error) {
+    for (size_t i = first; i < requests->size(); ++i) {
+      (*requests)[i].callback(error);
+    }
+  }
+
+  void CompletionLoop() {
+    std::vector<std::pair<Pending*, int32_t>> completed;
+    while (true) {
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      if (head == tail) {
+        {
+          std::lock_guard<std::mutex> lock(submit_lock_);
+          if (stopping_ && inflight_ == 0 && saw_wakeup_) {
+            return;
+          }
+        }
+        IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+        continue;
+      }
+
+      completed.clear();
+      for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        completed.emplace_back(reinterpret_cast<Pending*>(cqe.user_data),
+                               cqe.res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+      unsigned finished = 0;
+      for (auto& item : completed) {
+        if (item.first == nullptr) {
+          std::lock_guard<std::mutex> lock(submit_lock_);
+          saw_wakeup_ = true;
+          continue;
+        }
+        item.first->request.callback(item.second);
+        delete item.first;
+        ++finished;
+      }
+      if (finished > 0) {
+        {
+          std::lock_guard<std::mutex> lock(submit_lock_);
+          inflight_ -= finished;
+        }
+        space_cv_.notify_all();
+      }
+    }
+  }
+
+  int ring_fd_ = -1;
+
+  void* sq_ptr_ = nullptr;
+  size_t sq_size_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_entries_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  void* cq_ptr_ = nullptr;
+  size_t cq_size_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned cq_entries_ = 0;
+
+  std::mutex submit_lock_;
+  std::condition_variable space_cv_;
+  unsigned local_sq_tail_ GUARDED_BY(submit_lock_) = 0;
+  unsigned inflight_ GUARDED_BY(submit_lock_) = 0;
+  bool stopping_ GUARDED_BY(submit_lock_) = false;
+  bool saw_wakeup_ GUARDED_BY(submit_lock_) = false;
+  std::thread completion_thread_;
+};
+
+#endif  // AVP_HAVE_IO_URING
+
+}  // namespace
+
+std::shared_ptr<AsyncReadEngine> AsyncReadEngine::Create(
+    size_t queue_depth,
+    size_t fallback_threads) {
+  if (auto engine = CreateIoUring(queue_depth)) {
+    return engine;
+  }
+  AVE_LOG(LS_INFO) << "AsyncReadEngine: using " << fallback_threads
+                   << " thread pool workers";
+  return CreateThreadPool(fallback_threads);
+}
+
+std::shared_ptr<AsyncReadEngine> AsyncReadEngine::CreateIoUring(
+    size_t queue_depth) {
+#if AVP_HAVE_IO_URING
+  return IoUringEngine::Create(static_cast<unsigned>(queue_depth));
+#else
+  (void)queue_depth;
+  return nullptr;
+#endif
+}
+
+std::shared_ptr<AsyncReadEngine> AsyncReadEngine::CreateThreadPool(
+    size_t threads) {
+  return std::make_shared<ThreadPoolEngine>(threads);
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,75 @@
+/*
+ * async_read_engine.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_READ_ENGINE_H_
+#define AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_READ_ENGINE_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "base/errors.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Process-wide engine that performs positional file reads without
+ * blocking the caller.
+ *
+ * One engine is meant to be shared by every file source of a process, so the
+ * number of threads stays constant no matter how many streams are playing.
+ * The io_uring backend uses a single completion thread; where io_uring is not
+ * available a small pread() thread pool is used instead.
+ */
+class AsyncReadEngine {
+ public:
+  // Receives the number of bytes read, 0 at end of file, or -errno.
+  // Invoked on an engine thread, so it must not block.
+  using Callback = std::function<void(ssize_t result)>;
+
+  struct Request {
+    int fd = -1;
+    off64_t offset = 0;
+    void* buffer = nullptr;
+    size_t size = 0;
+    Callback callback;
+  };
+
+  /**
+   * @brief Creates the io_uring engine, or the thread pool engine when
+   * io_uring cannot be set up on this kernel.
+   * @param queue_depth Submission queue size of the io_uring backend.
+   * @param fallback_threads Worker count of the thread pool backend.
+   */
+  static std::shared_ptr<AsyncReadEngine> Create(size_t queue_depth = 256,
+                                                 size_t fallback_threads = 4);
+
+  // The io_uring engine, or nullptr when io_uring is not available.
+  static std::shared_ptr<AsyncReadEngine> CreateIoUring(size_t queue_depth);
+  static std::shared_ptr<AsyncReadEngine> CreateThreadPool(size_t threads);
+
+  virtual ~AsyncReadEngine() = default;
+
+  /**
+   * @brief Queues all |requests| with as few syscalls as the backend allows.
+   * Every callback is invoked exactly once whatever is returned: requests
+   * that cannot be queued are completed with a negative errno on the calling
+   * thread before Submit() returns an error.
+   */
+  virtual status_t Submit(std::vector<Request> requests) = 0;
+
+  virtual const char* name() const = 0;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_DATA_SOURCE_ASYNC_READ_ENGINE_H_
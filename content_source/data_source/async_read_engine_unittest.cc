@@ -0,0 +1,206 @@
+/*
+ * async_read_engine_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/async_read_engine.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+constexpr size_t kFileSize = 1024 * 1024 + 77;
+
+// Counts completions and lets the test wait for a number of them.
+class Completions {
+ public:
+  explicit Completions(size_t count) : results_(count), calls_(count) {}
+
+  AsyncReadEngine::Callback Callback(size_t index) {
+    return [this, index](ssize_t result) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      results_[index] = result;
+      ++calls_[index];
+      ++done_;
+      cv_.notify_all();
+    };
+  }
+
+  bool WaitAll() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(10),
+                        [this]() { return done_ >= results_.size(); });
+  }
+
+  ssize_t result(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return results_[index];
+  }
+
+  int calls(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return calls_[index];
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<ssize_t> results_;
+  std::vector<int> calls_;
+  size_t done_ = 0;
+};
+
+class AsyncReadEngineTest : public ::testing::TestWithParam<std::string> {
+ protected:
+  void SetUp() override {
+    engine_ = GetParam() == "io_uring"
+                  ? AsyncReadEngine::CreateIoUring(8)
+                  : AsyncReadEngine::CreateThreadPool(3);
+    if (!engine_) {
+      GTEST_SKIP() << "io_uring is not available";
+    }
+
+    char path[] = "/tmp/async_read_engine_test.XXXXXX";
+    fd_ = mkstemp(path);
+    ASSERT_GE(fd_, 0);
+    unlink(path);
+
+    data_.resize(kFileSize);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<uint8_t>(i * 13 + i / 256);
+    }
+    ASSERT_EQ(write(fd_, data_.data(), data_.size()),
+              static_cast<ssize_t>(data_.size()));
+  }
+
+  void TearDown() override {
+    engine_.reset();
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  AsyncReadEngine::Request MakeRequest(off64_t offset,
+                                       std::vector<uint8_t>* buffer,
+                                       AsyncReadEngine::Callback callback) {
+    AsyncReadEngine::Request request;
+    request.fd = fd_;
+    request.offset = offset;
+    request.buffer = buffer->data();
+    request.size = buffer->size();
+    request.callback = std::move(callback);
+    return request;
+  }
+
+  std::shared_ptr<AsyncReadEngine> engine_;
+  int fd_ = -1;
+  std::vector<uint8_t> data_;
+};
+
+TEST_P(AsyncReadEngineTest, CompletesEveryRequestWithItsOwnData) {
+  // More requests than the io_uring queue holds, so Submit() has to wait
+  // for completions in between batches.
+  constexpr size_t kCount = 40;
+  constexpr size_t kSize = 4096;
+  Completions completions(kCount);
+  std::vector<std::vector<uint8_t>> buffers(kCount,
+                                            std::vector<uint8_t>(kSize));
+  std::vector<AsyncReadEngine::Request> requests;
+  for (size_t i = 0; i < kCount; ++i) {
+    // Spread back and forth over the file; completion order is not
+    // specified, only that each callback reports its own request.
+    const off64_t offset = static_cast<off64_t>(((i * 7) % kCount) * 25000);
+    requests.push_back(
+        MakeRequest(offset, &buffers[i], completions.Callback(i)));
+  }
+  ASSERT_EQ(engine_->Submit(std::move(requests)), OK);
+  ASSERT_TRUE(completions.WaitAll());
+
+  for (size_t i = 0; i < kCount; ++i) {
+    const size_t offset = ((i * 7) % kCount) * 25000;
+    EXPECT_EQ(completions.calls(i), 1);
+    ASSERT_EQ(completions.result(i), static_cast<ssize_t>(kSize));
+    EXPECT_EQ(buffers[i], std::vector<uint8_t>(data_.begin() + offset,
+                                               data_.begin() + offset + kSize));
+  }
+}
+
+TEST_P(AsyncReadEngineTest, ShortReadAtEndOfFile) {
+  Completions completions(2);
+  std::vector<uint8_t> tail(1000);
+  std::vector<uint8_t> past_end(16);
+  std::vector<AsyncReadEngine::Request> requests;
+  requests.push_back(
+      MakeRequest(kFileSize - 100, &tail, completions.Callback(0)));
+  requests.push_back(
+      MakeRequest(kFileSize, &past_end, completions.Callback(1)));
+  ASSERT_EQ(engine_->Submit(std::move(requests)), OK);
+  ASSERT_TRUE(completions.WaitAll());
+
+  ASSERT_EQ(completions.result(0), 100);
+  EXPECT_EQ(std::vector<uint8_t>(tail.begin(), tail.begin() + 100),
+            std::vector<uint8_t>(data_.end() - 100, data_.end()));
+  EXPECT_EQ(completions.result(1), 0);
+}
+
+TEST_P(AsyncReadEngineTest, ReportsErrorsAsNegativeErrno) {
+  Completions completions(1);
+  std::vector<uint8_t> buffer(16);
+  auto request = MakeRequest(0, &buffer, completions.Callback(0));
+  request.fd = -1;
+  std::vector<AsyncReadEngine::Request> requests;
+  requests.push_back(std::move(request));
+  engine_->Submit(std::move(requests));
+  ASSERT_TRUE(completions.WaitAll());
+  EXPECT_EQ(completions.result(0), -EBADF);
+}
+
+TEST_P(AsyncReadEngineTest, ClosingCompletesRequestsInFlight) {
+  constexpr size_t kCount = 64;
+  Completions completions(kCount);
+  std::vector<std::vector<uint8_t>> buffers(kCount,
+                                            std::vector<uint8_t>(16 * 1024));
+  std::vector<AsyncReadEngine::Request> requests;
+  for (size_t i = 0; i < kCount; ++i) {
+    requests.push_back(
+        MakeRequest(i * 16 * 1024, &buffers[i], completions.Callback(i)));
+  }
+  engine_->Submit(std::move(requests));
+  // Destroying the engine waits for what is in flight: every callback has
+  // run exactly once by the time it returns.
+  engine_.reset();
+
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(completions.calls(i), 1) << "request " << i;
+    const ssize_t result = completions.result(i);
+    EXPECT_TRUE(result == 16 * 1024 || result == -ECANCELED)
+        << "request " << i << " result " << result;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends,
+                         AsyncReadEngineTest,
+                         ::testing::Values("io_uring", "threadpool"),
+                         [](const ::testing::TestParamInfo<std::string>& info) {
+                           return info.param;
+                         });
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,559 @@
+/*
+ * http_disk_cache.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/http_disk_cache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "base/logging.h"
+#include "media/foundation/media_errors.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+constexpr const char* kIndexSuffix = ".idx";
+constexpr const char* kDataSuffix = ".data";
+// Persist the range map after this many newly downloaded bytes so a crash
+// loses little of what was already fetched.
+constexpr int64_t kIndexSaveIntervalBytes = 4 * 1024 * 1024;
+// Gaps are filled with at least this many bytes per upstream request to
+// amortize the cost of a ranged HTTP request.
+constexpr size_t kMinFillSize = 256 * 1024;
+
+bool EndsWith(const std::string& value, const char* suffix) {
+  const size_t suffix_size = std::strlen(suffix);
+  return value.size() >= suffix_size &&
+         value.compare(value.size() - suffix_size, suffix_size, suffix) == 0;
+}
+
+// Returns the key recorded in the index file at |path|, or an empty string if
+// there is no readable index.
+std::string ReadIndexKey(const std::string& path) {
+  std::ifstream index(path);
+  std::string tag;
+  std::string key;
+  if (!(index >> tag) || tag != "key" || !std::getline(index >> std::ws, key)) {
+    return std::string();
+  }
+  return key;
+}
+
+}  // namespace
+
+/******************************* HttpDiskCache *******************************/
+
+HttpDiskCache::HttpDiskCache(std::string cache_dir, int64_t max_size_bytes)
+    : cache_dir_(std::move(cache_dir)), max_size_bytes_(max_size_bytes) {}
+
+HttpDiskCache::~HttpDiskCache() = default;
+
+status_t HttpDiskCache::Init() {
+  DIR* dir = opendir(cache_dir_.c_str());
+  if (dir == nullptr) {
+    AVE_LOG(LS_ERROR) << "HttpDiskCache: cannot open " << cache_dir_;
+    return NO_INIT;
+  }
+
+  std::vector<std::pair<int64_t, std::shared_ptr<Entry>>> found;
+  while (struct dirent* ent = readdir(dir)) {
+    const std::string name = ent->d_name;
+    if (!EndsWith(name, kIndexSuffix)) {
+      continue;
+    }
+    const std::string prefix =
+        cache_dir_ + "/" +
+        name.substr(0, name.size() - std::strlen(kIndexSuffix));
+
+    const std::string key = ReadIndexKey(prefix + kIndexSuffix);
+    if (key.empty()) {
+      continue;
+    }
+
+    auto entry = std::make_shared<Entry>(weak_from_this(), key, prefix);
+    {
+      std::lock_guard<std::mutex> lock(entry->lock_);
+      entry->LoadIndexLocked();
+    }
+
+    struct stat st {};
+    const int64_t mtime =
+        stat((prefix + kIndexSuffix).c_str(), &st) == 0 ? st.st_mtime : 0;
+    found.emplace_back(mtime, std::move(entry));
+  }
+  closedir(dir);
+
+  // Oldest first so that pushing to the front leaves the newest in front.
+  std::sort(found.begin(), found.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& item : found) {
+    const std::string& key = item.second->key();
+    if (entries_.count(key) != 0) {
+      continue;
+    }
+    total_bytes_ += item.second->cached_bytes();
+    lru_.push_front(key);
+    paths_.insert(item.second->path_prefix());
+    entries_[key] = std::move(item.second);
+  }
+  AVE_LOG(LS_INFO) << "HttpDiskCache: loaded " << entries_.size()
+                   << " entries, " << total_bytes_ << " bytes";
+  EvictLocked();
+  return OK;
+}
+
+std::shared_ptr<HttpDiskCache::Entry> HttpDiskCache::OpenEntry(
+    const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    auto entry =
+        std::make_shared<Entry>(weak_from_this(), key, PathForKeyLocked(key));
+    paths_.insert(entry->path_prefix());
+    {
+      std::lock_guard<std::mutex> entry_lock(entry->lock_);
+      entry->LoadIndexLocked();
+    }
+    total_bytes_ += entry->cached_bytes();
+    lru_.push_front(key);
+    it = entries_.emplace(key, std::move(entry)).first;
+  }
+  TouchLocked(key);
+  return it->second;
+}
+
+int64_t HttpDiskCache::total_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_bytes_;
+}
+
+// Names files after the hash of |key|. On a collision with another key, either
+// open or recorded in an index on disk, a numeric suffix is appended until a
+// free name is found.
+std::string HttpDiskCache::PathForKeyLocked(const std::string& key) const {
+  const size_t hash = std::hash<std::string>()(key);
+  for (unsigned attempt = 0;; ++attempt) {
+    char name[48];
+    if (attempt == 0) {
+      snprintf(name, sizeof(name), "%016zx", hash);
+    } else {
+      snprintf(name, sizeof(name), "%016zx-%u", hash, attempt);
+    }
+    std::string prefix = cache_dir_ + "/" + name;
+    if (paths_.count(prefix) != 0) {
+      continue;
+    }
+    const std::string owner = ReadIndexKey(prefix + kIndexSuffix);
+    if (owner.empty() || owner == key) {
+      return prefix;
+    }
+  }
+}
+
+void HttpDiskCache::OnEntryGrew(Entry* entry, int64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  total_bytes_ += bytes;
+  TouchLocked(entry->key());
+  EvictLocked();
+}
+
+void HttpDiskCache::TouchLocked(const std::string& key) {
+  auto it = std::find(lru_.begin(), lru_.end(), key);
+  if (it != lru_.end() && it != lru_.begin()) {
+    lru_.splice(lru_.begin(), lru_, it);
+  }
+}
+
+void HttpDiskCache::EvictLocked() {
+  auto it = lru_.end();
+  while (total_bytes_ > max_size_bytes_ && it != lru_.begin()) {
+    --it;
+    auto entry_it = entries_.find(*it);
+    if (entry_it == entries_.end()) {
+      it = lru_.erase(it);
+      continue;
+    }
+    // Entries referenced outside the map are being played; keep them.
+    if (entry_it->second.use_count() > 1) {
+      continue;
+    }
+    AVE_LOG(LS_INFO) << "HttpDiskCache: evicting " << *it << " ("
+                     << entry_it->second->cached_bytes() << " bytes)";
+    total_bytes_ -= entry_it->second->cached_bytes();
+    paths_.erase(entry_it->second->path_prefix());
+    entry_it->second->RemoveFiles();
+    entries_.erase(entry_it);
+    it = lru_.erase(it);
+  }
+}
+
+/**************************** HttpDiskCache::Entry ****************************/
+
+HttpDiskCache::Entry::Entry(std::weak_ptr<HttpDiskCache> cache,
+                            std::string key,
+                            std::string path_prefix)
+    : cache_(std::move(cache)),
+      key_(std::move(key)),
+      path_prefix_(std::move(path_prefix)),
+      data_path_(path_prefix_ + kDataSuffix),
+      index_path_(path_prefix_ + kIndexSuffix) {}
+
+HttpDiskCache::Entry::~Entry() {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (unsaved_bytes_ > 0) {
+    SaveIndexLocked();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+ssize_t HttpDiskCache::Entry::ReadCached(off64_t offset,
+                                         void* data,
+                                         size_t size) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = extents_.upper_bound(offset);
+  if (it == extents_.begin()) {
+    return 0;
+  }
+  --it;
+  if (it->second <= offset) {
+    return 0;
+  }
+
+  if (OpenLocked() != OK) {
+    return media::ERROR_IO;
+  }
+
+  const size_t available = static_cast<size_t>(it->second - offset);
+  const size_t to_read = std::min(size, available);
+  size_t done = 0;
+  while (done < to_read) {
+    const ssize_t n = pread(fd_, static_cast<uint8_t*>(data) + done,
+                            to_read - done, offset + done);
+    if (n <= 0) {
+      break;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return done > 0 ? static_cast<ssize_t>(done)
+                  : static_cast<ssize_t>(media::ERROR_IO);
+}
+
+status_t HttpDiskCache::Entry::Write(off64_t offset,
+                                     const void* data,
+                                     size_t size) {
+  int64_t added = 0;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (OpenLocked() != OK) {
+      return media::ERROR_IO;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+      const ssize_t n = pwrite(fd_, static_cast<const uint8_t*>(data) + done,
+                               size - done, offset + done);
+      if (n <= 0) {
+        AVE_LOG(LS_WARNING) << "HttpDiskCache: write failed: "
+                            << strerror(errno);
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    if (done == 0) {
+      return media::ERROR_IO;
+    }
+
+    added = AddExtentLocked(offset, offset + static_cast<off64_t>(done));
+    unsaved_bytes_ += added;
+    if (unsaved_bytes_ >= kIndexSaveIntervalBytes) {
+      SaveIndexLocked();
+    }
+  }
+
+  if (added > 0) {
+    if (auto cache = cache_.lock()) {
+      cache->OnEntryGrew(this, added);
+    }
+  }
+  return OK;
+}
+
+off64_t HttpDiskCache::Entry::NextCachedOffset(off64_t offset) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = extents_.upper_bound(offset);
+  return it == extents_.end() ? -1 : it->first;
+}
+
+bool HttpDiskCache::Entry::IsComplete() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return content_length_ > 0 && extents_.size() == 1 &&
+         extents_.begin()->first == 0 &&
+         extents_.begin()->second >= content_length_;
+}
+
+int64_t HttpDiskCache::Entry::content_length() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return content_length_;
+}
+
+void HttpDiskCache::Entry::SetContentLength(int64_t length) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (content_length_ != length) {
+    content_length_ = length;
+    SaveIndexLocked();
+  }
+}
+
+int64_t HttpDiskCache::Entry::cached_bytes() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return cached_bytes_;
+}
+
+status_t HttpDiskCache::Entry::OpenLocked() {
+  if (fd_ >= 0) {
+    return OK;
+  }
+  fd_ = open(data_path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd_ < 0) {
+    AVE_LOG(LS_ERROR) << "HttpDiskCache: cannot open " << data_path_ << ": "
+                      << strerror(errno);
+    return media::ERROR_IO;
+  }
+  return OK;
+}
+
+void HttpDiskCache::Entry::LoadIndexLocked() {
+  std::ifstream index(index_path_);
+  if (!index) {
+    return;
+  }
+
+  std::string tag;
+  std::string key;
+  if (!(index >> tag) || tag != "key" ||
+      !std::getline(index >> std::ws, key) || key != key_) {
+    // Missing or colliding index; start from scratch.
+    return;
+  }
+
+  int64_t length = -1;
+  if (!(index >> tag) || tag != "length" || !(index >> length)) {
+    return;
+  }
+  content_length_ = length;
+
+  off64_t start = 0;
+  off64_t end = 0;
+  while (index >> start >> end) {
+    if (start >= 0 && end > start) {
+      AddExtentLocked(start, end);
+    }
+  }
+}
+
+void HttpDiskCache::Entry::SaveIndexLocked() {
+  const std::string tmp_path = index_path_ + ".tmp";
+  {
+    std::ofstream index(tmp_path, std::ios::trunc);
+    if (!index) {
+      return;
+    }
+    index << "key " << key_ << "\n";
+    index << "length " << content_length_ << "\n";
+    for (const auto& extent : extents_) {
+      index << extent.first << " " << extent.second << "\n";
+    }
+  }
+  rename(tmp_path.c_str(), index_path_.c_str());
+  unsaved_bytes_ = 0;
+}
+
+void HttpDiskCache::Entry::RemoveFiles() {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  unlink(data_path_.c_str());
+  unlink(index_path_.c_str());
+  extents_.clear();
+  cached_bytes_ = 0;
+  unsaved_bytes_ = 0;
+}
+
+int64_t HttpDiskCache::Entry::AddExtentLocked(off64_t start, off64_t end) {
+  auto it = extents_.upper_bound(start);
+  if (it != extents_.begin() && std::prev(it)->second >= start) {
+    --it;
+  }
+
+  off64_t merged_start = start;
+  off64_t merged_end = end;
+  int64_t merged_bytes = 0;
+  while (it != extents_.end() && it->first <= merged_end) {
+    merged_start = std::min(merged_start, it->first);
+    merged_end = std::max(merged_end, it->second);
+    merged_bytes += it->second - it->first;
+    it = extents_.erase(it);
+  }
+  extents_[merged_start] = merged_end;
+
+  const int64_t added = (merged_end - merged_start) - merged_bytes;
+  cached_bytes_ += added;
+  return added;
+}
+
+/***************************** CachingHttpSource *****************************/
+
+CachingHttpSource::CachingHttpSource(
+    std::string uri,
+    std::shared_ptr<HttpDiskCache::Entry> entry,
+    UpstreamFactory upstream_factory)
+    : uri_(std::move(uri)),
+      entry_(std::move(entry)),
+      upstream_factory_(std::move(upstream_factory)) {}
+
+CachingHttpSource::~CachingHttpSource() = default;
+
+status_t CachingHttpSource::InitCheck() const {
+  return entry_ && upstream_factory_ ? OK : NO_INIT;
+}
+
+ssize_t CachingHttpSource::ReadAt(off64_t offset, void* data, size_t size) {
+  if (offset < 0 || data == nullptr) {
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  const int64_t length = entry_->content_length();
+  if (length >= 0) {
+    if (offset >= length) {
+      return 0;
+    }
+    size = std::min<size_t>(size, static_cast<size_t>(length - offset));
+  }
+
+  uint8_t* out = static_cast<uint8_t*>(data);
+  size_t total = 0;
+  while (total < size) {
+    const off64_t pos = offset + static_cast<off64_t>(total);
+    ssize_t n = entry_->ReadCached(pos, out + total, size - total);
+    if (n == 0) {
+      n = FillGapLocked(pos, size - total);
+      if (n > 0) {
+        std::memcpy(out + total, fill_buffer_.data(), static_cast<size_t>(n));
+      }
+    }
+    if (n <= 0) {
+      return total > 0 ? static_cast<ssize_t>(total) : n;
+    }
+    total += static_cast<size_t>(n);
+  }
+  return static_cast<ssize_t>(total);
+}
+
+status_t CachingHttpSource::GetSize(off64_t* size) {
+  if (!size) {
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  int64_t length = entry_->content_length();
+  if (length < 0) {
+    auto upstream = EnsureUpstreamLocked();
+    if (!upstream) {
+      return media::ERROR_IO;
+    }
+    off64_t upstream_size = -1;
+    status_t err = upstream->GetSize(&upstream_size);
+    if (err != OK) {
+      return err;
+    }
+    length = upstream_size;
+    entry_->SetContentLength(length);
+  }
+  *size = static_cast<off64_t>(length);
+  return OK;
+}
+
+std::shared_ptr<ave::DataSource> CachingHttpSource::EnsureUpstreamLocked() {
+  if (!upstream_ && !upstream_failed_) {
+    AVE_LOG(LS_INFO) << "CachingHttpSource: connecting upstream for " << uri_;
+    upstream_ = upstream_factory_();
+    upstream_failed_ = upstream_ == nullptr;
+  }
+  return upstream_;
+}
+
+// Downloads the gap starting at |offset| into fill_buffer_, stores it in the
+// cache and returns how many of the |size| requested bytes are available.
+ssize_t CachingHttpSource::FillGapLocked(off64_t offset, size_t size) {
+  size_t fill_size = std::max(size, kMinFillSize);
+  const off64_t gap_end = entry_->NextCachedOffset(offset);
+  if (gap_end > offset) {
+    fill_size = std::min(fill_size, static_cast<size_t>(gap_end - offset));
+  }
+  const int64_t length = entry_->content_length();
+  if (length >= 0) {
+    fill_size = std::min(fill_size, static_cast<size_t>(length - offset));
+  }
+
+  auto upstream = EnsureUpstreamLocked();
+  if (!upstream) {
+    return media::ERROR_IO;
+  }
+
+  fill_buffer_.resize(fill_size);
+  size_t got = 0;
+  bool reached_eos = false;
+  while (got < fill_size) {
+    const ssize_t n = upstream->ReadAt(offset + static_cast<off64_t>(got),
+                                       fill_buffer_.data() + got,
+                                       fill_size - got);
+    if (n < 0) {
+      if (got == 0) {
+        return n;
+      }
+      break;
+    }
+    if (n == 0) {
+      reached_eos = true;
+      break;
+    }
+    got += static_cast<size_t>(n);
+  }
+
+  if (got > 0 && entry_->Write(offset, fill_buffer_.data(), got) != OK) {
+    AVE_LOG(LS_WARNING) << "CachingHttpSource: failed to cache " << got
+                        << " bytes at " << offset;
+  }
+  if (reached_eos && length < 0) {
+    entry_->SetContentLength(offset + static_cast<off64_t>(got));
+  }
+
+  return static_cast<ssize_t>(std::min(got, size));
+}
+
+}  // namespace player
+}  // namespace ave
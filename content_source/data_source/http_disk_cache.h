@@ -0,0 +1,194 @@
+/*
+ * http_disk_cache.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_DATA_SOURCE_HTTP_DISK_CACHE_H_
+#define AVP_CONTENT_SOURCE_DATA_SOURCE_HTTP_DISK_CACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/data_source/data_source.h"
+#include "base/errors.h"
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief On-disk sparse cache for progressive HTTP resources.
+ *
+ * Every cached resource is stored as a sparse file plus a small index that
+ * records which byte extents have been downloaded. The total amount of cached
+ * data is capped; when the cap is exceeded whole resources are evicted in
+ * least-recently-used order. Resources that are currently open are never
+ * evicted. File names are derived from a hash of the key; the key itself is
+ * stored in the index and checked on open, so colliding keys get distinct
+ * files.
+ */
+class HttpDiskCache : public std::enable_shared_from_this<HttpDiskCache> {
+ public:
+  class Entry;
+
+  /**
+   * @param cache_dir Directory holding the cache files. Must exist.
+   * @param max_size_bytes Upper bound of downloaded bytes kept on disk.
+   */
+  HttpDiskCache(std::string cache_dir, int64_t max_size_bytes);
+  ~HttpDiskCache();
+
+  /**
+   * @brief Loads the index files already present in the cache directory so
+   * that data downloaded by a previous process can be reused.
+   */
+  status_t Init() EXCLUDES(mutex_);
+
+  /**
+   * @brief Opens the cache entry for |key| (usually the resource url),
+   * creating it when needed.
+   */
+  std::shared_ptr<Entry> OpenEntry(const std::string& key) EXCLUDES(mutex_);
+
+  int64_t total_bytes() const EXCLUDES(mutex_);
+  int64_t max_size_bytes() const { return max_size_bytes_; }
+
+ private:
+  friend class Entry;
+
+  std::string PathForKeyLocked(const std::string& key) const REQUIRES(mutex_);
+  void OnEntryGrew(Entry* entry, int64_t bytes) EXCLUDES(mutex_);
+  void TouchLocked(const std::string& key) REQUIRES(mutex_);
+  void EvictLocked() REQUIRES(mutex_);
+
+  const std::string cache_dir_;
+  const int64_t max_size_bytes_;
+
+  mutable std::mutex mutex_;
+  int64_t total_bytes_ GUARDED_BY(mutex_) = 0;
+  std::unordered_map<std::string, std::shared_ptr<Entry>> entries_
+      GUARDED_BY(mutex_);
+  // Path prefixes owned by the entries in |entries_|.
+  std::unordered_set<std::string> paths_ GUARDED_BY(mutex_);
+  // Most recently used key at the front.
+  std::list<std::string> lru_ GUARDED_BY(mutex_);
+};
+
+/**
+ * @brief A single cached resource: a sparse data file plus its range map.
+ */
+class HttpDiskCache::Entry {
+ public:
+  Entry(std::weak_ptr<HttpDiskCache> cache,
+        std::string key,
+        std::string path_prefix);
+  ~Entry();
+
+  const std::string& key() const { return key_; }
+  const std::string& path_prefix() const { return path_prefix_; }
+
+  /**
+   * @brief Reads cached bytes starting at |offset|.
+   * @return Number of contiguous bytes copied, 0 if |offset| is not cached, or
+   * a negative error code.
+   */
+  ssize_t ReadCached(off64_t offset, void* data, size_t size) EXCLUDES(lock_);
+
+  /**
+   * @brief Stores downloaded bytes and merges them into the range map.
+   */
+  status_t Write(off64_t offset, const void* data, size_t size)
+      EXCLUDES(lock_);
+
+  /**
+   * @brief Returns the start of the first cached extent after |offset|, or -1
+   * if there is none.
+   */
+  off64_t NextCachedOffset(off64_t offset) const EXCLUDES(lock_);
+
+  /**
+   * @brief Returns true when every byte of the resource has been downloaded.
+   */
+  bool IsComplete() const EXCLUDES(lock_);
+
+  int64_t content_length() const EXCLUDES(lock_);
+  void SetContentLength(int64_t length) EXCLUDES(lock_);
+  int64_t cached_bytes() const EXCLUDES(lock_);
+
+ private:
+  friend class HttpDiskCache;
+
+  status_t OpenLocked() REQUIRES(lock_);
+  void LoadIndexLocked() REQUIRES(lock_);
+  void SaveIndexLocked() REQUIRES(lock_);
+  void RemoveFiles() EXCLUDES(lock_);
+  int64_t AddExtentLocked(off64_t start, off64_t end) REQUIRES(lock_);
+
+  const std::weak_ptr<HttpDiskCache> cache_;
+  const std::string key_;
+  const std::string path_prefix_;
+  const std::string data_path_;
+  const std::string index_path_;
+
+  mutable std::mutex lock_;
+  int fd_ GUARDED_BY(lock_) = -1;
+  int64_t content_length_ GUARDED_BY(lock_) = -1;
+  int64_t cached_bytes_ GUARDED_BY(lock_) = 0;
+  int64_t unsaved_bytes_ GUARDED_BY(lock_) = 0;
+  // Downloaded extents as [start, end), keyed by start, never overlapping.
+  std::map<off64_t, off64_t> extents_ GUARDED_BY(lock_);
+};
+
+/**
+ * @brief DataSource that serves reads from an HttpDiskCache entry and only
+ * touches the network to fill gaps. The upstream source is opened lazily, so a
+ * fully cached resource is played back without any network traffic.
+ *
+ * Cached bytes are never revalidated against the server: net::HTTPConnection
+ * does not expose response headers, so there are no ETag or Last-Modified
+ * values to compare. A resource replaced on the server keeps being served
+ * from the cache until its entry is evicted.
+ */
+class CachingHttpSource : public ave::DataSource {
+ public:
+  using UpstreamFactory = std::function<std::shared_ptr<ave::DataSource>()>;
+
+  CachingHttpSource(std::string uri,
+                    std::shared_ptr<HttpDiskCache::Entry> entry,
+                    UpstreamFactory upstream_factory);
+  ~CachingHttpSource() override;
+
+  status_t InitCheck() const override;
+  ssize_t ReadAt(off64_t offset, void* data, size_t size) override;
+  status_t GetSize(off64_t* size) override;
+  std::string GetUri() override { return uri_; }
+  int32_t Flags() override { return kSeekable; }
+
+ private:
+  std::shared_ptr<ave::DataSource> EnsureUpstreamLocked() REQUIRES(lock_);
+  ssize_t FillGapLocked(off64_t offset, size_t size) REQUIRES(lock_);
+
+  const std::string uri_;
+  const std::shared_ptr<HttpDiskCache::Entry> entry_;
+  UpstreamFactory upstream_factory_;
+
+  std::mutex lock_;
+  std::shared_ptr<ave::DataSource> upstream_ GUARDED_BY(lock_);
+  bool upstream_failed_ GUARDED_BY(lock_) = false;
+  std::vector<uint8_t> fill_buffer_ GUARDED_BY(lock_);
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_DATA_SOURCE_HTTP_DISK_CACHE_H_
@@ -0,0 +1,183 @@
+/*
+ * http_disk_cache_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/http_disk_cache.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+class HttpDiskCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/http_disk_cache_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+  }
+
+  void TearDown() override {
+    if (DIR* dir = opendir(dir_.c_str())) {
+      while (struct dirent* ent = readdir(dir)) {
+        const std::string name = ent->d_name;
+        if (name != "." && name != "..") {
+          unlink((dir_ + "/" + name).c_str());
+        }
+      }
+      closedir(dir);
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::shared_ptr<HttpDiskCache> NewCache(int64_t max_size_bytes) {
+    auto cache = std::make_shared<HttpDiskCache>(dir_, max_size_bytes);
+    EXPECT_EQ(cache->Init(), OK);
+    return cache;
+  }
+
+  static void Fill(HttpDiskCache::Entry* entry, off64_t start, size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<uint8_t>(start + i);
+    }
+    ASSERT_EQ(entry->Write(start, data.data(), size), OK);
+  }
+
+  std::string dir_;
+};
+
+TEST_F(HttpDiskCacheTest, MergesExtents) {
+  auto cache = NewCache(1 << 20);
+  auto entry = cache->OpenEntry("http://example.com/a.mp4");
+
+  Fill(entry.get(), 0, 10);
+  Fill(entry.get(), 20, 10);
+  EXPECT_EQ(entry->cached_bytes(), 20);
+  EXPECT_EQ(entry->NextCachedOffset(10), 20);
+  EXPECT_EQ(entry->NextCachedOffset(25), -1);
+
+  uint8_t buffer[32];
+  EXPECT_EQ(entry->ReadCached(12, buffer, sizeof(buffer)), 0);
+  EXPECT_EQ(entry->ReadCached(5, buffer, sizeof(buffer)), 5);
+  EXPECT_EQ(buffer[0], 5);
+
+  // Overlapping write that bridges the gap only counts the new bytes.
+  Fill(entry.get(), 5, 20);
+  EXPECT_EQ(entry->cached_bytes(), 30);
+  EXPECT_EQ(cache->total_bytes(), 30);
+  EXPECT_EQ(entry->ReadCached(0, buffer, sizeof(buffer)), 30);
+  for (int i = 0; i < 30; ++i) {
+    EXPECT_EQ(buffer[i], i);
+  }
+
+  EXPECT_FALSE(entry->IsComplete());
+  entry->SetContentLength(30);
+  EXPECT_TRUE(entry->IsComplete());
+}
+
+TEST_F(HttpDiskCacheTest, EvictsLeastRecentlyUsed) {
+  auto cache = NewCache(100);
+  {
+    auto a = cache->OpenEntry("a");
+    Fill(a.get(), 0, 40);
+  }
+  {
+    auto b = cache->OpenEntry("b");
+    Fill(b.get(), 0, 40);
+  }
+  // Touch "a" so that "b" becomes the oldest entry.
+  cache->OpenEntry("a");
+  {
+    auto c = cache->OpenEntry("c");
+    Fill(c.get(), 0, 40);
+  }
+
+  EXPECT_EQ(cache->total_bytes(), 80);
+  EXPECT_EQ(cache->OpenEntry("a")->cached_bytes(), 40);
+  EXPECT_EQ(cache->OpenEntry("c")->cached_bytes(), 40);
+  EXPECT_EQ(cache->OpenEntry("b")->cached_bytes(), 0);
+}
+
+TEST_F(HttpDiskCacheTest, KeepsEntriesInUse) {
+  auto cache = NewCache(50);
+  auto a = cache->OpenEntry("a");
+  Fill(a.get(), 0, 40);
+  {
+    auto b = cache->OpenEntry("b");
+    Fill(b.get(), 0, 40);
+  }
+
+  // "a" is older but still open, so the cache runs over its limit instead.
+  EXPECT_EQ(a->cached_bytes(), 40);
+  EXPECT_EQ(cache->total_bytes(), 80);
+}
+
+TEST_F(HttpDiskCacheTest, PersistsIndexAcrossInit) {
+  {
+    auto cache = NewCache(1 << 20);
+    auto entry = cache->OpenEntry("http://example.com/a.mp4");
+    Fill(entry.get(), 0, 16);
+    Fill(entry.get(), 64, 16);
+    entry->SetContentLength(128);
+  }
+
+  auto cache = NewCache(1 << 20);
+  EXPECT_EQ(cache->total_bytes(), 32);
+  auto entry = cache->OpenEntry("http://example.com/a.mp4");
+  EXPECT_EQ(entry->content_length(), 128);
+  EXPECT_EQ(entry->cached_bytes(), 32);
+  EXPECT_EQ(entry->NextCachedOffset(16), 64);
+
+  uint8_t buffer[16];
+  ASSERT_EQ(entry->ReadCached(64, buffer, sizeof(buffer)), 16);
+  EXPECT_EQ(buffer[0], 64);
+}
+
+TEST_F(HttpDiskCacheTest, CollidingFileNameGetsOwnFiles) {
+  const std::string key = "http://example.com/a.mp4";
+  char name[32];
+  snprintf(name, sizeof(name), "%016zx", std::hash<std::string>()(key));
+  const std::string foreign_prefix = dir_ + "/" + name;
+  {
+    std::ofstream index(foreign_prefix + ".idx");
+    index << "key http://example.com/other.mp4\n"
+          << "length 4\n0 4\n";
+    std::ofstream data(foreign_prefix + ".data");
+    data << "abcd";
+  }
+
+  {
+    auto cache = NewCache(1 << 20);
+    auto entry = cache->OpenEntry(key);
+    EXPECT_EQ(entry->cached_bytes(), 0);
+    EXPECT_NE(entry->path_prefix(), foreign_prefix);
+    Fill(entry.get(), 0, 8);
+  }
+
+  auto cache = NewCache(1 << 20);
+  uint8_t buffer[8];
+  auto other = cache->OpenEntry("http://example.com/other.mp4");
+  ASSERT_EQ(other->ReadCached(0, buffer, sizeof(buffer)), 4);
+  EXPECT_EQ(buffer[0], 'a');
+  auto entry = cache->OpenEntry(key);
+  ASSERT_EQ(entry->ReadCached(0, buffer, sizeof(buffer)), 8);
+  EXPECT_EQ(buffer[7], 7);
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,179 @@
+/*
+ * mmap_data_source.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/mmap_data_source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+// How far ahead of the read cursor the kernel is asked to prefetch.
+constexpr int64_t kReadAheadBytes = 2 * 1024 * 1024;
+
+}  // namespace
+
+struct MmapDataSource::Mapping {
+  Mapping(void* addr, size_t length) : addr(addr), length(length) {}
+  ~Mapping() { munmap(addr, length); }
+
+  void* const addr;
+  const size_t length;
+  // Distance between the page aligned mapping start and the requested offset.
+  size_t page_delta = 0;
+};
+
+MmapDataSource::MmapDataSource(const char* path) : uri_(path ? path : "") {
+  int fd = open(uri_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    AVE_LOG(LS_ERROR) << "MmapDataSource: cannot open " << uri_ << ": "
+                      << strerror(errno);
+    return;
+  }
+  MapFd(fd, 0, -1);
+}
+
+MmapDataSource::MmapDataSource(int fd, int64_t offset, int64_t length) {
+  if (fd < 0) {
+    return;
+  }
+  MapFd(fd, offset, length);
+}
+
+MmapDataSource::~MmapDataSource() = default;
+
+void MmapDataSource::MapFd(int fd, int64_t offset, int64_t length) {
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || offset < 0 ||
+      offset >= st.st_size) {
+    close(fd);
+    return;
+  }
+
+  const int64_t available = st.st_size - offset;
+  const int64_t size =
+      length < 0 ? available : std::min<int64_t>(length, available);
+  if (size <= 0) {
+    close(fd);
+    return;
+  }
+
+  const int64_t page_size = sysconf(_SC_PAGESIZE);
+  const int64_t aligned_offset = offset - offset % page_size;
+  const size_t map_length = static_cast<size_t>(size + offset - aligned_offset);
+
+  void* addr = mmap(nullptr, map_length, PROT_READ, MAP_SHARED, fd,
+                    static_cast<off_t>(aligned_offset));
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (addr == MAP_FAILED) {
+    AVE_LOG(LS_WARNING) << "MmapDataSource: mmap failed: " << strerror(errno);
+    return;
+  }
+
+  madvise(addr, map_length, MADV_SEQUENTIAL);
+
+  mapping_ = std::make_shared<Mapping>(addr, map_length);
+  mapping_->page_delta = static_cast<size_t>(offset - aligned_offset);
+  data_ = static_cast<const uint8_t*>(addr) + mapping_->page_delta;
+  size_ = size;
+
+  std::lock_guard<std::mutex> lock(advice_lock_);
+  AdviseLocked(0, 0);
+}
+
+status_t MmapDataSource::InitCheck() const {
+  return mapping_ ? OK : NO_INIT;
+}
+
+ssize_t MmapDataSource::ReadAt(off64_t offset, void* data, size_t size) {
+  if (!mapping_) {
+    return NO_INIT;
+  }
+  if (offset < 0 || data == nullptr) {
+    return BAD_VALUE;
+  }
+  if (offset >= size_) {
+    return 0;
+  }
+
+  const size_t to_copy =
+      std::min<size_t>(size, static_cast<size_t>(size_ - offset));
+  {
+    std::lock_guard<std::mutex> lock(advice_lock_);
+    AdviseLocked(offset, to_copy);
+  }
+  std::memcpy(data, data_ + offset, to_copy);
+  return static_cast<ssize_t>(to_copy);
+}
+
+std::shared_ptr<const uint8_t> MmapDataSource::GetView(off64_t offset,
+                                                      size_t size) {
+  if (!mapping_ || offset < 0 || offset > size_ ||
+      size > static_cast<size_t>(size_ - offset)) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(advice_lock_);
+    AdviseLocked(offset, size);
+  }
+  // Aliases the mapping so the view keeps it alive.
+  return std::shared_ptr<const uint8_t>(mapping_, data_ + offset);
+}
+
+status_t MmapDataSource::GetSize(off64_t* size) {
+  if (!mapping_) {
+    return NO_INIT;
+  }
+  if (!size) {
+    return BAD_VALUE;
+  }
+  *size = size_;
+  return OK;
+}
+
+// Keeps a read-ahead window in front of the cursor. The window is only moved
+// once the cursor leaves it or crosses its midpoint, so sequential reads cost
+// one madvise per half window and random access (seek, interleaved tracks far
+// apart) re-targets the prefetch to the new position.
+void MmapDataSource::AdviseLocked(off64_t offset, size_t size) {
+  const off64_t end = offset + static_cast<off64_t>(size);
+  const off64_t midpoint = advised_start_ + (advised_end_ - advised_start_) / 2;
+  if (offset >= advised_start_ && end <= midpoint) {
+    return;
+  }
+
+  const int64_t page_size = sysconf(_SC_PAGESIZE);
+  // Offsets relative to the page aligned mapping start.
+  const int64_t map_offset = offset + static_cast<int64_t>(mapping_->page_delta);
+  const int64_t start = map_offset - map_offset % page_size;
+  const int64_t stop = std::min<int64_t>(
+      map_offset + std::max<int64_t>(kReadAheadBytes, size),
+      static_cast<int64_t>(mapping_->length));
+  if (stop <= start) {
+    return;
+  }
+
+  madvise(static_cast<uint8_t*>(mapping_->addr) + start,
+          static_cast<size_t>(stop - start), MADV_WILLNEED);
+  advised_start_ = offset;
+  advised_end_ = stop - static_cast<int64_t>(mapping_->page_delta);
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,75 @@
+/*
+ * mmap_data_source.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_DATA_SOURCE_MMAP_DATA_SOURCE_H_
+#define AVP_CONTENT_SOURCE_DATA_SOURCE_MMAP_DATA_SOURCE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "base/errors.h"
+#include "base/thread_annotation.h"
+#include "common/mapped_data_source.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief DataSource backed by a read-only memory mapping of a local file.
+ *
+ * Reads are served straight from the page cache without a syscall, and
+ * GetView() hands out pointers into the mapping so demuxers can wrap samples
+ * without copying them. Views hold a reference to the mapping, so it stays
+ * mapped until the last frame pointing into it is released.
+ * Read-ahead is driven by the read cursor through madvise(MADV_WILLNEED) on
+ * top of MADV_SEQUENTIAL.
+ *
+ * The file is assumed to be complete and not to shrink while mapped:
+ * truncating it underneath the mapping makes accesses past the new end raise
+ * SIGBUS, and bytes appended after opening are not seen. GenericSource only
+ * uses it when mmap is enabled explicitly.
+ */
+class MmapDataSource : public MappedDataSource {
+ public:
+  explicit MmapDataSource(const char* path);
+  // Takes ownership of |fd|. A negative |length| maps up to the end of file.
+  MmapDataSource(int fd, int64_t offset, int64_t length);
+  ~MmapDataSource() override;
+
+  status_t InitCheck() const override;
+  ssize_t ReadAt(off64_t offset, void* data, size_t size) override;
+  status_t GetSize(off64_t* size) override;
+  std::string GetUri() override { return uri_; }
+  int32_t Flags() override { return kSeekable; }
+
+  std::shared_ptr<const uint8_t> GetView(off64_t offset,
+                                         size_t size) override;
+
+ private:
+  struct Mapping;
+
+  void MapFd(int fd, int64_t offset, int64_t length);
+  void AdviseLocked(off64_t offset, size_t size) REQUIRES(advice_lock_);
+
+  std::string uri_;
+  std::shared_ptr<Mapping> mapping_;
+  // Start of the requested range inside the mapping.
+  const uint8_t* data_ = nullptr;
+  int64_t size_ = 0;
+
+  std::mutex advice_lock_;
+  // Window [advised_start_, advised_end_) last passed to MADV_WILLNEED.
+  off64_t advised_start_ GUARDED_BY(advice_lock_) = -1;
+  off64_t advised_end_ GUARDED_BY(advice_lock_) = -1;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_DATA_SOURCE_MMAP_DATA_SOURCE_H_
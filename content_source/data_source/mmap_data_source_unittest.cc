@@ -0,0 +1,139 @@
+/*
+ * mmap_data_source_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/mmap_data_source.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+class MmapDataSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/mmap_data_source_test.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    path_ = path;
+
+    // Spans more than one page so offset mappings are not page aligned.
+    data_.resize(3 * sysconf(_SC_PAGESIZE) + 123);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    ASSERT_EQ(write(fd, data_.data(), data_.size()),
+              static_cast<ssize_t>(data_.size()));
+    close(fd);
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  std::string path_;
+  std::vector<uint8_t> data_;
+};
+
+TEST_F(MmapDataSourceTest, ReadsFileContents) {
+  MmapDataSource source(path_.c_str());
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  off64_t size = 0;
+  ASSERT_EQ(source.GetSize(&size), OK);
+  EXPECT_EQ(size, static_cast<off64_t>(data_.size()));
+
+  std::vector<uint8_t> out(100);
+  ASSERT_EQ(source.ReadAt(1000, out.data(), out.size()), 100);
+  EXPECT_EQ(out, std::vector<uint8_t>(data_.begin() + 1000,
+                                      data_.begin() + 1100));
+}
+
+TEST_F(MmapDataSourceTest, ShortReadAtEndOfFile) {
+  MmapDataSource source(path_.c_str());
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  std::vector<uint8_t> out(64);
+  const off64_t offset = static_cast<off64_t>(data_.size()) - 10;
+  ASSERT_EQ(source.ReadAt(offset, out.data(), out.size()), 10);
+  EXPECT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + 10),
+            std::vector<uint8_t>(data_.end() - 10, data_.end()));
+  EXPECT_EQ(source.ReadAt(data_.size(), out.data(), out.size()), 0);
+}
+
+TEST_F(MmapDataSourceTest, MissingFileFailsInitCheck) {
+  MmapDataSource source((path_ + ".missing").c_str());
+  EXPECT_NE(source.InitCheck(), OK);
+  EXPECT_EQ(source.GetView(0, 1), nullptr);
+}
+
+TEST_F(MmapDataSourceTest, ViewPointsIntoFile) {
+  MmapDataSource source(path_.c_str());
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  auto view = source.GetView(4097, 300);
+  ASSERT_NE(view, nullptr);
+  EXPECT_EQ(std::vector<uint8_t>(view.get(), view.get() + 300),
+            std::vector<uint8_t>(data_.begin() + 4097,
+                                 data_.begin() + 4397));
+
+  // A view may end exactly at the end of the file.
+  EXPECT_NE(source.GetView(data_.size() - 5, 5), nullptr);
+}
+
+TEST_F(MmapDataSourceTest, ViewOutsideFileIsRejected) {
+  MmapDataSource source(path_.c_str());
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  EXPECT_EQ(source.GetView(-1, 10), nullptr);
+  EXPECT_EQ(source.GetView(data_.size() - 5, 6), nullptr);
+  EXPECT_EQ(source.GetView(data_.size() + 1, 0), nullptr);
+}
+
+TEST_F(MmapDataSourceTest, ViewOutlivesSource) {
+  std::shared_ptr<const uint8_t> view;
+  {
+    auto source = std::make_shared<MmapDataSource>(path_.c_str());
+    ASSERT_EQ(source->InitCheck(), OK);
+    view = source->GetView(0, data_.size());
+    ASSERT_NE(view, nullptr);
+  }
+  // The mapping is still there after the source is gone.
+  EXPECT_EQ(std::vector<uint8_t>(view.get(), view.get() + data_.size()),
+            data_);
+}
+
+TEST_F(MmapDataSourceTest, MapsRangeOfDescriptor) {
+  int fd = open(path_.c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  const int64_t offset = 4096 + 17;
+  MmapDataSource source(fd, offset, 1000);
+  ASSERT_EQ(source.InitCheck(), OK);
+
+  off64_t size = 0;
+  ASSERT_EQ(source.GetSize(&size), OK);
+  EXPECT_EQ(size, 1000);
+
+  uint8_t byte = 0;
+  ASSERT_EQ(source.ReadAt(0, &byte, 1), 1);
+  EXPECT_EQ(byte, data_[offset]);
+
+  auto view = source.GetView(10, 990);
+  ASSERT_NE(view, nullptr);
+  EXPECT_EQ(view.get()[0], data_[offset + 10]);
+  EXPECT_EQ(view.get()[989], data_[offset + 999]);
+  EXPECT_EQ(source.GetView(10, 991), nullptr);
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,111 @@
+/*
+ * pipe_data_source.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/pipe_data_source.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "base/logging.h"
+#include "media/foundation/media_errors.h"
+
+namespace ave {
+namespace player {
+
+PipeDataSource::PipeDataSource(int fd, size_t ring_capacity)
+    : fd_(fd),
+      uri_("pipe://" + std::to_string(fd)),
+      ring_(std::max<size_t>(ring_capacity, 64 * 1024)) {}
+
+PipeDataSource::~PipeDataSource() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool PipeDataSource::IsNonSeekableFd(int fd) {
+  return lseek(fd, 0, SEEK_CUR) < 0 && errno == ESPIPE;
+}
+
+status_t PipeDataSource::InitCheck() const {
+  return fd_ >= 0 ? OK : NO_INIT;
+}
+
+ssize_t PipeDataSource::ReadAt(off64_t offset, void* data, size_t size) {
+  if (fd_ < 0) {
+    return NO_INIT;
+  }
+  if (offset < 0 || data == nullptr) {
+    return BAD_VALUE;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  const off64_t capacity = static_cast<off64_t>(ring_.size());
+  const off64_t ring_start = std::max<off64_t>(0, end_ - capacity);
+  if (offset < ring_start) {
+    AVE_LOG(LS_WARNING) << "PipeDataSource: read at " << offset
+                        << " is before the retained window starting at "
+                        << ring_start;
+    return media::ERROR_IO;
+  }
+
+  // Never ask for more than the ring can hold at once, otherwise the head of
+  // the request would be overwritten before it is copied out.
+  size = std::min<size_t>(size, ring_.size());
+  status_t err = FillUntilLocked(offset + static_cast<off64_t>(size));
+  if (offset >= end_) {
+    return err != OK ? err : 0;
+  }
+
+  const size_t available =
+      std::min<size_t>(size, static_cast<size_t>(end_ - offset));
+  auto* out = static_cast<uint8_t*>(data);
+  size_t copied = 0;
+  while (copied < available) {
+    const size_t pos =
+        static_cast<size_t>((offset + static_cast<off64_t>(copied)) % capacity);
+    const size_t n = std::min(available - copied, ring_.size() - pos);
+    std::memcpy(out + copied, ring_.data() + pos, n);
+    copied += n;
+  }
+  return static_cast<ssize_t>(copied);
+}
+
+status_t PipeDataSource::GetSize(off64_t* /* size */) {
+  return media::ERROR_UNSUPPORTED;
+}
+
+status_t PipeDataSource::FillUntilLocked(off64_t target) {
+  const off64_t capacity = static_cast<off64_t>(ring_.size());
+  while (end_ < target && !eos_) {
+    const size_t pos = static_cast<size_t>(end_ % capacity);
+    // Forward gaps are consumed in ring sized steps; only the tail matters.
+    const size_t want = std::min<size_t>(ring_.size() - pos,
+                                         static_cast<size_t>(target - end_));
+    const ssize_t n = read(fd_, ring_.data() + pos, want);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      AVE_LOG(LS_ERROR) << "PipeDataSource: read failed: " << strerror(errno);
+      return media::ERROR_IO;
+    }
+    if (n == 0) {
+      AVE_LOG(LS_INFO) << "PipeDataSource: end of input at " << end_;
+      eos_ = true;
+      break;
+    }
+    end_ += n;
+  }
+  return OK;
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,69 @@
+/*
+ * pipe_data_source.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_DATA_SOURCE_PIPE_DATA_SOURCE_H_
+#define AVP_CONTENT_SOURCE_DATA_SOURCE_PIPE_DATA_SOURCE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/data_source/data_source.h"
+#include "base/errors.h"
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief DataSource for non-seekable descriptors such as pipes, FIFOs and
+ * stdin.
+ *
+ * Bytes are pulled from the descriptor on demand and the most recent
+ * |ring_capacity| bytes are kept in a ring, which is enough for the short
+ * backward reads done while probing and resyncing. Reads before the ring
+ * fail with ERROR_IO, forward gaps are read and discarded, and memory use is
+ * constant regardless of how long the input runs. Flags() does not report
+ * kSeekable and GetSize() is unsupported, so demuxers take their streaming
+ * paths.
+ */
+class PipeDataSource : public ave::DataSource {
+ public:
+  static constexpr size_t kDefaultRingCapacity = 1024 * 1024;
+
+  // Takes ownership of |fd|.
+  explicit PipeDataSource(int fd, size_t ring_capacity = kDefaultRingCapacity);
+  ~PipeDataSource() override;
+
+  // Returns true if |fd| cannot be repositioned with lseek().
+  static bool IsNonSeekableFd(int fd);
+
+  status_t InitCheck() const override;
+  ssize_t ReadAt(off64_t offset, void* data, size_t size) override;
+  status_t GetSize(off64_t* size) override;
+  std::string GetUri() override { return uri_; }
+  int32_t Flags() override { return 0; }
+
+ private:
+  // Reads from the descriptor until |end_| reaches |target| or input ends.
+  status_t FillUntilLocked(off64_t target) REQUIRES(lock_);
+
+  const int fd_;
+  const std::string uri_;
+
+  std::mutex lock_;
+  std::vector<uint8_t> ring_ GUARDED_BY(lock_);
+  // Stream position one past the last byte read from the descriptor.
+  off64_t end_ GUARDED_BY(lock_) = 0;
+  bool eos_ GUARDED_BY(lock_) = false;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_DATA_SOURCE_PIPE_DATA_SOURCE_H_
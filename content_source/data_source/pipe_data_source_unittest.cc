@@ -0,0 +1,185 @@
+/*
+ * pipe_data_source_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/data_source/pipe_data_source.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "media/foundation/media_errors.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+// The smallest ring PipeDataSource accepts.
+constexpr size_t kRingCapacity = 64 * 1024;
+
+class PipeDataSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // The writer fails with EPIPE instead when a test stops reading early.
+    signal(SIGPIPE, SIG_IGN);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+
+    data_.resize(3 * kRingCapacity + 1000);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<uint8_t>(i * 11 + i / 1024);
+    }
+  }
+
+  void TearDown() override {
+    if (writer_.joinable()) {
+      writer_.join();
+    }
+    CloseWriteEnd();
+  }
+
+  // Writes all of data_ from another thread, since the pipe holds less than
+  // the test data, then closes the write end.
+  void WriteAllAndClose() {
+    writer_ = std::thread([this]() {
+      size_t written = 0;
+      while (written < data_.size()) {
+        ssize_t n =
+            write(write_fd_, data_.data() + written, data_.size() - written);
+        if (n <= 0) {
+          break;
+        }
+        written += static_cast<size_t>(n);
+      }
+      CloseWriteEnd();
+    });
+  }
+
+  void CloseWriteEnd() {
+    int fd = write_fd_.exchange(-1);
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  std::vector<uint8_t> Expected(size_t offset, size_t size) const {
+    return std::vector<uint8_t>(data_.begin() + offset,
+                                data_.begin() + offset + size);
+  }
+
+  int read_fd_ = -1;
+  std::atomic<int> write_fd_{-1};
+  std::thread writer_;
+  std::vector<uint8_t> data_;
+};
+
+TEST_F(PipeDataSourceTest, IsNotSeekable) {
+  PipeDataSource source(read_fd_);
+  ASSERT_EQ(source.InitCheck(), OK);
+  EXPECT_EQ(source.Flags() & DataSource::kSeekable, 0);
+  off64_t size = 0;
+  EXPECT_NE(source.GetSize(&size), OK);
+  EXPECT_TRUE(PipeDataSource::IsNonSeekableFd(read_fd_));
+
+  char path[] = "/tmp/pipe_data_source_test.XXXXXX";
+  int file_fd = mkstemp(path);
+  ASSERT_GE(file_fd, 0);
+  unlink(path);
+  EXPECT_FALSE(PipeDataSource::IsNonSeekableFd(file_fd));
+  close(file_fd);
+}
+
+TEST_F(PipeDataSourceTest, SequentialReadsWrapAroundTheRing) {
+  PipeDataSource source(read_fd_, kRingCapacity);
+  WriteAllAndClose();
+
+  // Chunks that do not divide the ring, so reads straddle the wrap point.
+  std::vector<uint8_t> out(10000);
+  size_t offset = 0;
+  while (offset < data_.size()) {
+    const ssize_t n = source.ReadAt(offset, out.data(), out.size());
+    ASSERT_GT(n, 0) << "offset " << offset;
+    ASSERT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + n),
+              Expected(offset, n))
+        << "offset " << offset;
+    offset += static_cast<size_t>(n);
+  }
+  EXPECT_EQ(offset, data_.size());
+}
+
+TEST_F(PipeDataSourceTest, BackwardReadsInsideTheRingOnly) {
+  PipeDataSource source(read_fd_, kRingCapacity);
+  WriteAllAndClose();
+
+  // A forward gap is read and discarded.
+  std::vector<uint8_t> out(100);
+  const size_t offset = 2 * kRingCapacity + 500;
+  ASSERT_EQ(source.ReadAt(offset, out.data(), out.size()), 100);
+  EXPECT_EQ(out, Expected(offset, 100));
+
+  // The last kRingCapacity bytes are still there, across the wrap point.
+  const size_t end = offset + 100;
+  const size_t back = end - kRingCapacity;
+  ASSERT_EQ(source.ReadAt(back, out.data(), out.size()), 100);
+  EXPECT_EQ(out, Expected(back, 100));
+
+  EXPECT_EQ(source.ReadAt(back - 1, out.data(), out.size()), media::ERROR_IO);
+}
+
+TEST_F(PipeDataSourceTest, ShortReadThenZeroAtEndOfInput) {
+  PipeDataSource source(read_fd_, kRingCapacity);
+  WriteAllAndClose();
+
+  std::vector<uint8_t> out(1000);
+  const size_t offset = data_.size() - 10;
+  ASSERT_EQ(source.ReadAt(offset, out.data(), out.size()), 10);
+  EXPECT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + 10),
+            Expected(offset, 10));
+  EXPECT_EQ(source.ReadAt(data_.size(), out.data(), out.size()), 0);
+  EXPECT_EQ(source.ReadAt(data_.size() + 50, out.data(), out.size()), 0);
+}
+
+TEST_F(PipeDataSourceTest, ReadsAreCappedToTheRing) {
+  PipeDataSource source(read_fd_, kRingCapacity);
+  WriteAllAndClose();
+
+  std::vector<uint8_t> out(2 * kRingCapacity);
+  ASSERT_EQ(source.ReadAt(0, out.data(), out.size()),
+            static_cast<ssize_t>(kRingCapacity));
+  EXPECT_EQ(std::vector<uint8_t>(out.begin(), out.begin() + kRingCapacity),
+            Expected(0, kRingCapacity));
+}
+
+TEST_F(PipeDataSourceTest, ReadBlocksUntilDataArrives) {
+  PipeDataSource source(read_fd_, kRingCapacity);
+
+  std::vector<uint8_t> out(4);
+  std::atomic<ssize_t> result{-1};
+  std::thread reader([&]() {
+    result = source.ReadAt(0, out.data(), out.size());
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(result, -1);
+
+  ASSERT_EQ(write(write_fd_, data_.data(), 4), 4);
+  reader.join();
+  EXPECT_EQ(result, 4);
+  EXPECT_EQ(out, Expected(0, 4));
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
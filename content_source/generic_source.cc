@@ -13,7 +13,11 @@
 #include "base/data_source/file_source.h"
 #include "base/errors.h"
 #include "base/logging.h"
+#include "content_source/data_source/async_file_source.h"
+#include "content_source/data_source/mmap_data_source.h"
+#include "content_source/data_source/pipe_data_source.h"
 #include "media/foundation/looper.h"
+#include "media/foundation/media_errors.h"
 #include "media/foundation/media_source.h"
 #include "media/foundation/message.h"
 
@@ -24,10 +28,61 @@ namespace player {
 
 namespace {
 const int32_t kDefaultPollBufferingIntervalUs = 1000000;
+
+// Local files are read through FileSource. With |use_mmap| they are memory
+// mapped instead when possible, so reads come straight from the page cache;
+// anything mmap cannot handle still falls back to FileSource.
+std::shared_ptr<ave::DataSource> CreateLocalFileSource(const char* path,
+                                                       bool use_mmap) {
+  if (use_mmap) {
+    auto mmap_source = std::make_shared<MmapDataSource>(path);
+    if (mmap_source->InitCheck() == ave::OK) {
+      return mmap_source;
+    }
+  }
+  auto file_source = std::make_shared<ave::FileSource>(path);
+  if (file_source->InitCheck() == ave::OK) {
+    return file_source;
+  }
+  return nullptr;
+}
+
+std::shared_ptr<ave::DataSource> CreateLocalFileSource(int fd,
+                                                       int64_t offset,
+                                                       int64_t length,
+                                                       bool use_mmap) {
+  if (PipeDataSource::IsNonSeekableFd(fd)) {
+    return std::make_shared<PipeDataSource>(dup(fd));
+  }
+  if (use_mmap) {
+    auto mmap_source =
+        std::make_shared<MmapDataSource>(dup(fd), offset, length);
+    if (mmap_source->InitCheck() == ave::OK) {
+      return mmap_source;
+    }
+  }
+  auto file_source =
+      std::make_shared<ave::FileSource>(dup(fd), offset, length);
+  if (file_source->InitCheck() == ave::OK) {
+    return file_source;
+  }
+  return nullptr;
+}
+
+// Direct reads need a seekable source that is not fetched over the network,
+// whether GenericSource opened it or the caller did.
+bool IsLocalFileSource(ave::DataSource* source) {
+  if ((source->Flags() & ave::DataSource::kSeekable) == 0) {
+    return false;
+  }
+  const std::string uri = source->GetUri();
+  return uri.find("://") == std::string::npos ||
+         !strncasecmp(uri.c_str(), "file://", 7);
+}
+
 }  // namespace
 
 using ave::DataSource;
-using ave::FileSource;
 using ave::media::Looper;
 using ave::media::MediaSource;
 using ave::media::ReplyToken;
@@ -45,7 +100,8 @@ GenericSource::GenericSource(std::shared_ptr<DemuxerFactory> demuxer_factory)
       pending_read_buffer_types_(0),
       preparing_(false),
       started_(false),
-      is_streaming_(false) {}
+      local_file_source_(false),
+      mmap_local_files_(false) {}
 
 GenericSource::~GenericSource() = default;
 
@@ -54,6 +110,11 @@ void GenericSource::SetNotify(Notify* notify) {
   notify_ = notify;
 }
 
+void GenericSource::SetMmapLocalFiles(bool enable) {
+  std::lock_guard<std::mutex> lock(lock_);
+  mmap_local_files_ = enable;
+}
+
 void GenericSource::ResetDataSource() {
   uri_.clear();
   offset_ = -1;
@@ -70,7 +131,8 @@ void GenericSource::ResetDataSource() {
 
   preparing_ = false;
   started_ = false;
-  is_streaming_ = false;
+  local_file_source_ = false;
+  async_file_source_.reset();
 }
 
 // TODO: implement http source
@@ -127,6 +189,8 @@ void GenericSource::Start() {
   }
 
   started_ = true;
+  ArmDataAvailableNotifyLocked(MediaType::AUDIO, audio_track_);
+  ArmDataAvailableNotifyLocked(MediaType::VIDEO, video_track_);
 }
 
 void GenericSource::Stop() {
@@ -142,6 +206,8 @@ void GenericSource::Pause() {
 void GenericSource::Resume() {
   std::lock_guard<std::mutex> lock(lock_);
   started_ = true;
+  ArmDataAvailableNotifyLocked(MediaType::AUDIO, audio_track_);
+  ArmDataAvailableNotifyLocked(MediaType::VIDEO, video_track_);
 }
 
 status_t GenericSource::SeekTo(int64_t seek_time_us, SeekMode mode) {
@@ -228,6 +294,147 @@ status_t GenericSource::DequeueAccessUnit(
     return result;
   }
 
+  OnAccessUnitDequeued(access_unit);
+  return result;
+}
+
+status_t GenericSource::RequestDataAvailableNotify(
+    MediaType track_type,
+    std::shared_ptr<Message> notify) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (track_type != MediaType::AUDIO && track_type != MediaType::VIDEO) {
+    return ave::INVALID_OPERATION;
+  }
+
+  auto& track = track_type == MediaType::VIDEO ? video_track_ : audio_track_;
+  if (track.source == nullptr) {
+    return ave::INVALID_OPERATION;
+  }
+
+  // Nothing is dequeued until the source is started; hold the notify until
+  // then.
+  track.data_available_notify = std::move(notify);
+  if (started_) {
+    ArmDataAvailableNotifyLocked(track_type, track);
+  }
+  return ave::OK;
+}
+
+void GenericSource::ArmDataAvailableNotifyLocked(MediaType track_type,
+                                                 Track& track) {
+  auto notify = std::move(track.data_available_notify);
+  if (notify == nullptr || track.packet_source == nullptr) {
+    return;
+  }
+
+  status_t result = ave::OK;
+  if (track.direct_read && !track.read_in_flight &&
+      !track.packet_source->HasBufferAvailable(&result)) {
+    // Direct reads are served on demand, nothing to wait for.
+    notify->post();
+    return;
+  }
+
+  track.packet_source->SetDataAvailableNotify(std::move(notify));
+  PostReadBuffer(track_type);
+}
+
+// Direct reads need the demuxer to support them, and are kept to local
+// files: the read runs on the caller's (decoder) thread, where a network or
+// pipe stall would hold the codec buffer.
+bool GenericSource::SupportsDirectRead(MediaType track_type) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return SupportsDirectReadLocked(track_type);
+}
+
+bool GenericSource::SupportsDirectReadLocked(MediaType track_type) const {
+  if (track_type != MediaType::AUDIO && track_type != MediaType::VIDEO) {
+    return false;
+  }
+  return local_file_source_ && demuxer_ != nullptr &&
+         demuxer_->SupportsReadSampleInto();
+}
+
+status_t GenericSource::DequeueAccessUnitInto(
+    MediaType track_type,
+    uint8_t* buffer,
+    size_t capacity,
+    std::shared_ptr<MediaFrame>& access_unit,
+    size_t* size) {
+  std::unique_lock<std::mutex> lock(lock_);
+
+  if (!started_) {
+    return ave::WOULD_BLOCK;
+  }
+
+  auto& track = track_type == MediaType::VIDEO ? video_track_ : audio_track_;
+
+  if (track.source == nullptr) {
+    return ave::WOULD_BLOCK;
+  }
+
+  if (!SupportsDirectReadLocked(track_type)) {
+    lock.unlock();
+    return ContentSource::DequeueAccessUnitInto(track_type, buffer, capacity,
+                                                access_unit, size);
+  }
+
+  // Stop reading ahead. Packets already read ahead, or still being read,
+  // come first and are copied.
+  track.direct_read = true;
+  status_t result = ave::OK;
+  if (track.read_in_flight ||
+      track.packet_source->HasBufferAvailable(&result)) {
+    lock.unlock();
+    return ContentSource::DequeueAccessUnitInto(track_type, buffer, capacity,
+                                                access_unit, size);
+  }
+
+  MediaSource::ReadOptions read_options;
+  if (track.pending_seek_time_us >= 0) {
+    read_options.SetSeekTo(
+        track.pending_seek_time_us,
+        static_cast<MediaSource::ReadOptions::SeekMode>(
+            track.pending_seek_mode));
+    track.pending_seek_time_us = -1;
+  }
+
+  auto demuxer = demuxer_;
+  auto source = track.source;
+  const size_t index = track.index;
+  const uint32_t seek_generation = track.seek_generation;
+  track.read_in_flight = true;
+  lock.unlock();
+  result = demuxer->ReadSampleInto(index, buffer, capacity, access_unit, size,
+                                   &read_options);
+  if (result == ave::NO_MEMORY) {
+    // The demuxer left the sample unread; read it with its payload for the
+    // caller to copy.
+    access_unit.reset();
+    MediaSource::ReadOptions options;
+    status_t err = source->Read(access_unit, &options);
+    if (err != ave::OK || access_unit == nullptr) {
+      result = err != ave::OK ? err : ave::media::ERROR_IO;
+    }
+  }
+  lock.lock();
+  track.read_in_flight = false;
+
+  // maybe reset or seeked meanwhile
+  if (track.packet_source == nullptr ||
+      seek_generation != track.seek_generation) {
+    return ave::WOULD_BLOCK;
+  }
+  if (result != ave::OK && result != ave::NO_MEMORY) {
+    return result;
+  }
+
+  OnAccessUnitDequeued(access_unit);
+  return result;
+}
+
+void GenericSource::OnAccessUnitDequeued(
+    const std::shared_ptr<MediaFrame>& access_unit) {
   int64_t time_us = 0;
   if (access_unit->stream_type() == MediaType::VIDEO) {
     auto pts = access_unit->video_info()->pts;
@@ -257,8 +464,6 @@ status_t GenericSource::DequeueAccessUnit(
     msg->setInt64("time_us", time_us);
     msg->post();
   }
-
-  return result;
 }
 
 status_t GenericSource::GetDuration(int64_t* duration_us) {
@@ -478,9 +683,13 @@ void GenericSource::OnPrepare() {
         // TODO: create http source
       } else if (!strncasecmp("file://", uri, 7)) {
         uri += 7;
-        auto file_source = std::make_shared<FileSource>(uri);
-        if (file_source->InitCheck() == ave::OK) {
-          data_source_ = std::move(file_source);
+        data_source_ = CreateLocalFileSource(uri, mmap_local_files_);
+      } else if (!strncasecmp("pipe://", uri, 7)) {
+        uri += 7;
+        char* end = nullptr;
+        int fd = strtol(uri, &end, 10);
+        if (end != uri && fd >= 0) {
+          data_source_ = std::make_shared<PipeDataSource>(dup(fd));
         }
       } else if (!strncasecmp("fd://", uri, 5)) {
         uri += 5;
@@ -500,26 +709,17 @@ void GenericSource::OnPrepare() {
           }
 
           if (end != uri) {
-            auto file_source =
-                std::make_shared<FileSource>(dup(fd), offset, length);
-            if (file_source->InitCheck() == ave::OK) {
-              data_source_ = std::move(file_source);
-            }
+            data_source_ =
+                CreateLocalFileSource(fd, offset, length, mmap_local_files_);
           }
         }
       } else {
         // treat as file path
-        auto file_source = std::make_shared<FileSource>(uri);
-        if (file_source->InitCheck() == ave::OK) {
-          data_source_ = std::move(file_source);
-        }
+        data_source_ = CreateLocalFileSource(uri, mmap_local_files_);
       }
     } else {
-      auto file_source =
-          std::make_shared<FileSource>(dup(fd_.get()), offset_, length_);
-      if (file_source->InitCheck() == ave::OK) {
-        data_source_ = std::move(file_source);
-      }
+      data_source_ = CreateLocalFileSource(fd_.get(), offset_, length_,
+                                           mmap_local_files_);
     }
 
     if (data_source_ == nullptr) {
@@ -528,6 +728,9 @@ void GenericSource::OnPrepare() {
       return;
     }
   }
+  local_file_source_ = IsLocalFileSource(data_source_.get());
+  async_file_source_ =
+      std::dynamic_pointer_cast<AsyncFileSource>(data_source_);
   // TODO: if streaming, wrap data source with cache source
 
   // probe source and init demuxer
@@ -542,9 +745,12 @@ void GenericSource::OnPrepare() {
     NotifyVideoSizeChanged(format);
   }
 
-  // FIXME: how to confirm can seek ?
-  NotifyFlagsChanged(FLAG_CAN_PAUSE | FLAG_CAN_SEEK | FLAG_CAN_SEEK_BACKWARD |
-                     FLAG_CAN_SEEK_FORWARD);
+  if (data_source_->Flags() & DataSource::kSeekable) {
+    NotifyFlagsChanged(FLAG_CAN_PAUSE | FLAG_CAN_SEEK |
+                       FLAG_CAN_SEEK_BACKWARD | FLAG_CAN_SEEK_FORWARD);
+  } else {
+    NotifyFlagsChanged(FLAG_CAN_PAUSE);
+  }
 
   FinishPrepare();
 
@@ -559,11 +765,8 @@ void GenericSource::FinishPrepare() {
     return;
   }
 
-  if (is_streaming_) {
-    // TODO: (yofua) when streaming, notify until buffering done
-  } else {
-    NotifyPrepared();
-  }
+  // TODO: (yofua) when streaming, notify until buffering done
+  NotifyPrepared();
 
   if (video_track_.source != nullptr) {
     PostReadBuffer(MediaType::VIDEO);
@@ -666,6 +869,18 @@ void GenericSource::ReadBuffer(MediaType track_type,
     *actual_time_us = seek_time_us;
   }
 
+  if (track->direct_read) {
+    // The consumer reads the track itself; only note the seek for its next
+    // read and drop what was read before it.
+    if (seek_time_us >= 0) {
+      track->pending_seek_time_us = seek_time_us;
+      track->pending_seek_mode = seek_mode;
+      ++track->seek_generation;
+      track->packet_source->Clear();
+    }
+    return;
+  }
+
   MediaSource::ReadOptions read_options;
 
   if (seek_time_us >= 0) {
@@ -687,6 +902,7 @@ void GenericSource::ReadBuffer(MediaType track_type,
     auto& source = track->source;
 
     //    AVE_LOG(LS_INFO) << "before read type:" << trackType;
+    track->read_in_flight = true;
     lock_.unlock();
     if (could_read_multiple) {
       err = source->ReadMultiple(media_packets, max_buffers - num_buffer,
@@ -699,6 +915,7 @@ void GenericSource::ReadBuffer(MediaType track_type,
       }
     }
     lock_.lock();
+    track->read_in_flight = false;
     //    AVE_LOG(LS_INFO) << "after read" << trackType;
 
     // maybe reset, return;
@@ -723,6 +940,27 @@ void GenericSource::ReadBuffer(MediaType track_type,
       break;
     }
   }
+
+  PrefetchNextSamples(*track, max_buffers);
+}
+
+// Queues the reads of the samples the next ReadBuffer() of |track| takes, so
+// they are in memory by then instead of being read on the looper.
+void GenericSource::PrefetchNextSamples(const Track& track, size_t count) {
+  if (async_file_source_ == nullptr || demuxer_ == nullptr) {
+    return;
+  }
+
+  auto demuxer = demuxer_;
+  auto source = async_file_source_;
+  const size_t index = track.index;
+  std::vector<std::pair<off64_t, size_t>> ranges;
+  lock_.unlock();
+  if (demuxer->GetNextSampleRanges(index, count, &ranges) == ave::OK &&
+      !ranges.empty()) {
+    source->Prefetch(ranges);
+  }
+  lock_.lock();
 }
 
 status_t GenericSource::DoSeek(int64_t seek_time_us, SeekMode mode) {
@@ -772,7 +1010,13 @@ void GenericSource::onMessageReceived(const std::shared_ptr<Message>& message) {
       AVE_CHECK(message->findInt32("mode", &mode));
 
       std::shared_ptr<Message> response = std::make_shared<Message>();
-      status_t err = DoSeek(seek_time_us, static_cast<SeekMode>(mode));
+      status_t err = ave::INVALID_OPERATION;
+      if (data_source_ != nullptr &&
+          (data_source_->Flags() & DataSource::kSeekable)) {
+        err = DoSeek(seek_time_us, static_cast<SeekMode>(mode));
+      } else {
+        AVE_LOG(LS_WARNING) << "SeekTo ignored, source is not seekable";
+      }
       response->setInt32("err", err);
 
       std::shared_ptr<ReplyToken> replyID;
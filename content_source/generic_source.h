@@ -9,6 +9,7 @@
 #define AVP_GENERIC_SOURCE_H
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "base/data_source/data_source.h"
@@ -29,6 +30,8 @@
 namespace ave {
 namespace player {
 
+class AsyncFileSource;
+
 using ave::media::Buffer;
 using ave::media::Handler;
 using ave::media::MediaFrame;
@@ -43,6 +46,12 @@ class GenericSource : public Handler, public ContentSource {
 
   void SetNotify(Notify* notify) override;
 
+  // Memory maps local files instead of reading them with FileSource. Only
+  // for files that are complete and stay so: a file truncated while mapped
+  // raises SIGBUS, and one still being written is not seen past the size it
+  // had when opened. Off by default.
+  void SetMmapLocalFiles(bool enable);
+
   status_t SetDataSource(const char* url /*, http_downloader*/);
   status_t SetDataSource(int fd, int64_t offset, int64_t length);
   status_t SetDataSource(std::shared_ptr<ave::DataSource> data_source);
@@ -59,6 +68,15 @@ class GenericSource : public Handler, public ContentSource {
   status_t DequeueAccessUnit(MediaType track_type,
                              std::shared_ptr<MediaFrame>& access_unit) override;
 
+  bool SupportsDirectRead(MediaType track_type) const override;
+  status_t DequeueAccessUnitInto(MediaType track_type,
+                                 uint8_t* buffer,
+                                 size_t capacity,
+                                 std::shared_ptr<MediaFrame>& access_unit,
+                                 size_t* size) override;
+  status_t RequestDataAvailableNotify(MediaType track_type,
+                                      std::shared_ptr<Message> notify) override;
+
   status_t GetDuration(int64_t* duration_us) override;
 
   size_t GetTrackCount() const override;
@@ -103,6 +121,9 @@ class GenericSource : public Handler, public ContentSource {
                   SeekMode seek_mode = SeekMode::SEEK_PREVIOUS_SYNC,
                   int64_t* actual_time_us = nullptr) REQUIRES(lock_);
   status_t DoSeek(int64_t seek_time_us, SeekMode mode) REQUIRES(lock_);
+  bool SupportsDirectReadLocked(MediaType track_type) const REQUIRES(lock_);
+  void OnAccessUnitDequeued(const std::shared_ptr<MediaFrame>& access_unit)
+      REQUIRES(lock_);
 
   void SchedulePollBuffering() REQUIRES(lock_);
   void OnPollBuffering() REQUIRES(lock_);
@@ -118,8 +139,27 @@ class GenericSource : public Handler, public ContentSource {
     MediaType media_type;
     std::shared_ptr<MediaSource> source;
     std::shared_ptr<PacketSource> packet_source;
+    // Set once the consumer reads the track with DequeueAccessUnitInto();
+    // samples are then read on demand into its buffers instead of being
+    // read ahead into packet_source.
+    bool direct_read = false;
+    // A read of the track is running with lock_ released.
+    bool read_in_flight = false;
+    // Seek for the next direct read, and a count of seeks to drop reads
+    // that were in flight across one.
+    int64_t pending_seek_time_us = -1;
+    SeekMode pending_seek_mode = SeekMode::SEEK_PREVIOUS_SYNC;
+    uint32_t seek_generation = 0;
+    // Data-available notify requested while the source was not started.
+    std::shared_ptr<Message> data_available_notify;
   };
 
+  void PrefetchNextSamples(const Track& track, size_t count) REQUIRES(lock_);
+
+  // Arms |track|'s data-available notify now that the source is started.
+  void ArmDataAvailableNotifyLocked(MediaType track_type, Track& track)
+      REQUIRES(lock_);
+
   Notify* notify_ GUARDED_BY(lock_);
   std::string uri_ GUARDED_BY(lock_);
   ave::base::unique_fd fd_ GUARDED_BY(lock_);
@@ -146,7 +186,11 @@ class GenericSource : public Handler, public ContentSource {
 
   bool preparing_;
   bool started_;
-  bool is_streaming_;
+  // Set when data_source_ is a seekable local file.
+  bool local_file_source_ GUARDED_BY(lock_);
+  // data_source_ when it can prefetch samples read ahead by ReadBuffer().
+  std::shared_ptr<AsyncFileSource> async_file_source_ GUARDED_BY(lock_);
+  bool mmap_local_files_ GUARDED_BY(lock_);
 
   mutable std::mutex lock_;
   std::shared_ptr<ave::media::Looper> looper_;
@@ -0,0 +1,210 @@
+/*
+ * generic_source_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/generic_source.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "content_source/data_source/pipe_data_source.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace {
+
+using ave::media::MediaMeta;
+
+// Audio track that never has data, and records the seeks it is asked for.
+class FakeTrack : public MediaSource {
+ public:
+  explicit FakeTrack(std::shared_ptr<MediaMeta> format)
+      : format_(std::move(format)) {}
+
+  status_t Start(std::shared_ptr<ave::media::Message> /* params */) override {
+    return OK;
+  }
+  status_t Stop() override { return OK; }
+  std::shared_ptr<MediaMeta> GetFormat() override { return format_; }
+
+  status_t Read(std::shared_ptr<MediaFrame>& /* frame */,
+                const ReadOptions* options) override {
+    int64_t seek_time_us = 0;
+    ReadOptions::SeekMode mode;
+    if (options != nullptr && options->GetSeekTo(&seek_time_us, &mode)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_seek_time_us_ = seek_time_us;
+    }
+    return WOULD_BLOCK;
+  }
+
+  int64_t last_seek_time_us() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_seek_time_us_;
+  }
+
+ private:
+  std::shared_ptr<MediaMeta> format_;
+  std::mutex mutex_;
+  int64_t last_seek_time_us_ = -1;
+};
+
+class FakeDemuxer : public Demuxer {
+ public:
+  FakeDemuxer(std::shared_ptr<ave::DataSource> data_source,
+              std::shared_ptr<FakeTrack> track)
+      : Demuxer(std::move(data_source)), track_(std::move(track)) {}
+
+  status_t GetFormat(std::shared_ptr<MediaMeta>& format) override {
+    format = MediaMeta::CreatePtr(MediaType::UNKNOWN,
+                                  MediaMeta::FormatType::kTrack);
+    return OK;
+  }
+  size_t GetTrackCount() override { return 1; }
+  status_t GetTrackFormat(std::shared_ptr<MediaMeta>& format,
+                          size_t /* track_index */) override {
+    format = track_->GetFormat();
+    return OK;
+  }
+  std::shared_ptr<MediaSource> GetTrack(size_t /* track_index */) override {
+    return track_;
+  }
+  const char* name() override { return "fake"; }
+
+ private:
+  std::shared_ptr<FakeTrack> track_;
+};
+
+class FakeDemuxerFactory : public DemuxerFactory {
+ public:
+  explicit FakeDemuxerFactory(std::shared_ptr<FakeTrack> track)
+      : track_(std::move(track)) {}
+
+  std::shared_ptr<Demuxer> CreateDemuxer(
+      std::shared_ptr<ave::DataSource> data_source) override {
+    return std::make_shared<FakeDemuxer>(std::move(data_source), track_);
+  }
+
+ private:
+  std::shared_ptr<FakeTrack> track_;
+};
+
+class FakeNotify : public ContentSource::Notify {
+ public:
+  void OnPrepared(status_t err) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prepared_ = true;
+    prepared_err_ = err;
+    cv_.notify_all();
+  }
+  void OnFlagsChanged(int32_t flags) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flags_ = flags;
+  }
+  void OnVideoSizeChanged(std::shared_ptr<MediaMeta>& /* format */) override {}
+  void OnCompletion() override {}
+  void OnError(status_t /* error */) override {}
+  void OnFetchData(MediaType /* stream_type */) override {}
+
+  // Returns the prepare result, or TIMED_OUT.
+  status_t WaitPrepared() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cv_.wait_for(lock, std::chrono::seconds(5),
+                      [this]() { return prepared_; })) {
+      return TIMED_OUT;
+    }
+    return prepared_err_;
+  }
+
+  int32_t flags() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flags_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool prepared_ = false;
+  status_t prepared_err_ = OK;
+  int32_t flags_ = 0;
+};
+
+// Seekable source with no content; the fake demuxer never reads it.
+class SeekableDataSource : public ave::DataSource {
+ public:
+  status_t InitCheck() const override { return OK; }
+  ssize_t ReadAt(off64_t /* offset */,
+                 void* /* data */,
+                 size_t /* size */) override {
+    return 0;
+  }
+  status_t GetSize(off64_t* size) override {
+    *size = 0;
+    return OK;
+  }
+  std::string GetUri() override { return "memory"; }
+  int32_t Flags() override { return kSeekable; }
+};
+
+class GenericSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    track_ = std::make_shared<FakeTrack>(
+        MediaMeta::CreatePtr(MediaType::AUDIO, MediaMeta::FormatType::kTrack));
+    source_ = std::make_shared<GenericSource>(
+        std::make_shared<FakeDemuxerFactory>(track_));
+    source_->SetNotify(&notify_);
+  }
+
+  void TearDown() override {
+    source_.reset();
+    if (write_fd_ >= 0) {
+      close(write_fd_);
+    }
+  }
+
+  std::shared_ptr<ave::DataSource> CreatePipeSource() {
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    write_fd_ = fds[1];
+    return std::make_shared<PipeDataSource>(fds[0]);
+  }
+
+  FakeNotify notify_;
+  std::shared_ptr<FakeTrack> track_;
+  std::shared_ptr<GenericSource> source_;
+  int write_fd_ = -1;
+};
+
+TEST_F(GenericSourceTest, RefusesSeekOnNonSeekableSource) {
+  source_->SetDataSource(CreatePipeSource());
+  source_->Prepare();
+  ASSERT_EQ(notify_.WaitPrepared(), OK);
+  EXPECT_EQ(notify_.flags(), ContentSource::FLAG_CAN_PAUSE);
+
+  EXPECT_EQ(source_->SeekTo(1000000, SeekMode::SEEK_PREVIOUS_SYNC),
+            INVALID_OPERATION);
+  EXPECT_EQ(track_->last_seek_time_us(), -1);
+}
+
+TEST_F(GenericSourceTest, SeeksSeekableSource) {
+  source_->SetDataSource(std::make_shared<SeekableDataSource>());
+  source_->Prepare();
+  ASSERT_EQ(notify_.WaitPrepared(), OK);
+  EXPECT_NE(notify_.flags() & ContentSource::FLAG_CAN_SEEK, 0);
+
+  EXPECT_EQ(source_->SeekTo(1000000, SeekMode::SEEK_PREVIOUS_SYNC), OK);
+  EXPECT_EQ(track_->last_seek_time_us(), 1000000);
+}
+
+}  // namespace
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,140 @@
+/*
+ * abr_controller.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/abr_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+namespace {
+
+// Fetches shorter than this mostly measure latency, not throughput.
+constexpr size_t kMinSampleBytes = 16 * 1024;
+constexpr int64_t kMinSampleDurationUs = 1000;
+// Bytes sampled before the estimate replaces the initial guess.
+constexpr size_t kMinTotalBytes = 128 * 1024;
+
+}  // namespace
+
+ThroughputEstimator::Ewma::Ewma(double half_life_s)
+    : alpha(std::exp(std::log(0.5) / half_life_s)) {}
+
+void ThroughputEstimator::Ewma::Add(double weight_s, double value) {
+  const double adjusted_alpha = std::pow(alpha, weight_s);
+  estimate = value * (1 - adjusted_alpha) + adjusted_alpha * estimate;
+  total_weight += weight_s;
+}
+
+double ThroughputEstimator::Ewma::Get() const {
+  // Undo the bias towards the zero starting value.
+  const double zero_factor = 1 - std::pow(alpha, total_weight);
+  return zero_factor > 0 ? estimate / zero_factor : 0;
+}
+
+ThroughputEstimator::ThroughputEstimator(double fast_half_life_s,
+                                         double slow_half_life_s)
+    : fast_half_life_s_(fast_half_life_s),
+      slow_half_life_s_(slow_half_life_s),
+      fast_(fast_half_life_s),
+      slow_(slow_half_life_s) {}
+
+void ThroughputEstimator::AddSample(size_t bytes, int64_t duration_us) {
+  if (bytes < kMinSampleBytes) {
+    return;
+  }
+  duration_us = std::max(duration_us, kMinSampleDurationUs);
+  const double duration_s = static_cast<double>(duration_us) / 1e6;
+  const double bps = static_cast<double>(bytes) * 8 / duration_s;
+  fast_.Add(duration_s, bps);
+  slow_.Add(duration_s, bps);
+  sampled_bytes_ += bytes;
+}
+
+int64_t ThroughputEstimator::GetEstimateBps() const {
+  if (sampled_bytes_ < kMinTotalBytes) {
+    return -1;
+  }
+  return static_cast<int64_t>(std::min(fast_.Get(), slow_.Get()));
+}
+
+void ThroughputEstimator::Reset() {
+  fast_ = Ewma(fast_half_life_s_);
+  slow_ = Ewma(slow_half_life_s_);
+  sampled_bytes_ = 0;
+}
+
+AbrController::AbrController() : AbrController(Options()) {}
+
+AbrController::AbrController(Options options)
+    : options_(options),
+      estimator_(options.fast_half_life_s, options.slow_half_life_s) {}
+
+void AbrController::SetVariants(const std::vector<int64_t>& bandwidths_bps) {
+  bandwidths_bps_ = bandwidths_bps;
+  order_.resize(bandwidths_bps_.size());
+  std::iota(order_.begin(), order_.end(), 0);
+  std::stable_sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+    return bandwidths_bps_[a] < bandwidths_bps_[b];
+  });
+}
+
+size_t AbrController::GetInitialVariant() const {
+  return HighestVariantBelow(GetEstimateBps());
+}
+
+void AbrController::OnSegmentFetched(size_t bytes, int64_t fetch_time_us) {
+  estimator_.AddSample(bytes, fetch_time_us);
+}
+
+size_t AbrController::SelectVariant(size_t current, int64_t buffered_us) const {
+  if (order_.size() < 2 || current >= bandwidths_bps_.size()) {
+    return order_.empty() ? 0 : current;
+  }
+  if (buffered_us < options_.panic_buffer_us) {
+    return order_.front();
+  }
+
+  const size_t wanted = HighestVariantBelow(GetEstimateBps());
+  if (BandwidthOf(wanted) > BandwidthOf(current) &&
+      buffered_us < options_.min_buffer_for_up_switch_us) {
+    return current;
+  }
+  return wanted;
+}
+
+int64_t AbrController::GetEstimateBps() const {
+  const int64_t estimate = estimator_.GetEstimateBps();
+  return estimate > 0 ? estimate : options_.initial_estimate_bps;
+}
+
+size_t AbrController::HighestVariantBelow(int64_t bandwidth_bps) const {
+  if (order_.empty()) {
+    return 0;
+  }
+  const double budget = static_cast<double>(bandwidth_bps) *
+                        options_.bandwidth_fraction;
+  size_t best = order_.front();
+  for (size_t variant : order_) {
+    if (static_cast<double>(bandwidths_bps_[variant]) <= budget) {
+      best = variant;
+    }
+  }
+  return best;
+}
+
+int64_t AbrController::BandwidthOf(size_t variant) const {
+  return variant < bandwidths_bps_.size() ? bandwidths_bps_[variant] : -1;
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
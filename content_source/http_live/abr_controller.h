@@ -0,0 +1,112 @@
+/*
+ * abr_controller.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_ABR_CONTROLLER_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_ABR_CONTROLLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Network throughput estimate built from segment fetch timings.
+ *
+ * Keeps a fast and a slow exponentially weighted moving average, weighted by
+ * the time each sample took, and reports the lower of the two: drops in
+ * throughput are picked up quickly while short bursts do not cause an
+ * upswitch on their own. Samples that are too small to time reliably are
+ * ignored.
+ */
+class ThroughputEstimator {
+ public:
+  ThroughputEstimator(double fast_half_life_s, double slow_half_life_s);
+
+  void AddSample(size_t bytes, int64_t duration_us);
+  // Returns -1 until enough data has been sampled.
+  int64_t GetEstimateBps() const;
+  void Reset();
+
+ private:
+  struct Ewma {
+    explicit Ewma(double half_life_s);
+    void Add(double weight_s, double value);
+    double Get() const;
+
+    double alpha;
+    double estimate = 0;
+    double total_weight = 0;
+  };
+
+  const double fast_half_life_s_;
+  const double slow_half_life_s_;
+  Ewma fast_;
+  Ewma slow_;
+  size_t sampled_bytes_ = 0;
+};
+
+/**
+ * @brief Picks the variant to download next.
+ *
+ * The choice is the highest bandwidth variant that fits in a fraction of the
+ * measured throughput, gated by the forward buffer: switching up waits until
+ * enough media is buffered to survive a wrong guess, and a buffer below the
+ * panic level drops straight to the lowest variant. Variants are identified
+ * by their index in the list passed to SetVariants().
+ */
+class AbrController {
+ public:
+  struct Options {
+    // Bandwidth assumed before the first measurement.
+    int64_t initial_estimate_bps = 1000000;
+    // Fraction of the estimate a variant may use.
+    double bandwidth_fraction = 0.8;
+    double fast_half_life_s = 2.0;
+    double slow_half_life_s = 5.0;
+    // Buffered media required before switching to a higher variant.
+    int64_t min_buffer_for_up_switch_us = 10000000;
+    // Below this the lowest variant is used regardless of the estimate.
+    int64_t panic_buffer_us = 2000000;
+  };
+
+  AbrController();
+  explicit AbrController(Options options);
+
+  // |bandwidths_bps| in playlist order; -1 for an unknown bandwidth.
+  void SetVariants(const std::vector<int64_t>& bandwidths_bps);
+  size_t GetInitialVariant() const;
+
+  void OnSegmentFetched(size_t bytes, int64_t fetch_time_us);
+
+  /**
+   * @brief Returns the variant to use for the next segment.
+   * @param current index of the variant currently downloaded.
+   * @param buffered_us media buffered ahead of the playback position.
+   */
+  size_t SelectVariant(size_t current, int64_t buffered_us) const;
+
+  int64_t GetEstimateBps() const;
+
+ private:
+  size_t HighestVariantBelow(int64_t bandwidth_bps) const;
+  int64_t BandwidthOf(size_t variant) const;
+
+  const Options options_;
+  ThroughputEstimator estimator_;
+  std::vector<int64_t> bandwidths_bps_;
+  // Variant indices sorted by bandwidth, lowest first.
+  std::vector<size_t> order_;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_ABR_CONTROLLER_H_
@@ -0,0 +1,165 @@
+/*
+ * abr_controller_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/abr_controller.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+namespace {
+
+constexpr int64_t kSegmentDurationUs = 4000000;
+
+// Variants in playlist order, deliberately not sorted by bandwidth.
+const std::vector<int64_t> kBandwidths = {2000000, 500000, 4000000, 1000000};
+constexpr size_t k500k = 1;
+constexpr size_t k1M = 3;
+constexpr size_t k2M = 0;
+constexpr size_t k4M = 2;
+
+// Link of a settable rate with its own clock: each fetch advances the clock
+// by the time the bytes take at the current rate and reports that time.
+class FakeLink {
+ public:
+  void set_rate_bps(int64_t rate_bps) { rate_bps_ = rate_bps; }
+  int64_t now_us() const { return now_us_; }
+
+  int64_t Fetch(size_t bytes) {
+    const int64_t duration_us =
+        static_cast<int64_t>(bytes) * 8 * 1000000 / rate_bps_;
+    now_us_ += duration_us;
+    return duration_us;
+  }
+
+  // Fetches one segment of |variant| and feeds the timing to |abr|.
+  void FetchSegment(AbrController* abr, size_t variant) {
+    const size_t bytes =
+        static_cast<size_t>(kBandwidths[variant] / 8 * kSegmentDurationUs /
+                            1000000);
+    abr->OnSegmentFetched(bytes, Fetch(bytes));
+  }
+
+ private:
+  int64_t rate_bps_ = 1000000;
+  int64_t now_us_ = 0;
+};
+
+AbrController CreateController() {
+  AbrController abr;
+  abr.SetVariants(kBandwidths);
+  return abr;
+}
+
+}  // namespace
+
+TEST(ThroughputEstimatorTest, NeedsEnoughData) {
+  ThroughputEstimator estimator(2.0, 5.0);
+  FakeLink link;
+  link.set_rate_bps(4000000);
+
+  // Too small to time reliably.
+  estimator.AddSample(8 * 1024, link.Fetch(8 * 1024));
+  EXPECT_EQ(estimator.GetEstimateBps(), -1);
+  estimator.AddSample(100 * 1024, link.Fetch(100 * 1024));
+  EXPECT_EQ(estimator.GetEstimateBps(), -1);
+  estimator.AddSample(100 * 1024, link.Fetch(100 * 1024));
+  EXPECT_NEAR(estimator.GetEstimateBps(), 4000000, 40000);
+
+  estimator.Reset();
+  EXPECT_EQ(estimator.GetEstimateBps(), -1);
+}
+
+TEST(ThroughputEstimatorTest, IgnoresShortBursts) {
+  ThroughputEstimator estimator(2.0, 5.0);
+  FakeLink link;
+  link.set_rate_bps(4000000);
+  for (int i = 0; i < 10; ++i) {
+    estimator.AddSample(1000000, link.Fetch(1000000));
+  }
+  EXPECT_NEAR(estimator.GetEstimateBps(), 4000000, 40000);
+
+  // 0.2 s at 40 Mbps only nudges the slow average, which is reported.
+  link.set_rate_bps(40000000);
+  estimator.AddSample(1000000, link.Fetch(1000000));
+  EXPECT_LT(estimator.GetEstimateBps(), 5500000);
+}
+
+TEST(ThroughputEstimatorTest, FollowsDropsQuickly) {
+  ThroughputEstimator estimator(2.0, 5.0);
+  FakeLink link;
+  link.set_rate_bps(4000000);
+  for (int i = 0; i < 10; ++i) {
+    estimator.AddSample(1000000, link.Fetch(1000000));
+  }
+
+  // After two fast half-lives at 1 Mbps the fast average is near 1.75 Mbps,
+  // while the slow one alone would still report about 2.7 Mbps.
+  link.set_rate_bps(1000000);
+  const int64_t drop_start_us = link.now_us();
+  while (link.now_us() - drop_start_us < 4000000) {
+    estimator.AddSample(50000, link.Fetch(50000));
+  }
+  EXPECT_LT(estimator.GetEstimateBps(), 2000000);
+}
+
+TEST(AbrControllerTest, StartsFromInitialEstimate) {
+  AbrController::Options options;
+  options.initial_estimate_bps = 3000000;
+  AbrController abr(options);
+  abr.SetVariants(kBandwidths);
+  // 80% of 3 Mbps fits the 2 Mbps variant.
+  EXPECT_EQ(abr.GetInitialVariant(), k2M);
+  EXPECT_EQ(CreateController().GetInitialVariant(), k500k);
+}
+
+TEST(AbrControllerTest, UpSwitchWaitsForBuffer) {
+  AbrController abr = CreateController();
+  FakeLink link;
+  link.set_rate_bps(6000000);
+  for (int i = 0; i < 5; ++i) {
+    link.FetchSegment(&abr, k1M);
+  }
+  EXPECT_EQ(abr.SelectVariant(k1M, 5000000), k1M);
+  EXPECT_EQ(abr.SelectVariant(k1M, 12000000), k4M);
+}
+
+TEST(AbrControllerTest, DownSwitchIgnoresBuffer) {
+  AbrController abr = CreateController();
+  FakeLink link;
+  link.set_rate_bps(6000000);
+  for (int i = 0; i < 5; ++i) {
+    link.FetchSegment(&abr, k4M);
+  }
+  ASSERT_EQ(abr.SelectVariant(k4M, 30000000), k4M);
+
+  link.set_rate_bps(1500000);
+  for (int i = 0; i < 5; ++i) {
+    link.FetchSegment(&abr, k4M);
+  }
+  EXPECT_EQ(abr.SelectVariant(k4M, 30000000), k1M);
+}
+
+TEST(AbrControllerTest, LowBufferDropsToLowest) {
+  AbrController abr = CreateController();
+  FakeLink link;
+  link.set_rate_bps(20000000);
+  for (int i = 0; i < 5; ++i) {
+    link.FetchSegment(&abr, k4M);
+  }
+  EXPECT_EQ(abr.SelectVariant(k4M, 12000000), k4M);
+  EXPECT_EQ(abr.SelectVariant(k4M, 1000000), k500k);
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,482 @@
+/*
+ * aes_cbc_decryptor.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/aes_cbc_decryptor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "media/foundation/media_errors.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AVP_AES_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AVP_AES_ARMV8 1
+#include <arm_neon.h>
+#endif
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+namespace {
+
+constexpr size_t kBlockSize = Aes128CbcDecryptor::kBlockSize;
+constexpr int kRounds = 10;
+
+using RoundKeys = uint8_t[kRounds + 1][kBlockSize];
+using CbcFunction = void (*)(const RoundKeys& keys,
+                             uint8_t* chain,
+                             const uint8_t* in,
+                             uint8_t* out,
+                             size_t blocks);
+
+uint8_t Rotl8(uint8_t x, int shift) {
+  return static_cast<uint8_t>((x << shift) | (x >> (8 - shift)));
+}
+
+uint8_t XTime(uint8_t x) {
+  return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+uint8_t GfMul(uint8_t a, uint8_t b) {
+  uint8_t product = 0;
+  while (b) {
+    if (b & 1) {
+      product ^= a;
+    }
+    a = XTime(a);
+    b >>= 1;
+  }
+  return product;
+}
+
+uint32_t LoadBe32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+void StoreBe32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+uint32_t Rotr32(uint32_t v, int shift) {
+  return (v >> shift) | (v << (32 - shift));
+}
+
+// S-boxes and the inverse round tables, computed once instead of being
+// spelled out.
+struct Tables {
+  Tables() {
+    // Walks the multiplicative group with generator 3 and its inverse to
+    // get each element's inverse, then applies the affine transform.
+    uint8_t p = 1;
+    uint8_t q = 1;
+    do {
+      p = static_cast<uint8_t>(p ^ (p << 1) ^ ((p & 0x80) ? 0x1b : 0));
+      q = static_cast<uint8_t>(q ^ (q << 1));
+      q = static_cast<uint8_t>(q ^ (q << 2));
+      q = static_cast<uint8_t>(q ^ (q << 4));
+      if (q & 0x80) {
+        q ^= 0x09;
+      }
+      sbox[p] = static_cast<uint8_t>(q ^ Rotl8(q, 1) ^ Rotl8(q, 2) ^
+                                     Rotl8(q, 3) ^ Rotl8(q, 4) ^ 0x63);
+    } while (p != 1);
+    sbox[0] = 0x63;
+
+    for (int i = 0; i < 256; ++i) {
+      inv_sbox[sbox[i]] = static_cast<uint8_t>(i);
+    }
+    for (int i = 0; i < 256; ++i) {
+      const uint8_t s = inv_sbox[i];
+      const uint32_t word = (static_cast<uint32_t>(GfMul(s, 0x0e)) << 24) |
+                            (static_cast<uint32_t>(GfMul(s, 0x09)) << 16) |
+                            (static_cast<uint32_t>(GfMul(s, 0x0d)) << 8) |
+                            static_cast<uint32_t>(GfMul(s, 0x0b));
+      td[0][i] = word;
+      td[1][i] = Rotr32(word, 8);
+      td[2][i] = Rotr32(word, 16);
+      td[3][i] = Rotr32(word, 24);
+    }
+  }
+
+  uint8_t sbox[256];
+  uint8_t inv_sbox[256];
+  uint32_t td[4][256];
+};
+
+const Tables& GetTables() {
+  static const Tables tables;
+  return tables;
+}
+
+void InvMixColumns(uint8_t* block) {
+  for (int c = 0; c < 4; ++c) {
+    uint8_t* a = block + 4 * c;
+    const uint8_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+    a[0] = GfMul(a0, 0x0e) ^ GfMul(a1, 0x0b) ^ GfMul(a2, 0x0d) ^
+           GfMul(a3, 0x09);
+    a[1] = GfMul(a0, 0x09) ^ GfMul(a1, 0x0e) ^ GfMul(a2, 0x0b) ^
+           GfMul(a3, 0x0d);
+    a[2] = GfMul(a0, 0x0d) ^ GfMul(a1, 0x09) ^ GfMul(a2, 0x0e) ^
+           GfMul(a3, 0x0b);
+    a[3] = GfMul(a0, 0x0b) ^ GfMul(a1, 0x0d) ^ GfMul(a2, 0x09) ^
+           GfMul(a3, 0x0e);
+  }
+}
+
+// Expands |key| and converts the schedule for the equivalent inverse
+// cipher: round keys in reverse order, InvMixColumns applied to the inner
+// ones. All three implementations use this layout.
+void ExpandDecryptionKeys(const uint8_t* key, RoundKeys& keys) {
+  const Tables& tables = GetTables();
+  RoundKeys encryption;
+  std::memcpy(encryption[0], key, kBlockSize);
+  uint8_t rcon = 1;
+  for (int round = 1; round <= kRounds; ++round) {
+    const uint8_t* prev = encryption[round - 1];
+    uint8_t* next = encryption[round];
+    const uint8_t t[4] = {
+        static_cast<uint8_t>(tables.sbox[prev[13]] ^ rcon),
+        tables.sbox[prev[14]], tables.sbox[prev[15]], tables.sbox[prev[12]]};
+    rcon = XTime(rcon);
+    for (int i = 0; i < 4; ++i) {
+      next[i] = prev[i] ^ t[i];
+    }
+    for (int i = 4; i < 16; ++i) {
+      next[i] = prev[i] ^ next[i - 4];
+    }
+  }
+
+  for (int round = 0; round <= kRounds; ++round) {
+    std::memcpy(keys[round], encryption[kRounds - round], kBlockSize);
+    if (round > 0 && round < kRounds) {
+      InvMixColumns(keys[round]);
+    }
+  }
+}
+
+void CbcDecryptPortable(const RoundKeys& keys,
+                        uint8_t* chain,
+                        const uint8_t* in,
+                        uint8_t* out,
+                        size_t blocks) {
+  const Tables& tables = GetTables();
+  const auto& td = tables.td;
+  const uint8_t* inv = tables.inv_sbox;
+  uint32_t rk[kRounds + 1][4];
+  for (int round = 0; round <= kRounds; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      rk[round][i] = LoadBe32(keys[round] + 4 * i);
+    }
+  }
+
+  uint8_t cipher[kBlockSize];
+  for (size_t b = 0; b < blocks; ++b, in += kBlockSize, out += kBlockSize) {
+    std::memcpy(cipher, in, kBlockSize);
+    uint32_t s0 = LoadBe32(in) ^ rk[0][0];
+    uint32_t s1 = LoadBe32(in + 4) ^ rk[0][1];
+    uint32_t s2 = LoadBe32(in + 8) ^ rk[0][2];
+    uint32_t s3 = LoadBe32(in + 12) ^ rk[0][3];
+    for (int round = 1; round < kRounds; ++round) {
+      const uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^
+                          td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^
+                          rk[round][0];
+      const uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^
+                          td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^
+                          rk[round][1];
+      const uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^
+                          td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^
+                          rk[round][2];
+      const uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^
+                          td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^
+                          rk[round][3];
+      s0 = t0;
+      s1 = t1;
+      s2 = t2;
+      s3 = t3;
+    }
+    auto last = [inv](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+      return (static_cast<uint32_t>(inv[a >> 24]) << 24) |
+             (static_cast<uint32_t>(inv[(b >> 16) & 0xff]) << 16) |
+             (static_cast<uint32_t>(inv[(c >> 8) & 0xff]) << 8) |
+             static_cast<uint32_t>(inv[d & 0xff]);
+    };
+    StoreBe32(out, last(s0, s3, s2, s1) ^ rk[kRounds][0] ^ LoadBe32(chain));
+    StoreBe32(out + 4,
+              last(s1, s0, s3, s2) ^ rk[kRounds][1] ^ LoadBe32(chain + 4));
+    StoreBe32(out + 8,
+              last(s2, s1, s0, s3) ^ rk[kRounds][2] ^ LoadBe32(chain + 8));
+    StoreBe32(out + 12,
+              last(s3, s2, s1, s0) ^ rk[kRounds][3] ^ LoadBe32(chain + 12));
+    std::memcpy(chain, cipher, kBlockSize);
+  }
+}
+
+#if defined(AVP_AES_X86)
+
+bool CpuHasAesNi() {
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0;
+}
+
+// CBC decryption has no dependency between blocks, so four are kept in
+// flight to hide the latency of aesdec.
+__attribute__((target("aes,sse2"))) void CbcDecryptAesNi(
+    const RoundKeys& keys,
+    uint8_t* chain,
+    const uint8_t* in,
+    uint8_t* out,
+    size_t blocks) {
+  __m128i k[kRounds + 1];
+  for (int round = 0; round <= kRounds; ++round) {
+    k[round] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys[round]));
+  }
+  __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chain));
+
+  for (; blocks >= 4;
+       blocks -= 4, in += 4 * kBlockSize, out += 4 * kBlockSize) {
+    const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i c1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+    const __m128i c2 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+    const __m128i c3 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+    __m128i b0 = _mm_xor_si128(c0, k[0]);
+    __m128i b1 = _mm_xor_si128(c1, k[0]);
+    __m128i b2 = _mm_xor_si128(c2, k[0]);
+    __m128i b3 = _mm_xor_si128(c3, k[0]);
+    for (int round = 1; round < kRounds; ++round) {
+      b0 = _mm_aesdec_si128(b0, k[round]);
+      b1 = _mm_aesdec_si128(b1, k[round]);
+      b2 = _mm_aesdec_si128(b2, k[round]);
+      b3 = _mm_aesdec_si128(b3, k[round]);
+    }
+    b0 = _mm_xor_si128(_mm_aesdeclast_si128(b0, k[kRounds]), prev);
+    b1 = _mm_xor_si128(_mm_aesdeclast_si128(b1, k[kRounds]), c0);
+    b2 = _mm_xor_si128(_mm_aesdeclast_si128(b2, k[kRounds]), c1);
+    b3 = _mm_xor_si128(_mm_aesdeclast_si128(b3, k[kRounds]), c2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), b0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), b1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), b2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 48), b3);
+    prev = c3;
+  }
+
+  for (; blocks > 0; --blocks, in += kBlockSize, out += kBlockSize) {
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i b = _mm_xor_si128(c, k[0]);
+    for (int round = 1; round < kRounds; ++round) {
+      b = _mm_aesdec_si128(b, k[round]);
+    }
+    b = _mm_xor_si128(_mm_aesdeclast_si128(b, k[kRounds]), prev);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), b);
+    prev = c;
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(chain), prev);
+}
+
+#endif  // AVP_AES_X86
+
+#if defined(AVP_AES_ARMV8)
+
+// AESD xors the key before InvSubBytes and has no InvMixColumns, so each
+// round is AESIMC of the previous state followed by AESD with the next key;
+// the last key is xored in on its own.
+void CbcDecryptArmv8(const RoundKeys& keys,
+                     uint8_t* chain,
+                     const uint8_t* in,
+                     uint8_t* out,
+                     size_t blocks) {
+  uint8x16_t k[kRounds + 1];
+  for (int round = 0; round <= kRounds; ++round) {
+    k[round] = vld1q_u8(keys[round]);
+  }
+  uint8x16_t prev = vld1q_u8(chain);
+  for (; blocks > 0; --blocks, in += kBlockSize, out += kBlockSize) {
+    const uint8x16_t c = vld1q_u8(in);
+    uint8x16_t b = vaesdq_u8(c, k[0]);
+    for (int round = 1; round < kRounds; ++round) {
+      b = vaesdq_u8(vaesimcq_u8(b), k[round]);
+    }
+    b = veorq_u8(veorq_u8(b, k[kRounds]), prev);
+    vst1q_u8(out, b);
+    prev = c;
+  }
+  vst1q_u8(chain, prev);
+}
+
+#endif  // AVP_AES_ARMV8
+
+struct CbcImplementation {
+  CbcFunction decrypt;
+  const char* name;
+};
+
+// Implementations this host can run, fastest first.
+const std::vector<CbcImplementation>& AvailableImplementationList() {
+  static const std::vector<CbcImplementation> implementations = []() {
+    std::vector<CbcImplementation> list;
+#if defined(AVP_AES_X86)
+    if (CpuHasAesNi()) {
+      list.push_back({&CbcDecryptAesNi, "aesni"});
+    }
+#endif
+#if defined(AVP_AES_ARMV8)
+    list.push_back({&CbcDecryptArmv8, "armv8"});
+#endif
+    list.push_back({&CbcDecryptPortable, "portable"});
+    return list;
+  }();
+  return implementations;
+}
+
+std::atomic<const CbcImplementation*> g_forced_implementation{nullptr};
+
+const CbcImplementation& SelectImplementation() {
+  const CbcImplementation* forced =
+      g_forced_implementation.load(std::memory_order_relaxed);
+  return forced ? *forced : AvailableImplementationList().front();
+}
+
+}  // namespace
+
+Aes128CbcDecryptor::Aes128CbcDecryptor(const Block& key, const Block& iv)
+    : chain_(iv) {
+  ExpandDecryptionKeys(key.data(), round_keys_);
+}
+
+Aes128CbcDecryptor::~Aes128CbcDecryptor() {
+  // Do not leave key material behind.
+  volatile uint8_t* keys = &round_keys_[0][0];
+  for (size_t i = 0; i < sizeof(round_keys_); ++i) {
+    keys[i] = 0;
+  }
+}
+
+void Aes128CbcDecryptor::Update(const uint8_t* data,
+                                size_t size,
+                                std::vector<uint8_t>* out) {
+  if (partial_size_ > 0) {
+    const size_t n = std::min(size, kBlockSize - partial_size_);
+    std::memcpy(partial_.data() + partial_size_, data, n);
+    partial_size_ += n;
+    data += n;
+    size -= n;
+    if (partial_size_ < kBlockSize) {
+      return;
+    }
+  }
+
+  const size_t whole = size / kBlockSize;
+  const size_t blocks = whole + (partial_size_ == kBlockSize ? 1 : 0);
+  if (blocks > 0) {
+    const size_t start = out->size();
+    out->resize(start + (has_last_ ? kBlockSize : 0) + blocks * kBlockSize);
+    uint8_t* dst = out->data() + start;
+    if (has_last_) {
+      std::memcpy(dst, last_.data(), kBlockSize);
+      dst += kBlockSize;
+    }
+    if (partial_size_ == kBlockSize) {
+      DecryptBlocks(partial_.data(), dst, 1);
+      dst += kBlockSize;
+      partial_size_ = 0;
+    }
+    DecryptBlocks(data, dst, whole);
+    data += whole * kBlockSize;
+    size -= whole * kBlockSize;
+
+    std::memcpy(last_.data(), out->data() + out->size() - kBlockSize,
+                kBlockSize);
+    out->resize(out->size() - kBlockSize);
+    has_last_ = true;
+  }
+
+  std::memcpy(partial_.data(), data, size);
+  partial_size_ = size;
+}
+
+status_t Aes128CbcDecryptor::Finish(std::vector<uint8_t>* out) {
+  if (partial_size_ != 0 || !has_last_) {
+    return media::ERROR_MALFORMED;
+  }
+  const uint8_t padding = last_[kBlockSize - 1];
+  if (padding == 0 || padding > kBlockSize) {
+    return media::ERROR_MALFORMED;
+  }
+  for (size_t i = kBlockSize - padding; i < kBlockSize; ++i) {
+    if (last_[i] != padding) {
+      return media::ERROR_MALFORMED;
+    }
+  }
+  out->insert(out->end(), last_.begin(), last_.end() - padding);
+  has_last_ = false;
+  return OK;
+}
+
+Aes128CbcDecryptor::Block Aes128CbcDecryptor::IvFromSequence(
+    int64_t sequence) {
+  Block iv{};
+  for (size_t i = 0; i < 8; ++i) {
+    iv[kBlockSize - 1 - i] = static_cast<uint8_t>(
+        static_cast<uint64_t>(sequence) >> (8 * i));
+  }
+  return iv;
+}
+
+const char* Aes128CbcDecryptor::Implementation() {
+  return SelectImplementation().name;
+}
+
+std::vector<const char*> Aes128CbcDecryptor::AvailableImplementations() {
+  std::vector<const char*> names;
+  for (const auto& implementation : AvailableImplementationList()) {
+    names.push_back(implementation.name);
+  }
+  return names;
+}
+
+bool Aes128CbcDecryptor::UseImplementationForTesting(const char* name) {
+  if (name == nullptr) {
+    g_forced_implementation.store(nullptr, std::memory_order_relaxed);
+    return true;
+  }
+  for (const auto& implementation : AvailableImplementationList()) {
+    if (std::strcmp(implementation.name, name) == 0) {
+      g_forced_implementation.store(&implementation,
+                                    std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Aes128CbcDecryptor::DecryptBlocks(const uint8_t* in,
+                                       uint8_t* out,
+                                       size_t blocks) {
+  if (blocks > 0) {
+    SelectImplementation().decrypt(round_keys_, chain_.data(), in, out,
+                                   blocks);
+  }
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,85 @@
+/*
+ * aes_cbc_decryptor.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_AES_CBC_DECRYPTOR_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_AES_CBC_DECRYPTOR_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/errors.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Streaming AES-128-CBC decryption of HLS segments encrypted with
+ * EXT-X-KEY METHOD=AES-128.
+ *
+ * Ciphertext can be fed in chunks of any size as it downloads. The last
+ * complete block is held back until Finish(), which strips its PKCS#7
+ * padding. Uses AES-NI on x86 CPUs that have it, the ARMv8 crypto
+ * extensions when built for them, and a table-based implementation
+ * otherwise.
+ */
+class Aes128CbcDecryptor {
+ public:
+  static constexpr size_t kBlockSize = 16;
+  using Block = std::array<uint8_t, kBlockSize>;
+
+  Aes128CbcDecryptor(const Block& key, const Block& iv);
+  ~Aes128CbcDecryptor();
+
+  // Appends the plaintext of the next |size| bytes of ciphertext to |out|.
+  void Update(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+
+  /**
+   * @brief Appends the rest of the plaintext to |out|, without padding.
+   * @return ERROR_MALFORMED if the ciphertext is not a whole number of
+   * blocks or the padding is invalid.
+   */
+  status_t Finish(std::vector<uint8_t>* out);
+
+  // IV used when EXT-X-KEY has none: the media sequence number as a
+  // 128-bit big-endian integer.
+  static Block IvFromSequence(int64_t sequence);
+
+  // "aesni", "armv8" or "portable".
+  static const char* Implementation();
+
+  // Implementations this host can run, fastest first.
+  static std::vector<const char*> AvailableImplementations();
+
+  // Makes all decryptors use the implementation called |name|, or the
+  // default one again for nullptr. Returns false if |name| is not available
+  // on this host.
+  static bool UseImplementationForTesting(const char* name);
+
+ private:
+  void DecryptBlocks(const uint8_t* in, uint8_t* out, size_t blocks);
+
+  // Decryption round keys of the equivalent inverse cipher, in the order
+  // they are applied.
+  uint8_t round_keys_[11][kBlockSize];
+  // Previous ciphertext block.
+  Block chain_;
+  // Ciphertext bytes short of a whole block.
+  Block partial_;
+  size_t partial_size_ = 0;
+  // Plaintext of the last block, held back for the padding.
+  Block last_;
+  bool has_last_ = false;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_AES_CBC_DECRYPTOR_H_
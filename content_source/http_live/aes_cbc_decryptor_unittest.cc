@@ -0,0 +1,161 @@
+/*
+ * aes_cbc_decryptor_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/aes_cbc_decryptor.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "media/foundation/media_errors.h"
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+using Block = Aes128CbcDecryptor::Block;
+
+std::vector<uint8_t> FromHex(const std::string& hex) {
+  std::vector<uint8_t> bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+    bytes.push_back(
+        static_cast<uint8_t>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+  }
+  return bytes;
+}
+
+Block BlockFromHex(const std::string& hex) {
+  const std::vector<uint8_t> bytes = FromHex(hex);
+  Block block{};
+  std::copy(bytes.begin(), bytes.end(), block.begin());
+  return block;
+}
+
+// NIST SP 800-38A, F.2.2 CBC-AES128.Decrypt.
+const Block kKey = BlockFromHex("2b7e151628aed2a6abf7158809cf4f3c");
+const Block kIv = BlockFromHex("000102030405060708090a0b0c0d0e0f");
+const char kCiphertext[] =
+    "7649abac8119b246cee98e9b12e9197d"
+    "5086cb9b507219ee95db113a917678b2"
+    "73bed6b8e3c1743b7116e69e22229516"
+    "3ff1caa1681fac09120eca307586e1a7";
+const char kPlaintext[] =
+    "6bc1bee22e409f96e93d7e117393172a"
+    "ae2d8a571e03ac9c9eb76fac45af8e51"
+    "30c81c46a35ce411e5fbc1191a0a52ef"
+    "f69f2445df4f9b17ad2b417be66c3710";
+// Encryption of the full PKCS#7 padding block that follows the F.2.2
+// plaintext, as produced by `openssl enc -aes-128-cbc`.
+const char kPaddingBlock[] = "8cb82807230e1321d3fae00d18cc2012";
+
+std::vector<std::string> Implementations() {
+  std::vector<std::string> names;
+  for (const char* name : Aes128CbcDecryptor::AvailableImplementations()) {
+    names.emplace_back(name);
+  }
+  return names;
+}
+
+class AesCbcDecryptorTest : public ::testing::TestWithParam<std::string> {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(
+        Aes128CbcDecryptor::UseImplementationForTesting(GetParam().c_str()));
+    ASSERT_EQ(GetParam(), Aes128CbcDecryptor::Implementation());
+  }
+
+  void TearDown() override {
+    Aes128CbcDecryptor::UseImplementationForTesting(nullptr);
+  }
+
+  // Decrypts |ciphertext| fed in |chunk_size| byte pieces and returns the
+  // result of Finish().
+  static status_t Decrypt(const std::vector<uint8_t>& ciphertext,
+                          size_t chunk_size,
+                          std::vector<uint8_t>* plaintext) {
+    Aes128CbcDecryptor decryptor(kKey, kIv);
+    for (size_t offset = 0; offset < ciphertext.size(); offset += chunk_size) {
+      const size_t size = std::min(chunk_size, ciphertext.size() - offset);
+      decryptor.Update(ciphertext.data() + offset, size, plaintext);
+    }
+    return decryptor.Finish(plaintext);
+  }
+};
+
+TEST_P(AesCbcDecryptorTest, DecryptsNistVectorsInChunks) {
+  std::vector<uint8_t> ciphertext = FromHex(kCiphertext);
+  const std::vector<uint8_t> padding = FromHex(kPaddingBlock);
+  ciphertext.insert(ciphertext.end(), padding.begin(), padding.end());
+
+  for (size_t chunk_size : {1, 5, 16, 17, 64}) {
+    SCOPED_TRACE(chunk_size);
+    std::vector<uint8_t> plaintext;
+    EXPECT_EQ(Decrypt(ciphertext, chunk_size, &plaintext), OK);
+    EXPECT_EQ(plaintext, FromHex(kPlaintext));
+  }
+}
+
+TEST_P(AesCbcDecryptorTest, HoldsBackLastBlockUntilFinish) {
+  const std::vector<uint8_t> ciphertext = FromHex(kCiphertext);
+  Aes128CbcDecryptor decryptor(kKey, kIv);
+  std::vector<uint8_t> plaintext;
+  decryptor.Update(ciphertext.data(), ciphertext.size(), &plaintext);
+
+  const std::vector<uint8_t> expected = FromHex(kPlaintext);
+  EXPECT_EQ(plaintext, std::vector<uint8_t>(expected.begin(),
+                                            expected.end() - 16));
+}
+
+TEST_P(AesCbcDecryptorTest, AcceptsShortPadding) {
+  // "HLS" padded with thirteen 0x0d bytes.
+  std::vector<uint8_t> plaintext;
+  EXPECT_EQ(Decrypt(FromHex("a1b2a87fd697211a051de37a33a6873a"), 16,
+                    &plaintext),
+            OK);
+  EXPECT_EQ(std::string(plaintext.begin(), plaintext.end()), "HLS");
+}
+
+TEST_P(AesCbcDecryptorTest, RejectsBadPadding) {
+  std::vector<uint8_t> plaintext;
+  // Plaintext ends in 0x10 but the rest of the block is not padding.
+  EXPECT_EQ(Decrypt(FromHex(kCiphertext), 16, &plaintext),
+            media::ERROR_MALFORMED);
+  // Plaintext ends in a zero padding length.
+  EXPECT_EQ(Decrypt(FromHex("53274720b085c306d508e9fd7928624f"), 16,
+                    &plaintext),
+            media::ERROR_MALFORMED);
+  // Plaintext ends in 0x05 preceded by other bytes.
+  EXPECT_EQ(Decrypt(FromHex("500642a67347f438009650bbd5ce8130"), 16,
+                    &plaintext),
+            media::ERROR_MALFORMED);
+}
+
+TEST_P(AesCbcDecryptorTest, RejectsPartialOrEmptyInput) {
+  std::vector<uint8_t> plaintext;
+  EXPECT_EQ(Decrypt({}, 16, &plaintext), media::ERROR_MALFORMED);
+
+  std::vector<uint8_t> ciphertext = FromHex(kCiphertext);
+  ciphertext.pop_back();
+  EXPECT_EQ(Decrypt(ciphertext, 17, &plaintext), media::ERROR_MALFORMED);
+}
+
+INSTANTIATE_TEST_SUITE_P(Implementations,
+                         AesCbcDecryptorTest,
+                         ::testing::ValuesIn(Implementations()));
+
+TEST(AesCbcDecryptorIvTest, IvFromSequenceIsBigEndian) {
+  EXPECT_EQ(Aes128CbcDecryptor::IvFromSequence(0x0102030405060708),
+            BlockFromHex("00000000000000000102030405060708"));
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
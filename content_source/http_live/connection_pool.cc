@@ -0,0 +1,170 @@
+/*
+ * connection_pool.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/connection_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/time_utils.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+ConnectionPool::ConnectionPool(std::shared_ptr<net::HTTPProvider> http_provider,
+                               Options options)
+    : http_provider_(std::move(http_provider)), options_(options) {}
+
+ConnectionPool::~ConnectionPool() {
+  CloseIdle();
+}
+
+std::shared_ptr<net::HTTPConnection> ConnectionPool::Acquire(
+    const std::string& url,
+    const std::unordered_map<std::string, std::string>& headers) {
+  const std::string origin = OriginOf(url);
+  const size_t max_active =
+      std::max<size_t>(options_.max_connections_per_origin, 1);
+  std::shared_ptr<net::HTTPConnection> connection;
+  std::vector<std::shared_ptr<net::HTTPConnection>> expired;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, &origin, max_active]() {
+      return origins_[origin].active < max_active;
+    });
+    expired = TakeExpiredLocked(base::TimeMicros());
+    Origin& state = origins_[origin];
+    ++state.active;
+    if (!state.idle.empty()) {
+      connection = std::move(state.idle.back().connection);
+      state.idle.pop_back();
+    }
+  }
+  for (auto& idle : expired) {
+    idle->Disconnect();
+  }
+
+  bool reused = connection != nullptr;
+  bool connected = false;
+  int64_t setup_time_us = 0;
+  for (;;) {
+    if (!connection) {
+      connection = http_provider_->CreateConnection();
+    }
+    const int64_t start_us = base::TimeMicros();
+    connected = connection && connection->Connect(url.c_str(), headers);
+    setup_time_us = base::TimeMicros() - start_us;
+    if (connected || !reused) {
+      break;
+    }
+    // The server may have closed the kept connection meanwhile.
+    connection->Disconnect();
+    connection.reset();
+    reused = false;
+  }
+
+  AVE_LOG(LS_VERBOSE) << "HLS connect " << origin << ": reused=" << reused
+                      << " setup_us=" << setup_time_us
+                      << " ok=" << connected;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.requests;
+  if (reused) {
+    ++stats_.reused;
+    stats_.reused_setup_time_us += setup_time_us;
+  } else {
+    stats_.new_setup_time_us += setup_time_us;
+  }
+  if (!connected) {
+    --origins_[origin].active;
+    cv_.notify_all();
+    return nullptr;
+  }
+  return connection;
+}
+
+void ConnectionPool::Release(const std::string& url,
+                             std::shared_ptr<net::HTTPConnection> connection,
+                             bool reusable) {
+  std::vector<std::shared_ptr<net::HTTPConnection>> expired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now_us = base::TimeMicros();
+    Origin& state = origins_[OriginOf(url)];
+    if (state.active > 0) {
+      --state.active;
+    }
+    if (reusable && connection) {
+      state.idle.push_back({std::move(connection), now_us});
+      connection.reset();
+    }
+    expired = TakeExpiredLocked(now_us);
+    cv_.notify_all();
+  }
+  if (connection) {
+    connection->Disconnect();
+  }
+  for (auto& idle : expired) {
+    idle->Disconnect();
+  }
+}
+
+void ConnectionPool::CloseIdle() {
+  std::vector<std::shared_ptr<net::HTTPConnection>> idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& origin : origins_) {
+      for (auto& item : origin.second.idle) {
+        idle.push_back(std::move(item.connection));
+      }
+      origin.second.idle.clear();
+    }
+  }
+  for (auto& connection : idle) {
+    connection->Disconnect();
+  }
+}
+
+ConnectionPool::Stats ConnectionPool::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::string ConnectionPool::OriginOf(const std::string& url) {
+  const size_t scheme_end = url.find("://");
+  if (scheme_end == std::string::npos) {
+    return std::string();
+  }
+  const size_t authority_end = url.find_first_of("/?#", scheme_end + 3);
+  return url.substr(0, authority_end);
+}
+
+std::vector<std::shared_ptr<net::HTTPConnection>>
+ConnectionPool::TakeExpiredLocked(int64_t now_us) {
+  std::vector<std::shared_ptr<net::HTTPConnection>> expired;
+  for (auto it = origins_.begin(); it != origins_.end();) {
+    auto& idle = it->second.idle;
+    // Oldest at the front.
+    while (!idle.empty() &&
+           now_us - idle.front().idle_since_us >= options_.idle_timeout_us) {
+      expired.push_back(std::move(idle.front().connection));
+      idle.pop_front();
+    }
+    if (it->second.active == 0 && idle.empty()) {
+      it = origins_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return expired;
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,120 @@
+/*
+ * connection_pool.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_CONNECTION_POOL_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_CONNECTION_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/net/http/http_provider.h"
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Per-origin pool of HTTP connections for playlist and segment
+ * fetches.
+ *
+ * A connection whose response was read completely is kept open and
+ * connected to the next url of the same origin, so the transport (and TLS
+ * session) of the HTTP stack behind net::HTTPConnection carries over instead
+ * of being set up for every request. Idle connections are closed after a
+ * timeout. The number of connections in use per origin is capped; callers
+ * beyond the cap wait for one to be released, so concurrent prefetches and
+ * playlist loads share the limit. All methods are thread safe.
+ */
+class ConnectionPool {
+ public:
+  struct Options {
+    // Connections in use at once per origin.
+    size_t max_connections_per_origin = 6;
+    // Idle connections are closed after this long without a request.
+    int64_t idle_timeout_us = 30 * 1000 * 1000;
+  };
+
+  struct Stats {
+    uint64_t requests = 0;
+    // Requests served on a connection kept from an earlier one.
+    uint64_t reused = 0;
+    // Time spent in Connect(), split by whether the connection was reused.
+    int64_t new_setup_time_us = 0;
+    int64_t reused_setup_time_us = 0;
+  };
+
+  ConnectionPool(std::shared_ptr<net::HTTPProvider> http_provider,
+                 Options options);
+  ~ConnectionPool();
+
+  /**
+   * @brief Connects to |url|, reusing an idle connection of its origin when
+   * there is one. Blocks while the origin has no connection to spare.
+   * @return null if the connection failed.
+   */
+  std::shared_ptr<net::HTTPConnection> Acquire(
+      const std::string& url,
+      const std::unordered_map<std::string, std::string>& headers)
+      EXCLUDES(mutex_);
+
+  /**
+   * @brief Hands back a connection obtained from Acquire(). Pass |reusable|
+   * only when its response was read to the end without error; otherwise it
+   * is disconnected.
+   */
+  void Release(const std::string& url,
+               std::shared_ptr<net::HTTPConnection> connection,
+               bool reusable) EXCLUDES(mutex_);
+
+  // Disconnects the idle connections.
+  void CloseIdle() EXCLUDES(mutex_);
+
+  Stats GetStats() const EXCLUDES(mutex_);
+
+  // scheme://host[:port] of |url|.
+  static std::string OriginOf(const std::string& url);
+
+ private:
+  struct IdleConnection {
+    std::shared_ptr<net::HTTPConnection> connection;
+    int64_t idle_since_us = 0;
+  };
+
+  struct Origin {
+    size_t active = 0;
+    // Most recently released at the back.
+    std::deque<IdleConnection> idle;
+  };
+
+  // Removes the connections idle for longer than the timeout, which the
+  // caller disconnects once the lock is released.
+  std::vector<std::shared_ptr<net::HTTPConnection>> TakeExpiredLocked(
+      int64_t now_us) REQUIRES(mutex_);
+
+  const std::shared_ptr<net::HTTPProvider> http_provider_;
+  const Options options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<std::string, Origin> origins_ GUARDED_BY(mutex_);
+  Stats stats_ GUARDED_BY(mutex_);
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_CONNECTION_POOL_H_
@@ -0,0 +1,219 @@
+/*
+ * connection_pool_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/connection_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+// Records what the pool does with it; Connect() fails while |fail| is set.
+class FakeConnection : public net::HTTPConnection {
+ public:
+  bool Connect(
+      const char* uri,
+      const std::unordered_map<std::string, std::string>& /* headers */)
+      override {
+    connected_uris.push_back(uri);
+    connected = !fail;
+    return connected;
+  }
+  void Disconnect() override {
+    connected = false;
+    ++disconnects;
+  }
+  ssize_t ReadAt(off64_t /* offset */,
+                 void* /* data */,
+                 size_t /* size */) override {
+    return 0;
+  }
+  off64_t GetSize() override { return -1; }
+  status_t GetMIMEType(std::string& /* mime_type */) override { return OK; }
+  status_t GetUri(std::string& uri) override {
+    uri = connected_uris.empty() ? std::string() : connected_uris.back();
+    return OK;
+  }
+
+  std::vector<std::string> connected_uris;
+  bool connected = false;
+  bool fail = false;
+  int disconnects = 0;
+};
+
+class FakeProvider : public net::HTTPProvider {
+ public:
+  std::shared_ptr<net::HTTPConnection> CreateConnection() override {
+    auto connection = std::make_shared<FakeConnection>();
+    connection->fail = fail_new_connections;
+    created.push_back(connection);
+    return connection;
+  }
+  bool SupportsScheme(const std::string& /* scheme */) override {
+    return true;
+  }
+
+  std::vector<std::shared_ptr<FakeConnection>> created;
+  bool fail_new_connections = false;
+};
+
+FakeConnection* AsFake(const std::shared_ptr<net::HTTPConnection>& c) {
+  return static_cast<FakeConnection*>(c.get());
+}
+
+class ConnectionPoolTest : public ::testing::Test {
+ protected:
+  void CreatePool(ConnectionPool::Options options) {
+    provider_ = std::make_shared<FakeProvider>();
+    pool_ = std::make_unique<ConnectionPool>(provider_, options);
+  }
+
+  std::shared_ptr<net::HTTPConnection> Acquire(const std::string& url) {
+    return pool_->Acquire(url, {});
+  }
+
+  std::shared_ptr<FakeProvider> provider_;
+  std::unique_ptr<ConnectionPool> pool_;
+};
+
+TEST_F(ConnectionPoolTest, OriginOf) {
+  EXPECT_EQ(ConnectionPool::OriginOf("https://a.com/x/y.m3u8"),
+            "https://a.com");
+  EXPECT_EQ(ConnectionPool::OriginOf("http://a.com:8080?q=1"),
+            "http://a.com:8080");
+  EXPECT_EQ(ConnectionPool::OriginOf("https://a.com"), "https://a.com");
+  EXPECT_EQ(ConnectionPool::OriginOf("seg.ts"), "");
+}
+
+TEST_F(ConnectionPoolTest, ReusesReleasedConnectionOfTheSameOrigin) {
+  CreatePool(ConnectionPool::Options());
+  auto first = Acquire("https://a.com/1.ts");
+  ASSERT_NE(first, nullptr);
+  pool_->Release("https://a.com/1.ts", first, true);
+
+  auto second = Acquire("https://a.com/2.ts");
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(provider_->created.size(), 1u);
+  EXPECT_EQ(AsFake(second)->connected_uris.back(), "https://a.com/2.ts");
+
+  // Another origin gets its own connection.
+  auto other = Acquire("https://b.com/1.ts");
+  EXPECT_NE(other, first);
+  EXPECT_EQ(provider_->created.size(), 2u);
+
+  const auto stats = pool_->GetStats();
+  EXPECT_EQ(stats.requests, 3u);
+  EXPECT_EQ(stats.reused, 1u);
+}
+
+TEST_F(ConnectionPoolTest, NonReusableReleaseDisconnects) {
+  CreatePool(ConnectionPool::Options());
+  auto connection = Acquire("https://a.com/1.ts");
+  pool_->Release("https://a.com/1.ts", connection, false);
+  EXPECT_EQ(AsFake(connection)->disconnects, 1);
+
+  auto next = Acquire("https://a.com/2.ts");
+  EXPECT_NE(next, connection);
+  EXPECT_EQ(pool_->GetStats().reused, 0u);
+}
+
+TEST_F(ConnectionPoolTest, StaleKeptConnectionFallsBackToANewOne) {
+  CreatePool(ConnectionPool::Options());
+  auto kept = Acquire("https://a.com/1.ts");
+  pool_->Release("https://a.com/1.ts", kept, true);
+  // The server closed it meanwhile.
+  AsFake(kept)->fail = true;
+
+  auto next = Acquire("https://a.com/2.ts");
+  ASSERT_NE(next, nullptr);
+  EXPECT_NE(next, kept);
+  EXPECT_EQ(AsFake(kept)->disconnects, 1);
+  EXPECT_EQ(pool_->GetStats().reused, 0u);
+}
+
+TEST_F(ConnectionPoolTest, FailedConnectFreesItsSlot) {
+  ConnectionPool::Options options;
+  options.max_connections_per_origin = 1;
+  CreatePool(options);
+  provider_->fail_new_connections = true;
+  EXPECT_EQ(Acquire("https://a.com/1.ts"), nullptr);
+
+  // Would block forever if the failed attempt kept the only slot.
+  provider_->fail_new_connections = false;
+  EXPECT_NE(Acquire("https://a.com/1.ts"), nullptr);
+}
+
+TEST_F(ConnectionPoolTest, CapsConnectionsInUsePerOrigin) {
+  ConnectionPool::Options options;
+  options.max_connections_per_origin = 2;
+  CreatePool(options);
+  auto first = Acquire("https://a.com/1.ts");
+  auto second = Acquire("https://a.com/2.ts");
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+
+  std::atomic<bool> acquired{false};
+  std::shared_ptr<net::HTTPConnection> third;
+  std::thread waiter([&]() {
+    third = Acquire("https://a.com/3.ts");
+    acquired = true;
+  });
+
+  // Other origins are not held up by the busy one.
+  EXPECT_NE(Acquire("https://b.com/1.ts"), nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(acquired);
+
+  pool_->Release("https://a.com/1.ts", first, true);
+  waiter.join();
+  EXPECT_TRUE(acquired);
+  EXPECT_EQ(third, first);
+}
+
+TEST_F(ConnectionPoolTest, IdleConnectionsAreClosedAfterTheTimeout) {
+  ConnectionPool::Options options;
+  options.idle_timeout_us = 20 * 1000;
+  CreatePool(options);
+  auto connection = Acquire("https://a.com/1.ts");
+  pool_->Release("https://a.com/1.ts", connection, true);
+  EXPECT_EQ(AsFake(connection)->disconnects, 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // Any pool call sweeps the expired connections, whatever the origin.
+  auto other = Acquire("https://b.com/1.ts");
+  EXPECT_EQ(AsFake(connection)->disconnects, 1);
+
+  auto next = Acquire("https://a.com/2.ts");
+  EXPECT_NE(next, connection);
+  EXPECT_EQ(pool_->GetStats().reused, 0u);
+}
+
+TEST_F(ConnectionPoolTest, CloseIdleDisconnectsKeptConnections) {
+  CreatePool(ConnectionPool::Options());
+  auto first = Acquire("https://a.com/1.ts");
+  auto second = Acquire("https://b.com/1.ts");
+  pool_->Release("https://a.com/1.ts", first, true);
+  pool_->Release("https://b.com/1.ts", second, true);
+
+  pool_->CloseIdle();
+  EXPECT_EQ(AsFake(first)->disconnects, 1);
+  EXPECT_EQ(AsFake(second)->disconnects, 1);
+  EXPECT_NE(Acquire("https://a.com/2.ts"), first);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,805 @@
+/*
+ * fmp4_segment_parser.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/fmp4_segment_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "base/logging.h"
+#include "base/units/time_delta.h"
+#include "base/units/timestamp.h"
+#include "api/demuxer/demuxer.h"
+#include "demuxer/isobmff/box_types.h"
+#include "media/audio/channel_layout.h"
+#include "media/codec/codec_id.h"
+#include "media/foundation/aac_utils.h"
+#include "media/foundation/esds.h"
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_mimes.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+using namespace isobmff;
+
+namespace {
+
+// tfhd flags
+constexpr uint32_t kTfhdBaseDataOffset = 0x000001;
+constexpr uint32_t kTfhdSampleDescriptionIndex = 0x000002;
+constexpr uint32_t kTfhdDefaultSampleDuration = 0x000008;
+constexpr uint32_t kTfhdDefaultSampleSize = 0x000010;
+constexpr uint32_t kTfhdDefaultSampleFlags = 0x000020;
+constexpr uint32_t kTfhdDefaultBaseIsMoof = 0x020000;
+
+// trun flags
+constexpr uint32_t kTrunDataOffset = 0x000001;
+constexpr uint32_t kTrunFirstSampleFlags = 0x000004;
+constexpr uint32_t kTrunSampleDuration = 0x000100;
+constexpr uint32_t kTrunSampleSize = 0x000200;
+constexpr uint32_t kTrunSampleFlags = 0x000400;
+constexpr uint32_t kTrunSampleCompositionTimeOffset = 0x000800;
+
+// sample_is_non_sync_sample bit of the trex/tfhd/trun sample flags.
+constexpr uint32_t kSampleIsNonSyncSample = 0x00010000;
+
+// Fixed fields of the sample entries, after the box header.
+constexpr size_t kVisualSampleEntrySize = 78;
+constexpr size_t kAudioSampleEntrySize = 28;
+
+uint16_t U16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t U32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t U64(const uint8_t* p) {
+  return (static_cast<uint64_t>(U32(p)) << 32) | U32(p + 4);
+}
+
+// A box held in memory.
+struct Box {
+  uint32_t type = 0;
+  const uint8_t* data = nullptr;  // Payload, after the header.
+  size_t size = 0;                // Payload size.
+};
+
+// Iterates over the boxes in [data, data + size).
+class BoxIterator {
+ public:
+  BoxIterator(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool Next(Box* box) {
+    if (size_ - pos_ < 8) {
+      return false;
+    }
+    const uint8_t* p = data_ + pos_;
+    uint64_t box_size = U32(p);
+    size_t header_size = 8;
+    if (box_size == 1) {
+      if (size_ - pos_ < 16) {
+        return false;
+      }
+      box_size = U64(p + 8);
+      header_size = 16;
+    } else if (box_size == 0) {
+      box_size = size_ - pos_;
+    }
+    if (box_size < header_size || box_size > size_ - pos_) {
+      return false;
+    }
+    box->type = U32(p + 4);
+    box->data = p + header_size;
+    box->size = static_cast<size_t>(box_size) - header_size;
+    pos_ += static_cast<size_t>(box_size);
+    return true;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+};
+
+bool FindChild(const Box& parent, uint32_t type, Box* child) {
+  BoxIterator it(parent.data, parent.size);
+  while (it.Next(child)) {
+    if (child->type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int64_t TicksToUs(int64_t ticks, uint32_t timescale) {
+  // Split to avoid overflow with 64-bit tfdt values.
+  const int64_t seconds = ticks / timescale;
+  const int64_t remainder = ticks % timescale;
+  return seconds * 1000000LL + remainder * 1000000LL / timescale;
+}
+
+media::ChannelLayout ChannelLayoutFromCount(uint16_t channel_count) {
+  switch (channel_count) {
+    case 1:
+      return media::CHANNEL_LAYOUT_MONO;
+    case 2:
+      return media::CHANNEL_LAYOUT_STEREO;
+    case 6:
+      return media::CHANNEL_LAYOUT_5_1;
+    case 8:
+      return media::CHANNEL_LAYOUT_7_1;
+    default:
+      return media::CHANNEL_LAYOUT_UNSUPPORTED;
+  }
+}
+
+std::shared_ptr<media::MediaMeta> ParseVideoSampleEntry(const Box& entry) {
+  if (entry.size < kVisualSampleEntrySize) {
+    return nullptr;
+  }
+
+  media::CodecId codec_id = media::CodecId::AVE_CODEC_ID_NONE;
+  const char* mime = nullptr;
+  uint32_t config_type = 0;
+  switch (entry.type) {
+    case FOURCC_avc1:
+    case FOURCC_avc3:
+      codec_id = media::CodecId::AVE_CODEC_ID_H264;
+      mime = media::MEDIA_MIMETYPE_VIDEO_AVC;
+      config_type = FOURCC_avcC;
+      break;
+    case FOURCC_hvc1:
+    case FOURCC_hev1:
+      codec_id = media::CodecId::AVE_CODEC_ID_HEVC;
+      mime = media::MEDIA_MIMETYPE_VIDEO_HEVC;
+      config_type = FOURCC_hvcC;
+      break;
+    default:
+      return nullptr;
+  }
+
+  auto meta = media::MediaMeta::CreatePtr(media::MediaType::VIDEO,
+                                          media::MediaMeta::FormatType::kTrack);
+  meta->SetCodec(codec_id);
+  meta->SetMime(mime);
+  meta->SetWidth(U16(entry.data + 24));
+  meta->SetHeight(U16(entry.data + 26));
+
+  BoxIterator it(entry.data + kVisualSampleEntrySize,
+                 entry.size - kVisualSampleEntrySize);
+  Box child;
+  while (it.Next(&child)) {
+    if (child.type == config_type && child.size > 0) {
+      meta->SetPrivateData(static_cast<uint32_t>(child.size),
+                           const_cast<uint8_t*>(child.data));
+    }
+  }
+  return meta;
+}
+
+std::shared_ptr<media::MediaMeta> ParseAudioSampleEntry(const Box& entry) {
+  if (entry.size < kAudioSampleEntrySize) {
+    return nullptr;
+  }
+
+  media::CodecId codec_id = media::CodecId::AVE_CODEC_ID_NONE;
+  const char* mime = nullptr;
+  switch (entry.type) {
+    case FOURCC_mp4a:
+      codec_id = media::CodecId::AVE_CODEC_ID_AAC;
+      mime = media::MEDIA_MIMETYPE_AUDIO_AAC;
+      break;
+    case FOURCC_ac_3:
+      codec_id = media::CodecId::AVE_CODEC_ID_AC3;
+      mime = media::MEDIA_MIMETYPE_AUDIO_AC3;
+      break;
+    case FOURCC_ec_3:
+      codec_id = media::CodecId::AVE_CODEC_ID_EAC3;
+      mime = media::MEDIA_MIMETYPE_AUDIO_EAC3;
+      break;
+    default:
+      return nullptr;
+  }
+
+  const uint16_t channel_count = U16(entry.data + 16);
+  auto meta = media::MediaMeta::CreatePtr(media::MediaType::AUDIO,
+                                          media::MediaMeta::FormatType::kTrack);
+  meta->SetCodec(codec_id);
+  meta->SetMime(mime);
+  meta->SetSampleRate(U32(entry.data + 24) >> 16);
+  meta->SetBitsPerSample(static_cast<int16_t>(U16(entry.data + 18)));
+  meta->SetChannelLayout(ChannelLayoutFromCount(channel_count));
+
+  BoxIterator it(entry.data + kAudioSampleEntrySize,
+                 entry.size - kAudioSampleEntrySize);
+  Box child;
+  while (it.Next(&child)) {
+    if (child.type == FOURCC_esds && child.size > 4) {
+      // Skip version and flags.
+      media::ESDS esds(child.data + 4, child.size - 4);
+      const void* codec_data = nullptr;
+      size_t codec_data_size = 0;
+      if (esds.InitCheck() != OK ||
+          esds.getCodecSpecificInfo(&codec_data, &codec_data_size) != OK) {
+        continue;
+      }
+      meta->SetPrivateData(static_cast<uint32_t>(codec_data_size),
+                           const_cast<void*>(codec_data));
+      if (codec_data_size >= 2) {
+        // The AudioSpecificConfig is authoritative for the sample rate.
+        const auto* asc = static_cast<const uint8_t*>(codec_data);
+        const uint8_t freq_index = ((asc[0] & 0x07) << 1) | (asc[1] >> 7);
+        const uint32_t sample_rate = media::GetSamplingRate(freq_index);
+        if (sample_rate > 0) {
+          meta->SetSampleRate(sample_rate);
+        }
+      }
+    } else if ((child.type == FOURCC_dac3 || child.type == FOURCC_dec3) &&
+               child.size > 0) {
+      meta->SetPrivateData(static_cast<uint32_t>(child.size),
+                           const_cast<uint8_t*>(child.data));
+    }
+  }
+  return meta;
+}
+
+// Fills |track| from a trak box; returns false for tracks that cannot be
+// played (unknown handler, unsupported or encrypted sample entry).
+bool ParseTrak(const Box& trak, Fmp4InitSegment::Track* track) {
+  Box tkhd;
+  if (!FindChild(trak, FOURCC_tkhd, &tkhd) || tkhd.size < 24) {
+    return false;
+  }
+  track->track_id = U32(tkhd.data + (tkhd.data[0] == 1 ? 20 : 12));
+
+  Box mdia;
+  Box mdhd;
+  Box hdlr;
+  if (!FindChild(trak, FOURCC_mdia, &mdia) ||
+      !FindChild(mdia, FOURCC_mdhd, &mdhd) ||
+      !FindChild(mdia, FOURCC_hdlr, &hdlr) || mdhd.size < 24 ||
+      hdlr.size < 12) {
+    return false;
+  }
+  track->timescale = U32(mdhd.data + (mdhd.data[0] == 1 ? 20 : 12));
+  if (track->timescale == 0) {
+    return false;
+  }
+
+  const uint32_t handler = U32(hdlr.data + 8);
+  if (handler == FOURCC_vide) {
+    track->media_type = media::MediaType::VIDEO;
+  } else if (handler == FOURCC_soun) {
+    track->media_type = media::MediaType::AUDIO;
+  } else {
+    return false;
+  }
+
+  Box minf;
+  Box stbl;
+  Box stsd;
+  if (!FindChild(mdia, FOURCC_minf, &minf) ||
+      !FindChild(minf, FOURCC_stbl, &stbl) ||
+      !FindChild(stbl, FOURCC_stsd, &stsd) || stsd.size < 8) {
+    return false;
+  }
+
+  // Version, flags and entry count precede the first sample entry.
+  BoxIterator entries(stsd.data + 8, stsd.size - 8);
+  Box entry;
+  if (!entries.Next(&entry)) {
+    return false;
+  }
+  track->format = track->media_type == media::MediaType::VIDEO
+                      ? ParseVideoSampleEntry(entry)
+                      : ParseAudioSampleEntry(entry);
+  if (!track->format) {
+    char fourcc[5];
+    FourCCToString(entry.type, fourcc);
+    AVE_LOG(LS_WARNING) << "fMP4 track " << track->track_id
+                        << ": unsupported sample entry '" << fourcc << "'";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+status_t Fmp4InitSegment::Parse(const uint8_t* data,
+                                size_t size,
+                                std::shared_ptr<Fmp4InitSegment>* init) {
+  auto result = std::make_shared<Fmp4InitSegment>();
+
+  BoxIterator top(data, size);
+  Box moov;
+  bool found_moov = false;
+  while (top.Next(&moov)) {
+    if (moov.type == FOURCC_moov) {
+      found_moov = true;
+      break;
+    }
+  }
+  if (!found_moov) {
+    return media::ERROR_MALFORMED;
+  }
+
+  BoxIterator children(moov.data, moov.size);
+  Box child;
+  while (children.Next(&child)) {
+    if (child.type != FOURCC_trak) {
+      continue;
+    }
+    Track track;
+    if (ParseTrak(child, &track)) {
+      result->tracks.push_back(std::move(track));
+    }
+  }
+
+  Box mvex;
+  if (FindChild(moov, FOURCC_mvex, &mvex)) {
+    BoxIterator it(mvex.data, mvex.size);
+    Box trex;
+    while (it.Next(&trex)) {
+      if (trex.type != FOURCC_trex || trex.size < 24) {
+        continue;
+      }
+      const uint32_t track_id = U32(trex.data + 4);
+      for (auto& track : result->tracks) {
+        if (track.track_id == track_id) {
+          track.default_sample_duration = U32(trex.data + 12);
+          track.default_sample_size = U32(trex.data + 16);
+          track.default_sample_flags = U32(trex.data + 20);
+        }
+      }
+    }
+  }
+
+  if (result->tracks.empty()) {
+    return media::ERROR_UNSUPPORTED;
+  }
+  *init = std::move(result);
+  return OK;
+}
+
+const Fmp4InitSegment::Track* Fmp4InitSegment::FindTrack(
+    uint32_t track_id) const {
+  for (const auto& track : tracks) {
+    if (track.track_id == track_id) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+Fmp4SegmentParser::Fmp4SegmentParser(
+    std::shared_ptr<const Fmp4InitSegment> init,
+    std::shared_ptr<MediaFramePool> audio_frame_pool,
+    std::shared_ptr<MediaFramePool> video_frame_pool)
+    : init_(std::move(init)) {
+  for (const auto& track : init_->tracks) {
+    TrackOutput& output =
+        track.media_type == media::MediaType::AUDIO ? audio_ : video_;
+    if (!output.track) {
+      output.track = &track;
+    }
+  }
+  audio_.frame_pool = audio_frame_pool
+                          ? std::move(audio_frame_pool)
+                          : MediaFramePool::Create(media::MediaType::AUDIO);
+  video_.frame_pool = video_frame_pool
+                          ? std::move(video_frame_pool)
+                          : MediaFramePool::Create(media::MediaType::VIDEO);
+}
+
+Fmp4SegmentParser::~Fmp4SegmentParser() = default;
+
+status_t Fmp4SegmentParser::Append(const uint8_t* data, size_t size) {
+  if (finished_) {
+    return media::ERROR_END_OF_STREAM;
+  }
+  buffer_.insert(buffer_.end(), data, data + size);
+  return Process();
+}
+
+status_t Fmp4SegmentParser::Finish() {
+  status_t err = Process();
+  if (next_sample_ < samples_.size()) {
+    AVE_LOG(LS_WARNING) << "fMP4 segment truncated: "
+                        << samples_.size() - next_sample_
+                        << " samples missing";
+  }
+  finished_ = true;
+  buffer_.clear();
+  return err;
+}
+
+bool Fmp4SegmentParser::TracksReady() const {
+  // Everything is known from the init section.
+  return true;
+}
+
+std::shared_ptr<media::MediaMeta> Fmp4SegmentParser::GetFormat(
+    media::MediaType media_type) const {
+  const TrackOutput& output =
+      media_type == media::MediaType::AUDIO ? audio_ : video_;
+  return output.track ? output.track->format : nullptr;
+}
+
+status_t Fmp4SegmentParser::DequeueAccessUnit(
+    media::MediaType media_type,
+    std::shared_ptr<media::MediaFrame>& access_unit) {
+  TrackOutput& output = media_type == media::MediaType::AUDIO ? audio_ : video_;
+  if (output.frames.empty()) {
+    return finished_ ? static_cast<status_t>(media::ERROR_END_OF_STREAM)
+                     : static_cast<status_t>(WOULD_BLOCK);
+  }
+  access_unit = std::move(output.frames.front());
+  output.frames.pop_front();
+  return OK;
+}
+
+int64_t Fmp4SegmentParser::GetBaseMediaTimeUs() const {
+  return base_media_time_us_;
+}
+
+// Walks the top-level boxes as far as the buffered bytes allow. Boxes other
+// than moof and mdat (styp, sidx, prft, emsg, ...) are skipped.
+status_t Fmp4SegmentParser::Process() {
+  for (;;) {
+    if (in_mdat_) {
+      while (next_sample_ < samples_.size()) {
+        const Sample& sample = samples_[next_sample_];
+        if (sample.offset < buffer_offset_) {
+          AVE_LOG(LS_WARNING) << "fMP4 sample outside mdat at "
+                              << sample.offset;
+          ++next_sample_;
+          continue;
+        }
+        if (sample.offset + sample.size > buffered_end()) {
+          break;
+        }
+        status_t err = EmitSample(sample);
+        if (err != OK) {
+          return err;
+        }
+        ++next_sample_;
+      }
+      if (mdat_end_ < 0 || buffered_end() < mdat_end_) {
+        break;
+      }
+      in_mdat_ = false;
+      box_offset_ = mdat_end_;
+      continue;
+    }
+
+    if (box_offset_ < buffer_offset_ || box_offset_ + 8 > buffered_end()) {
+      break;
+    }
+    const uint8_t* p =
+        buffer_.data() + static_cast<size_t>(box_offset_ - buffer_offset_);
+    int64_t box_size = U32(p);
+    const uint32_t type = U32(p + 4);
+    int64_t header_size = 8;
+    if (box_size == 1) {
+      if (box_offset_ + 16 > buffered_end()) {
+        break;
+      }
+      const uint64_t large_size = U64(p + 8);
+      if (large_size > static_cast<uint64_t>(
+                           std::numeric_limits<int64_t>::max())) {
+        return media::ERROR_MALFORMED;
+      }
+      box_size = static_cast<int64_t>(large_size);
+      header_size = 16;
+    } else if (box_size == 0) {
+      // Extends to the end of the segment.
+      box_size = -1;
+    }
+    if (box_size >= 0 && box_size < header_size) {
+      return media::ERROR_MALFORMED;
+    }
+
+    if (type == FOURCC_mdat) {
+      in_mdat_ = true;
+      mdat_end_ = box_size < 0 ? -1 : box_offset_ + box_size;
+      continue;
+    }
+    if (box_size < 0) {
+      // Nothing but mdat may run to the end; ignore the rest.
+      box_offset_ = std::numeric_limits<int64_t>::max();
+      break;
+    }
+    if (type == FOURCC_moof) {
+      if (box_offset_ + box_size > buffered_end()) {
+        break;
+      }
+      status_t err = ParseMoof(p + header_size,
+                               static_cast<size_t>(box_size - header_size),
+                               box_offset_);
+      if (err != OK) {
+        return err;
+      }
+    }
+    box_offset_ += box_size;
+  }
+
+  DiscardConsumed();
+  return OK;
+}
+
+status_t Fmp4SegmentParser::ParseMoof(const uint8_t* data,
+                                      size_t size,
+                                      int64_t moof_offset) {
+  if (next_sample_ < samples_.size()) {
+    AVE_LOG(LS_WARNING) << "fMP4 moof at " << moof_offset << " drops "
+                        << samples_.size() - next_sample_ << " samples";
+  }
+  samples_.clear();
+  next_sample_ = 0;
+
+  const int64_t previous_base_time_us = base_media_time_us_;
+  int64_t first_time_us = std::numeric_limits<int64_t>::max();
+  int64_t next_data_offset = moof_offset;
+  BoxIterator it(data, size);
+  Box traf;
+  while (it.Next(&traf)) {
+    if (traf.type != FOURCC_traf) {
+      continue;
+    }
+    const size_t first_sample = samples_.size();
+    status_t err = ParseTraf(traf.data, traf.size, moof_offset,
+                             &next_data_offset);
+    if (err != OK) {
+      return err;
+    }
+    if (samples_.size() > first_sample) {
+      const Sample& sample = samples_[first_sample];
+      first_time_us = std::min(
+          first_time_us, TicksToUs(sample.dts, sample.track->timescale));
+    }
+  }
+
+  if (previous_base_time_us < 0 &&
+      first_time_us != std::numeric_limits<int64_t>::max()) {
+    base_media_time_us_ = first_time_us;
+  }
+
+  // Emit in file order so the mdat can be consumed front to back.
+  std::stable_sort(samples_.begin(), samples_.end(),
+                   [](const Sample& a, const Sample& b) {
+                     return a.offset < b.offset;
+                   });
+  return OK;
+}
+
+status_t Fmp4SegmentParser::ParseTraf(const uint8_t* data,
+                                      size_t size,
+                                      int64_t moof_offset,
+                                      int64_t* next_data_offset) {
+  const Box traf{FOURCC_traf, data, size};
+  Box tfhd;
+  if (!FindChild(traf, FOURCC_tfhd, &tfhd) || tfhd.size < 8) {
+    return media::ERROR_MALFORMED;
+  }
+
+  const uint32_t tfhd_flags = U32(tfhd.data) & 0xffffff;
+  TrackOutput* output = FindOutput(U32(tfhd.data + 4));
+  if (!output) {
+    return OK;
+  }
+  const Fmp4InitSegment::Track* track = output->track;
+
+  size_t pos = 8;
+  auto has = [&tfhd, &pos](size_t bytes) { return pos + bytes <= tfhd.size; };
+  int64_t base_offset =
+      tfhd_flags & kTfhdDefaultBaseIsMoof ? moof_offset : *next_data_offset;
+  uint32_t default_duration = track->default_sample_duration;
+  uint32_t default_size = track->default_sample_size;
+  uint32_t default_flags = track->default_sample_flags;
+  if (tfhd_flags & kTfhdBaseDataOffset) {
+    if (!has(8)) {
+      return media::ERROR_MALFORMED;
+    }
+    base_offset = static_cast<int64_t>(U64(tfhd.data + pos));
+    pos += 8;
+  }
+  if (tfhd_flags & kTfhdSampleDescriptionIndex) {
+    pos += 4;
+  }
+  if (tfhd_flags & kTfhdDefaultSampleDuration) {
+    if (!has(4)) {
+      return media::ERROR_MALFORMED;
+    }
+    default_duration = U32(tfhd.data + pos);
+    pos += 4;
+  }
+  if (tfhd_flags & kTfhdDefaultSampleSize) {
+    if (!has(4)) {
+      return media::ERROR_MALFORMED;
+    }
+    default_size = U32(tfhd.data + pos);
+    pos += 4;
+  }
+  if (tfhd_flags & kTfhdDefaultSampleFlags) {
+    if (!has(4)) {
+      return media::ERROR_MALFORMED;
+    }
+    default_flags = U32(tfhd.data + pos);
+    pos += 4;
+  }
+
+  int64_t dts = output->next_dts;
+  Box tfdt;
+  if (FindChild(traf, FOURCC_tfdt, &tfdt) && tfdt.size >= 8) {
+    dts = tfdt.data[0] == 1 && tfdt.size >= 12
+              ? static_cast<int64_t>(U64(tfdt.data + 4))
+              : static_cast<int64_t>(U32(tfdt.data + 4));
+  }
+
+  int64_t data_offset = base_offset;
+  BoxIterator it(traf.data, traf.size);
+  Box trun;
+  while (it.Next(&trun)) {
+    if (trun.type != FOURCC_trun) {
+      continue;
+    }
+    if (trun.size < 8) {
+      return media::ERROR_MALFORMED;
+    }
+    const uint32_t flags = U32(trun.data) & 0xffffff;
+    const uint32_t count = U32(trun.data + 4);
+    size_t p = 8;
+    if (flags & kTrunDataOffset) {
+      if (p + 4 > trun.size) {
+        return media::ERROR_MALFORMED;
+      }
+      data_offset = base_offset + static_cast<int32_t>(U32(trun.data + p));
+      p += 4;
+    }
+    bool has_first_sample_flags = false;
+    uint32_t first_sample_flags = 0;
+    if (flags & kTrunFirstSampleFlags) {
+      if (p + 4 > trun.size) {
+        return media::ERROR_MALFORMED;
+      }
+      has_first_sample_flags = true;
+      first_sample_flags = U32(trun.data + p);
+      p += 4;
+    }
+
+    const size_t entry_size =
+        4 * (!!(flags & kTrunSampleDuration) + !!(flags & kTrunSampleSize) +
+             !!(flags & kTrunSampleFlags) +
+             !!(flags & kTrunSampleCompositionTimeOffset));
+    if (p > trun.size || (trun.size - p) / std::max<size_t>(entry_size, 1) <
+                             (entry_size ? count : 0)) {
+      return media::ERROR_MALFORMED;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+      Sample sample;
+      sample.track = track;
+      sample.duration = default_duration;
+      sample.size = default_size;
+      uint32_t sample_flags = i == 0 && has_first_sample_flags
+                                  ? first_sample_flags
+                                  : default_flags;
+      int64_t composition_offset = 0;
+      if (flags & kTrunSampleDuration) {
+        sample.duration = U32(trun.data + p);
+        p += 4;
+      }
+      if (flags & kTrunSampleSize) {
+        sample.size = U32(trun.data + p);
+        p += 4;
+      }
+      if (flags & kTrunSampleFlags) {
+        sample_flags = U32(trun.data + p);
+        p += 4;
+      }
+      if (flags & kTrunSampleCompositionTimeOffset) {
+        // Signed in version 1. Version 0 is unsigned in the spec, but
+        // packagers write negative offsets there too.
+        composition_offset = static_cast<int32_t>(U32(trun.data + p));
+        p += 4;
+      }
+      sample.offset = data_offset;
+      sample.dts = dts;
+      sample.pts = dts + composition_offset;
+      sample.is_sync = (sample_flags & kSampleIsNonSyncSample) == 0;
+      data_offset += sample.size;
+      dts += sample.duration;
+      samples_.push_back(sample);
+    }
+  }
+
+  output->next_dts = dts;
+  *next_data_offset = data_offset;
+  return OK;
+}
+
+status_t Fmp4SegmentParser::EmitSample(const Sample& sample) {
+  const Fmp4InitSegment::Track* track = sample.track;
+  TrackOutput& output =
+      track->media_type == media::MediaType::AUDIO ? audio_ : video_;
+  auto frame = output.frame_pool->Acquire(sample.size);
+  if (!frame) {
+    return NO_MEMORY;
+  }
+  std::memcpy(frame->data(),
+              buffer_.data() + static_cast<size_t>(sample.offset - buffer_offset_),
+              sample.size);
+  frame->SetStreamType(track->media_type);
+  frame->SetCodec(track->format->codec());
+  frame->SetPts(
+      base::Timestamp::Micros(TicksToUs(sample.pts, track->timescale)));
+  frame->SetDts(
+      base::Timestamp::Micros(TicksToUs(sample.dts, track->timescale)));
+  frame->SetDuration(
+      base::TimeDelta::Micros(TicksToUs(sample.duration, track->timescale)));
+
+  if (track->media_type == media::MediaType::VIDEO) {
+    // Decoders skipping late video resume at sync samples.
+    if (sample.is_sync) {
+      frame->setFlags(frame->flags() | ACCESS_UNIT_FLAG_SYNC);
+    }
+  } else if (auto* audio_info = frame->audio_info()) {
+    const int sample_rate = track->format->sample_rate();
+    audio_info->codec_id = track->format->codec();
+    audio_info->sample_rate_hz = sample_rate;
+    audio_info->channel_layout = track->format->channel_layout();
+    audio_info->bits_per_sample = track->format->bits_per_sample();
+    audio_info->samples_per_channel =
+        sample_rate > 0 ? static_cast<int64_t>(sample.duration) * sample_rate /
+                              track->timescale
+                        : 0;
+  }
+
+  output.frames.push_back(std::move(frame));
+  return OK;
+}
+
+// Drops the bytes no longer needed: everything before the next box, or
+// inside an mdat everything before the next sample to emit.
+void Fmp4SegmentParser::DiscardConsumed() {
+  int64_t keep_from = box_offset_;
+  if (in_mdat_) {
+    keep_from = next_sample_ < samples_.size() ? samples_[next_sample_].offset
+                                               : buffered_end();
+  }
+  if (keep_from <= buffer_offset_) {
+    return;
+  }
+  const size_t drop = static_cast<size_t>(
+      std::min<int64_t>(keep_from - buffer_offset_,
+                        static_cast<int64_t>(buffer_.size())));
+  buffer_.erase(buffer_.begin(),
+                buffer_.begin() + static_cast<ptrdiff_t>(drop));
+  buffer_offset_ += static_cast<int64_t>(drop);
+}
+
+Fmp4SegmentParser::TrackOutput* Fmp4SegmentParser::FindOutput(
+    uint32_t track_id) {
+  if (audio_.track && audio_.track->track_id == track_id) {
+    return &audio_;
+  }
+  if (video_.track && video_.track->track_id == track_id) {
+    return &video_;
+  }
+  return nullptr;
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
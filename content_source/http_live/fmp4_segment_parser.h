@@ -0,0 +1,141 @@
+/*
+ * fmp4_segment_parser.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_FMP4_SEGMENT_PARSER_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_FMP4_SEGMENT_PARSER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/media_frame_pool.h"
+#include "content_source/http_live/segment_parser.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Track setup from an fMP4 media initialization section (EXT-X-MAP).
+ *
+ * Parsed once per distinct init section and shared by the parsers of all
+ * segments that reference it.
+ */
+struct Fmp4InitSegment {
+  struct Track {
+    uint32_t track_id = 0;
+    media::MediaType media_type = media::MediaType::UNKNOWN;
+    uint32_t timescale = 0;
+    std::shared_ptr<media::MediaMeta> format;
+    // Sample defaults from trex.
+    uint32_t default_sample_duration = 0;
+    uint32_t default_sample_size = 0;
+    uint32_t default_sample_flags = 0;
+  };
+
+  static status_t Parse(const uint8_t* data,
+                        size_t size,
+                        std::shared_ptr<Fmp4InitSegment>* init);
+
+  const Track* FindTrack(uint32_t track_id) const;
+
+  std::vector<Track> tracks;
+};
+
+/**
+ * @brief SegmentParser for fragmented MP4 / CMAF media segments.
+ *
+ * moof boxes are parsed once they are complete. Samples in the following
+ * mdat are emitted as soon as their bytes have arrived, so a large mdat is
+ * never held in full. Timestamps are in the media timeline of the tfdt box;
+ * edit lists are not applied. Only the first audio and the first video track
+ * are exposed. Video samples whose trex/tfhd/trun sample flags leave
+ * sample_is_non_sync_sample clear carry ACCESS_UNIT_FLAG_SYNC, and audio
+ * samples carry the audio info of their track.
+ *
+ * Sample frames come from per-track MediaFramePools. A source parsing a
+ * series of segments passes the same pools to each parser so frames are
+ * recycled across segments; without them the parser makes its own.
+ */
+class Fmp4SegmentParser : public SegmentParser {
+ public:
+  explicit Fmp4SegmentParser(
+      std::shared_ptr<const Fmp4InitSegment> init,
+      std::shared_ptr<MediaFramePool> audio_frame_pool = nullptr,
+      std::shared_ptr<MediaFramePool> video_frame_pool = nullptr);
+  ~Fmp4SegmentParser() override;
+
+  status_t Append(const uint8_t* data, size_t size) override;
+  status_t Finish() override;
+
+  bool TracksReady() const override;
+  std::shared_ptr<media::MediaMeta> GetFormat(
+      media::MediaType media_type) const override;
+  status_t DequeueAccessUnit(
+      media::MediaType media_type,
+      std::shared_ptr<media::MediaFrame>& access_unit) override;
+  int64_t GetBaseMediaTimeUs() const override;
+  bool HasLengthPrefixedNalUnits() const override { return true; }
+
+ private:
+  struct Sample {
+    const Fmp4InitSegment::Track* track = nullptr;
+    // Offset in the segment.
+    int64_t offset = 0;
+    uint32_t size = 0;
+    int64_t dts = 0;
+    int64_t pts = 0;
+    uint32_t duration = 0;
+    // sample_is_non_sync_sample clear in the effective sample flags.
+    bool is_sync = true;
+  };
+
+  struct TrackOutput {
+    const Fmp4InitSegment::Track* track = nullptr;
+    // Decode time of the next sample when a fragment carries no tfdt.
+    int64_t next_dts = 0;
+    std::shared_ptr<MediaFramePool> frame_pool;
+    std::deque<std::shared_ptr<media::MediaFrame>> frames;
+  };
+
+  status_t Process();
+  status_t ParseMoof(const uint8_t* data, size_t size, int64_t moof_offset);
+  status_t ParseTraf(const uint8_t* data,
+                     size_t size,
+                     int64_t moof_offset,
+                     int64_t* next_data_offset);
+  status_t EmitSample(const Sample& sample);
+  void DiscardConsumed();
+  TrackOutput* FindOutput(uint32_t track_id);
+  int64_t buffered_end() const {
+    return buffer_offset_ + static_cast<int64_t>(buffer_.size());
+  }
+
+  const std::shared_ptr<const Fmp4InitSegment> init_;
+  TrackOutput audio_;
+  TrackOutput video_;
+
+  // Unconsumed input; buffer_[0] is at segment offset buffer_offset_.
+  std::vector<uint8_t> buffer_;
+  int64_t buffer_offset_ = 0;
+  // Offset of the next top-level box.
+  int64_t box_offset_ = 0;
+  bool in_mdat_ = false;
+  // End of the current mdat, -1 if it extends to the end of the segment.
+  int64_t mdat_end_ = 0;
+  // Samples of the last moof, in file order, and the next one to emit.
+  std::vector<Sample> samples_;
+  size_t next_sample_ = 0;
+  int64_t base_media_time_us_ = -1;
+  bool finished_ = false;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_FMP4_SEGMENT_PARSER_H_
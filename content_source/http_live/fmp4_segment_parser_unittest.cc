@@ -0,0 +1,395 @@
+/*
+ * fmp4_segment_parser_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/fmp4_segment_parser.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "api/demuxer/demuxer.h"
+#include "media/codec/codec_id.h"
+#include "media/foundation/media_errors.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr uint32_t kVideoTrackId = 1;
+constexpr uint32_t kAudioTrackId = 2;
+constexpr uint32_t kVideoTimescale = 90000;
+constexpr uint32_t kAudioTimescale = 48000;
+
+// Sample flags: an independent sync sample, and a dependent non-sync one.
+constexpr uint32_t kSyncSampleFlags = 0x02000000;
+constexpr uint32_t kNonSyncSampleFlags = 0x01010000;
+
+void Put16(Bytes* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void Put32(Bytes* out, uint32_t value) {
+  Put16(out, value >> 16);
+  Put16(out, value & 0xffff);
+}
+
+void Put64(Bytes* out, uint64_t value) {
+  Put32(out, static_cast<uint32_t>(value >> 32));
+  Put32(out, static_cast<uint32_t>(value));
+}
+
+void PutZeros(Bytes* out, size_t count) {
+  out->insert(out->end(), count, 0);
+}
+
+void Append(Bytes* out, const Bytes& bytes) {
+  out->insert(out->end(), bytes.begin(), bytes.end());
+}
+
+Bytes MakeBox(const char* type, const Bytes& payload) {
+  Bytes box;
+  Put32(&box, static_cast<uint32_t>(payload.size() + 8));
+  box.insert(box.end(), type, type + 4);
+  Append(&box, payload);
+  return box;
+}
+
+// Version 0 full box header.
+Bytes FullBoxHeader(uint32_t flags) {
+  Bytes out;
+  Put32(&out, flags & 0xffffff);
+  return out;
+}
+
+Bytes MakeTrak(uint32_t track_id,
+               uint32_t timescale,
+               const char* handler,
+               const Bytes& sample_entry) {
+  Bytes tkhd = FullBoxHeader(0);
+  PutZeros(&tkhd, 8);  // creation and modification time
+  Put32(&tkhd, track_id);
+  PutZeros(&tkhd, 84 - tkhd.size());
+
+  Bytes mdhd = FullBoxHeader(0);
+  PutZeros(&mdhd, 8);
+  Put32(&mdhd, timescale);
+  PutZeros(&mdhd, 8);  // duration, language, pre_defined
+
+  Bytes hdlr = FullBoxHeader(0);
+  PutZeros(&hdlr, 4);
+  hdlr.insert(hdlr.end(), handler, handler + 4);
+  PutZeros(&hdlr, 13);
+
+  Bytes stsd = FullBoxHeader(0);
+  Put32(&stsd, 1);
+  Append(&stsd, sample_entry);
+
+  const Bytes stbl = MakeBox("stbl", MakeBox("stsd", stsd));
+  const Bytes minf = MakeBox("minf", stbl);
+  Bytes mdia = MakeBox("mdhd", mdhd);
+  Append(&mdia, MakeBox("hdlr", hdlr));
+  Append(&mdia, minf);
+
+  Bytes trak = MakeBox("tkhd", tkhd);
+  Append(&trak, MakeBox("mdia", mdia));
+  return MakeBox("trak", trak);
+}
+
+Bytes MakeAvc1Entry() {
+  Bytes entry;
+  PutZeros(&entry, 6);
+  Put16(&entry, 1);  // data_reference_index
+  PutZeros(&entry, 16);
+  Put16(&entry, 640);
+  Put16(&entry, 360);
+  PutZeros(&entry, 78 - entry.size());
+  Append(&entry, MakeBox("avcC", {0x01, 0x64, 0x00, 0x1f, 0xff, 0xe0, 0x00}));
+  return MakeBox("avc1", entry);
+}
+
+Bytes MakeAc3Entry() {
+  Bytes entry;
+  PutZeros(&entry, 6);
+  Put16(&entry, 1);  // data_reference_index
+  PutZeros(&entry, 8);
+  Put16(&entry, 2);   // channelcount
+  Put16(&entry, 16);  // samplesize
+  PutZeros(&entry, 4);
+  Put32(&entry, kAudioTimescale << 16);
+  Append(&entry, MakeBox("dac3", {0x10, 0x3c, 0x00}));
+  return MakeBox("ac-3", entry);
+}
+
+Bytes MakeTrex(uint32_t track_id, uint32_t duration, uint32_t flags) {
+  Bytes trex = FullBoxHeader(0);
+  Put32(&trex, track_id);
+  Put32(&trex, 1);  // default_sample_description_index
+  Put32(&trex, duration);
+  Put32(&trex, 0);  // default_sample_size
+  Put32(&trex, flags);
+  return MakeBox("trex", trex);
+}
+
+// Init section with an H.264 video track whose samples default to non-sync,
+// and an AC-3 audio track.
+Bytes MakeInitSegment() {
+  Bytes moov = MakeTrak(kVideoTrackId, kVideoTimescale, "vide",
+                        MakeAvc1Entry());
+  Append(&moov,
+         MakeTrak(kAudioTrackId, kAudioTimescale, "soun", MakeAc3Entry()));
+  Bytes mvex = MakeTrex(kVideoTrackId, 3000, kNonSyncSampleFlags);
+  Append(&mvex, MakeTrex(kAudioTrackId, 1536, 0));
+  Append(&moov, MakeBox("mvex", mvex));
+
+  Bytes init = MakeBox("ftyp", {'i', 's', 'o', '6', 0, 0, 0, 0});
+  Append(&init, MakeBox("moov", moov));
+  return init;
+}
+
+struct TrunSample {
+  uint32_t size = 0;
+  // Written per sample when |per_sample_flags| is set on the run.
+  uint32_t flags = 0;
+};
+
+// traf with a tfdt and one trun whose data offset is relative to the moof.
+Bytes MakeTraf(uint32_t track_id,
+               uint64_t base_decode_time,
+               const std::vector<TrunSample>& samples,
+               uint32_t data_offset,
+               bool first_sample_flags,
+               bool per_sample_flags) {
+  Bytes tfhd = FullBoxHeader(0x020000);  // default-base-is-moof
+  Put32(&tfhd, track_id);
+
+  Bytes tfdt;
+  Put32(&tfdt, 0x01000000);  // version 1
+  Put64(&tfdt, base_decode_time);
+
+  uint32_t trun_flags = 0x000001 | 0x000200;  // data offset, sample size
+  if (first_sample_flags) {
+    trun_flags |= 0x000004;
+  }
+  if (per_sample_flags) {
+    trun_flags |= 0x000400;
+  }
+  Bytes trun = FullBoxHeader(trun_flags);
+  Put32(&trun, static_cast<uint32_t>(samples.size()));
+  Put32(&trun, data_offset);
+  if (first_sample_flags) {
+    Put32(&trun, kSyncSampleFlags);
+  }
+  for (const auto& sample : samples) {
+    Put32(&trun, sample.size);
+    if (per_sample_flags) {
+      Put32(&trun, sample.flags);
+    }
+  }
+
+  Bytes traf = MakeBox("tfhd", tfhd);
+  Append(&traf, MakeBox("tfdt", tfdt));
+  Append(&traf, MakeBox("trun", trun));
+  return MakeBox("traf", traf);
+}
+
+// Payload byte |index| of sample |sample|, so every sample is distinct.
+uint8_t PayloadByte(size_t sample, size_t index) {
+  return static_cast<uint8_t>(sample * 16 + index);
+}
+
+// moof + mdat with |samples| of |track_id|. The sync flags come from the
+// first-sample-flags field, or from the per-sample field when
+// |per_sample_flags| is set.
+Bytes MakeMediaSegment(uint32_t track_id,
+                       uint64_t base_decode_time,
+                       const std::vector<TrunSample>& samples,
+                       bool per_sample_flags) {
+  Bytes mdat;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    for (size_t j = 0; j < samples[i].size; ++j) {
+      mdat.push_back(PayloadByte(i, j));
+    }
+  }
+
+  Bytes mfhd = FullBoxHeader(0);
+  Put32(&mfhd, 1);
+
+  // The trun data offset depends on the moof size, which does not depend on
+  // the offset value; build once to measure it.
+  auto make_moof = [&](uint32_t data_offset) {
+    Bytes moof = MakeBox("mfhd", mfhd);
+    Append(&moof, MakeTraf(track_id, base_decode_time, samples, data_offset,
+                           !per_sample_flags, per_sample_flags));
+    return MakeBox("moof", moof);
+  };
+  const size_t moof_size = make_moof(0).size();
+
+  Bytes segment = make_moof(static_cast<uint32_t>(moof_size + 8));
+  Append(&segment, MakeBox("mdat", mdat));
+  return segment;
+}
+
+std::shared_ptr<const Fmp4InitSegment> ParseInit() {
+  const Bytes init_bytes = MakeInitSegment();
+  std::shared_ptr<Fmp4InitSegment> init;
+  EXPECT_EQ(Fmp4InitSegment::Parse(init_bytes.data(), init_bytes.size(), &init),
+            OK);
+  return init;
+}
+
+std::vector<std::shared_ptr<media::MediaFrame>> DrainFrames(
+    Fmp4SegmentParser* parser,
+    media::MediaType media_type) {
+  std::vector<std::shared_ptr<media::MediaFrame>> frames;
+  for (;;) {
+    std::shared_ptr<media::MediaFrame> frame;
+    if (parser->DequeueAccessUnit(media_type, frame) != OK) {
+      return frames;
+    }
+    frames.push_back(frame);
+  }
+}
+
+TEST(Fmp4SegmentParserTest, ParsesInitSegmentTracks) {
+  auto init = ParseInit();
+  ASSERT_NE(init, nullptr);
+  ASSERT_EQ(init->tracks.size(), 2u);
+
+  const auto* video = init->FindTrack(kVideoTrackId);
+  ASSERT_NE(video, nullptr);
+  EXPECT_EQ(video->media_type, media::MediaType::VIDEO);
+  EXPECT_EQ(video->timescale, kVideoTimescale);
+  EXPECT_EQ(video->default_sample_duration, 3000u);
+  EXPECT_EQ(video->default_sample_flags, kNonSyncSampleFlags);
+  EXPECT_EQ(video->format->width(), 640);
+  EXPECT_EQ(video->format->height(), 360);
+
+  const auto* audio = init->FindTrack(kAudioTrackId);
+  ASSERT_NE(audio, nullptr);
+  EXPECT_EQ(audio->media_type, media::MediaType::AUDIO);
+  EXPECT_EQ(audio->format->sample_rate(), static_cast<int>(kAudioTimescale));
+}
+
+TEST(Fmp4SegmentParserTest, EmitsSamplesWithTimingAndPayload) {
+  Fmp4SegmentParser parser(ParseInit());
+  const Bytes segment = MakeMediaSegment(
+      kVideoTrackId, kVideoTimescale, {{10}, {20}, {30}}, false);
+  ASSERT_EQ(parser.Append(segment.data(), segment.size()), OK);
+  ASSERT_EQ(parser.Finish(), OK);
+
+  EXPECT_EQ(parser.GetBaseMediaTimeUs(), 1000000);
+  auto frames = DrainFrames(&parser, media::MediaType::VIDEO);
+  ASSERT_EQ(frames.size(), 3u);
+  const size_t sizes[] = {10, 20, 30};
+  // tfdt of 1 s, then 3000 ticks at 90 kHz per sample.
+  const int64_t pts_us[] = {1000000, 1033333, 1066666};
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_EQ(frames[i]->size(), sizes[i]);
+    EXPECT_EQ(frames[i]->data()[0], PayloadByte(i, 0));
+    EXPECT_EQ(frames[i]->data()[sizes[i] - 1], PayloadByte(i, sizes[i] - 1));
+    EXPECT_EQ(frames[i]->pts().us(), pts_us[i]);
+  }
+
+  std::shared_ptr<media::MediaFrame> frame;
+  EXPECT_EQ(parser.DequeueAccessUnit(media::MediaType::VIDEO, frame),
+            media::ERROR_END_OF_STREAM);
+}
+
+TEST(Fmp4SegmentParserTest, MarksSyncSamplesFromFirstSampleFlags) {
+  Fmp4SegmentParser parser(ParseInit());
+  const Bytes segment = MakeMediaSegment(
+      kVideoTrackId, 0, {{8}, {8}, {8}}, false);
+  ASSERT_EQ(parser.Append(segment.data(), segment.size()), OK);
+
+  // The first sample overrides the non-sync trex default.
+  auto frames = DrainFrames(&parser, media::MediaType::VIDEO);
+  ASSERT_EQ(frames.size(), 3u);
+  EXPECT_NE(frames[0]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+  EXPECT_EQ(frames[1]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+  EXPECT_EQ(frames[2]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+}
+
+TEST(Fmp4SegmentParserTest, MarksSyncSamplesFromPerSampleFlags) {
+  Fmp4SegmentParser parser(ParseInit());
+  const Bytes segment = MakeMediaSegment(
+      kVideoTrackId, 0,
+      {{8, kNonSyncSampleFlags}, {8, kSyncSampleFlags},
+       {8, kNonSyncSampleFlags}},
+      true);
+  ASSERT_EQ(parser.Append(segment.data(), segment.size()), OK);
+
+  auto frames = DrainFrames(&parser, media::MediaType::VIDEO);
+  ASSERT_EQ(frames.size(), 3u);
+  EXPECT_EQ(frames[0]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+  EXPECT_NE(frames[1]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+  EXPECT_EQ(frames[2]->flags() & ACCESS_UNIT_FLAG_SYNC, 0u);
+}
+
+TEST(Fmp4SegmentParserTest, FillsAudioInfo) {
+  Fmp4SegmentParser parser(ParseInit());
+  const Bytes segment = MakeMediaSegment(
+      kAudioTrackId, kAudioTimescale, {{16, 0}, {16, 0}}, true);
+  ASSERT_EQ(parser.Append(segment.data(), segment.size()), OK);
+
+  auto frames = DrainFrames(&parser, media::MediaType::AUDIO);
+  ASSERT_EQ(frames.size(), 2u);
+  const auto* audio_info = frames[1]->audio_info();
+  ASSERT_NE(audio_info, nullptr);
+  EXPECT_EQ(audio_info->codec_id, media::CodecId::AVE_CODEC_ID_AC3);
+  EXPECT_EQ(audio_info->sample_rate_hz, static_cast<int>(kAudioTimescale));
+  EXPECT_EQ(audio_info->channel_layout, media::CHANNEL_LAYOUT_STEREO);
+  EXPECT_EQ(audio_info->bits_per_sample, 16);
+  EXPECT_EQ(audio_info->samples_per_channel, 1536);
+  EXPECT_EQ(audio_info->pts.us(), 1032000);
+}
+
+TEST(Fmp4SegmentParserTest, EmitsSamplesAsBytesArrive) {
+  Fmp4SegmentParser parser(ParseInit());
+  const Bytes segment = MakeMediaSegment(
+      kVideoTrackId, 0, {{40}, {40}, {40}}, false);
+
+  // Byte by byte: each sample appears once its last byte is appended.
+  size_t emitted = 0;
+  for (uint8_t byte : segment) {
+    ASSERT_EQ(parser.Append(&byte, 1), OK);
+    emitted += DrainFrames(&parser, media::MediaType::VIDEO).size();
+    if (emitted == 1) {
+      // Nothing of the second sample is complete yet.
+      std::shared_ptr<media::MediaFrame> frame;
+      EXPECT_EQ(parser.DequeueAccessUnit(media::MediaType::VIDEO, frame),
+                WOULD_BLOCK);
+    }
+  }
+  EXPECT_EQ(emitted, 3u);
+}
+
+TEST(Fmp4SegmentParserTest, RecyclesFramesThroughSharedPool) {
+  auto init = ParseInit();
+  auto pool = MediaFramePool::Create(media::MediaType::VIDEO);
+  const Bytes segment = MakeMediaSegment(kVideoTrackId, 0, {{64}}, false);
+
+  for (int i = 0; i < 2; ++i) {
+    Fmp4SegmentParser parser(init, nullptr, pool);
+    ASSERT_EQ(parser.Append(segment.data(), segment.size()), OK);
+    // Released at the end of the iteration.
+    EXPECT_EQ(DrainFrames(&parser, media::MediaType::VIDEO).size(), 1u);
+  }
+
+  const auto stats = pool->GetStats();
+  EXPECT_EQ(stats.acquired, 2u);
+  EXPECT_EQ(stats.reused, 1u);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
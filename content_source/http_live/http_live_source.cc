@@ -8,313 +8,80 @@
 #include "content_source/http_live/http_live_source.h"
 
 #include <algorithm>
-#include <array>
-#include <cstring>
 #include <utility>
 #include <vector>
 
-#include "base/data_source/data_source.h"
 #include "base/logging.h"
+#include "base/task_util/default_task_runner_factory.h"
 #include "base/time_utils.h"
 #include "base/units/time_delta.h"
 #include "base/units/timestamp.h"
-#include "media/foundation/media_mimes.h"
-#include "media/modules/mpeg2ts/packet_source.h"
-#include "media/modules/mpeg2ts/ts_parser.h"
+#include "content_source/data_source/http_disk_cache.h"
+#include "content_source/http_live/ts_segment_parser.h"
+#include "demuxer/nal_unit_classifier.h"
+#include "media/foundation/media_errors.h"
 
 namespace ave {
 namespace player {
 
 namespace {
 
-struct TsPacketLayout {
-  size_t sync_offset = 0;
-  size_t packet_stride = 188;
-};
-
-constexpr size_t kTsPacketSize = 188;
-constexpr size_t kM2tsPacketSize = 192;
-constexpr size_t kTsSniffPacketCount = 5;
-constexpr size_t kMaxTsSyncOffset = kM2tsPacketSize - 1;
-constexpr size_t kMaxTsPacketSpacing = 204;
-constexpr size_t kResyncProbeSize = kTsPacketSize + 512;
-constexpr size_t kResyncAdvance = 256;
-
-class MemoryDataSource : public DataSource {
- public:
-  MemoryDataSource(std::string uri, std::vector<uint8_t> data)
-      : uri_(std::move(uri)), data_(std::move(data)) {}
-
-  status_t InitCheck() const override { return OK; }
-
-  ssize_t ReadAt(off64_t offset, void* data, size_t size) override {
-    if (offset < 0 || static_cast<size_t>(offset) >= data_.size()) {
-      return 0;
-    }
-    const size_t available = data_.size() - static_cast<size_t>(offset);
-    const size_t to_copy = std::min(size, available);
-    if (to_copy > 0) {
-      std::memcpy(data, data_.data() + offset, to_copy);
-    }
-    return static_cast<ssize_t>(to_copy);
-  }
-
-  status_t GetSize(off64_t* size) override {
-    if (!size) {
-      return BAD_VALUE;
-    }
-    *size = static_cast<off64_t>(data_.size());
-    return OK;
-  }
-
-  std::string GetUri() override { return uri_; }
-
-  int32_t Flags() override { return kSeekable; }
-
- private:
-  std::string uri_;
-  std::vector<uint8_t> data_;
-};
+// Read size for segment bodies; each chunk goes to the parser as it arrives.
+constexpr size_t kFetchChunkSize = 64 * 1024;
 
 std::shared_ptr<media::MediaMeta> CloneMeta(
     const std::shared_ptr<media::MediaMeta>& meta) {
   return meta ? std::make_shared<media::MediaMeta>(*meta) : nullptr;
 }
 
-bool HasSyncPattern(const uint8_t* data,
-                    size_t size,
-                    size_t sync_offset,
-                    size_t packet_size) {
-  const size_t required =
-      sync_offset + (kTsSniffPacketCount - 1) * packet_size + 1;
-  if (size < required) {
-    return false;
-  }
-
-  for (size_t i = 0; i < kTsSniffPacketCount; ++i) {
-    if (data[sync_offset + i * packet_size] != 0x47) {
-      return false;
-    }
-  }
-  return true;
-}
-
-bool SniffTsSegment(const std::shared_ptr<ave::DataSource>& data_source,
-                    TsPacketLayout* layout) {
-  if (!data_source || !layout) {
-    return false;
-  }
-
-  std::array<uint8_t, kMaxTsSyncOffset + kTsSniffPacketCount * kM2tsPacketSize>
-      probe = {};
-  const ssize_t bytes_read = data_source->ReadAt(0, probe.data(), probe.size());
-  if (bytes_read < static_cast<ssize_t>(kTsPacketSize * kTsSniffPacketCount)) {
-    return false;
-  }
-
-  for (size_t sync_offset = 0; sync_offset <= kMaxTsSyncOffset; ++sync_offset) {
-    if (HasSyncPattern(probe.data(), bytes_read, sync_offset, kTsPacketSize)) {
-      layout->sync_offset = sync_offset;
-      layout->packet_stride = kTsPacketSize;
-      return true;
-    }
-
-    if (HasSyncPattern(probe.data(), bytes_read, sync_offset,
-                       kM2tsPacketSize)) {
-      layout->sync_offset = sync_offset;
-      layout->packet_stride = kM2tsPacketSize;
-      return true;
+int64_t FrameTimeUs(const std::shared_ptr<media::MediaFrame>& frame) {
+  if (frame->stream_type() == MediaType::AUDIO) {
+    const auto* info = frame->audio_info();
+    if (info && info->pts.IsFinite()) {
+      return info->pts.us();
     }
-  }
-
-  return false;
-}
-
-bool LooksLikePacketStart(const uint8_t* data, size_t size, size_t candidate) {
-  if (candidate >= size || data[candidate] != 0x47) {
-    return false;
-  }
-
-  if (candidate + kTsPacketSize >= size) {
-    return true;
-  }
-
-  for (size_t delta = kTsPacketSize; delta <= kMaxTsPacketSpacing; ++delta) {
-    const size_t next = candidate + delta;
-    if (next < size && data[next] == 0x47) {
-      return true;
+  } else if (frame->stream_type() == MediaType::VIDEO) {
+    const auto* info = frame->video_info();
+    if (info && info->pts.IsFinite()) {
+      return info->pts.us();
     }
   }
-
-  return false;
+  return -1;
 }
 
-bool IsTsTrackFormatReady(const std::shared_ptr<media::MediaMeta>& format) {
-  if (!format || format->mime().empty()) {
-    return false;
-  }
-
-  if (format->mime() == media::MEDIA_MIMETYPE_VIDEO_AVC) {
-    return format->private_data() && format->width() > 0 &&
-           format->height() > 0;
-  }
-
-  if (format->mime() == media::MEDIA_MIMETYPE_AUDIO_AAC) {
-    return format->private_data() && format->sample_rate() > 0;
-  }
-
-  return true;
-}
-
-class TsSegmentExtractor {
- public:
-  explicit TsSegmentExtractor(std::shared_ptr<ave::DataSource> data_source)
-      : data_source_(std::move(data_source)) {}
-
-  status_t Parse() {
-    if (!SniffTsSegment(data_source_, &layout_)) {
-      return media::ERROR_UNSUPPORTED;
-    }
-
-    parser_ = std::make_unique<media::mpeg2ts::TSParser>();
-    offset_ = static_cast<off64_t>(layout_.sync_offset);
-
-    for (;;) {
-      const status_t err = FeedMore();
-      MaybeAddTrack(media::mpeg2ts::TSParser::VIDEO);
-      MaybeAddTrack(media::mpeg2ts::TSParser::AUDIO);
-
-      if (err == media::ERROR_END_OF_STREAM) {
-        break;
-      }
-      if (err != OK) {
-        return err;
-      }
-    }
-
-    MaybeAddTrack(media::mpeg2ts::TSParser::VIDEO);
-    MaybeAddTrack(media::mpeg2ts::TSParser::AUDIO);
-
-    return audio_source_ || video_source_
-               ? static_cast<status_t>(OK)
-               : static_cast<status_t>(media::ERROR_UNSUPPORTED);
-  }
-
-  std::shared_ptr<media::mpeg2ts::PacketSource> GetSource(
-      MediaType media_type) const {
-    switch (media_type) {
-      case MediaType::AUDIO:
-        return audio_source_;
-      case MediaType::VIDEO:
-        return video_source_;
-      default:
-        return nullptr;
-    }
-  }
-
- private:
-  void SignalParserEOS(status_t result) {
-    if (!eos_signaled_ && parser_) {
-      parser_->SignalEOS(result);
-      eos_signaled_ = true;
-    }
-  }
-
-  void MaybeAddTrack(media::mpeg2ts::TSParser::SourceType type) {
-    auto& track = type == media::mpeg2ts::TSParser::AUDIO ? audio_source_
-                                                          : video_source_;
-    if (track || !parser_) {
-      return;
-    }
-
-    auto source = parser_->GetSource(type);
-    if (!source || !IsTsTrackFormatReady(source->GetFormat())) {
-      return;
-    }
-
-    track = std::move(source);
-  }
-
-  status_t FeedMore() {
-    if (eos_signaled_) {
-      return media::ERROR_END_OF_STREAM;
-    }
-
-    uint8_t probe[kResyncProbeSize];
-    uint8_t packet[kTsPacketSize];
-
-    for (;;) {
-      const ssize_t probe_read = data_source_->ReadAt(offset_, probe, sizeof(probe));
-      if (probe_read < static_cast<ssize_t>(kTsPacketSize)) {
-        const status_t final_result =
-            probe_read < 0 ? static_cast<status_t>(probe_read)
-                           : static_cast<status_t>(media::ERROR_END_OF_STREAM);
-        SignalParserEOS(final_result);
-        return final_result;
-      }
-
-      bool found_candidate = false;
-      const size_t limit = static_cast<size_t>(probe_read) - kTsPacketSize + 1;
-      for (size_t candidate = 0; candidate < limit; ++candidate) {
-        if (!LooksLikePacketStart(probe, static_cast<size_t>(probe_read),
-                                  candidate)) {
-          continue;
-        }
-
-        const off64_t packet_offset = offset_ + static_cast<off64_t>(candidate);
-        const ssize_t bytes_read =
-            data_source_->ReadAt(packet_offset, packet, sizeof(packet));
-        if (bytes_read < static_cast<ssize_t>(sizeof(packet))) {
-          const status_t final_result =
-              bytes_read < 0 ? static_cast<status_t>(bytes_read)
-                             : static_cast<status_t>(media::ERROR_END_OF_STREAM);
-          SignalParserEOS(final_result);
-          return final_result;
-        }
-
-        media::mpeg2ts::TSParser::SyncEvent event(packet_offset);
-        const status_t err = parser_->FeedTSPacket(packet, sizeof(packet), &event);
-        if (err == media::ERROR_MALFORMED) {
-          offset_ = packet_offset + 1;
-          found_candidate = true;
-          break;
-        }
-
-        offset_ = packet_offset + static_cast<off64_t>(layout_.packet_stride);
-        if (err != OK) {
-          SignalParserEOS(err);
-        }
-        return err;
-      }
-
-      if (found_candidate) {
-        continue;
-      }
-
-      if (probe_read < static_cast<ssize_t>(sizeof(probe))) {
-        SignalParserEOS(media::ERROR_END_OF_STREAM);
-        return media::ERROR_END_OF_STREAM;
-      }
-
-      offset_ += kResyncAdvance;
-    }
-  }
-
-  std::shared_ptr<ave::DataSource> data_source_;
-  std::unique_ptr<media::mpeg2ts::TSParser> parser_;
-  std::shared_ptr<media::mpeg2ts::PacketSource> audio_source_;
-  std::shared_ptr<media::mpeg2ts::PacketSource> video_source_;
-  TsPacketLayout layout_;
-  off64_t offset_ = 0;
-  bool eos_signaled_ = false;
-};
-
 }  // namespace
 
 HttpLiveSource::HttpLiveSource(std::shared_ptr<net::HTTPProvider> http_provider)
-    : http_provider_(std::move(http_provider)) {}
-
-HttpLiveSource::~HttpLiveSource() = default;
+    : HttpLiveSource(std::move(http_provider), Config()) {}
+
+HttpLiveSource::HttpLiveSource(std::shared_ptr<net::HTTPProvider> http_provider,
+                               Config config)
+    : http_provider_(std::move(http_provider)),
+      config_(config),
+      connection_pool_(
+          http_provider_ ? std::make_shared<http_live::ConnectionPool>(
+                               http_provider_, config_.connections)
+                         : nullptr),
+      task_runner_factory_(base::CreateDefaultTaskRunnerFactory()),
+      playlist_runner_(std::make_unique<base::TaskRunner>(
+          task_runner_factory_->CreateTaskRunner(
+              "HlsPlaylist",
+              base::TaskRunnerFactory::Priority::NORMAL))),
+      abr_(config_.abr),
+      audio_frame_pool_(MediaFramePool::Create(MediaType::AUDIO)),
+      video_frame_pool_(MediaFramePool::Create(MediaType::VIDEO)) {}
+
+HttpLiveSource::~HttpLiveSource() {
+  {
+    // The download workers post to playlist_runner_, so they are joined
+    // first; the playlist tasks still queued find their generation stale.
+    std::lock_guard<std::mutex> lock(lock_);
+    ++fetch_generation_;
+    ++playlist_generation_;
+    downloader_.reset();
+  }
+  playlist_runner_.reset();
+}
 
 status_t HttpLiveSource::SetDataSource(
     const char* url,
@@ -410,7 +177,37 @@ status_t HttpLiveSource::DequeueAccessUnit(
                           : static_cast<status_t>(WOULD_BLOCK);
   }
 
-  return track->packet_source->DequeueAccessUnit(access_unit);
+  status_t err = track->packet_source->DequeueAccessUnit(access_unit);
+  if (err == OK && access_unit) {
+    const int64_t time_us = FrameTimeUs(access_unit);
+    if (time_us >= 0) {
+      last_dequeued_time_us_ = std::max(last_dequeued_time_us_, time_us);
+    }
+  }
+  return err;
+}
+
+status_t HttpLiveSource::RequestDataAvailableNotify(
+    MediaType track_type,
+    std::shared_ptr<media::Message> notify) {
+  std::lock_guard<std::mutex> lock(lock_);
+  TrackState* track = FindTrackLocked(track_type);
+  if (!track || !track->packet_source) {
+    return INVALID_OPERATION;
+  }
+
+  status_t result = OK;
+  if (end_of_stream_ || track->packet_source->HasBufferAvailable(&result)) {
+    track->data_available_notify.reset();
+    notify->post();
+    return OK;
+  }
+  // The next call to QueueAccessUnitsLocked() for the track posts it. Bytes
+  // downloaded since the caller last fed are parsed right away, later ones
+  // as they arrive.
+  track->data_available_notify = std::move(notify);
+  PostFeedWaitingTracks();
+  return OK;
 }
 
 std::shared_ptr<media::MediaMeta> HttpLiveSource::GetFormat() {
@@ -472,26 +269,15 @@ status_t HttpLiveSource::SeekTo(int64_t seek_time_us, SeekMode /* mode */) {
       }
     }
 
+    CancelDownloadsLocked();
     end_of_stream_ = false;
-    next_segment_sequence_ = playlist_.media_sequence;
-    next_segment_start_time_us_ = 0;
-
-    int64_t accumulated_us = 0;
-    bool found_segment = false;
-    for (const auto& segment : playlist_.segments) {
-      if (accumulated_us + segment.duration_us > seek_time_us) {
-        next_segment_sequence_ = segment.sequence;
-        next_segment_start_time_us_ = accumulated_us;
-        found_segment = true;
-        break;
-      }
-      accumulated_us += segment.duration_us;
-    }
-
-    if (!found_segment) {
-      next_segment_sequence_ =
-          playlist_.media_sequence + static_cast<int32_t>(playlist_.segments.size());
-      next_segment_start_time_us_ = accumulated_us;
+    last_dequeued_time_us_ = seek_time_us;
+    next_segment_sequence_ = segment_index_.SequenceForTime(seek_time_us);
+    next_segment_start_time_us_ =
+        segment_index_.StartTimeUs(next_segment_sequence_);
+    next_download_sequence_ = next_segment_sequence_;
+    next_download_start_time_us_ = next_segment_start_time_us_;
+    if (next_segment_sequence_ >= EndSequenceLocked()) {
       end_of_stream_ = true;
       return media::ERROR_END_OF_STREAM;
     }
@@ -505,8 +291,23 @@ bool HttpLiveSource::IsStreaming() const {
   return playlist_.is_live;
 }
 
+http_live::ConnectionPool::Stats HttpLiveSource::GetConnectionStats() const {
+  return connection_pool_ ? connection_pool_->GetStats()
+                          : http_live::ConnectionPool::Stats();
+}
+
+http_live::SegmentCache::Stats HttpLiveSource::GetSegmentCacheStats() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return segment_cache_ ? segment_cache_->GetStats()
+                        : http_live::SegmentCache::Stats();
+}
+
 status_t HttpLiveSource::FeedMoreESData() {
   std::lock_guard<std::mutex> lock(lock_);
+  return FeedMoreESDataLocked();
+}
+
+status_t HttpLiveSource::FeedMoreESDataLocked() {
   if (!prepared_) {
     return INVALID_OPERATION;
   }
@@ -514,15 +315,42 @@ status_t HttpLiveSource::FeedMoreESData() {
     return media::ERROR_END_OF_STREAM;
   }
 
-  status_t err = LoadNextSegmentLocked();
+  status_t err = LoadNextSegmentLocked(false);
   if (err == media::ERROR_END_OF_STREAM) {
     AVE_LOG(LS_INFO) << "HttpLiveSource reached EOS at sequence="
                      << next_segment_sequence_;
     end_of_stream_ = true;
+    // Nothing more is coming; consumers waiting for data find the end.
+    PostDataAvailableNotifiesLocked();
   }
   return err;
 }
 
+void HttpLiveSource::PostFeedWaitingTracks() {
+  if (feed_pending_.exchange(true)) {
+    return;
+  }
+  playlist_runner_->PostTask([this]() {
+    feed_pending_ = false;
+    std::lock_guard<std::mutex> lock(lock_);
+    FeedWaitingTracksLocked();
+  });
+}
+
+void HttpLiveSource::FeedWaitingTracksLocked() {
+  if (!prepared_ || end_of_stream_ ||
+      std::none_of(tracks_.begin(), tracks_.end(), [](const TrackState& track) {
+        return track.data_available_notify != nullptr;
+      })) {
+    return;
+  }
+  status_t err = FeedMoreESDataLocked();
+  if (err != OK && err != media::ERROR_END_OF_STREAM) {
+    AVE_LOG(LS_WARNING) << "HttpLiveSource failed to parse downloaded data: "
+                        << err;
+  }
+}
+
 status_t HttpLiveSource::PrepareLocked() {
   if (!http_provider_) {
     return NO_INIT;
@@ -531,12 +359,41 @@ status_t HttpLiveSource::PrepareLocked() {
     return BAD_VALUE;
   }
 
-  status_t err = RefreshPlaylistLocked(true);
+  status_t err = LoadPlaylistLocked();
   if (err != OK) {
     return err;
   }
 
-  err = LoadNextSegmentLocked();
+  if (!playlist_.is_live && config_.segment_cache_bytes > 0) {
+    std::shared_ptr<HttpDiskCache> disk_cache;
+    if (!config_.segment_cache_dir.empty()) {
+      disk_cache = std::make_shared<HttpDiskCache>(
+          config_.segment_cache_dir, config_.segment_cache_disk_bytes);
+      if (disk_cache->Init() != OK) {
+        AVE_LOG(LS_WARNING) << "HLS segment cache: no disk spill in "
+                            << config_.segment_cache_dir;
+        disk_cache.reset();
+      }
+    }
+    segment_cache_ = std::make_shared<http_live::SegmentCache>(
+        config_.segment_cache_bytes, std::move(disk_cache));
+  }
+
+  auto connection_pool = connection_pool_;
+  auto headers = headers_;
+  downloader_ = std::make_unique<http_live::SegmentDownloader>(
+      task_runner_factory_.get(),
+      [connection_pool, headers](
+          const http_live::SegmentRequest& request,
+          const http_live::SegmentDownloader::DataSink& sink) {
+        return FetchUrl(connection_pool, headers, request.uri, sink,
+                        request.offset, request.length);
+      },
+      config_.prefetch, segment_cache_);
+  downloader_->SetDataCallback([this]() { PostFeedWaitingTracks(); });
+
+  // Tracks are known once the start of the first segment has been parsed.
+  err = LoadNextSegmentLocked(true);
   if (err != OK && err != media::ERROR_END_OF_STREAM) {
     return err;
   }
@@ -544,62 +401,77 @@ status_t HttpLiveSource::PrepareLocked() {
   return FinishPrepareLocked();
 }
 
-status_t HttpLiveSource::RefreshPlaylistLocked(bool initial) {
-  std::string playlist_url = initial ? master_url_ : media_playlist_url_;
-  if (playlist_url.empty()) {
-    playlist_url = master_url_;
-  }
-
+status_t HttpLiveSource::LoadPlaylistLocked() {
   std::string text;
-  status_t err = FetchTextLocked(playlist_url, text);
+  status_t err = FetchTextLocked(master_url_, text);
   if (err != OK) {
     return err;
   }
 
-  http_live::Playlist parsed;
-  err = http_live::ParsePlaylist(playlist_url, text, parsed);
+  // Parsed into the scratch playlist, whose storage is left from the
+  // playlist before the current one.
+  http_live::Playlist& parsed = scratch_playlist_;
+  err = http_live::ParsePlaylist(master_url_, text, parsed);
   if (err != OK) {
     return err;
   }
 
-  if (parsed.is_encrypted || parsed.has_init_segment) {
+  if (parsed.has_unsupported_encryption) {
     return media::ERROR_UNSUPPORTED;
   }
 
   if (parsed.is_master) {
-    const auto* variant = http_live::SelectPrimaryVariant(parsed);
-    if (!variant) {
+    const auto* primary = http_live::SelectPrimaryVariant(parsed);
+    if (!primary) {
       return BAD_VALUE;
     }
-    AVE_LOG(LS_INFO) << "HttpLiveSource selected variant: uri=" << variant->uri
-                     << " bandwidth=" << variant->bandwidth_bps;
-    media_playlist_url_ = variant->uri;
-    std::string media_text;
-    err = FetchTextLocked(media_playlist_url_, media_text);
-    if (err != OK) {
-      return err;
+    variants_ = parsed.variants;
+    current_variant_ = static_cast<size_t>(primary - parsed.variants.data());
+    if (config_.enable_abr) {
+      std::vector<int64_t> bandwidths;
+      for (const auto& variant : variants_) {
+        bandwidths.push_back(variant.bandwidth_bps);
+      }
+      abr_.SetVariants(bandwidths);
+      current_variant_ = abr_.GetInitialVariant();
     }
-    err = http_live::ParsePlaylist(media_playlist_url_, media_text, parsed);
+    const auto& variant = variants_[current_variant_];
+    AVE_LOG(LS_INFO) << "HttpLiveSource selected variant: uri=" << variant.uri
+                     << " bandwidth=" << variant.bandwidth_bps;
+    media_playlist_url_ = variant.uri;
+    err = FetchMediaPlaylistLocked(media_playlist_url_, parsed);
     if (err != OK) {
       return err;
     }
-    if (parsed.is_encrypted || parsed.has_init_segment) {
-      return media::ERROR_UNSUPPORTED;
-    }
-  } else if (initial) {
-    media_playlist_url_ = playlist_url;
+  } else {
+    media_playlist_url_ = master_url_;
   }
 
-  if (initial) {
-    next_segment_sequence_ = parsed.media_sequence;
-    next_segment_start_time_us_ = 0;
-  }
+  UpdatePlaylistLocked();
+  next_segment_sequence_ = playlist_.media_sequence;
+  next_segment_start_time_us_ = 0;
+  next_download_sequence_ = next_segment_sequence_;
+  next_download_part_ = -1;
+  next_download_start_time_us_ = 0;
+  SelectLiveStartLocked();
+  return OK;
+}
 
-  playlist_ = std::move(parsed);
+// Makes scratch_playlist_ the current playlist. The old one becomes the
+// scratch playlist so that the next reload reuses its storage.
+void HttpLiveSource::UpdatePlaylistLocked() {
+  std::swap(playlist_, scratch_playlist_);
+  segment_index_.Update(playlist_);
   duration_us_ = playlist_.duration_us;
 
   if (!playlist_.is_live || playlist_.target_duration_us <= 0) {
     next_playlist_refresh_time_us_ = 0;
+  } else if (IsLowLatencyLocked() && playlist_.can_block_reload) {
+    // The next reload waits on the server for the next part.
+    next_playlist_refresh_time_us_ = 0;
+  } else if (IsLowLatencyLocked()) {
+    next_playlist_refresh_time_us_ =
+        base::TimeMicros() + playlist_.part_target_duration_us;
   } else {
     next_playlist_refresh_time_us_ =
         base::TimeMicros() + std::max<int64_t>(500000, playlist_.target_duration_us / 2);
@@ -613,175 +485,957 @@ status_t HttpLiveSource::RefreshPlaylistLocked(bool initial) {
   } else {
     source_format_->SetDuration(base::TimeDelta::Micros(duration_us_));
   }
+}
+
+// Starts live playback the hold-back distance behind the live edge, at the
+// start of a segment or, in low-latency mode, of an independent part.
+void HttpLiveSource::SelectLiveStartLocked() {
+  if (!playlist_.is_live) {
+    return;
+  }
+  const bool low_latency = IsLowLatencyLocked();
+  int64_t hold_back_us = config_.live_hold_back_us;
+  if (hold_back_us < 0) {
+    if (low_latency && playlist_.part_hold_back_us > 0) {
+      hold_back_us = playlist_.part_hold_back_us;
+    } else if (playlist_.hold_back_us > 0) {
+      hold_back_us = playlist_.hold_back_us;
+    } else {
+      hold_back_us = 3 * playlist_.target_duration_us;
+    }
+  }
+
+  struct Position {
+    int32_t sequence;
+    int32_t part;
+    int64_t duration_us;
+    bool independent;
+  };
+  std::vector<Position> positions;
+  auto add_parts = [&positions](int32_t sequence,
+                                const std::vector<http_live::MediaPlaylistPart>&
+                                    parts) {
+    for (size_t i = 0; i < parts.size(); ++i) {
+      positions.push_back({sequence, static_cast<int32_t>(i),
+                           parts[i].duration_us,
+                           i == 0 || parts[i].independent});
+    }
+  };
+  for (const auto& segment : playlist_.segments) {
+    if (low_latency && !segment.parts.empty()) {
+      add_parts(segment.sequence, segment.parts);
+    } else {
+      positions.push_back({segment.sequence, -1, segment.duration_us, true});
+    }
+  }
+  if (low_latency) {
+    add_parts(EndSequenceLocked(), playlist_.trailing_parts);
+  }
+  if (positions.empty()) {
+    return;
+  }
+
+  size_t start = 0;
+  int64_t behind_us = 0;
+  for (size_t i = positions.size(); i-- > 0;) {
+    behind_us += positions[i].duration_us;
+    if (behind_us >= hold_back_us) {
+      start = i;
+      break;
+    }
+  }
+  while (start > 0 && !positions[start].independent) {
+    --start;
+  }
+
+  next_segment_sequence_ = positions[start].sequence;
+  next_download_sequence_ = positions[start].sequence;
+  next_download_part_ = positions[start].part;
+  AVE_LOG(LS_INFO) << "HttpLiveSource live start: sequence="
+                   << next_segment_sequence_ << " part=" << next_download_part_
+                   << " hold_back_us=" << hold_back_us
+                   << " low_latency=" << low_latency;
+}
+
+// Keeps a live playlist fresh once the download stage has reached its end.
+// Reloads run on playlist_runner_ and are applied when they return, so this
+// thread never waits on the server.
+void HttpLiveSource::ReloadPlaylistLocked() {
+  if (IsLowLatencyLocked() && playlist_.can_block_reload) {
+    RequestBlockingReloadLocked();
+    return;
+  }
+  if (playlist_reload_pending_ ||
+      (next_playlist_refresh_time_us_ != 0 &&
+       base::TimeMicros() < next_playlist_refresh_time_us_)) {
+    return;
+  }
+  PostPlaylistReloadLocked(media_playlist_url_, false);
+}
+
+// Asks for the playlist update that adds the part after the last listed one.
+// The server holds the request until that part is published.
+void HttpLiveSource::RequestBlockingReloadLocked() {
+  if (playlist_reload_pending_ ||
+      base::TimeMicros() < next_playlist_refresh_time_us_) {
+    return;
+  }
+  const std::string url = http_live::AppendDeliveryDirectives(
+      media_playlist_url_, EndSequenceLocked(),
+      static_cast<int32_t>(playlist_.trailing_parts.size()),
+      playlist_.can_skip_until_us > 0);
+  PostPlaylistReloadLocked(url, true);
+}
+
+// Fetches |url| on playlist_runner_. The result is parsed and applied under
+// lock_ when it returns, unless the variant changed or the source was reset
+// in the meantime.
+void HttpLiveSource::PostPlaylistReloadLocked(const std::string& url,
+                                              bool blocking) {
+  playlist_reload_pending_ = true;
+  playlist_runner_->PostTask([this, url, blocking,
+                              generation = playlist_generation_,
+                              connection_pool = connection_pool_,
+                              headers = headers_]() {
+    std::vector<uint8_t> text;
+    status_t err = FetchUrl(connection_pool, headers, url,
+                            [&text](const uint8_t* data, size_t size) {
+                              text.insert(text.end(), data, data + size);
+                              return true;
+                            });
+    std::lock_guard<std::mutex> lock(lock_);
+    if (generation != playlist_generation_) {
+      return;
+    }
+    playlist_reload_pending_ = false;
+    if (blocking) {
+      OnBlockingReloadLocked(err, text);
+    } else {
+      OnPlaylistReloadLocked(err, text);
+    }
+  });
+}
+
+void HttpLiveSource::OnPlaylistReloadLocked(status_t err,
+                                            const std::vector<uint8_t>& text) {
+  if (err == OK) {
+    // Segments still listed are taken over rather than parsed again; they
+    // are given back to playlist_ if the update is rejected.
+    err = http_live::ParsePlaylistUpdate(
+        media_playlist_url_,
+        std::string_view(reinterpret_cast<const char*>(text.data()),
+                         text.size()),
+        playlist_, scratch_playlist_);
+  }
+  if (err != OK) {
+    AVE_LOG(LS_WARNING) << "HttpLiveSource playlist reload failed: " << err;
+    next_playlist_refresh_time_us_ =
+        base::TimeMicros() +
+        std::max<int64_t>(500000, playlist_.target_duration_us / 2);
+    return;
+  }
+
+  UpdatePlaylistLocked();
+  // New segments can be fetched right away rather than on the next poll.
+  ScheduleDownloadsLocked();
+}
+
+void HttpLiveSource::OnBlockingReloadLocked(status_t err,
+                                            const std::vector<uint8_t>& text) {
+  http_live::Playlist& parsed = scratch_playlist_;
+  if (err == OK) {
+    err = http_live::ParsePlaylist(
+        media_playlist_url_,
+        std::string_view(reinterpret_cast<const char*>(text.data()),
+                         text.size()),
+        parsed);
+  }
+  if (err == OK && (parsed.is_master || parsed.has_unsupported_encryption)) {
+    err = media::ERROR_UNSUPPORTED;
+  }
+  if (err != OK) {
+    AVE_LOG(LS_WARNING) << "HttpLiveSource blocking reload failed: " << err;
+    next_playlist_refresh_time_us_ =
+        base::TimeMicros() + std::max<int64_t>(playlist_.part_target_duration_us,
+                                               100000);
+    return;
+  }
+
+  if (http_live::MergeDeltaPlaylist(playlist_, parsed) != OK) {
+    // The skipped segments are no longer known locally; reload the whole
+    // playlist, without the delivery directives.
+    AVE_LOG(LS_WARNING) << "HttpLiveSource cannot apply delta playlist";
+    PostPlaylistReloadLocked(media_playlist_url_, false);
+    return;
+  }
+
+  UpdatePlaylistLocked();
+  // New parts can be fetched right away rather than on the next poll.
+  ScheduleDownloadsLocked();
+}
 
+bool HttpLiveSource::IsLowLatencyLocked() const {
+  return config_.enable_low_latency && playlist_.is_live &&
+         playlist_.part_target_duration_us > 0;
+}
+
+// Parts of segment |sequence|: those listed with it once it is complete, or
+// the trailing ones while it is being published.
+const std::vector<http_live::MediaPlaylistPart>* HttpLiveSource::PartsLocked(
+    int32_t sequence) const {
+  if (sequence < playlist_.media_sequence) {
+    return nullptr;
+  }
+  const int32_t end_sequence = EndSequenceLocked();
+  if (sequence < end_sequence) {
+    return &playlist_
+                .segments[static_cast<size_t>(sequence -
+                                              playlist_.media_sequence)]
+                .parts;
+  }
+  return sequence == end_sequence ? &playlist_.trailing_parts : nullptr;
+}
+
+// Duration of a fetched part; the playlist may list it by now if it was
+// requested from a preload hint.
+int64_t HttpLiveSource::PartDurationLocked(
+    const http_live::SegmentRequest& request) const {
+  const auto* parts = PartsLocked(request.sequence);
+  if (parts && static_cast<size_t>(request.part) < parts->size()) {
+    return (*parts)[static_cast<size_t>(request.part)].duration_us;
+  }
+  return request.duration_us;
+}
+
+// Parses straight into |playlist|, which is left partly filled on failure.
+status_t HttpLiveSource::FetchMediaPlaylistLocked(
+    const std::string& url,
+    http_live::Playlist& playlist) {
+  std::string text;
+  status_t err = FetchTextLocked(url, text);
+  if (err != OK) {
+    return err;
+  }
+  err = http_live::ParsePlaylist(url, text, playlist);
+  if (err != OK) {
+    return err;
+  }
+  if (playlist.is_master || playlist.has_unsupported_encryption) {
+    return media::ERROR_UNSUPPORTED;
+  }
   return OK;
 }
 
-status_t HttpLiveSource::LoadNextSegmentLocked() {
-  const int32_t first_sequence = playlist_.media_sequence;
-  const int32_t last_sequence =
-      first_sequence + static_cast<int32_t>(playlist_.segments.size());
+int64_t HttpLiveSource::BufferedDurationLocked() const {
+  return std::max<int64_t>(0,
+                           next_segment_start_time_us_ - last_dequeued_time_us_);
+}
 
-  if (next_segment_sequence_ < first_sequence) {
-    next_segment_sequence_ = first_sequence;
+// Runs at segment boundaries, after a segment has been parsed and before the
+// next ones are handed to the downloader. The playlist of the variant picked
+// is fetched on playlist_runner_ and the switch happens at the first
+// boundary after it has arrived, if the variant is still the one wanted.
+void HttpLiveSource::MaybeSwitchVariantLocked() {
+  if (!config_.enable_abr || variants_.size() < 2) {
+    return;
+  }
+  const size_t target =
+      abr_.SelectVariant(current_variant_, BufferedDurationLocked());
+  if (fetched_variant_playlist_) {
+    std::unique_ptr<http_live::Playlist> playlist =
+        std::move(fetched_variant_playlist_);
+    if (target == pending_variant_) {
+      SwitchVariantLocked(target, *playlist);
+      // The retired playlist's storage serves the next reload.
+      scratch_playlist_ = std::move(*playlist);
+      return;
+    }
   }
+  if (target == current_variant_ || variant_fetch_pending_) {
+    return;
+  }
+  RequestVariantPlaylistLocked(target);
+}
 
-  if (next_segment_sequence_ >= last_sequence) {
-    if (!playlist_.is_live) {
-      return media::ERROR_END_OF_STREAM;
+void HttpLiveSource::RequestVariantPlaylistLocked(size_t variant) {
+  const std::string url = variants_[variant].uri;
+  pending_variant_ = variant;
+  variant_fetch_pending_ = true;
+  playlist_runner_->PostTask([this, variant, url,
+                              generation = fetch_generation_,
+                              connection_pool = connection_pool_,
+                              headers = headers_]() {
+    std::string text;
+    status_t err = FetchUrl(connection_pool, headers, url,
+                            [&text](const uint8_t* data, size_t size) {
+                              text.append(reinterpret_cast<const char*>(data),
+                                          size);
+                              return true;
+                            });
+    auto parsed = std::make_unique<http_live::Playlist>();
+    if (err == OK) {
+      err = http_live::ParsePlaylist(url, text, *parsed);
+    }
+    if (err == OK && (parsed->is_master || parsed->has_unsupported_encryption)) {
+      err = media::ERROR_UNSUPPORTED;
     }
 
-    const int64_t now_us = base::TimeMicros();
-    if (next_playlist_refresh_time_us_ == 0 || now_us >= next_playlist_refresh_time_us_) {
-      status_t err = RefreshPlaylistLocked(false);
+    std::lock_guard<std::mutex> lock(lock_);
+    if (generation != fetch_generation_) {
+      return;
+    }
+    variant_fetch_pending_ = false;
+    if (err != OK) {
+      AVE_LOG(LS_WARNING) << "HttpLiveSource failed to load variant "
+                          << variant << ": " << err;
+      return;
+    }
+    fetched_variant_playlist_ = std::move(parsed);
+  });
+}
+
+// Moves downloading to |variant| from the parse position on. Segments are
+// placed at the running timeline position rather than at their own media
+// timestamps, so the timeline stays continuous across the switch. |parsed|
+// becomes the current playlist and receives the previous one.
+void HttpLiveSource::SwitchVariantLocked(size_t variant,
+                                         http_live::Playlist& parsed) {
+  const std::string& url = variants_[variant].uri;
+
+  http_live::SegmentIndex index;
+  index.Update(parsed);
+  int32_t sequence = next_segment_sequence_;
+  if (!parsed.is_live) {
+    // Variants of a VOD presentation share segment boundaries but not
+    // necessarily sequence numbers; find the segment at the same time,
+    // rounding to the nearest boundary.
+    sequence = index.SequenceForTime(next_segment_start_time_us_);
+    if (sequence < index.end_sequence() &&
+        (index.StartTimeUs(sequence) + index.StartTimeUs(sequence + 1)) / 2 <=
+            next_segment_start_time_us_) {
+      ++sequence;
+    }
+  }
+
+  AVE_LOG(LS_INFO) << "HttpLiveSource switching variant " << current_variant_
+                   << " -> " << variant << ": bandwidth="
+                   << variants_[variant].bandwidth_bps
+                   << " estimate=" << abr_.GetEstimateBps()
+                   << " buffered_us=" << BufferedDurationLocked()
+                   << " sequence=" << sequence;
+
+  // Prefetched segments belong to the old variant.
+  CancelDownloadsLocked();
+  current_variant_ = variant;
+  media_playlist_url_ = url;
+  std::swap(playlist_, parsed);
+  segment_index_ = std::move(index);
+  next_segment_sequence_ = sequence;
+  next_download_sequence_ = sequence;
+  next_download_start_time_us_ = next_segment_start_time_us_;
+}
+
+int32_t HttpLiveSource::EndSequenceLocked() const {
+  return playlist_.media_sequence +
+         static_cast<int32_t>(playlist_.segments.size());
+}
+
+// Parse stage: queues the access units of the next segment (or LL-HLS part)
+// if its download has progressed. Downloads run ahead on the
+// SegmentDownloader workers, so this only blocks when |wait_for_data| is set
+// (during Prepare).
+status_t HttpLiveSource::LoadNextSegmentLocked(bool wait_for_data) {
+  if (next_segment_sequence_ < playlist_.media_sequence) {
+    // Fell behind a live window; restart from its oldest segment.
+    CancelDownloadsLocked();
+    next_segment_sequence_ = playlist_.media_sequence;
+    next_download_sequence_ = next_segment_sequence_;
+    next_download_start_time_us_ = next_segment_start_time_us_;
+  }
+
+  if (next_download_sequence_ >= EndSequenceLocked() && playlist_.is_live) {
+    ReloadPlaylistLocked();
+  }
+
+  ScheduleDownloadsLocked();
+
+  if (segment_parser_ && next_download_sequence_ > next_segment_sequence_ &&
+      (scheduled_.empty() ||
+       scheduled_.front().sequence != next_segment_sequence_)) {
+    // The playlist now lists the segment loaded part by part as complete.
+    return FinishPartialSegmentLocked();
+  }
+
+  if (scheduled_.empty()) {
+    return playlist_.is_live || next_segment_sequence_ < EndSequenceLocked()
+               ? static_cast<status_t>(OK)
+               : static_cast<status_t>(media::ERROR_END_OF_STREAM);
+  }
+
+  for (;;) {
+    const http_live::SegmentRequest next = scheduled_.front();
+    if (!segment_parser_ && !wait_for_data) {
+      // The key and init section are fetched on playlist_runner_; the segment
+      // waits for them instead of blocking this thread.
+      status_t err = SegmentResourcesStatusLocked(next);
+      if (err == WOULD_BLOCK) {
+        return OK;
+      }
       if (err != OK) {
         return err;
       }
     }
 
-    if (next_segment_sequence_ >=
-        playlist_.media_sequence + static_cast<int32_t>(playlist_.segments.size())) {
+    http_live::DownloadedSegment chunk;
+    if (wait_for_data) {
+      if (downloader_->WaitForData(next.sequence, next.part, &chunk) != OK) {
+        return WOULD_BLOCK;
+      }
+    } else if (!downloader_->TakeData(next.sequence, next.part, &chunk)) {
+      // Nothing new since the last call.
       return OK;
     }
-  }
 
-  const size_t index =
-      static_cast<size_t>(next_segment_sequence_ - playlist_.media_sequence);
-  if (index >= playlist_.segments.size()) {
-    return WOULD_BLOCK;
+    status_t err = ParseSegmentDataLocked(chunk, chunk.complete && next.part < 0);
+    if (err != OK) {
+      return err;
+    }
+
+    if (!chunk.complete) {
+      // Prepare only needs the beginning of the first segment: keep waiting
+      // until the parser knows the tracks.
+      if (wait_for_data && !segment_parser_->TracksReady()) {
+        continue;
+      }
+      return OK;
+    }
+    scheduled_.pop_front();
+
+    if (next.part >= 0) {
+      // Parts are fetched as the server publishes them, so their fetch time
+      // says nothing about the link and they are kept out of the estimate.
+      next_segment_start_time_us_ += PartDurationLocked(next);
+      ScheduleDownloadsLocked();
+      if (next_download_sequence_ > next.sequence &&
+          (scheduled_.empty() || scheduled_.front().sequence != next.sequence)) {
+        return FinishPartialSegmentLocked();
+      }
+      if (wait_for_data && !segment_parser_->TracksReady() &&
+          !scheduled_.empty()) {
+        continue;
+      }
+      return OK;
+    }
+
+    if (!chunk.from_cache) {
+      abr_.OnSegmentFetched(chunk.total_bytes * chunk.concurrent_fetches,
+                            chunk.fetch_time_us);
+    }
+    next_segment_start_time_us_ += chunk.request.duration_us;
+    next_segment_sequence_ = chunk.request.sequence + 1;
+    MaybeSwitchVariantLocked();
+    ScheduleDownloadsLocked();
+    return OK;
   }
+}
 
-  const auto& segment = playlist_.segments[index];
-  AVE_LOG(LS_INFO) << "HttpLiveSource loading segment: sequence="
-                   << segment.sequence << " uri=" << segment.uri
-                   << " start_us=" << next_segment_start_time_us_
-                   << " duration_us=" << segment.duration_us;
-  status_t err = LoadSegmentLocked(segment, next_segment_start_time_us_);
+// Ends the segment loaded part by part: all of its parts have been parsed and
+// the playlist lists it as complete.
+status_t HttpLiveSource::FinishPartialSegmentLocked() {
+  http_live::DownloadedSegment end;
+  end.request.sequence = next_segment_sequence_;
+  end.complete = true;
+  status_t err = ParseSegmentDataLocked(end, true);
   if (err != OK) {
     return err;
   }
-
-  next_segment_start_time_us_ += segment.duration_us;
-  next_segment_sequence_ = segment.sequence + 1;
+  ++next_segment_sequence_;
+  MaybeSwitchVariantLocked();
+  ScheduleDownloadsLocked();
   return OK;
 }
 
-status_t HttpLiveSource::LoadSegmentLocked(
-    const http_live::MediaPlaylistSegment& segment,
-    int64_t segment_start_time_us) {
-  std::vector<uint8_t> bytes;
-  status_t err = FetchUrlLocked(segment.uri, bytes);
-  if (err != OK) {
-    return err;
+// Download stage: hands segments after the download position to the
+// downloader until its look-ahead window or byte budget is full. In
+// low-latency mode the segment at the live edge is fetched part by part as
+// the playlist announces them, including the preload-hinted part.
+void HttpLiveSource::ScheduleDownloadsLocked() {
+  if (!downloader_) {
+    return;
+  }
+  if (next_download_sequence_ < next_segment_sequence_) {
+    next_download_sequence_ = next_segment_sequence_;
+    next_download_part_ = -1;
+    next_download_start_time_us_ = next_segment_start_time_us_;
+  }
+
+  while (downloader_->CanEnqueue()) {
+    const int32_t end_sequence = EndSequenceLocked();
+    if (next_download_part_ < 0) {
+      if (next_download_sequence_ < end_sequence) {
+        const size_t index = static_cast<size_t>(next_download_sequence_ -
+                                                 playlist_.media_sequence);
+        const auto& segment = playlist_.segments[index];
+        http_live::SegmentRequest request =
+            MakeRequestLocked(next_download_sequence_);
+        request.uri = segment.uri;
+        request.duration_us = segment.duration_us;
+        EnqueueLocked(std::move(request));
+
+        next_download_start_time_us_ += segment.duration_us;
+        ++next_download_sequence_;
+        continue;
+      }
+      if (!IsLowLatencyLocked()) {
+        break;
+      }
+      next_download_part_ = 0;
+    }
+
+    const auto* parts = PartsLocked(next_download_sequence_);
+    const size_t part_count = parts ? parts->size() : 0;
+    const http_live::MediaPlaylistPart* part = nullptr;
+    if (static_cast<size_t>(next_download_part_) < part_count) {
+      part = &(*parts)[static_cast<size_t>(next_download_part_)];
+    } else if (next_download_sequence_ < end_sequence) {
+      // Every listed part of the completed segment is queued.
+      ++next_download_sequence_;
+      next_download_part_ = -1;
+      continue;
+    } else if (playlist_.has_preload_hint &&
+               static_cast<size_t>(next_download_part_) == part_count) {
+      // The server holds this request until the part is published.
+      part = &playlist_.preload_hint;
+    } else {
+      break;
+    }
+
+    http_live::SegmentRequest request =
+        MakeRequestLocked(next_download_sequence_);
+    request.part = next_download_part_;
+    request.uri = part->uri;
+    request.offset = part->offset;
+    request.length = part->length;
+    request.duration_us = part->duration_us > 0
+                              ? part->duration_us
+                              : playlist_.part_target_duration_us;
+    next_download_start_time_us_ += request.duration_us;
+    ++next_download_part_;
+    EnqueueLocked(std::move(request));
   }
+}
+
+// Request for segment |sequence| without its uri and duration. A segment
+// still being published takes the init section of the last listed one.
+http_live::SegmentRequest HttpLiveSource::MakeRequestLocked(
+    int32_t sequence) const {
+  http_live::SegmentRequest request;
+  request.sequence = sequence;
+  request.start_time_us = next_download_start_time_us_;
+  const int32_t end_sequence = EndSequenceLocked();
+  if (playlist_.segments.empty()) {
+    return request;
+  }
+  const auto& segment =
+      sequence < end_sequence
+          ? playlist_.segments[static_cast<size_t>(sequence -
+                                                   playlist_.media_sequence)]
+          : playlist_.segments.back();
+  request.discontinuity = sequence < end_sequence && segment.discontinuity;
+  request.init_uri = segment.init_uri;
+  request.init_offset = segment.init_offset;
+  request.init_length = segment.init_length;
+  request.key_uri = segment.key_uri;
+  request.has_iv = segment.has_iv;
+  request.iv = segment.iv;
+  return request;
+}
 
-  auto data_source =
-      std::make_shared<MemoryDataSource>(segment.uri, std::move(bytes));
-  return LoadTsSegmentLocked(data_source, segment_start_time_us);
+void HttpLiveSource::EnqueueLocked(http_live::SegmentRequest request) {
+  RequestSegmentResourcesLocked(request);
+  scheduled_.push_back(request);
+  downloader_->Enqueue(std::move(request));
 }
 
-status_t HttpLiveSource::LoadTsSegmentLocked(
-    const std::shared_ptr<ave::DataSource>& data_source,
-    int64_t segment_start_time_us) {
-  TsSegmentExtractor extractor(data_source);
-  status_t err = extractor.Parse();
+void HttpLiveSource::CancelDownloadsLocked() {
+  if (downloader_) {
+    downloader_->Cancel();
+  }
+  scheduled_.clear();
+  segment_parser_.reset();
+  segment_decryptor_.reset();
+  segment_tracks_.clear();
+  next_download_sequence_ = next_segment_sequence_;
+  next_download_part_ = -1;
+  next_download_start_time_us_ = next_segment_start_time_us_;
+  // A blocking reload in flight may belong to another variant.
+  ++playlist_generation_;
+  playlist_reload_pending_ = false;
+}
+
+// Feeds one chunk of the segment at the parse position to its parser and
+// queues every access unit completed by it. |end_of_segment| marks the last
+// chunk of the segment, which for LL-HLS may come after several parts.
+status_t HttpLiveSource::ParseSegmentDataLocked(
+    const http_live::DownloadedSegment& chunk,
+    bool end_of_segment) {
+  if (chunk.status != OK) {
+    AVE_LOG(LS_ERROR) << "HttpLiveSource failed to fetch segment "
+                      << chunk.request.sequence << ": " << chunk.status;
+    return chunk.status;
+  }
+
+  status_t err = OK;
+  if (!segment_parser_) {
+    AVE_LOG(LS_INFO) << "HttpLiveSource loading segment: sequence="
+                     << chunk.request.sequence << " part="
+                     << chunk.request.part << " uri=" << chunk.request.uri
+                     << " start_us=" << next_segment_start_time_us_
+                     << " duration_us=" << chunk.request.duration_us;
+    err = CreateSegmentParserLocked(chunk.request);
+    if (err != OK) {
+      return err;
+    }
+    segment_start_time_us_ = next_segment_start_time_us_;
+  }
+
+  // Encrypted bytes go through the decryptor first. It keeps the last block
+  // back for the padding, which only the end of the segment releases.
+  const uint8_t* data = chunk.data.data();
+  size_t size = chunk.data.size();
+  if (segment_decryptor_) {
+    decrypted_.clear();
+    segment_decryptor_->Update(data, size, &decrypted_);
+    if (end_of_segment) {
+      err = segment_decryptor_->Finish(&decrypted_);
+      if (err != OK) {
+        AVE_LOG(LS_ERROR) << "HttpLiveSource failed to decrypt segment "
+                          << chunk.request.sequence << ": " << err;
+      }
+    }
+    data = decrypted_.data();
+    size = decrypted_.size();
+  }
+
+  if (err == OK && size > 0) {
+    err = segment_parser_->Append(data, size);
+  }
+  if (err == OK && end_of_segment) {
+    AVE_LOG(LS_INFO) << "HttpLiveSource segment " << chunk.request.sequence
+                     << " complete: bytes=" << chunk.total_bytes
+                     << " fetch_us=" << chunk.fetch_time_us;
+    err = segment_parser_->Finish();
+  }
   if (err != OK) {
+    segment_parser_.reset();
+    segment_decryptor_.reset();
     return err;
   }
 
+  // TS timestamps are relative to the segment start; fMP4 ones are in the
+  // media timeline of the rendition, which is mapped onto the segment slot
+  // the same way so that variant switches stay continuous.
+  const int64_t base_media_time_us = segment_parser_->GetBaseMediaTimeUs();
+  const int64_t segment_offset_us =
+      segment_start_time_us_ -
+      (base_media_time_us >= 0 ? base_media_time_us : 0);
   for (MediaType media_type : {MediaType::AUDIO, MediaType::VIDEO}) {
-    auto source = extractor.GetSource(media_type);
-    if (!source) {
-      continue;
-    }
-
-    std::shared_ptr<media::MediaMeta> format = source->GetFormat();
-    if (!format) {
-      continue;
+    if (std::find(segment_tracks_.begin(), segment_tracks_.end(),
+                  media_type) == segment_tracks_.end()) {
+      std::shared_ptr<media::MediaMeta> format =
+          segment_parser_->GetFormat(media_type);
+      if (!format) {
+        continue;
+      }
+      err = EnsureTrackStateLocked(media_type, format);
+      if (err != OK) {
+        return err;
+      }
+      segment_tracks_.push_back(media_type);
     }
 
-    err = EnsureTrackStateLocked(media_type, format);
+    err = QueueAccessUnitsLocked(media_type, segment_offset_us);
     if (err != OK) {
       return err;
     }
+  }
 
-    err = QueueTsPacketsLocked(media_type, source, segment_start_time_us);
+  if (end_of_segment) {
+    segment_parser_.reset();
+    segment_decryptor_.reset();
+    segment_tracks_.clear();
+  }
+  return OK;
+}
+
+// fMP4 segments need their initialization section, fetched on first use and
+// shared by every segment that references it; others are parsed as TS.
+// Encrypted segments also get a decryptor, keyed with the IV of the
+// playlist or, without one, the media sequence number.
+status_t HttpLiveSource::CreateSegmentParserLocked(
+    const http_live::SegmentRequest& request) {
+  segment_tracks_.clear();
+  segment_decryptor_.reset();
+  if (!request.key_uri.empty()) {
+    http_live::Aes128CbcDecryptor::Block key;
+    status_t err = GetKeyLocked(request.key_uri, &key);
     if (err != OK) {
       return err;
     }
+    segment_decryptor_ = std::make_unique<http_live::Aes128CbcDecryptor>(
+        key, request.has_iv ? request.iv
+                            : http_live::Aes128CbcDecryptor::IvFromSequence(
+                                  request.sequence));
+  }
+
+  if (request.init_uri.empty()) {
+    segment_parser_ = std::make_unique<http_live::TsSegmentParser>();
+    return OK;
   }
 
+  std::shared_ptr<const http_live::Fmp4InitSegment> init;
+  status_t err = GetInitSegmentLocked(request, &init);
+  if (err != OK) {
+    return err;
+  }
+  segment_parser_ = std::make_unique<http_live::Fmp4SegmentParser>(
+      init, audio_frame_pool_, video_frame_pool_);
   return OK;
 }
 
-status_t HttpLiveSource::FetchUrlLocked(const std::string& url,
-                                        std::vector<uint8_t>& data) {
-  if (!http_provider_) {
-    return NO_INIT;
+// Starts fetching the key and init section of |request| on
+// playlist_runner_ when it is scheduled, so they are usually loaded by the
+// time the segment is parsed. While preparing they are fetched directly
+// instead.
+void HttpLiveSource::RequestSegmentResourcesLocked(
+    const http_live::SegmentRequest& request) {
+  if (!prepared_) {
+    return;
   }
-  auto connection = http_provider_->CreateConnection();
-  if (!connection || !connection->Connect(url.c_str(), headers_)) {
-    return UNKNOWN_ERROR;
+  if (!request.key_uri.empty() && keys_.count(request.key_uri) == 0 &&
+      key_fetches_.count(request.key_uri) == 0) {
+    const std::string uri = request.key_uri;
+    key_fetches_[uri] = WOULD_BLOCK;
+    FetchAsyncLocked(uri, 0, -1,
+                     [this, uri](status_t err,
+                                 const std::vector<uint8_t>& bytes) {
+                       err = OnKeyFetchedLocked(uri, err, bytes);
+                       if (err == OK) {
+                         key_fetches_.erase(uri);
+                       } else {
+                         key_fetches_[uri] = err;
+                       }
+                     });
+  }
+  if (request.init_uri.empty()) {
+    return;
+  }
+  const std::string key = InitSegmentKey(request);
+  if (init_segments_.count(key) == 0 && init_segment_fetches_.count(key) == 0) {
+    const std::string uri = request.init_uri;
+    init_segment_fetches_[key] = WOULD_BLOCK;
+    FetchAsyncLocked(uri, request.init_offset, request.init_length,
+                     [this, key, uri](status_t err,
+                                      const std::vector<uint8_t>& bytes) {
+                       err = OnInitSegmentFetchedLocked(key, uri, err, bytes);
+                       if (err == OK) {
+                         init_segment_fetches_.erase(key);
+                       } else {
+                         init_segment_fetches_[key] = err;
+                       }
+                     });
   }
+}
 
-  const off64_t size = connection->GetSize();
-  if (size < 0) {
-    connection->Disconnect();
-    return UNKNOWN_ERROR;
+// OK once the key and init section of |request| are loaded, WOULD_BLOCK
+// while they are being fetched. A failed fetch is reported once and retried
+// on the next call.
+status_t HttpLiveSource::SegmentResourcesStatusLocked(
+    const http_live::SegmentRequest& request) {
+  RequestSegmentResourcesLocked(request);
+  auto status = [](std::map<std::string, status_t>& fetches,
+                   const std::string& key) {
+    auto it = fetches.find(key);
+    if (it == fetches.end()) {
+      return static_cast<status_t>(WOULD_BLOCK);
+    }
+    const status_t err = it->second;
+    if (err != WOULD_BLOCK) {
+      fetches.erase(it);
+    }
+    return err;
+  };
+  if (!request.key_uri.empty() && keys_.count(request.key_uri) == 0) {
+    return status(key_fetches_, request.key_uri);
+  }
+  if (!request.init_uri.empty()) {
+    const std::string key = InitSegmentKey(request);
+    if (init_segments_.count(key) == 0) {
+      return status(init_segment_fetches_, key);
+    }
   }
+  return OK;
+}
 
-  data.resize(static_cast<size_t>(size));
-  size_t total_read = 0;
-  while (total_read < data.size()) {
-    ssize_t bytes_read = connection->ReadAt(
-        static_cast<off64_t>(total_read), data.data() + total_read,
-        data.size() - total_read);
-    if (bytes_read < 0) {
-      connection->Disconnect();
-      return UNKNOWN_ERROR;
+std::string HttpLiveSource::InitSegmentKey(
+    const http_live::SegmentRequest& request) {
+  return request.init_uri + "@" + std::to_string(request.init_offset) + "-" +
+         std::to_string(request.init_length);
+}
+
+// Init sections are shared by every segment that references them. Once
+// prepared they are normally loaded ahead by RequestSegmentResourcesLocked(),
+// so the direct fetch here only happens while preparing.
+status_t HttpLiveSource::GetInitSegmentLocked(
+    const http_live::SegmentRequest& request,
+    std::shared_ptr<const http_live::Fmp4InitSegment>* init) {
+  const std::string key = InitSegmentKey(request);
+  auto it = init_segments_.find(key);
+  if (it == init_segments_.end()) {
+    std::vector<uint8_t> bytes;
+    status_t err = FetchUrlLocked(request.init_uri, bytes, request.init_offset,
+                                  request.init_length);
+    err = OnInitSegmentFetchedLocked(key, request.init_uri, err, bytes);
+    if (err != OK) {
+      return err;
     }
-    if (bytes_read == 0) {
-      break;
+    it = init_segments_.find(key);
+  }
+  *init = it->second;
+  return OK;
+}
+
+status_t HttpLiveSource::OnInitSegmentFetchedLocked(
+    const std::string& key,
+    const std::string& uri,
+    status_t err,
+    const std::vector<uint8_t>& bytes) {
+  if (err != OK) {
+    AVE_LOG(LS_ERROR) << "HttpLiveSource failed to fetch init section " << uri
+                      << ": " << err;
+    return err;
+  }
+
+  std::shared_ptr<http_live::Fmp4InitSegment> parsed;
+  err = http_live::Fmp4InitSegment::Parse(bytes.data(), bytes.size(), &parsed);
+  if (err != OK) {
+    AVE_LOG(LS_ERROR) << "HttpLiveSource invalid init section " << uri << ": "
+                      << err;
+    return err;
+  }
+  AVE_LOG(LS_INFO) << "HttpLiveSource loaded init section " << key
+                   << ": tracks=" << parsed->tracks.size();
+  init_segments_.emplace(key, std::move(parsed));
+  return OK;
+}
+
+// Keys are kept for the session; a playlist rotating its key references each
+// one for a run of segments. Like init sections, they are fetched here only
+// while preparing.
+status_t HttpLiveSource::GetKeyLocked(
+    const std::string& uri,
+    http_live::Aes128CbcDecryptor::Block* key) {
+  auto it = keys_.find(uri);
+  if (it == keys_.end()) {
+    std::vector<uint8_t> bytes;
+    status_t err = FetchUrlLocked(uri, bytes);
+    err = OnKeyFetchedLocked(uri, err, bytes);
+    if (err != OK) {
+      return err;
     }
-    total_read += static_cast<size_t>(bytes_read);
+    it = keys_.find(uri);
   }
-  data.resize(total_read);
-  connection->Disconnect();
+  *key = it->second;
   return OK;
 }
 
-status_t HttpLiveSource::FetchTextLocked(const std::string& url,
-                                         std::string& text) {
-  std::vector<uint8_t> bytes;
-  status_t err = FetchUrlLocked(url, bytes);
+status_t HttpLiveSource::OnKeyFetchedLocked(const std::string& uri,
+                                            status_t err,
+                                            const std::vector<uint8_t>& bytes) {
   if (err != OK) {
+    AVE_LOG(LS_ERROR) << "HttpLiveSource failed to fetch key " << uri << ": "
+                      << err;
     return err;
   }
-  text.assign(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  http_live::Aes128CbcDecryptor::Block key;
+  if (bytes.size() != key.size()) {
+    AVE_LOG(LS_ERROR) << "HttpLiveSource invalid key " << uri
+                      << ": size=" << bytes.size();
+    return media::ERROR_MALFORMED;
+  }
+  std::copy(bytes.begin(), bytes.end(), key.begin());
+  AVE_LOG(LS_INFO) << "HttpLiveSource loaded key " << uri << " ("
+                   << http_live::Aes128CbcDecryptor::Implementation() << ")";
+  keys_.emplace(uri, key);
   return OK;
 }
 
-status_t HttpLiveSource::QueueTsPacketsLocked(
-    MediaType media_type,
-    const std::shared_ptr<media::mpeg2ts::PacketSource>& source,
-    int64_t segment_start_time_us) {
+void HttpLiveSource::FetchAsyncLocked(
+    const std::string& url,
+    int64_t offset,
+    int64_t length,
+    std::function<void(status_t err, const std::vector<uint8_t>& data)> done) {
+  playlist_runner_->PostTask([this, url, offset, length, done = std::move(done),
+                              generation = fetch_generation_,
+                              connection_pool = connection_pool_,
+                              headers = headers_]() {
+    std::vector<uint8_t> data;
+    status_t err = FetchUrl(connection_pool, headers, url,
+                            [&data](const uint8_t* bytes, size_t size) {
+                              data.insert(data.end(), bytes, bytes + size);
+                              return true;
+                            },
+                            offset, length);
+    std::lock_guard<std::mutex> lock(lock_);
+    if (generation == fetch_generation_) {
+      done(err, data);
+      // The segment waiting on the key or init section can be parsed now.
+      FeedWaitingTracksLocked();
+    }
+  });
+}
+
+status_t HttpLiveSource::QueueAccessUnitsLocked(MediaType media_type,
+                                                int64_t segment_start_time_us) {
   TrackState* track = FindTrackLocked(media_type);
   if (!track || !track->packet_source) {
     return UNKNOWN_ERROR;
   }
 
+  // Video access units are marked so a decoder falling behind can skip
+  // them. TS segments carry Annex B, fMP4 ones NAL units whose length
+  // prefixes and temporal layers are declared by the avcC/hvcC record.
+  NalStreamInfo nal_stream;
+  if (media_type == MediaType::VIDEO && track->format) {
+    const NalCodec codec = NalCodecFromMime(track->format->mime());
+    if (segment_parser_->HasLengthPrefixedNalUnits()) {
+      const auto format = segment_parser_->GetFormat(media_type);
+      const auto config = format ? format->private_data() : nullptr;
+      nal_stream =
+          NalStreamInfoFromConfig(codec, config ? config->data() : nullptr,
+                                  config ? config->size() : 0);
+    } else {
+      nal_stream.codec = codec;
+    }
+  }
+
+  // Only drains what the parser has completed so far; the segment may still
+  // be downloading.
   size_t packet_count = 0;
   for (;;) {
     std::shared_ptr<media::MediaFrame> packet;
-    status_t err = source->DequeueAccessUnit(packet);
-    if (err == media::INFO_DISCONTINUITY) {
-      continue;
-    }
-    if (err == media::ERROR_END_OF_STREAM) {
-      AVE_LOG(LS_INFO) << "HttpLiveSource queued " << packet_count
-                       << " packets for "
-                       << (media_type == MediaType::AUDIO ? "audio" : "video")
-                       << " at segment_start_us=" << segment_start_time_us;
+    status_t err = segment_parser_->DequeueAccessUnit(media_type, packet);
+    if (err == WOULD_BLOCK || err == media::ERROR_END_OF_STREAM) {
+      if (packet_count > 0 && track->data_available_notify) {
+        // Wakes the consumer that found the track empty.
+        track->data_available_notify->post();
+        track->data_available_notify.reset();
+      }
+      AVE_LOG(LS_VERBOSE) << "HttpLiveSource queued " << packet_count
+                          << " packets for "
+                          << (media_type == MediaType::AUDIO ? "audio"
+                                                             : "video")
+                          << " at segment_start_us=" << segment_start_time_us;
       return OK;
     }
     if (err != OK) {
@@ -793,6 +1447,11 @@ status_t HttpLiveSource::QueueTsPacketsLocked(
     }
 
     OffsetFrameTimestamp(packet, segment_start_time_us);
+    if (nal_stream.codec != NalCodec::kNone) {
+      const uint32_t flags =
+          ClassifyAccessUnit(nal_stream, packet->data(), packet->size());
+      packet->setFlags(packet->flags() | flags);
+    }
     track->packet_source->QueueAccessunit(packet);
     ++packet_count;
   }
@@ -827,6 +1486,15 @@ status_t HttpLiveSource::EnsureTrackStateLocked(
   return OK;
 }
 
+void HttpLiveSource::PostDataAvailableNotifiesLocked() {
+  for (auto& track : tracks_) {
+    if (track.data_available_notify) {
+      track.data_available_notify->post();
+      track.data_available_notify.reset();
+    }
+  }
+}
+
 HttpLiveSource::TrackState* HttpLiveSource::FindTrackLocked(MediaType media_type) {
   for (auto& track : tracks_) {
     if (track.media_type == media_type) {
@@ -855,16 +1523,39 @@ status_t HttpLiveSource::FinishPrepareLocked() {
 }
 
 void HttpLiveSource::ResetLocked() {
+  downloader_.reset();
+  segment_cache_.reset();
+  scheduled_.clear();
+  segment_parser_.reset();
+  segment_decryptor_.reset();
+  segment_tracks_.clear();
+  segment_start_time_us_ = 0;
+  init_segments_.clear();
+  keys_.clear();
+  init_segment_fetches_.clear();
+  key_fetches_.clear();
+  ++fetch_generation_;
+  variant_fetch_pending_ = false;
+  fetched_variant_playlist_.reset();
+  ++playlist_generation_;
+  playlist_reload_pending_ = false;
   master_url_.clear();
   media_playlist_url_.clear();
   headers_.clear();
   playlist_ = http_live::Playlist();
+  segment_index_.Clear();
   source_format_.reset();
   tracks_.clear();
   duration_us_ = -1;
   next_segment_sequence_ = 0;
   next_segment_start_time_us_ = 0;
+  next_download_sequence_ = 0;
+  next_download_part_ = -1;
+  next_download_start_time_us_ = 0;
   next_playlist_refresh_time_us_ = 0;
+  last_dequeued_time_us_ = 0;
+  variants_.clear();
+  current_variant_ = 0;
   prepared_ = false;
   started_ = false;
   end_of_stream_ = false;
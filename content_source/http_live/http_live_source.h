@@ -8,6 +8,10 @@
 #ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_HTTP_LIVE_SOURCE_H_
 #define AVP_CONTENT_SOURCE_HTTP_LIVE_HTTP_LIVE_SOURCE_H_
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -16,26 +20,59 @@
 
 #include "api/content_source/content_source.h"
 #include "base/net/http/http_provider.h"
+#include "base/task_util/task_runner.h"
+#include "base/task_util/task_runner_factory.h"
+#include "common/media_frame_pool.h"
 #include "core/packet_source.h"
 #include "media/foundation/media_meta.h"
+#include "media/foundation/message.h"
 
+#include "content_source/http_live/abr_controller.h"
+#include "content_source/http_live/aes_cbc_decryptor.h"
+#include "content_source/http_live/connection_pool.h"
 #include "content_source/http_live/playlist_parser.h"
-
-namespace ave {
-class DataSource;
-namespace media {
-namespace mpeg2ts {
-class PacketSource;
-}  // namespace mpeg2ts
-}  // namespace media
-}
+#include "content_source/http_live/fmp4_segment_parser.h"
+#include "content_source/http_live/segment_cache.h"
+#include "content_source/http_live/segment_downloader.h"
+#include "content_source/http_live/segment_index.h"
+#include "content_source/http_live/segment_parser.h"
 
 namespace ave {
 namespace player {
 
 class HttpLiveSource : public ContentSource {
  public:
+  struct Config {
+    // Segment prefetch window, see SegmentDownloader::Options.
+    http_live::SegmentDownloader::Options prefetch;
+    // Switch between the variants of a master playlist based on measured
+    // throughput. When off the highest bandwidth variant is used throughout.
+    bool enable_abr = true;
+    http_live::AbrController::Options abr;
+    // Low-Latency HLS: at the live edge, fetch partial segments as they are
+    // published and use blocking playlist reloads when the server offers
+    // them.
+    bool enable_low_latency = true;
+    // Distance behind the live edge at which live playback starts. Negative
+    // uses the playlist's PART-HOLD-BACK in low-latency mode, else its
+    // HOLD-BACK, else three target durations.
+    int64_t live_hold_back_us = -1;
+    // VOD only: memory budget of the cache of fetched segment bytes that
+    // lets seeking back replay segments without network traffic. 0
+    // disables the cache.
+    size_t segment_cache_bytes = 32 * 1024 * 1024;
+    // Existing directory that segments evicted from the memory cache are
+    // spilled to, and its byte budget. Empty disables the spill.
+    std::string segment_cache_dir;
+    int64_t segment_cache_disk_bytes = 256 * 1024 * 1024;
+    // Keep-alive reuse and the per-origin connection limit shared by
+    // playlist loads and segment prefetches.
+    http_live::ConnectionPool::Options connections;
+  };
+
   explicit HttpLiveSource(std::shared_ptr<net::HTTPProvider> http_provider);
+  HttpLiveSource(std::shared_ptr<net::HTTPProvider> http_provider,
+                 Config config);
   ~HttpLiveSource() override;
 
   status_t SetDataSource(
@@ -51,6 +88,9 @@ class HttpLiveSource : public ContentSource {
   status_t DequeueAccessUnit(MediaType track_type,
                              std::shared_ptr<media::MediaFrame>& access_unit)
       override;
+  status_t RequestDataAvailableNotify(
+      MediaType track_type,
+      std::shared_ptr<media::Message> notify) override;
   std::shared_ptr<media::MediaMeta> GetFormat() override;
   status_t GetDuration(int64_t* duration_us) override;
   size_t GetTrackCount() const override;
@@ -61,29 +101,101 @@ class HttpLiveSource : public ContentSource {
   bool IsStreaming() const override;
   status_t FeedMoreESData() override;
 
+  // Connection reuse and setup time of the requests made so far.
+  http_live::ConnectionPool::Stats GetConnectionStats() const;
+  // Hit and miss counters of the segment cache, all zero when it is off.
+  http_live::SegmentCache::Stats GetSegmentCacheStats() const;
+
  private:
   struct TrackState {
     size_t index = 0;
     MediaType media_type = MediaType::UNKNOWN;
     std::shared_ptr<media::MediaMeta> format;
     std::shared_ptr<PacketSource> packet_source;
+    // Posted once access units are queued for the track, or at end of
+    // stream, while the consumer waits for them.
+    std::shared_ptr<media::Message> data_available_notify;
   };
 
   status_t PrepareLocked();
-  status_t RefreshPlaylistLocked(bool initial);
-  status_t LoadNextSegmentLocked();
-  status_t LoadSegmentLocked(const http_live::MediaPlaylistSegment& segment,
-                             int64_t segment_start_time_us);
-  status_t LoadTsSegmentLocked(const std::shared_ptr<ave::DataSource>& data_source,
-                               int64_t segment_start_time_us);
-  status_t FetchUrlLocked(const std::string& url, std::vector<uint8_t>& data);
+  status_t LoadPlaylistLocked();
+  status_t FetchMediaPlaylistLocked(const std::string& url,
+                                    http_live::Playlist& playlist);
+  void UpdatePlaylistLocked();
+  void SelectLiveStartLocked();
+  void ReloadPlaylistLocked();
+  void RequestBlockingReloadLocked();
+  void PostPlaylistReloadLocked(const std::string& url, bool blocking);
+  void OnPlaylistReloadLocked(status_t err, const std::vector<uint8_t>& text);
+  void OnBlockingReloadLocked(status_t err, const std::vector<uint8_t>& text);
+  bool IsLowLatencyLocked() const;
+  const std::vector<http_live::MediaPlaylistPart>* PartsLocked(
+      int32_t sequence) const;
+  int64_t PartDurationLocked(const http_live::SegmentRequest& request) const;
+  void MaybeSwitchVariantLocked();
+  void RequestVariantPlaylistLocked(size_t variant);
+  void SwitchVariantLocked(size_t variant, http_live::Playlist& playlist);
+  int64_t BufferedDurationLocked() const;
+  status_t LoadNextSegmentLocked(bool wait_for_data);
+  status_t FeedMoreESDataLocked();
+  // Parses on playlist_runner_ what has been downloaded if a track waits for
+  // data, so its notify goes out once the access units are queued. Callable
+  // from any thread.
+  void PostFeedWaitingTracks();
+  void FeedWaitingTracksLocked();
+  void ScheduleDownloadsLocked();
+  http_live::SegmentRequest MakeRequestLocked(int32_t sequence) const;
+  void EnqueueLocked(http_live::SegmentRequest request);
+  void CancelDownloadsLocked();
+  int32_t EndSequenceLocked() const;
+  status_t ParseSegmentDataLocked(const http_live::DownloadedSegment& chunk,
+                                  bool end_of_segment);
+  status_t FinishPartialSegmentLocked();
+  status_t CreateSegmentParserLocked(const http_live::SegmentRequest& request);
+  void RequestSegmentResourcesLocked(const http_live::SegmentRequest& request);
+  status_t SegmentResourcesStatusLocked(
+      const http_live::SegmentRequest& request);
+  status_t GetInitSegmentLocked(
+      const http_live::SegmentRequest& request,
+      std::shared_ptr<const http_live::Fmp4InitSegment>* init);
+  status_t OnInitSegmentFetchedLocked(const std::string& key,
+                                      const std::string& uri,
+                                      status_t err,
+                                      const std::vector<uint8_t>& bytes);
+  status_t GetKeyLocked(const std::string& uri,
+                        http_live::Aes128CbcDecryptor::Block* key);
+  status_t OnKeyFetchedLocked(const std::string& uri,
+                              status_t err,
+                              const std::vector<uint8_t>& bytes);
+  static std::string InitSegmentKey(const http_live::SegmentRequest& request);
+  // Reads |url| on playlist_runner_ and hands the result to |done| under
+  // lock_, unless the source is reset first.
+  void FetchAsyncLocked(
+      const std::string& url,
+      int64_t offset,
+      int64_t length,
+      std::function<void(status_t err, const std::vector<uint8_t>& data)>
+          done);
+  // Reads [offset, offset + length) of |url|, the rest of it for a negative
+  // |length|.
+  static status_t FetchUrl(
+      const std::shared_ptr<http_live::ConnectionPool>& connection_pool,
+      const std::unordered_map<std::string, std::string>& headers,
+      const std::string& url,
+      const http_live::SegmentDownloader::DataSink& sink,
+      int64_t offset = 0,
+      int64_t length = -1);
+  status_t FetchUrlLocked(const std::string& url,
+                          std::vector<uint8_t>& data,
+                          int64_t offset = 0,
+                          int64_t length = -1);
   status_t FetchTextLocked(const std::string& url, std::string& text);
-  status_t QueueTsPacketsLocked(
-      MediaType media_type,
-      const std::shared_ptr<media::mpeg2ts::PacketSource>& source,
-      int64_t segment_start_time_us);
+  status_t QueueAccessUnitsLocked(MediaType media_type,
+                                  int64_t segment_start_time_us);
   status_t EnsureTrackStateLocked(MediaType media_type,
                                   const std::shared_ptr<media::MediaMeta>& format);
+  // Posts the data-available notify of each track waiting on one.
+  void PostDataAvailableNotifiesLocked();
   TrackState* FindTrackLocked(MediaType media_type);
   const TrackState* FindTrackLocked(MediaType media_type) const;
   status_t FinishPrepareLocked();
@@ -93,18 +205,86 @@ class HttpLiveSource : public ContentSource {
 
   Notify* notify_ = nullptr;
   std::shared_ptr<net::HTTPProvider> http_provider_;
+  const Config config_;
+  // Shared with the download and playlist workers.
+  const std::shared_ptr<http_live::ConnectionPool> connection_pool_;
+  std::unique_ptr<base::TaskRunnerFactory> task_runner_factory_;
+  // Runs blocking playlist reloads, which the server holds until the next
+  // part is published, and the fetches of variant playlists, init sections
+  // and keys, which would otherwise block the caller's thread under lock_.
+  std::unique_ptr<base::TaskRunner> playlist_runner_;
+  std::shared_ptr<http_live::SegmentCache> segment_cache_;
+  std::unique_ptr<http_live::SegmentDownloader> downloader_;
+  // A PostFeedWaitingTracks() task is queued on playlist_runner_.
+  std::atomic<bool> feed_pending_{false};
+  // Requests handed to the downloader, in order. The parse stage consumes
+  // them from the front.
+  std::deque<http_live::SegmentRequest> scheduled_;
+  http_live::AbrController abr_;
+  // Frames of the fMP4 segment parsers, shared across segments so they are
+  // recycled once played.
+  const std::shared_ptr<MediaFramePool> audio_frame_pool_;
+  const std::shared_ptr<MediaFramePool> video_frame_pool_;
+  // Parser of the segment at the parse position while it downloads, and the
+  // tracks it has registered so far.
+  std::unique_ptr<http_live::SegmentParser> segment_parser_;
+  std::vector<MediaType> segment_tracks_;
+  // Timeline position the parsed segment is mapped to.
+  int64_t segment_start_time_us_ = 0;
+  // Parsed fMP4 initialization sections, keyed by uri and byte range. A
+  // playlist normally references one per variant.
+  std::map<std::string, std::shared_ptr<const http_live::Fmp4InitSegment>>
+      init_segments_;
+  // Decrypts the parsed segment when it is AES-128 encrypted; runs across
+  // the parts of a segment loaded part by part.
+  std::unique_ptr<http_live::Aes128CbcDecryptor> segment_decryptor_;
+  std::vector<uint8_t> decrypted_;
+  // AES-128 keys by uri.
+  std::map<std::string, http_live::Aes128CbcDecryptor::Block> keys_;
+  // Init sections and keys being fetched on playlist_runner_: WOULD_BLOCK
+  // while in flight, the error once a fetch has failed.
+  std::map<std::string, status_t> init_segment_fetches_;
+  std::map<std::string, status_t> key_fetches_;
+  // Bumped to drop the results of the fetches above still in flight.
+  uint32_t fetch_generation_ = 0;
 
   std::string master_url_;
   std::string media_playlist_url_;
   std::unordered_map<std::string, std::string> headers_;
   http_live::Playlist playlist_;
+  // Parse target of playlist reloads, swapped with playlist_ once accepted so
+  // that reloads reuse the storage of earlier playlists.
+  http_live::Playlist scratch_playlist_;
+  // Segment start times of playlist_.
+  http_live::SegmentIndex segment_index_;
+  // Variants of the master playlist, empty for a plain media playlist.
+  std::vector<http_live::VariantPlaylistItem> variants_;
+  size_t current_variant_ = 0;
+  // Variant picked by the ABR whose playlist is being fetched, and the
+  // playlist once fetched, applied at the next segment boundary.
+  size_t pending_variant_ = 0;
+  bool variant_fetch_pending_ = false;
+  std::unique_ptr<http_live::Playlist> fetched_variant_playlist_;
   std::shared_ptr<media::MediaMeta> source_format_;
   std::vector<TrackState> tracks_;
 
   int64_t duration_us_ = -1;
+  // Parse position: segment whose access units get queued next, and the
+  // timeline position reached.
   int32_t next_segment_sequence_ = 0;
   int64_t next_segment_start_time_us_ = 0;
+  // Download position: next segment handed to the downloader, and its part
+  // to fetch next, -1 while segments are fetched whole.
+  int32_t next_download_sequence_ = 0;
+  int32_t next_download_part_ = -1;
+  int64_t next_download_start_time_us_ = 0;
   int64_t next_playlist_refresh_time_us_ = 0;
+  bool playlist_reload_pending_ = false;
+  // Bumped to drop the result of a playlist reload still in flight.
+  uint32_t playlist_generation_ = 0;
+  // Latest timestamp handed out by DequeueAccessUnit, used as the playback
+  // position when measuring the forward buffer.
+  int64_t last_dequeued_time_us_ = 0;
   bool prepared_ = false;
   bool started_ = false;
   bool end_of_stream_ = false;
@@ -9,8 +9,11 @@
 
 #include <algorithm>
 #include <cctype>
-#include <sstream>
-#include <unordered_map>
+#include <charconv>
+#include <iterator>
+#include <utility>
+
+#include "media/foundation/media_errors.h"
 
 namespace ave {
 namespace player {
@@ -18,18 +21,18 @@ namespace http_live {
 
 namespace {
 
-std::string Trim(const std::string& value) {
-  size_t start = 0;
-  while (start < value.size() &&
-         std::isspace(static_cast<unsigned char>(value[start]))) {
-    ++start;
+bool IsSpace(char c) {
+  return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+std::string_view Trim(std::string_view value) {
+  while (!value.empty() && IsSpace(value.front())) {
+    value.remove_prefix(1);
   }
-  size_t end = value.size();
-  while (end > start &&
-         std::isspace(static_cast<unsigned char>(value[end - 1]))) {
-    --end;
+  while (!value.empty() && IsSpace(value.back())) {
+    value.remove_suffix(1);
   }
-  return value.substr(start, end - start);
+  return value;
 }
 
 std::string ToLower(std::string value) {
@@ -38,84 +41,109 @@ std::string ToLower(std::string value) {
   return value;
 }
 
-std::string GetScheme(const std::string& uri) {
-  size_t colon = uri.find(':');
-  if (colon == std::string::npos) {
-    return {};
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) ==
+                  std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+// Strips |tag| from the front of |line| into |rest|.
+bool ConsumeTag(std::string_view line,
+                std::string_view tag,
+                std::string_view* rest) {
+  if (line.substr(0, tag.size()) != tag) {
+    return false;
   }
-  for (size_t i = 0; i < colon; ++i) {
-    unsigned char c = static_cast<unsigned char>(uri[i]);
+  *rest = line.substr(tag.size());
+  return true;
+}
+
+// Length of the scheme of |uri| ("http" in "http://..."), 0 if it has none.
+size_t SchemeLength(std::string_view uri) {
+  for (size_t i = 0; i < uri.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(uri[i]);
+    if (c == ':') {
+      return i;
+    }
     if (!std::isalpha(c) && !std::isdigit(c) && c != '+' && c != '-' &&
         c != '.') {
-      return {};
+      return 0;
     }
   }
-  return ToLower(uri.substr(0, colon));
+  return 0;
 }
 
-std::unordered_map<std::string, std::string> ParseAttributes(
-    const std::string& text) {
-  std::unordered_map<std::string, std::string> attrs;
-  std::string current;
-  bool in_quotes = false;
-  std::vector<std::string> items;
-  for (char c : text) {
-    if (c == '"') {
-      in_quotes = !in_quotes;
+// Finds attribute |key| (case-insensitive) in an attribute list and returns
+// its value without quotes. Nothing is copied.
+bool FindAttribute(std::string_view list,
+                   std::string_view key,
+                   std::string_view* value) {
+  size_t pos = 0;
+  while (pos < list.size()) {
+    const size_t eq = list.find('=', pos);
+    if (eq == std::string_view::npos) {
+      return false;
     }
-    if (c == ',' && !in_quotes) {
-      items.push_back(current);
-      current.clear();
-      continue;
+    const std::string_view name = Trim(list.substr(pos, eq - pos));
+    size_t value_start = eq + 1;
+    while (value_start < list.size() && IsSpace(list[value_start])) {
+      ++value_start;
+    }
+    size_t value_end = std::string_view::npos;
+    size_t item_end = std::string_view::npos;
+    if (value_start < list.size() && list[value_start] == '"') {
+      const size_t close = list.find('"', value_start + 1);
+      if (close != std::string_view::npos) {
+        value_end = close + 1;
+        item_end = list.find(',', value_end);
+      }
+    } else {
+      item_end = list.find(',', value_start);
+      value_end = item_end;
     }
-    current.push_back(c);
-  }
-  if (!current.empty()) {
-    items.push_back(current);
-  }
 
-  for (const std::string& item : items) {
-    size_t eq = item.find('=');
-    if (eq == std::string::npos) {
-      continue;
+    if (EqualsIgnoreCase(name, key)) {
+      std::string_view found = Trim(
+          list.substr(value_start, value_end == std::string_view::npos
+                                       ? std::string_view::npos
+                                       : value_end - value_start));
+      if (found.size() >= 2 && found.front() == '"' && found.back() == '"') {
+        found = found.substr(1, found.size() - 2);
+      }
+      *value = found;
+      return true;
     }
-    std::string key = ToLower(Trim(item.substr(0, eq)));
-    std::string value = Trim(item.substr(eq + 1));
-    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-      value = value.substr(1, value.size() - 2);
+    if (item_end == std::string_view::npos) {
+      return false;
     }
-    attrs[key] = value;
+    pos = item_end + 1;
   }
-  return attrs;
+  return false;
 }
 
-bool ParseDurationUs(const std::string& value, int64_t* duration_us) {
-  if (!duration_us) {
-    return false;
-  }
-  char* end = nullptr;
-  double seconds = std::strtod(value.c_str(), &end);
-  if (end == value.c_str()) {
-    return false;
-  }
-  *duration_us = static_cast<int64_t>(seconds * 1000000.0);
-  return true;
+bool IsYes(std::string_view list, std::string_view key) {
+  std::string_view value;
+  return FindAttribute(list, key, &value) && value == "YES";
 }
 
-bool ParseInt64(const std::string& value, int64_t* out) {
-  if (!out) {
-    return false;
+bool ParseInt64(std::string_view value, int64_t* out) {
+  value = Trim(value);
+  if (!value.empty() && value.front() == '+') {
+    value.remove_prefix(1);
   }
-  char* end = nullptr;
-  long long parsed = std::strtoll(value.c_str(), &end, 10);
-  if (end == value.c_str()) {
+  int64_t parsed = 0;
+  const auto result =
+      std::from_chars(value.data(), value.data() + value.size(), parsed);
+  if (result.ec != std::errc() || result.ptr == value.data()) {
     return false;
   }
-  *out = static_cast<int64_t>(parsed);
+  *out = parsed;
   return true;
 }
 
-bool ParseInt32(const std::string& value, int32_t* out) {
+bool ParseInt32(std::string_view value, int32_t* out) {
   int64_t parsed = 0;
   if (!ParseInt64(value, &parsed)) {
     return false;
@@ -124,182 +152,458 @@ bool ParseInt32(const std::string& value, int32_t* out) {
   return true;
 }
 
-std::string GetBasePrefix(const std::string& uri) {
-  size_t slash = uri.rfind('/');
-  if (slash == std::string::npos) {
-    return uri;
+// Decimal seconds ("6", "5.005") to microseconds, without a round trip
+// through floating point. Digits past the microsecond are dropped.
+bool ParseDurationUs(std::string_view value, int64_t* duration_us) {
+  value = Trim(value);
+  bool negative = false;
+  if (!value.empty() && (value.front() == '-' || value.front() == '+')) {
+    negative = value.front() == '-';
+    value.remove_prefix(1);
+  }
+  int64_t seconds = 0;
+  int64_t micros = 0;
+  int64_t scale = 100000;
+  bool any_digit = false;
+  bool fraction = false;
+  for (char c : value) {
+    if (c == '.' && !fraction) {
+      fraction = true;
+      continue;
+    }
+    if (c < '0' || c > '9') {
+      break;
+    }
+    any_digit = true;
+    if (!fraction) {
+      seconds = seconds * 10 + (c - '0');
+    } else if (scale > 0) {
+      micros += (c - '0') * scale;
+      scale /= 10;
+    }
   }
-  return uri.substr(0, slash + 1);
+  if (!any_digit) {
+    return false;
+  }
+  const int64_t us = seconds * 1000000 + micros;
+  *duration_us = negative ? -us : us;
+  return true;
+}
+
+bool ParseDurationAttribute(std::string_view list,
+                            std::string_view key,
+                            int64_t* duration_us) {
+  std::string_view value;
+  return FindAttribute(list, key, &value) &&
+         ParseDurationUs(value, duration_us);
 }
 
-std::string GetOrigin(const std::string& uri) {
-  size_t scheme_sep = uri.find("://");
-  if (scheme_sep == std::string::npos) {
-    return {};
+// "<length>[@<offset>]" as used by EXT-X-MAP and EXT-X-BYTERANGE.
+bool ParseByteRange(std::string_view value, int64_t* length, int64_t* offset) {
+  const size_t at = value.find('@');
+  if (!ParseInt64(value.substr(0, at), length) || *length < 0) {
+    return false;
   }
-  size_t host_end = uri.find('/', scheme_sep + 3);
-  if (host_end == std::string::npos) {
-    return uri;
+  if (at != std::string_view::npos) {
+    return ParseInt64(value.substr(at + 1), offset) && *offset >= 0;
   }
-  return uri.substr(0, host_end);
+  *offset = 0;
+  return true;
 }
 
-}  // namespace
+// "0x" followed by up to 32 hex digits, right-aligned into |iv|.
+bool ParseIv(std::string_view value, std::array<uint8_t, 16>* iv) {
+  value = Trim(value);
+  if (value.size() < 3 || value[0] != '0' ||
+      (value[1] != 'x' && value[1] != 'X')) {
+    return false;
+  }
+  value.remove_prefix(2);
+  if (value.size() > 2 * iv->size()) {
+    return false;
+  }
+  iv->fill(0);
+  size_t nibble = 2 * iv->size() - value.size();
+  for (char c : value) {
+    int digit = 0;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    (*iv)[nibble / 2] |= static_cast<uint8_t>(nibble % 2 ? digit : digit << 4);
+    ++nibble;
+  }
+  return true;
+}
 
-bool LooksLikeHlsUrl(const std::string& url) {
-  const std::string lower = ToLower(url);
-  return lower.find(".m3u8") != std::string::npos ||
-         lower.find(".m3u") != std::string::npos;
+/**
+ * Resolves relative references against one base uri. The base is split into
+ * scheme, origin and directory once, so resolving a segment uri is a single
+ * append into storage that can be reused.
+ */
+class UriResolver {
+ public:
+  explicit UriResolver(std::string_view base_uri)
+      : base_uri_(base_uri),
+        scheme_(ToLower(std::string(base_uri.substr(0, SchemeLength(base_uri))))) {
+    const size_t slash = base_uri.rfind('/');
+    prefix_length_ =
+        slash == std::string_view::npos ? base_uri.size() : slash + 1;
+    const size_t scheme_sep = base_uri.find("://");
+    if (scheme_sep == std::string_view::npos) {
+      origin_length_ = 0;
+    } else {
+      const size_t host_end = base_uri.find('/', scheme_sep + 3);
+      origin_length_ =
+          host_end == std::string_view::npos ? base_uri.size() : host_end;
+    }
+  }
+
+  void Resolve(std::string_view ref, std::string* out) const {
+    if (ref.empty()) {
+      out->assign(base_uri_);
+    } else if (SchemeLength(ref) > 0) {
+      out->assign(ref);
+    } else if (ref.substr(0, 2) == "//") {
+      out->assign(scheme_);
+      if (!scheme_.empty()) {
+        out->push_back(':');
+      }
+      out->append(ref);
+    } else if (ref.front() == '/') {
+      out->assign(base_uri_.substr(0, origin_length_));
+      out->append(ref);
+    } else {
+      out->assign(base_uri_.substr(0, prefix_length_));
+      out->append(ref);
+    }
+  }
+
+ private:
+  const std::string_view base_uri_;
+  const std::string scheme_;
+  size_t prefix_length_ = 0;
+  size_t origin_length_ = 0;
+};
+
+// Fills |part| from the attributes of EXT-X-PART.
+bool ParsePart(const UriResolver& resolver,
+               std::string_view list,
+               MediaPlaylistPart* part) {
+  std::string_view value;
+  if (!FindAttribute(list, "URI", &value)) {
+    return false;
+  }
+  resolver.Resolve(value, &part->uri);
+  if (!ParseDurationAttribute(list, "DURATION", &part->duration_us)) {
+    return false;
+  }
+  part->independent = IsYes(list, "INDEPENDENT");
+  part->offset = 0;
+  part->length = -1;
+  if (FindAttribute(list, "BYTERANGE", &value) &&
+      !ParseByteRange(value, &part->length, &part->offset)) {
+    return false;
+  }
+  return true;
 }
 
-std::string ResolveUri(const std::string& base_uri, const std::string& ref_uri) {
-  if (ref_uri.empty()) {
-    return base_uri;
+// Fills |hint| from the attributes of an EXT-X-PRELOAD-HINT of TYPE=PART.
+bool ParsePreloadHint(const UriResolver& resolver,
+                      std::string_view list,
+                      MediaPlaylistPart* hint) {
+  std::string_view value;
+  if (!FindAttribute(list, "TYPE", &value) || value != "PART") {
+    return false;
   }
-  if (!GetScheme(ref_uri).empty()) {
-    return ref_uri;
+  if (!FindAttribute(list, "URI", &value)) {
+    return false;
   }
-  if (ref_uri.rfind("//", 0) == 0) {
-    const std::string scheme = GetScheme(base_uri);
-    return scheme.empty() ? ref_uri : scheme + ":" + ref_uri;
+  *hint = MediaPlaylistPart();
+  resolver.Resolve(value, &hint->uri);
+  if (FindAttribute(list, "BYTERANGE-START", &value) &&
+      !ParseInt64(value, &hint->offset)) {
+    return false;
   }
-  if (!ref_uri.empty() && ref_uri.front() == '/') {
-    const std::string origin = GetOrigin(base_uri);
-    return origin.empty() ? ref_uri : origin + ref_uri;
+  if (FindAttribute(list, "BYTERANGE-LENGTH", &value) &&
+      !ParseInt64(value, &hint->length)) {
+    return false;
   }
-  return GetBasePrefix(base_uri) + ref_uri;
+  return true;
 }
 
-status_t ParsePlaylist(const std::string& base_uri,
-                       const std::string& playlist_text,
-                       Playlist& playlist) {
+// Segments of the previous version of a playlist that a reload takes over
+// instead of parsing them again.
+struct ReusableSegments {
+  Playlist* previous = nullptr;
+  int32_t first_sequence = 0;
+  // End of the reusable range: segments near the live edge whose parts are
+  // still listed may change and are parsed again.
+  int32_t end_sequence = 0;
+  // Where the taken segments went, to put them back if parsing fails.
+  size_t taken_first_index = 0;
+  size_t taken_count = 0;
+
+  bool Contains(int32_t sequence) const {
+    return previous && sequence >= first_sequence && sequence < end_sequence;
+  }
+};
+
+// Returns the next unused element of |items|, reusing the storage of
+// elements left from an earlier parse.
+template <typename T>
+T* NextItem(std::vector<T>& items, size_t* count) {
+  if (*count == items.size()) {
+    items.emplace_back();
+  }
+  return &items[(*count)++];
+}
+
+status_t ParsePlaylistImpl(const std::string& base_uri,
+                           std::string_view text,
+                           Playlist& playlist,
+                           ReusableSegments* reusable) {
+  // Keep the element storage of the vectors, reset everything else.
+  std::vector<MediaPlaylistSegment> segments = std::move(playlist.segments);
+  std::vector<VariantPlaylistItem> variants = std::move(playlist.variants);
+  std::vector<MediaPlaylistPart> parts = std::move(playlist.trailing_parts);
   playlist = Playlist();
+  size_t segment_count = 0;
+  size_t variant_count = 0;
+  size_t part_count = 0;
 
-  std::istringstream stream(playlist_text);
-  std::string raw_line;
+  const UriResolver resolver(base_uri);
   bool saw_header = false;
   bool pending_variant = false;
-  VariantPlaylistItem variant;
   int64_t pending_segment_duration_us = -1;
   bool pending_discontinuity = false;
-
-  while (std::getline(stream, raw_line)) {
-    std::string line = Trim(raw_line);
-    if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
-      line = Trim(line);
+  std::string init_uri;
+  int64_t init_offset = 0;
+  int64_t init_length = -1;
+  std::string key_uri;
+  bool key_has_iv = false;
+  std::array<uint8_t, 16> key_iv{};
+  status_t err = OK;
+
+  auto next_sequence = [&playlist, &segment_count]() {
+    return playlist.media_sequence + playlist.skipped_segments +
+           static_cast<int32_t>(segment_count);
+  };
+
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t line_end = text.find('\n', pos);
+    if (line_end == std::string_view::npos) {
+      line_end = text.size();
     }
+    const std::string_view line = Trim(text.substr(pos, line_end - pos));
+    pos = line_end + 1;
     if (line.empty()) {
       continue;
     }
     if (!saw_header) {
       if (line != "#EXTM3U") {
-        return BAD_VALUE;
+        err = BAD_VALUE;
+        break;
       }
       saw_header = true;
       continue;
     }
 
-    if (line.rfind("#EXT-X-STREAM-INF:", 0) == 0) {
-      playlist.is_master = true;
-      variant = VariantPlaylistItem();
-      auto attrs = ParseAttributes(line.substr(18));
-      auto it = attrs.find("bandwidth");
-      if (it != attrs.end()) {
-        ParseInt64(it->second, &variant.bandwidth_bps);
-      }
-      pending_variant = true;
-      continue;
-    }
-
-    if (line.rfind("#EXTINF:", 0) == 0) {
-      size_t colon = line.find(':');
-      size_t comma = line.find(',', colon == std::string::npos ? 0 : colon + 1);
-      const std::string duration_text =
-          line.substr(colon + 1,
-                      comma == std::string::npos ? std::string::npos
-                                                 : comma - colon - 1);
-      if (!ParseDurationUs(duration_text, &pending_segment_duration_us)) {
-        return BAD_VALUE;
-      }
-      continue;
-    }
-
-    if (line.rfind("#EXT-X-TARGETDURATION:", 0) == 0) {
-      int64_t duration_seconds = -1;
-      if (ParseInt64(line.substr(22), &duration_seconds)) {
-        playlist.target_duration_us = duration_seconds * 1000000LL;
-      }
-      continue;
-    }
-
-    if (line.rfind("#EXT-X-MEDIA-SEQUENCE:", 0) == 0) {
-      ParseInt32(line.substr(22), &playlist.media_sequence);
-      continue;
-    }
-
-    if (line == "#EXT-X-ENDLIST") {
-      playlist.end_list = true;
-      playlist.is_live = false;
-      continue;
-    }
-
-    if (line.rfind("#EXT-X-PLAYLIST-TYPE:", 0) == 0) {
-      const std::string type = ToLower(Trim(line.substr(22)));
-      if (type == "event") {
-        playlist.is_event = true;
-        playlist.is_live = true;
-      } else if (type == "vod") {
+    std::string_view rest;
+    if (line.front() == '#') {
+      // Tags of a segment taken over from the previous playlist need no
+      // parsing; the segment carries their result.
+      const bool known_segment =
+          reusable && reusable->Contains(next_sequence());
+
+      if (ConsumeTag(line, "#EXTINF:", &rest)) {
+        if (!known_segment &&
+            !ParseDurationUs(rest.substr(0, rest.find(',')),
+                             &pending_segment_duration_us)) {
+          err = BAD_VALUE;
+          break;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-STREAM-INF:", &rest)) {
+        playlist.is_master = true;
+        VariantPlaylistItem* variant = NextItem(variants, &variant_count);
+        variant->bandwidth_bps = -1;
+        std::string_view value;
+        if (FindAttribute(rest, "BANDWIDTH", &value)) {
+          ParseInt64(value, &variant->bandwidth_bps);
+        }
+        pending_variant = true;
+      } else if (ConsumeTag(line, "#EXT-X-TARGETDURATION:", &rest)) {
+        int64_t duration_seconds = -1;
+        if (ParseInt64(rest, &duration_seconds)) {
+          playlist.target_duration_us = duration_seconds * 1000000LL;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-MEDIA-SEQUENCE:", &rest)) {
+        ParseInt32(rest, &playlist.media_sequence);
+      } else if (line == "#EXT-X-ENDLIST") {
+        playlist.end_list = true;
         playlist.is_live = false;
-      }
-      continue;
-    }
-
-    if (line == "#EXT-X-DISCONTINUITY") {
-      pending_discontinuity = true;
-      continue;
-    }
-
-    if (line.rfind("#EXT-X-KEY:", 0) == 0) {
-      auto attrs = ParseAttributes(line.substr(11));
-      auto it = attrs.find("method");
-      if (it != attrs.end() && ToLower(it->second) != "none") {
+      } else if (ConsumeTag(line, "#EXT-X-PLAYLIST-TYPE:", &rest)) {
+        rest = Trim(rest);
+        if (EqualsIgnoreCase(rest, "event")) {
+          playlist.is_event = true;
+          playlist.is_live = true;
+        } else if (EqualsIgnoreCase(rest, "vod")) {
+          playlist.is_live = false;
+        }
+      } else if (line == "#EXT-X-DISCONTINUITY") {
+        pending_discontinuity = !known_segment;
+      } else if (ConsumeTag(line, "#EXT-X-KEY:", &rest)) {
+        std::string_view method;
+        if (!FindAttribute(rest, "METHOD", &method)) {
+          err = BAD_VALUE;
+          break;
+        }
+        key_uri.clear();
+        key_has_iv = false;
+        if (EqualsIgnoreCase(method, "none")) {
+          continue;
+        }
         playlist.is_encrypted = true;
+        std::string_view value;
+        if (method != "AES-128" ||
+            (FindAttribute(rest, "KEYFORMAT", &value) && value != "identity")) {
+          playlist.has_unsupported_encryption = true;
+          continue;
+        }
+        if (!FindAttribute(rest, "URI", &value) || value.empty()) {
+          err = BAD_VALUE;
+          break;
+        }
+        resolver.Resolve(value, &key_uri);
+        if (FindAttribute(rest, "IV", &value)) {
+          if (!ParseIv(value, &key_iv)) {
+            err = BAD_VALUE;
+            break;
+          }
+          key_has_iv = true;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-MAP:", &rest)) {
+        playlist.has_init_segment = true;
+        if (!key_uri.empty()) {
+          // The init section would be encrypted with the current key.
+          playlist.has_unsupported_encryption = true;
+        }
+        if (known_segment) {
+          continue;
+        }
+        std::string_view value;
+        if (!FindAttribute(rest, "URI", &value)) {
+          err = BAD_VALUE;
+          break;
+        }
+        resolver.Resolve(value, &init_uri);
+        init_offset = 0;
+        init_length = -1;
+        if (FindAttribute(rest, "BYTERANGE", &value) &&
+            !ParseByteRange(value, &init_length, &init_offset)) {
+          err = BAD_VALUE;
+          break;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-SERVER-CONTROL:", &rest)) {
+        playlist.can_block_reload = IsYes(rest, "CAN-BLOCK-RELOAD");
+        ParseDurationAttribute(rest, "CAN-SKIP-UNTIL",
+                               &playlist.can_skip_until_us);
+        ParseDurationAttribute(rest, "HOLD-BACK", &playlist.hold_back_us);
+        ParseDurationAttribute(rest, "PART-HOLD-BACK",
+                               &playlist.part_hold_back_us);
+      } else if (ConsumeTag(line, "#EXT-X-PART-INF:", &rest)) {
+        if (!ParseDurationAttribute(rest, "PART-TARGET",
+                                    &playlist.part_target_duration_us)) {
+          err = BAD_VALUE;
+          break;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-PART:", &rest)) {
+        if (known_segment) {
+          continue;
+        }
+        if (!ParsePart(resolver, rest, NextItem(parts, &part_count))) {
+          err = BAD_VALUE;
+          break;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-PRELOAD-HINT:", &rest)) {
+        // TYPE=MAP hints are ignored; init sections are fetched on first use.
+        if (ParsePreloadHint(resolver, rest, &playlist.preload_hint)) {
+          playlist.has_preload_hint = true;
+        }
+      } else if (ConsumeTag(line, "#EXT-X-SKIP:", &rest)) {
+        std::string_view value;
+        if (!FindAttribute(rest, "SKIPPED-SEGMENTS", &value) ||
+            !ParseInt32(value, &playlist.skipped_segments) ||
+            playlist.skipped_segments < 0 || segment_count != 0) {
+          err = BAD_VALUE;
+          break;
+        }
       }
       continue;
     }
 
-    if (line.rfind("#EXT-X-MAP:", 0) == 0) {
-      playlist.has_init_segment = true;
-      continue;
-    }
-
-    if (!line.empty() && line[0] == '#') {
+    if (pending_variant) {
+      resolver.Resolve(line, &variants[variant_count - 1].uri);
+      pending_variant = false;
       continue;
     }
 
-    if (pending_variant) {
-      variant.uri = ResolveUri(base_uri, line);
-      playlist.variants.push_back(variant);
-      pending_variant = false;
+    const int32_t sequence = next_sequence();
+    if (reusable && reusable->Contains(sequence)) {
+      MediaPlaylistSegment& known =
+          reusable->previous->segments[static_cast<size_t>(
+              sequence - reusable->first_sequence)];
+      if (reusable->taken_count == 0) {
+        reusable->taken_first_index = segment_count;
+      }
+      ++reusable->taken_count;
+      MediaPlaylistSegment* segment = NextItem(segments, &segment_count);
+      *segment = std::move(known);
+      init_uri = segment->init_uri;
+      init_offset = segment->init_offset;
+      init_length = segment->init_length;
+      pending_segment_duration_us = -1;
+      pending_discontinuity = false;
+      part_count = 0;
       continue;
     }
 
-    MediaPlaylistSegment segment;
-    segment.uri = ResolveUri(base_uri, line);
-    segment.duration_us = pending_segment_duration_us > 0 ? pending_segment_duration_us : 0;
-    segment.discontinuity = pending_discontinuity;
-    segment.sequence =
-        playlist.media_sequence + static_cast<int32_t>(playlist.segments.size());
-    playlist.segments.push_back(segment);
+    MediaPlaylistSegment* segment = NextItem(segments, &segment_count);
+    resolver.Resolve(line, &segment->uri);
+    segment->duration_us =
+        pending_segment_duration_us > 0 ? pending_segment_duration_us : 0;
+    segment->sequence = sequence;
+    segment->discontinuity = pending_discontinuity;
+    segment->init_uri = init_uri;
+    segment->init_offset = init_offset;
+    segment->init_length = init_length;
+    segment->key_uri = key_uri;
+    segment->has_iv = key_has_iv;
+    segment->iv = key_iv;
+    segment->parts.assign(std::make_move_iterator(parts.begin()),
+                          std::make_move_iterator(parts.begin() + part_count));
+    part_count = 0;
     pending_segment_duration_us = -1;
     pending_discontinuity = false;
   }
 
-  if (!saw_header) {
-    return BAD_VALUE;
+  segments.resize(segment_count);
+  variants.resize(variant_count);
+  parts.resize(part_count);
+  playlist.segments = std::move(segments);
+  playlist.variants = std::move(variants);
+  playlist.trailing_parts = std::move(parts);
+
+  if (err != OK) {
+    return err;
   }
-  if (pending_variant) {
+  if (!saw_header || pending_variant) {
     return BAD_VALUE;
   }
 
@@ -322,6 +626,67 @@ status_t ParsePlaylist(const std::string& base_uri,
   return OK;
 }
 
+}  // namespace
+
+bool LooksLikeHlsUrl(const std::string& url) {
+  const std::string lower = ToLower(url);
+  return lower.find(".m3u8") != std::string::npos ||
+         lower.find(".m3u") != std::string::npos;
+}
+
+std::string ResolveUri(const std::string& base_uri, const std::string& ref_uri) {
+  std::string resolved;
+  UriResolver(base_uri).Resolve(ref_uri, &resolved);
+  return resolved;
+}
+
+status_t ParsePlaylist(const std::string& base_uri,
+                       std::string_view playlist_text,
+                       Playlist& playlist) {
+  return ParsePlaylistImpl(base_uri, playlist_text, playlist, nullptr);
+}
+
+status_t ParsePlaylistUpdate(const std::string& base_uri,
+                             std::string_view playlist_text,
+                             Playlist& previous,
+                             Playlist& playlist) {
+  if (&previous == &playlist || previous.is_master ||
+      previous.segments.empty()) {
+    return ParsePlaylist(base_uri, playlist_text, playlist);
+  }
+
+  ReusableSegments reusable;
+  reusable.previous = &previous;
+  reusable.first_sequence = previous.segments.front().sequence;
+  reusable.end_sequence = reusable.first_sequence;
+  for (const auto& segment : previous.segments) {
+    if (!segment.parts.empty()) {
+      break;
+    }
+    ++reusable.end_sequence;
+  }
+
+  status_t err = ParsePlaylistImpl(base_uri, playlist_text, playlist, &reusable);
+  // A reload that can no longer be played is rejected as a whole, so the
+  // caller can keep using |previous|.
+  if (err == OK && (playlist.is_master || playlist.has_unsupported_encryption)) {
+    err = media::ERROR_UNSUPPORTED;
+  }
+  if (err != OK && reusable.taken_count > 0) {
+    // Leave |previous| as it was.
+    for (size_t i = 0; i < reusable.taken_count &&
+                       reusable.taken_first_index + i < playlist.segments.size();
+         ++i) {
+      MediaPlaylistSegment& segment =
+          playlist.segments[reusable.taken_first_index + i];
+      previous.segments[static_cast<size_t>(segment.sequence -
+                                            reusable.first_sequence)] =
+          std::move(segment);
+    }
+  }
+  return err;
+}
+
 const VariantPlaylistItem* SelectPrimaryVariant(const Playlist& playlist) {
   if (playlist.variants.empty()) {
     return nullptr;
@@ -335,6 +700,49 @@ const VariantPlaylistItem* SelectPrimaryVariant(const Playlist& playlist) {
   return best;
 }
 
+status_t MergeDeltaPlaylist(const Playlist& previous, Playlist& delta) {
+  if (delta.skipped_segments == 0) {
+    return OK;
+  }
+  const int64_t first = static_cast<int64_t>(delta.media_sequence) -
+                        previous.media_sequence;
+  const int64_t end = first + delta.skipped_segments;
+  if (first < 0 || end > static_cast<int64_t>(previous.segments.size())) {
+    return BAD_VALUE;
+  }
+
+  std::vector<MediaPlaylistSegment> segments(
+      previous.segments.begin() + first, previous.segments.begin() + end);
+  segments.insert(segments.end(),
+                  std::make_move_iterator(delta.segments.begin()),
+                  std::make_move_iterator(delta.segments.end()));
+  delta.segments = std::move(segments);
+  delta.skipped_segments = 0;
+
+  int64_t total_duration_us = 0;
+  for (const auto& segment : delta.segments) {
+    total_duration_us += segment.duration_us;
+  }
+  delta.duration_us = total_duration_us;
+  return OK;
+}
+
+std::string AppendDeliveryDirectives(const std::string& url,
+                                     int32_t msn,
+                                     int32_t part,
+                                     bool skip) {
+  std::string result = url;
+  result += url.find('?') == std::string::npos ? '?' : '&';
+  result += "_HLS_msn=" + std::to_string(msn);
+  if (part >= 0) {
+    result += "&_HLS_part=" + std::to_string(part);
+  }
+  if (skip) {
+    result += "&_HLS_skip=YES";
+  }
+  return result;
+}
+
 }  // namespace http_live
 }  // namespace player
 }  // namespace ave
@@ -8,8 +8,10 @@
 #ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_PLAYLIST_PARSER_H_
 #define AVP_CONTENT_SOURCE_HTTP_LIVE_PLAYLIST_PARSER_H_
 
+#include <array>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/errors.h"
@@ -23,11 +25,37 @@ struct VariantPlaylistItem {
   int64_t bandwidth_bps = -1;
 };
 
+// Low-Latency HLS partial segment (EXT-X-PART), or the part announced by an
+// EXT-X-PRELOAD-HINT, whose duration is not known yet.
+struct MediaPlaylistPart {
+  std::string uri;
+  int64_t duration_us = 0;
+  bool independent = false;
+  // Byte range within |uri|; a negative length means the rest of it.
+  int64_t offset = 0;
+  int64_t length = -1;
+};
+
 struct MediaPlaylistSegment {
   std::string uri;
   int64_t duration_us = 0;
   int32_t sequence = 0;
   bool discontinuity = false;
+  // Media initialization section (EXT-X-MAP) for fMP4 segments; empty uri
+  // for self-contained segments such as TS. A negative length means the
+  // whole resource.
+  std::string init_uri;
+  int64_t init_offset = 0;
+  int64_t init_length = -1;
+  // EXT-X-KEY METHOD=AES-128 in effect: the key uri, empty when the segment
+  // is not encrypted. Without an explicit IV the media sequence number is
+  // used.
+  std::string key_uri;
+  bool has_iv = false;
+  std::array<uint8_t, 16> iv{};
+  // Partial segments making up the segment, while the server still lists
+  // them (LL-HLS, near the live edge only).
+  std::vector<MediaPlaylistPart> parts;
 };
 
 struct Playlist {
@@ -37,21 +65,70 @@ struct Playlist {
   bool end_list = false;
   bool has_init_segment = false;
   bool is_encrypted = false;
+  // Encryption HttpLiveSource cannot play: a METHOD other than AES-128 (such
+  // as SAMPLE-AES), a KEYFORMAT other than identity, or an encrypted
+  // EXT-X-MAP.
+  bool has_unsupported_encryption = false;
   int64_t target_duration_us = -1;
   int64_t duration_us = -1;
   int32_t media_sequence = 0;
 
+  // EXT-X-SERVER-CONTROL.
+  bool can_block_reload = false;
+  int64_t can_skip_until_us = -1;
+  int64_t hold_back_us = -1;
+  int64_t part_hold_back_us = -1;
+  // EXT-X-PART-INF; positive for low-latency playlists.
+  int64_t part_target_duration_us = -1;
+  // Segments left out of a delta playlist (EXT-X-SKIP). Until they are
+  // restored by MergeDeltaPlaylist(), segments[0] has sequence
+  // media_sequence + skipped_segments.
+  int32_t skipped_segments = 0;
+
   std::vector<VariantPlaylistItem> variants;
   std::vector<MediaPlaylistSegment> segments;
+  // Parts of the segment after the last complete one, still being produced.
+  std::vector<MediaPlaylistPart> trailing_parts;
+  // EXT-X-PRELOAD-HINT TYPE=PART: the part that follows the last listed one.
+  bool has_preload_hint = false;
+  MediaPlaylistPart preload_hint;
 };
 
 bool LooksLikeHlsUrl(const std::string& url);
 std::string ResolveUri(const std::string& base_uri, const std::string& ref_uri);
+
+// Parses |playlist_text| in a single pass without copying it line by line.
+// The storage of |playlist| is reused, so parsing repeatedly into the same
+// object allocates little.
 status_t ParsePlaylist(const std::string& base_uri,
-                       const std::string& playlist_text,
+                       std::string_view playlist_text,
                        Playlist& playlist);
+
+// ParsePlaylist() for a reload of a media playlist. Segments that |previous|,
+// the last version of the same playlist, already lists are moved into
+// |playlist| instead of being parsed again, up to the first one that still
+// lists partial segments. Only the lines after the known segments are
+// parsed in full. |previous| is left as it was when parsing fails, and when
+// the update is a master playlist or uses unsupported encryption, which fail
+// with ERROR_UNSUPPORTED.
+status_t ParsePlaylistUpdate(const std::string& base_uri,
+                             std::string_view playlist_text,
+                             Playlist& previous,
+                             Playlist& playlist);
 const VariantPlaylistItem* SelectPrimaryVariant(const Playlist& playlist);
 
+// Restores the segments skipped by delta playlist |delta| from |previous|.
+// Fails if |previous| no longer holds all of them.
+status_t MergeDeltaPlaylist(const Playlist& previous, Playlist& delta);
+
+// Appends the LL-HLS delivery directives to a playlist url: blocks until
+// media sequence |msn| (and part |part|, if not negative) is available and,
+// with |skip|, asks for a delta update.
+std::string AppendDeliveryDirectives(const std::string& url,
+                                     int32_t msn,
+                                     int32_t part,
+                                     bool skip);
+
 }  // namespace http_live
 }  // namespace player
 }  // namespace ave
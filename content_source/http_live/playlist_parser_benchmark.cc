@@ -0,0 +1,109 @@
+/*
+ * playlist_parser_benchmark.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// Times ParsePlaylist() and ParsePlaylistUpdate() on synthetic media
+// playlists: a full parse into a fresh Playlist, a full parse into a reused
+// one, and the incremental reload of a live window that slid by a few
+// segments.
+//
+//   playlist_parser_benchmark [segments] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "content_source/http_live/playlist_parser.h"
+
+namespace {
+
+using ave::player::http_live::ParsePlaylist;
+using ave::player::http_live::ParsePlaylistUpdate;
+using ave::player::http_live::Playlist;
+
+constexpr char kBaseUri[] = "https://cdn.example.com/live/stream/index.m3u8";
+
+std::string MakePlaylist(int first_sequence, int segments) {
+  std::string text;
+  text.reserve(static_cast<size_t>(segments) * 96 + 256);
+  text += "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-TARGETDURATION:6\n";
+  text += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(first_sequence) + "\n";
+  text += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+  for (int i = 0; i < segments; ++i) {
+    const int sequence = first_sequence + i;
+    if (sequence % 500 == 0) {
+      text += "#EXT-X-DISCONTINUITY\n";
+    }
+    text += "#EXTINF:5.005,\n";
+    text += "segments/video_1080p_" + std::to_string(sequence) + ".m4s\n";
+  }
+  return text;
+}
+
+template <typename Function>
+double TimeUs(int iterations, Function&& function) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    function(i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int segments = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+  // Segments appended (and dropped) per live reload.
+  constexpr int kSlide = 3;
+
+  // Reload texts for every iteration, generated up front.
+  std::vector<std::string> reloads;
+  for (int i = 0; i <= iterations; ++i) {
+    reloads.push_back(MakePlaylist(i * kSlide, segments));
+  }
+  const std::string& text = reloads.front();
+  std::printf("%d segments, %zu bytes, %d iterations\n", segments,
+              text.size(), iterations);
+
+  const double fresh_us = TimeUs(iterations, [&text](int) {
+    Playlist playlist;
+    if (ParsePlaylist(kBaseUri, text, playlist) != ave::OK) {
+      std::abort();
+    }
+  });
+
+  Playlist reused;
+  const double reused_us = TimeUs(iterations, [&text, &reused](int) {
+    if (ParsePlaylist(kBaseUri, text, reused) != ave::OK) {
+      std::abort();
+    }
+  });
+
+  Playlist current;
+  if (ParsePlaylist(kBaseUri, reloads[0], current) != ave::OK) {
+    return 1;
+  }
+  Playlist next;
+  const double update_us =
+      TimeUs(iterations, [&reloads, &current, &next](int i) {
+        if (ParsePlaylistUpdate(kBaseUri, reloads[static_cast<size_t>(i) + 1],
+                                current, next) != ave::OK) {
+          std::abort();
+        }
+        std::swap(current, next);
+      });
+
+  std::printf("full parse, fresh playlist:   %10.1f us\n", fresh_us);
+  std::printf("full parse, reused playlist:  %10.1f us\n", reused_us);
+  std::printf("incremental reload (+%d):     %10.1f us\n", kSlide, update_us);
+  return 0;
+}
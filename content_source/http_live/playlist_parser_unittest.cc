@@ -0,0 +1,262 @@
+/*
+ * playlist_parser_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/playlist_parser.h"
+
+#include <string>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+constexpr char kBaseUri[] = "https://example.com/live/media.m3u8";
+
+constexpr char kLowLatencyPlaylist[] =
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:9\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,CAN-SKIP-UNTIL=24.0,"
+    "PART-HOLD-BACK=1.0\n"
+    "#EXT-X-PART-INF:PART-TARGET=0.33334\n"
+    "#EXT-X-MEDIA-SEQUENCE:100\n"
+    "#EXTINF:4.0,\n"
+    "seg100.mp4\n"
+    "#EXT-X-PART:DURATION=0.33334,URI=\"seg101.part0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=0.33334,URI=\"seg101.mp4\",BYTERANGE=2000@1000\n"
+    "#EXTINF:0.66668,\n"
+    "seg101.mp4\n"
+    "#EXT-X-PART:DURATION=0.33334,URI=\"seg102.part0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg102.part1.mp4\","
+    "BYTERANGE-START=0,BYTERANGE-LENGTH=4096\n";
+
+TEST(PlaylistParserTest, ParsesServerControlAndPartInf) {
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylist(kBaseUri, kLowLatencyPlaylist, playlist), OK);
+  EXPECT_TRUE(playlist.is_live);
+  EXPECT_TRUE(playlist.can_block_reload);
+  EXPECT_EQ(playlist.can_skip_until_us, 24000000);
+  EXPECT_EQ(playlist.part_hold_back_us, 1000000);
+  EXPECT_EQ(playlist.hold_back_us, -1);
+  EXPECT_EQ(playlist.part_target_duration_us, 333340);
+}
+
+TEST(PlaylistParserTest, ParsesParts) {
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylist(kBaseUri, kLowLatencyPlaylist, playlist), OK);
+  ASSERT_EQ(playlist.segments.size(), 2u);
+  EXPECT_TRUE(playlist.segments[0].parts.empty());
+
+  const auto& parts = playlist.segments[1].parts;
+  ASSERT_EQ(parts.size(), 2u);
+  EXPECT_EQ(parts[0].uri, "https://example.com/live/seg101.part0.mp4");
+  EXPECT_EQ(parts[0].duration_us, 333340);
+  EXPECT_TRUE(parts[0].independent);
+  EXPECT_EQ(parts[0].offset, 0);
+  EXPECT_EQ(parts[0].length, -1);
+  EXPECT_FALSE(parts[1].independent);
+  EXPECT_EQ(parts[1].offset, 1000);
+  EXPECT_EQ(parts[1].length, 2000);
+
+  ASSERT_EQ(playlist.trailing_parts.size(), 1u);
+  EXPECT_EQ(playlist.trailing_parts[0].uri,
+            "https://example.com/live/seg102.part0.mp4");
+}
+
+TEST(PlaylistParserTest, ParsesPreloadHint) {
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylist(kBaseUri, kLowLatencyPlaylist, playlist), OK);
+  ASSERT_TRUE(playlist.has_preload_hint);
+  EXPECT_EQ(playlist.preload_hint.uri,
+            "https://example.com/live/seg102.part1.mp4");
+  EXPECT_EQ(playlist.preload_hint.offset, 0);
+  EXPECT_EQ(playlist.preload_hint.length, 4096);
+}
+
+TEST(PlaylistParserTest, IgnoresMapPreloadHint) {
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXTINF:4.0,\n"
+                          "seg0.mp4\n"
+                          "#EXT-X-PRELOAD-HINT:TYPE=MAP,URI=\"init1.mp4\"\n",
+                          playlist),
+            OK);
+  EXPECT_FALSE(playlist.has_preload_hint);
+}
+
+TEST(PlaylistParserTest, RejectsPartWithoutDuration) {
+  Playlist playlist;
+  EXPECT_NE(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXT-X-PART:URI=\"seg0.part0.mp4\"\n",
+                          playlist),
+            OK);
+}
+
+TEST(PlaylistParserTest, ParsesSkip) {
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXT-X-MEDIA-SEQUENCE:10\n"
+                          "#EXT-X-SKIP:SKIPPED-SEGMENTS=3\n"
+                          "#EXTINF:4.0,\n"
+                          "seg13.mp4\n",
+                          playlist),
+            OK);
+  EXPECT_EQ(playlist.skipped_segments, 3);
+  ASSERT_EQ(playlist.segments.size(), 1u);
+  EXPECT_EQ(playlist.segments[0].sequence, 13);
+}
+
+TEST(PlaylistParserTest, RejectsSkipAfterSegments) {
+  Playlist playlist;
+  EXPECT_NE(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXTINF:4.0,\n"
+                          "seg0.mp4\n"
+                          "#EXT-X-SKIP:SKIPPED-SEGMENTS=1\n",
+                          playlist),
+            OK);
+}
+
+// Full playlist with segments 10..14, as loaded before a delta update.
+Playlist FullPlaylist() {
+  Playlist playlist;
+  std::string text =
+      "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:4\n"
+      "#EXT-X-MEDIA-SEQUENCE:10\n";
+  for (int i = 10; i < 15; ++i) {
+    text += "#EXTINF:4.0,\nseg" + std::to_string(i) + ".mp4\n";
+  }
+  EXPECT_EQ(ParsePlaylist(kBaseUri, text, playlist), OK);
+  return playlist;
+}
+
+TEST(PlaylistParserTest, MergeDeltaPlaylistRestoresSkippedSegments) {
+  const Playlist previous = FullPlaylist();
+  Playlist delta;
+  ASSERT_EQ(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXT-X-MEDIA-SEQUENCE:12\n"
+                          "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n"
+                          "#EXTINF:4.0,\n"
+                          "seg14.mp4\n"
+                          "#EXTINF:2.0,\n"
+                          "seg15.mp4\n",
+                          delta),
+            OK);
+
+  ASSERT_EQ(MergeDeltaPlaylist(previous, delta), OK);
+  EXPECT_EQ(delta.skipped_segments, 0);
+  ASSERT_EQ(delta.segments.size(), 4u);
+  for (size_t i = 0; i < delta.segments.size(); ++i) {
+    EXPECT_EQ(delta.segments[i].sequence, static_cast<int32_t>(12 + i));
+    EXPECT_EQ(delta.segments[i].uri, "https://example.com/live/seg" +
+                                         std::to_string(12 + i) + ".mp4");
+  }
+  EXPECT_EQ(delta.duration_us, 14000000);
+}
+
+TEST(PlaylistParserTest, MergeDeltaPlaylistFailsWithoutSkippedSegments) {
+  const Playlist previous = FullPlaylist();
+  Playlist delta;
+  // Segments 15 and 16 were skipped, but the previous playlist ends at 14.
+  ASSERT_EQ(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXT-X-MEDIA-SEQUENCE:15\n"
+                          "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n"
+                          "#EXTINF:4.0,\n"
+                          "seg17.mp4\n",
+                          delta),
+            OK);
+  EXPECT_NE(MergeDeltaPlaylist(previous, delta), OK);
+
+  // The previous playlist starts after the first skipped segment.
+  ASSERT_EQ(ParsePlaylist(kBaseUri,
+                          "#EXTM3U\n"
+                          "#EXT-X-TARGETDURATION:4\n"
+                          "#EXT-X-MEDIA-SEQUENCE:9\n"
+                          "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n"
+                          "#EXTINF:4.0,\n"
+                          "seg11.mp4\n",
+                          delta),
+            OK);
+  EXPECT_NE(MergeDeltaPlaylist(previous, delta), OK);
+}
+
+TEST(PlaylistParserTest, MergeDeltaPlaylistKeepsFullPlaylist) {
+  const Playlist previous = FullPlaylist();
+  Playlist playlist = FullPlaylist();
+  ASSERT_EQ(MergeDeltaPlaylist(previous, playlist), OK);
+  EXPECT_EQ(playlist.segments.size(), 5u);
+}
+
+TEST(PlaylistParserTest, UpdateReusesKnownSegments) {
+  Playlist previous = FullPlaylist();
+  Playlist playlist;
+  ASSERT_EQ(ParsePlaylistUpdate(kBaseUri,
+                                "#EXTM3U\n"
+                                "#EXT-X-TARGETDURATION:4\n"
+                                "#EXT-X-MEDIA-SEQUENCE:11\n"
+                                "#EXTINF:4.0,\nseg11.mp4\n"
+                                "#EXTINF:4.0,\nseg12.mp4\n"
+                                "#EXTINF:4.0,\nseg13.mp4\n"
+                                "#EXTINF:4.0,\nseg14.mp4\n"
+                                "#EXTINF:4.0,\nseg15.mp4\n",
+                                previous, playlist),
+            OK);
+  ASSERT_EQ(playlist.segments.size(), 5u);
+  EXPECT_EQ(playlist.segments[0].uri, "https://example.com/live/seg11.mp4");
+  EXPECT_EQ(playlist.segments[4].uri, "https://example.com/live/seg15.mp4");
+}
+
+TEST(PlaylistParserTest, RejectedUpdateLeavesPreviousIntact) {
+  Playlist previous = FullPlaylist();
+  Playlist playlist;
+  EXPECT_NE(ParsePlaylistUpdate(kBaseUri,
+                                "#EXTM3U\n"
+                                "#EXT-X-TARGETDURATION:4\n"
+                                "#EXT-X-MEDIA-SEQUENCE:11\n"
+                                "#EXTINF:4.0,\nseg11.mp4\n"
+                                "#EXT-X-KEY:METHOD=SAMPLE-AES,URI=\"k\"\n"
+                                "#EXTINF:4.0,\nseg12.mp4\n",
+                                previous, playlist),
+            OK);
+  ASSERT_EQ(previous.segments.size(), 5u);
+  for (size_t i = 0; i < previous.segments.size(); ++i) {
+    EXPECT_EQ(previous.segments[i].uri, "https://example.com/live/seg" +
+                                            std::to_string(10 + i) + ".mp4");
+  }
+}
+
+TEST(PlaylistParserTest, AppendDeliveryDirectives) {
+  EXPECT_EQ(AppendDeliveryDirectives("https://example.com/a.m3u8", 12, -1,
+                                     false),
+            "https://example.com/a.m3u8?_HLS_msn=12");
+  EXPECT_EQ(AppendDeliveryDirectives("https://example.com/a.m3u8", 12, 3,
+                                     false),
+            "https://example.com/a.m3u8?_HLS_msn=12&_HLS_part=3");
+  EXPECT_EQ(AppendDeliveryDirectives("https://example.com/a.m3u8?token=x", 12,
+                                     0, true),
+            "https://example.com/a.m3u8?token=x&_HLS_msn=12&_HLS_part=0"
+            "&_HLS_skip=YES");
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,179 @@
+/*
+ * segment_cache.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_cache.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "content_source/data_source/http_disk_cache.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+SegmentCache::SegmentCache(size_t max_memory_bytes,
+                           std::shared_ptr<HttpDiskCache> disk_cache)
+    : max_memory_bytes_(max_memory_bytes),
+      disk_cache_(std::move(disk_cache)) {}
+
+SegmentCache::~SegmentCache() = default;
+
+std::string SegmentCache::MakeKey(const std::string& uri,
+                                  int64_t offset,
+                                  int64_t length) {
+  if (offset == 0 && length < 0) {
+    return uri;
+  }
+  return uri + "@" + std::to_string(offset) + "-" + std::to_string(length);
+}
+
+bool SegmentCache::Lookup(const std::string& key, std::vector<uint8_t>* data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = items_.find(key);
+    if (it != items_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      *data = it->second->data;
+      ++stats_.hits;
+      return true;
+    }
+    if (!disk_cache_ || spilled_.count(key) == 0) {
+      ++stats_.misses;
+      return false;
+    }
+  }
+
+  const bool found = ReadSpilled(key, data);
+  std::vector<Item> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (found) {
+      ++stats_.hits;
+      ++stats_.disk_hits;
+      InsertLocked(key, *data, &evicted);
+    } else {
+      // Evicted by the disk cache meanwhile, or unreadable.
+      spilled_.erase(key);
+      ++stats_.misses;
+    }
+  }
+  Spill(std::move(evicted));
+  return found;
+}
+
+void SegmentCache::Insert(const std::string& key, std::vector<uint8_t> data) {
+  std::vector<Item> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    InsertLocked(key, std::move(data), &evicted);
+  }
+  Spill(std::move(evicted));
+}
+
+void SegmentCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  items_.clear();
+  memory_bytes_ = 0;
+}
+
+SegmentCache::Stats SegmentCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.memory_entries = items_.size();
+  stats.memory_bytes = memory_bytes_;
+  return stats;
+}
+
+bool SegmentCache::ReadSpilled(const std::string& key,
+                               std::vector<uint8_t>* data) const {
+  auto entry = disk_cache_->OpenEntry(key);
+  const int64_t length = entry->content_length();
+  if (!entry->IsComplete() || length <= 0) {
+    return false;
+  }
+
+  data->resize(static_cast<size_t>(length));
+  size_t done = 0;
+  while (done < data->size()) {
+    const ssize_t n = entry->ReadCached(static_cast<off64_t>(done),
+                                        data->data() + done,
+                                        data->size() - done);
+    if (n <= 0) {
+      AVE_LOG(LS_WARNING) << "SegmentCache: reading " << key << " failed";
+      data->clear();
+      return false;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Writes evicted segments to the disk cache. A lookup of a segment while it
+// is being written misses, as it would without a disk cache.
+void SegmentCache::Spill(std::vector<Item> items) {
+  if (!disk_cache_) {
+    return;
+  }
+  for (const Item& item : items) {
+    if (item.data.empty()) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (spilled_.count(item.key) != 0) {
+        continue;
+      }
+    }
+
+    auto entry = disk_cache_->OpenEntry(item.key);
+    entry->SetContentLength(static_cast<int64_t>(item.data.size()));
+    if (entry->Write(0, item.data.data(), item.data.size()) != OK) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spilled_.insert(item.key);
+  }
+}
+
+void SegmentCache::InsertLocked(const std::string& key,
+                                std::vector<uint8_t> data,
+                                std::vector<Item>* evicted) {
+  auto it = items_.find(key);
+  if (it != items_.end()) {
+    memory_bytes_ -= it->second->data.size();
+    lru_.erase(it->second);
+    items_.erase(it);
+  }
+
+  Item item{key, std::move(data)};
+  if (item.data.size() > max_memory_bytes_) {
+    evicted->push_back(std::move(item));
+    return;
+  }
+
+  memory_bytes_ += item.data.size();
+  lru_.push_front(std::move(item));
+  items_[key] = lru_.begin();
+  EvictLocked(evicted);
+}
+
+void SegmentCache::EvictLocked(std::vector<Item>* evicted) {
+  while (memory_bytes_ > max_memory_bytes_ && !lru_.empty()) {
+    Item& item = lru_.back();
+    memory_bytes_ -= item.data.size();
+    items_.erase(item.key);
+    evicted->push_back(std::move(item));
+    lru_.pop_back();
+  }
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,113 @@
+/*
+ * segment_cache.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_CACHE_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+
+class HttpDiskCache;
+
+namespace http_live {
+
+/**
+ * @brief Cache of raw segment bytes, so seeking back in a VOD stream replays
+ * already fetched segments without network traffic.
+ *
+ * Segments are keyed by URI and byte range and kept in memory up to a byte
+ * budget. The least recently used ones are evicted first; with a disk cache
+ * they are spilled to it instead of being dropped, and a later hit moves them
+ * back into memory. All methods are thread safe.
+ */
+class SegmentCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    // Hits served from the disk spill, also counted in |hits|.
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;
+    size_t memory_entries = 0;
+    size_t memory_bytes = 0;
+  };
+
+  /**
+   * @param max_memory_bytes Upper bound of segment bytes held in memory.
+   * @param disk_cache Where evicted segments are spilled, may be null.
+   */
+  SegmentCache(size_t max_memory_bytes,
+               std::shared_ptr<HttpDiskCache> disk_cache);
+  ~SegmentCache();
+
+  static std::string MakeKey(const std::string& uri,
+                             int64_t offset,
+                             int64_t length);
+
+  /**
+   * @brief Copies the cached bytes of |key| into |data|.
+   * @return false on a miss.
+   */
+  bool Lookup(const std::string& key, std::vector<uint8_t>* data)
+      EXCLUDES(mutex_);
+
+  // Stores a complete segment, replacing an older copy.
+  void Insert(const std::string& key, std::vector<uint8_t> data)
+      EXCLUDES(mutex_);
+
+  // Drops the in-memory segments; the disk spill is left alone.
+  void Clear() EXCLUDES(mutex_);
+
+  Stats GetStats() const EXCLUDES(mutex_);
+
+ private:
+  struct Item {
+    std::string key;
+    std::vector<uint8_t> data;
+  };
+
+  // Disk I/O runs without |mutex_| held; the Locked methods only collect the
+  // items to spill.
+  bool ReadSpilled(const std::string& key, std::vector<uint8_t>* data) const
+      EXCLUDES(mutex_);
+  void Spill(std::vector<Item> items) EXCLUDES(mutex_);
+  void InsertLocked(const std::string& key,
+                    std::vector<uint8_t> data,
+                    std::vector<Item>* evicted) REQUIRES(mutex_);
+  void EvictLocked(std::vector<Item>* evicted) REQUIRES(mutex_);
+
+  const size_t max_memory_bytes_;
+  const std::shared_ptr<HttpDiskCache> disk_cache_;
+
+  mutable std::mutex mutex_;
+  // Most recently used segment at the front.
+  std::list<Item> lru_ GUARDED_BY(mutex_);
+  std::unordered_map<std::string, std::list<Item>::iterator> items_
+      GUARDED_BY(mutex_);
+  // Keys written to the disk cache. It evicts on its own, so a key listed
+  // here may still miss.
+  std::unordered_set<std::string> spilled_ GUARDED_BY(mutex_);
+  size_t memory_bytes_ GUARDED_BY(mutex_) = 0;
+  Stats stats_ GUARDED_BY(mutex_);
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_CACHE_H_
@@ -0,0 +1,192 @@
+/*
+ * segment_cache_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_cache.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "content_source/data_source/http_disk_cache.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+std::vector<uint8_t> MakeSegment(size_t size, uint8_t seed) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(seed + i * 5);
+  }
+  return data;
+}
+
+class SegmentCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/segment_cache_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+  }
+
+  void TearDown() override {
+    if (DIR* dir = opendir(dir_.c_str())) {
+      while (struct dirent* ent = readdir(dir)) {
+        const std::string name = ent->d_name;
+        if (name != "." && name != "..") {
+          unlink((dir_ + "/" + name).c_str());
+        }
+      }
+      closedir(dir);
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::shared_ptr<HttpDiskCache> NewDiskCache(int64_t max_size_bytes) {
+    auto cache = std::make_shared<HttpDiskCache>(dir_, max_size_bytes);
+    EXPECT_EQ(cache->Init(), OK);
+    return cache;
+  }
+
+  std::string dir_;
+};
+
+TEST_F(SegmentCacheTest, MakeKeyIncludesByteRange) {
+  EXPECT_EQ(SegmentCache::MakeKey("a.ts", 0, -1), "a.ts");
+  EXPECT_NE(SegmentCache::MakeKey("a.ts", 0, 100),
+            SegmentCache::MakeKey("a.ts", 100, 100));
+  EXPECT_NE(SegmentCache::MakeKey("a.ts", 0, 100),
+            SegmentCache::MakeKey("a.ts", 0, -1));
+}
+
+TEST_F(SegmentCacheTest, CountsHitsAndMisses) {
+  SegmentCache cache(1000, nullptr);
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.Lookup("a", &data));
+
+  cache.Insert("a", MakeSegment(100, 1));
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  EXPECT_EQ(data, MakeSegment(100, 1));
+  ASSERT_TRUE(cache.Lookup("a", &data));
+
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.disk_hits, 0u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.memory_entries, 1u);
+  EXPECT_EQ(stats.memory_bytes, 100u);
+}
+
+TEST_F(SegmentCacheTest, EvictsLeastRecentlyUsedFirst) {
+  SegmentCache cache(300, nullptr);
+  cache.Insert("a", MakeSegment(100, 1));
+  cache.Insert("b", MakeSegment(100, 2));
+  cache.Insert("c", MakeSegment(100, 3));
+
+  // Touch "a" so "b" becomes the oldest.
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  cache.Insert("d", MakeSegment(100, 4));
+
+  EXPECT_FALSE(cache.Lookup("b", &data));
+  for (const char* key : {"a", "c", "d"}) {
+    EXPECT_TRUE(cache.Lookup(key, &data)) << key;
+  }
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(stats.memory_entries, 3u);
+  EXPECT_EQ(stats.memory_bytes, 300u);
+}
+
+TEST_F(SegmentCacheTest, ReplacingASegmentKeepsTheByteCount) {
+  SegmentCache cache(300, nullptr);
+  cache.Insert("a", MakeSegment(100, 1));
+  cache.Insert("a", MakeSegment(150, 2));
+
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  EXPECT_EQ(data, MakeSegment(150, 2));
+  EXPECT_EQ(cache.GetStats().memory_entries, 1u);
+  EXPECT_EQ(cache.GetStats().memory_bytes, 150u);
+}
+
+TEST_F(SegmentCacheTest, OversizedSegmentIsNotKeptInMemory) {
+  SegmentCache cache(100, nullptr);
+  cache.Insert("a", MakeSegment(50, 1));
+  cache.Insert("big", MakeSegment(200, 2));
+
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.Lookup("big", &data));
+  EXPECT_TRUE(cache.Lookup("a", &data));
+}
+
+TEST_F(SegmentCacheTest, EvictedSegmentsSpillToDiskAndReload) {
+  SegmentCache cache(200, NewDiskCache(1 << 20));
+  cache.Insert("a", MakeSegment(100, 1));
+  cache.Insert("b", MakeSegment(100, 2));
+  // Pushes "a" out of memory and onto disk.
+  cache.Insert("c", MakeSegment(100, 3));
+  EXPECT_EQ(cache.GetStats().memory_entries, 2u);
+
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  EXPECT_EQ(data, MakeSegment(100, 1));
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.disk_hits, 1u);
+  EXPECT_EQ(stats.misses, 0u);
+
+  // The reload moved "a" back into memory, so the next hit is a memory one,
+  // and it pushed "b" out to disk in turn.
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  ASSERT_TRUE(cache.Lookup("b", &data));
+  EXPECT_EQ(data, MakeSegment(100, 2));
+  stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 3u);
+  EXPECT_EQ(stats.disk_hits, 2u);
+  EXPECT_EQ(stats.memory_entries, 2u);
+  EXPECT_EQ(stats.memory_bytes, 200u);
+}
+
+TEST_F(SegmentCacheTest, ClearKeepsTheDiskSpill) {
+  SegmentCache cache(100, NewDiskCache(1 << 20));
+  cache.Insert("a", MakeSegment(100, 1));
+  cache.Insert("b", MakeSegment(100, 2));
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().memory_bytes, 0u);
+
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.Lookup("b", &data));
+  ASSERT_TRUE(cache.Lookup("a", &data));
+  EXPECT_EQ(data, MakeSegment(100, 1));
+  EXPECT_EQ(cache.GetStats().disk_hits, 1u);
+}
+
+TEST_F(SegmentCacheTest, SegmentEvictedByTheDiskCacheMisses) {
+  // Room on disk for one segment only.
+  SegmentCache cache(100, NewDiskCache(150));
+  cache.Insert("a", MakeSegment(100, 1));
+  cache.Insert("b", MakeSegment(100, 2));
+  cache.Insert("c", MakeSegment(100, 3));
+
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.Lookup("a", &data));
+  ASSERT_TRUE(cache.Lookup("b", &data));
+  EXPECT_EQ(data, MakeSegment(100, 2));
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.disk_hits, 1u);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
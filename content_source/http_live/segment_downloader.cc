@@ -0,0 +1,240 @@
+/*
+ * segment_downloader.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_downloader.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/time_utils.h"
+#include "content_source/http_live/segment_cache.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+SegmentDownloader::SegmentDownloader(
+    base::TaskRunnerFactory* task_runner_factory,
+    FetchFunction fetch,
+    Options options,
+    std::shared_ptr<SegmentCache> cache)
+    : fetch_(std::move(fetch)), options_(options), cache_(std::move(cache)) {
+  const size_t slots = std::max<size_t>(options_.max_in_flight, 1);
+  slot_busy_.assign(slots, false);
+  for (size_t i = 0; i < slots; ++i) {
+    const std::string name = "HlsFetch" + std::to_string(i);
+    runners_.push_back(std::make_unique<base::TaskRunner>(
+        task_runner_factory->CreateTaskRunner(
+            name.c_str(), base::TaskRunnerFactory::Priority::NORMAL)));
+  }
+}
+
+SegmentDownloader::~SegmentDownloader() {
+  Cancel();
+  runners_.clear();
+}
+
+bool SegmentDownloader::CanEnqueue() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_.size() + segments_.size() < options_.max_segments_ahead &&
+         buffered_bytes_ < options_.max_buffered_bytes;
+}
+
+void SegmentDownloader::Enqueue(SegmentRequest request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queued_.push_back(std::move(request));
+  MaybeStartJobsLocked();
+}
+
+void SegmentDownloader::SetDataCallback(DataCallback callback) {
+  data_callback_ = std::move(callback);
+}
+
+bool SegmentDownloader::TakeData(int32_t sequence,
+                                 int32_t part,
+                                 DownloadedSegment* chunk) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return TakeDataLocked(Key(sequence, part), chunk);
+}
+
+status_t SegmentDownloader::WaitForData(int32_t sequence,
+                                        int32_t part,
+                                        DownloadedSegment* chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint32_t generation = generation_;
+  const Key key(sequence, part);
+  cv_.wait(lock, [this, &key, generation]() {
+    return generation != generation_ || HasDataLocked(key) ||
+           !IsKnownLocked(key);
+  });
+  if (generation != generation_) {
+    return WOULD_BLOCK;
+  }
+  return TakeDataLocked(key, chunk) ? static_cast<status_t>(OK)
+                                    : static_cast<status_t>(WOULD_BLOCK);
+}
+
+void SegmentDownloader::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++generation_;
+  queued_.clear();
+  segments_.clear();
+  buffered_bytes_ = 0;
+  cv_.notify_all();
+}
+
+size_t SegmentDownloader::buffered_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffered_bytes_;
+}
+
+bool SegmentDownloader::HasDataLocked(const Key& key) const {
+  auto it = segments_.find(key);
+  return it != segments_.end() &&
+         (it->second.complete || !it->second.data.empty());
+}
+
+bool SegmentDownloader::TakeDataLocked(const Key& key,
+                                       DownloadedSegment* chunk) {
+  if (!HasDataLocked(key)) {
+    return false;
+  }
+  auto it = segments_.find(key);
+  DownloadedSegment& segment = it->second;
+  buffered_bytes_ -= segment.data.size();
+  chunk->request = segment.request;
+  chunk->status = segment.status;
+  chunk->data = std::move(segment.data);
+  segment.data.clear();
+  chunk->complete = segment.complete;
+  chunk->total_bytes = segment.total_bytes;
+  chunk->fetch_time_us = segment.fetch_time_us;
+  chunk->concurrent_fetches = segment.concurrent_fetches;
+  chunk->from_cache = segment.from_cache;
+  if (segment.complete) {
+    segments_.erase(it);
+  }
+  // Consuming bytes may reopen the byte budget or the look-ahead window.
+  MaybeStartJobsLocked();
+  return true;
+}
+
+bool SegmentDownloader::IsKnownLocked(const Key& key) const {
+  return segments_.count(key) != 0 ||
+         std::any_of(queued_.begin(), queued_.end(),
+                     [&key](const SegmentRequest& request) {
+                       return Key(request.sequence, request.part) == key;
+                     });
+}
+
+void SegmentDownloader::MaybeStartJobsLocked() {
+  while (!queued_.empty() && buffered_bytes_ < options_.max_buffered_bytes) {
+    auto free_slot = std::find(slot_busy_.begin(), slot_busy_.end(), false);
+    if (free_slot == slot_busy_.end()) {
+      return;
+    }
+    const size_t slot = static_cast<size_t>(free_slot - slot_busy_.begin());
+    SegmentRequest request = std::move(queued_.front());
+    queued_.pop_front();
+    slot_busy_[slot] = true;
+
+    segments_[Key(request.sequence, request.part)].request = request;
+
+    runners_[slot]->PostTask([this, slot, generation = generation_,
+                              request = std::move(request)]() mutable {
+      RunJob(slot, generation, std::move(request));
+    });
+  }
+}
+
+void SegmentDownloader::RunJob(size_t slot,
+                               uint32_t generation,
+                               SegmentRequest request) {
+  const Key key(request.sequence, request.part);
+  size_t total_bytes = 0;
+  const int64_t start_us = base::TimeMicros();
+  auto sink = [&](const uint8_t* data, size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (generation != generation_) {
+        return false;
+      }
+      auto it = segments_.find(key);
+      if (it == segments_.end()) {
+        return false;
+      }
+      it->second.data.insert(it->second.data.end(), data, data + size);
+      buffered_bytes_ += size;
+      total_bytes += size;
+      cv_.notify_all();
+    }
+    if (data_callback_) {
+      data_callback_();
+    }
+    return true;
+  };
+
+  status_t status = OK;
+  bool from_cache = false;
+  std::vector<uint8_t> body;
+  const std::string cache_key =
+      cache_ ? SegmentCache::MakeKey(request.uri, request.offset,
+                                     request.length)
+             : std::string();
+  if (cache_ && cache_->Lookup(cache_key, &body)) {
+    from_cache = true;
+    status = sink(body.data(), body.size()) ? static_cast<status_t>(OK)
+                                            : static_cast<status_t>(
+                                                  INVALID_OPERATION);
+  } else if (cache_) {
+    status = fetch_(request, [&](const uint8_t* data, size_t size) {
+      body.insert(body.end(), data, data + size);
+      return sink(data, size);
+    });
+    if (status == OK && !body.empty()) {
+      cache_->Insert(cache_key, std::move(body));
+    }
+  } else {
+    status = fetch_(request, sink);
+  }
+  const int64_t fetch_time_us = base::TimeMicros() - start_us;
+
+  bool completed = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t concurrent_fetches = static_cast<size_t>(
+        std::count(slot_busy_.begin(), slot_busy_.end(), true));
+    slot_busy_[slot] = false;
+    auto it = segments_.find(key);
+    if (generation == generation_ && it != segments_.end()) {
+      AVE_LOG(LS_VERBOSE) << "HLS segment " << request.sequence << "."
+                          << request.part
+                          << (from_cache ? " from cache: " : " fetched: ")
+                          << total_bytes << " bytes in " << fetch_time_us
+                          << "us";
+      DownloadedSegment& segment = it->second;
+      segment.status = status;
+      segment.complete = true;
+      segment.total_bytes = total_bytes;
+      segment.fetch_time_us = fetch_time_us;
+      segment.concurrent_fetches = concurrent_fetches;
+      segment.from_cache = from_cache;
+      completed = true;
+    }
+    MaybeStartJobsLocked();
+    cv_.notify_all();
+  }
+  if (completed && data_callback_) {
+    data_callback_();
+  }
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,175 @@
+/*
+ * segment_downloader.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_DOWNLOADER_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_DOWNLOADER_H_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/errors.h"
+#include "base/task_util/task_runner.h"
+#include "base/task_util/task_runner_factory.h"
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+class SegmentCache;
+
+struct SegmentRequest {
+  int32_t sequence = 0;
+  // Index of the LL-HLS partial segment, -1 for the whole segment.
+  int32_t part = -1;
+  std::string uri;
+  // Byte range within |uri|; a negative length means the rest of it.
+  int64_t offset = 0;
+  int64_t length = -1;
+  // Position of the segment (or part) on the presentation timeline.
+  int64_t start_time_us = 0;
+  int64_t duration_us = 0;
+  bool discontinuity = false;
+  // Media initialization section of fMP4 segments, see MediaPlaylistSegment.
+  std::string init_uri;
+  int64_t init_offset = 0;
+  int64_t init_length = -1;
+  // AES-128 key of the segment, see MediaPlaylistSegment.
+  std::string key_uri;
+  bool has_iv = false;
+  std::array<uint8_t, 16> iv{};
+};
+
+// Bytes of one segment handed from the download stage to the parse stage.
+// A segment is normally delivered in several chunks while it downloads; the
+// last one has |complete| set.
+struct DownloadedSegment {
+  SegmentRequest request;
+  status_t status = OK;
+  std::vector<uint8_t> data;
+  bool complete = false;
+  // The fields below are only set on the last chunk.
+  // Size of the whole segment.
+  size_t total_bytes = 0;
+  // Wall time spent in the fetch.
+  int64_t fetch_time_us = 0;
+  // Fetches running when this one finished, itself included. They shared
+  // the link, so the link throughput is roughly this many times the
+  // throughput of the single fetch.
+  size_t concurrent_fetches = 1;
+  // Served from the SegmentCache; the timings say nothing about the link.
+  bool from_cache = false;
+};
+
+/**
+ * @brief Download stage of HttpLiveSource.
+ *
+ * Segments are enqueued in playback order and fetched on a small set of
+ * worker task runners, several at a time, while the parse stage consumes
+ * them in sequence order. Bytes are made available as they arrive, so the
+ * parser can work on a segment that is still downloading. Starting new
+ * fetches stops once the downloaded but not yet consumed bytes exceed the
+ * byte budget. Cancel() drops everything queued or downloaded and makes the
+ * running fetches stop at their next chunk. With a SegmentCache, cached
+ * segments are delivered without fetching and completed fetches are stored.
+ */
+class SegmentDownloader {
+ public:
+  // Receives the body as it is read; returning false aborts the fetch.
+  using DataSink = std::function<bool(const uint8_t* data, size_t size)>;
+  using FetchFunction = std::function<status_t(const SegmentRequest& request,
+                                               const DataSink& sink)>;
+  // Runs on a download worker, with no lock held, when bytes of a segment
+  // arrive or its fetch ends.
+  using DataCallback = std::function<void()>;
+
+  struct Options {
+    // Segments fetched concurrently.
+    size_t max_in_flight = 2;
+    // Segments queued, running or downloaded ahead of the parse position.
+    size_t max_segments_ahead = 4;
+    // Downloaded bytes waiting for the parser before new fetches are held.
+    size_t max_buffered_bytes = 32 * 1024 * 1024;
+  };
+
+  SegmentDownloader(base::TaskRunnerFactory* task_runner_factory,
+                    FetchFunction fetch,
+                    Options options,
+                    std::shared_ptr<SegmentCache> cache = nullptr);
+  ~SegmentDownloader();
+
+  // Returns true while the look-ahead window has room for another segment.
+  bool CanEnqueue() const EXCLUDES(mutex_);
+  void Enqueue(SegmentRequest request) EXCLUDES(mutex_);
+
+  // Set before the first Enqueue().
+  void SetDataCallback(DataCallback callback);
+
+  /**
+   * @brief Moves the bytes of segment |sequence| (or of its part |part|)
+   * received since the last call into |chunk|.
+   * @return false if nothing new arrived and the fetch is still running.
+   */
+  bool TakeData(int32_t sequence, int32_t part, DownloadedSegment* chunk)
+      EXCLUDES(mutex_);
+
+  /**
+   * @brief Blocking TakeData().
+   * @return WOULD_BLOCK if the segment was never enqueued or got cancelled.
+   */
+  status_t WaitForData(int32_t sequence, int32_t part, DownloadedSegment* chunk)
+      EXCLUDES(mutex_);
+
+  void Cancel() EXCLUDES(mutex_);
+
+  size_t buffered_bytes() const EXCLUDES(mutex_);
+
+ private:
+  // (sequence, part)
+  using Key = std::pair<int32_t, int32_t>;
+
+  bool HasDataLocked(const Key& key) const REQUIRES(mutex_);
+  bool TakeDataLocked(const Key& key, DownloadedSegment* chunk)
+      REQUIRES(mutex_);
+  bool IsKnownLocked(const Key& key) const REQUIRES(mutex_);
+  void MaybeStartJobsLocked() REQUIRES(mutex_);
+  void RunJob(size_t slot, uint32_t generation, SegmentRequest request)
+      EXCLUDES(mutex_);
+
+  const FetchFunction fetch_;
+  const Options options_;
+  const std::shared_ptr<SegmentCache> cache_;
+  DataCallback data_callback_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint32_t generation_ GUARDED_BY(mutex_) = 0;
+  std::deque<SegmentRequest> queued_ GUARDED_BY(mutex_);
+  std::vector<bool> slot_busy_ GUARDED_BY(mutex_);
+  // Started segments, running or complete, with their unconsumed bytes.
+  std::map<Key, DownloadedSegment> segments_ GUARDED_BY(mutex_);
+  size_t buffered_bytes_ GUARDED_BY(mutex_) = 0;
+
+  // Declared last so the workers are joined before the state they use is
+  // destroyed.
+  std::vector<std::unique_ptr<base::TaskRunner>> runners_;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_DOWNLOADER_H_
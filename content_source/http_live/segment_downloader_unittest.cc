@@ -0,0 +1,342 @@
+/*
+ * segment_downloader_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_downloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/task_util/default_task_runner_factory.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+// Serves bodies from memory in small chunks. Fetches of held URIs wait for
+// Release() before sending their last chunk; streaming URIs send chunks
+// until the sink refuses one.
+class FakeFetcher {
+ public:
+  static constexpr size_t kChunkSize = 100;
+
+  void AddBody(const std::string& uri, std::vector<uint8_t> body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bodies_[uri] = std::move(body);
+  }
+
+  void Hold(const std::string& uri) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.insert(uri);
+  }
+
+  void Release(const std::string& uri) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.erase(uri);
+    cv_.notify_all();
+  }
+
+  void Stream(const std::string& uri) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streamed_.insert(uri);
+  }
+
+  SegmentDownloader::FetchFunction Function() {
+    return [this](const SegmentRequest& request,
+                  const SegmentDownloader::DataSink& sink) {
+      return Fetch(request, sink);
+    };
+  }
+
+  std::vector<std::string> started() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return started_;
+  }
+
+  bool WaitStarted(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(5),
+                        [this, count]() { return started_.size() >= count; });
+  }
+
+  bool WaitAborted(const std::string& uri) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(5), [this, &uri]() {
+      return aborted_.count(uri) != 0;
+    });
+  }
+
+ private:
+  status_t Fetch(const SegmentRequest& request,
+                 const SegmentDownloader::DataSink& sink) {
+    std::vector<uint8_t> body;
+    bool streamed = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      started_.push_back(request.uri);
+      cv_.notify_all();
+      body = bodies_[request.uri];
+      streamed = streamed_.count(request.uri) != 0;
+    }
+
+    if (streamed) {
+      std::vector<uint8_t> chunk(kChunkSize, 0x55);
+      while (sink(chunk.data(), chunk.size())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      aborted_.insert(request.uri);
+      cv_.notify_all();
+      return INVALID_OPERATION;
+    }
+
+    for (size_t offset = 0; offset < body.size(); offset += kChunkSize) {
+      const size_t size = std::min(kChunkSize, body.size() - offset);
+      if (offset + size == body.size()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, &request]() {
+          return held_.count(request.uri) == 0;
+        });
+      }
+      if (!sink(body.data() + offset, size)) {
+        return INVALID_OPERATION;
+      }
+    }
+    return OK;
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<std::string, std::vector<uint8_t>> bodies_;
+  std::set<std::string> held_;
+  std::set<std::string> streamed_;
+  std::set<std::string> aborted_;
+  std::vector<std::string> started_;
+};
+
+std::vector<uint8_t> MakeBody(size_t size, uint8_t seed) {
+  std::vector<uint8_t> body(size);
+  for (size_t i = 0; i < size; ++i) {
+    body[i] = static_cast<uint8_t>(seed + i * 3);
+  }
+  return body;
+}
+
+SegmentRequest MakeRequest(int32_t sequence) {
+  SegmentRequest request;
+  request.sequence = sequence;
+  request.uri = "seg" + std::to_string(sequence) + ".ts";
+  return request;
+}
+
+class SegmentDownloaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    task_runner_factory_ = base::CreateDefaultTaskRunnerFactory();
+  }
+
+  void TearDown() override {
+    // The downloader joins its workers; release anything still held first.
+    for (int32_t sequence = 0; sequence < 8; ++sequence) {
+      fetcher_.Release(MakeRequest(sequence).uri);
+    }
+    downloader_.reset();
+  }
+
+  void CreateDownloader(SegmentDownloader::Options options) {
+    downloader_ = std::make_unique<SegmentDownloader>(
+        task_runner_factory_.get(), fetcher_.Function(), options);
+  }
+
+  // Collects segment |sequence| chunk by chunk until it completes.
+  status_t ReadSegment(int32_t sequence, std::vector<uint8_t>* body) {
+    DownloadedSegment chunk;
+    do {
+      status_t err = downloader_->WaitForData(sequence, -1, &chunk);
+      if (err != OK) {
+        return err;
+      }
+      body->insert(body->end(), chunk.data.begin(), chunk.data.end());
+    } while (!chunk.complete);
+    return chunk.status;
+  }
+
+  std::unique_ptr<base::TaskRunnerFactory> task_runner_factory_;
+  FakeFetcher fetcher_;
+  std::unique_ptr<SegmentDownloader> downloader_;
+};
+
+TEST_F(SegmentDownloaderTest, DeliversSegmentsInOrderWhateverFinishesFirst) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 2;
+  CreateDownloader(options);
+
+  for (int32_t sequence = 0; sequence < 4; ++sequence) {
+    fetcher_.AddBody(MakeRequest(sequence).uri,
+                     MakeBody(1000 + sequence * 10, sequence));
+  }
+  // Segment 0 finishes after segment 1.
+  fetcher_.Hold(MakeRequest(0).uri);
+  for (int32_t sequence = 0; sequence < 4; ++sequence) {
+    downloader_->Enqueue(MakeRequest(sequence));
+  }
+
+  std::vector<uint8_t> body;
+  ASSERT_EQ(ReadSegment(1, &body), OK);
+  EXPECT_EQ(body, MakeBody(1010, 1));
+
+  fetcher_.Release(MakeRequest(0).uri);
+  for (int32_t sequence : {0, 2, 3}) {
+    body.clear();
+    ASSERT_EQ(ReadSegment(sequence, &body), OK) << "segment " << sequence;
+    EXPECT_EQ(body, MakeBody(1000 + sequence * 10, sequence))
+        << "segment " << sequence;
+  }
+
+  // The first two fetches run side by side, the later ones follow as slots
+  // free up.
+  auto started = fetcher_.started();
+  ASSERT_EQ(started.size(), 4u);
+  std::sort(started.begin(), started.begin() + 2);
+  EXPECT_EQ(started[0], MakeRequest(0).uri);
+  EXPECT_EQ(started[1], MakeRequest(1).uri);
+  EXPECT_EQ(started[2], MakeRequest(2).uri);
+  EXPECT_EQ(started[3], MakeRequest(3).uri);
+}
+
+TEST_F(SegmentDownloaderTest, DataIsAvailableWhileDownloading) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 1;
+  CreateDownloader(options);
+
+  fetcher_.AddBody(MakeRequest(0).uri, MakeBody(1000, 0));
+  fetcher_.Hold(MakeRequest(0).uri);
+  downloader_->Enqueue(MakeRequest(0));
+
+  DownloadedSegment chunk;
+  ASSERT_EQ(downloader_->WaitForData(0, -1, &chunk), OK);
+  EXPECT_FALSE(chunk.complete);
+  EXPECT_FALSE(chunk.data.empty());
+}
+
+TEST_F(SegmentDownloaderTest, DataCallbackRunsForEachChunkAndTheEnd) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 1;
+  CreateDownloader(options);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t calls = 0;
+  downloader_->SetDataCallback([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++calls;
+    cv.notify_all();
+  });
+
+  fetcher_.AddBody(MakeRequest(0).uri, MakeBody(1000, 0));
+  downloader_->Enqueue(MakeRequest(0));
+
+  // Ten chunks of FakeFetcher::kChunkSize, then the end of the fetch.
+  std::unique_lock<std::mutex> lock(mutex);
+  EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(5),
+                          [&calls]() { return calls >= 11; }));
+  EXPECT_EQ(calls, 11u);
+}
+
+TEST_F(SegmentDownloaderTest, ByteBudgetHoldsNewFetches) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 1;
+  options.max_buffered_bytes = 500;
+  CreateDownloader(options);
+
+  fetcher_.AddBody(MakeRequest(0).uri, MakeBody(1000, 0));
+  fetcher_.AddBody(MakeRequest(1).uri, MakeBody(1000, 1));
+  downloader_->Enqueue(MakeRequest(0));
+  downloader_->Enqueue(MakeRequest(1));
+
+  ASSERT_TRUE(fetcher_.WaitStarted(1));
+  for (int i = 0; i < 500 && downloader_->buffered_bytes() < 1000; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(downloader_->buffered_bytes(), 1000u);
+  EXPECT_FALSE(downloader_->CanEnqueue());
+
+  // Segment 1 waits for the parser to consume segment 0.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(fetcher_.started().size(), 1u);
+
+  std::vector<uint8_t> body;
+  ASSERT_EQ(ReadSegment(0, &body), OK);
+  ASSERT_TRUE(fetcher_.WaitStarted(2));
+  body.clear();
+  ASSERT_EQ(ReadSegment(1, &body), OK);
+  EXPECT_EQ(body, MakeBody(1000, 1));
+}
+
+TEST_F(SegmentDownloaderTest, LookAheadWindowLimitsEnqueue) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 1;
+  options.max_segments_ahead = 2;
+  CreateDownloader(options);
+
+  fetcher_.AddBody(MakeRequest(0).uri, MakeBody(200, 0));
+  fetcher_.AddBody(MakeRequest(1).uri, MakeBody(200, 1));
+  fetcher_.Hold(MakeRequest(0).uri);
+  EXPECT_TRUE(downloader_->CanEnqueue());
+  downloader_->Enqueue(MakeRequest(0));
+  downloader_->Enqueue(MakeRequest(1));
+  EXPECT_FALSE(downloader_->CanEnqueue());
+
+  fetcher_.Release(MakeRequest(0).uri);
+  std::vector<uint8_t> body;
+  ASSERT_EQ(ReadSegment(0, &body), OK);
+  EXPECT_TRUE(downloader_->CanEnqueue());
+}
+
+TEST_F(SegmentDownloaderTest, CancelStopsRunningFetchesAndDropsQueued) {
+  SegmentDownloader::Options options;
+  options.max_in_flight = 1;
+  CreateDownloader(options);
+
+  fetcher_.Stream(MakeRequest(0).uri);
+  fetcher_.AddBody(MakeRequest(1).uri, MakeBody(200, 1));
+  downloader_->Enqueue(MakeRequest(0));
+  downloader_->Enqueue(MakeRequest(1));
+
+  DownloadedSegment chunk;
+  ASSERT_EQ(downloader_->WaitForData(0, -1, &chunk), OK);
+
+  downloader_->Cancel();
+  // The running fetch is refused its next chunk.
+  ASSERT_TRUE(fetcher_.WaitAborted(MakeRequest(0).uri));
+  EXPECT_EQ(downloader_->buffered_bytes(), 0u);
+  EXPECT_EQ(downloader_->WaitForData(0, -1, &chunk), WOULD_BLOCK);
+  EXPECT_EQ(downloader_->WaitForData(1, -1, &chunk), WOULD_BLOCK);
+
+  // The queued segment was dropped, not fetched.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(fetcher_.started().size(), 1u);
+}
+
+TEST_F(SegmentDownloaderTest, WaitForUnknownSegmentDoesNotBlock) {
+  CreateDownloader(SegmentDownloader::Options());
+  DownloadedSegment chunk;
+  EXPECT_EQ(downloader_->WaitForData(7, -1, &chunk), WOULD_BLOCK);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
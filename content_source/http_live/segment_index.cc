@@ -0,0 +1,93 @@
+/*
+ * segment_index.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_index.h"
+
+#include <algorithm>
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+namespace {
+
+int32_t FirstSequence(const Playlist& playlist) {
+  return playlist.segments.empty() ? playlist.media_sequence
+                                   : playlist.segments.front().sequence;
+}
+
+}  // namespace
+
+void SegmentIndex::Update(const Playlist& playlist) {
+  const int32_t first = FirstSequence(playlist);
+  if (empty() || first < first_sequence_) {
+    Rebuild(playlist, 0);
+    return;
+  }
+  if (first >= end_sequence()) {
+    // No overlap with the indexed window; continue the timeline after it.
+    Rebuild(playlist, end_time_us());
+    return;
+  }
+
+  // The window slid forward: drop the segments that left it and keep the
+  // start times of the ones still listed.
+  starts_.erase(starts_.begin(), starts_.begin() + (first - first_sequence_));
+  first_sequence_ = first;
+  const size_t kept = std::min(segment_count(), playlist.segments.size());
+  starts_.resize(kept + 1);
+  if (kept > 0 &&
+      starts_[kept] - starts_[kept - 1] !=
+          playlist.segments[kept - 1].duration_us) {
+    // Not the same segments after all.
+    Rebuild(playlist, starts_.front());
+    return;
+  }
+  Append(playlist, kept);
+}
+
+void SegmentIndex::Clear() {
+  first_sequence_ = 0;
+  starts_.clear();
+}
+
+int64_t SegmentIndex::StartTimeUs(int32_t sequence) const {
+  if (starts_.empty()) {
+    return 0;
+  }
+  const int64_t index = std::clamp<int64_t>(
+      static_cast<int64_t>(sequence) - first_sequence_, 0,
+      static_cast<int64_t>(segment_count()));
+  return starts_[static_cast<size_t>(index)];
+}
+
+int32_t SegmentIndex::SequenceForTime(int64_t time_us) const {
+  if (empty()) {
+    return first_sequence_;
+  }
+  // First segment starting after |time_us|; the one before it contains it.
+  auto it = std::upper_bound(starts_.begin(), starts_.end(), time_us);
+  const int64_t index = std::clamp<int64_t>(
+      (it - starts_.begin()) - 1, 0, static_cast<int64_t>(segment_count()));
+  return first_sequence_ + static_cast<int32_t>(index);
+}
+
+void SegmentIndex::Rebuild(const Playlist& playlist, int64_t origin_us) {
+  first_sequence_ = FirstSequence(playlist);
+  starts_.assign(1, origin_us);
+  Append(playlist, 0);
+}
+
+void SegmentIndex::Append(const Playlist& playlist, size_t from_index) {
+  for (size_t i = from_index; i < playlist.segments.size(); ++i) {
+    starts_.push_back(starts_.back() + playlist.segments[i].duration_us);
+  }
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
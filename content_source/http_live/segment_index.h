@@ -0,0 +1,69 @@
+/*
+ * segment_index.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_INDEX_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_INDEX_H_
+
+#include <cstdint>
+#include <deque>
+
+#include "content_source/http_live/playlist_parser.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Start times of the segments of a media playlist, as prefix sums of
+ * their durations, for O(log n) time to segment lookups.
+ *
+ * Update() keeps the start times of segments still listed by the reloaded
+ * playlist and only sums the ones appended to it, so refreshing a live or
+ * event playlist costs in proportion to what changed. Media segments never
+ * change once listed, so the overlap is taken over as is.
+ */
+class SegmentIndex {
+ public:
+  void Update(const Playlist& playlist);
+  void Clear();
+
+  bool empty() const { return starts_.size() < 2; }
+  int32_t first_sequence() const { return first_sequence_; }
+  int32_t end_sequence() const {
+    return first_sequence_ + static_cast<int32_t>(segment_count());
+  }
+
+  /**
+   * @brief Start time of segment |sequence|; end_sequence() gives the end of
+   * the last segment. The timeline starts at 0 with the first playlist and
+   * follows a live window as it slides.
+   */
+  int64_t StartTimeUs(int32_t sequence) const;
+  int64_t end_time_us() const { return starts_.empty() ? 0 : starts_.back(); }
+
+  /**
+   * @brief Segment playing at |time_us|. Times before the first segment map
+   * to it, times after the last one to end_sequence().
+   */
+  int32_t SequenceForTime(int64_t time_us) const;
+
+ private:
+  size_t segment_count() const { return starts_.empty() ? 0 : starts_.size() - 1; }
+  void Rebuild(const Playlist& playlist, int64_t origin_us);
+  void Append(const Playlist& playlist, size_t from_index);
+
+  int32_t first_sequence_ = 0;
+  // starts_[i] is the start of segment first_sequence_ + i; the extra last
+  // entry is the end of the last segment.
+  std::deque<int64_t> starts_;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_INDEX_H_
@@ -0,0 +1,161 @@
+/*
+ * segment_index_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/segment_index.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+// Media playlist listing segments |first_sequence| onwards with the given
+// durations in seconds.
+Playlist MakePlaylist(int32_t first_sequence,
+                      const std::vector<int64_t>& durations_s) {
+  Playlist playlist;
+  playlist.is_live = true;
+  playlist.media_sequence = first_sequence;
+  for (size_t i = 0; i < durations_s.size(); ++i) {
+    MediaPlaylistSegment segment;
+    segment.sequence = first_sequence + static_cast<int32_t>(i);
+    segment.uri = "seg" + std::to_string(segment.sequence) + ".ts";
+    segment.duration_us = durations_s[i] * 1000000;
+    playlist.segments.push_back(segment);
+  }
+  return playlist;
+}
+
+TEST(SegmentIndexTest, StartTimesArePrefixSums) {
+  SegmentIndex index;
+  EXPECT_TRUE(index.empty());
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+
+  ASSERT_FALSE(index.empty());
+  EXPECT_EQ(index.first_sequence(), 10);
+  EXPECT_EQ(index.end_sequence(), 13);
+  EXPECT_EQ(index.StartTimeUs(10), 0);
+  EXPECT_EQ(index.StartTimeUs(11), 4000000);
+  EXPECT_EQ(index.StartTimeUs(12), 10000000);
+  EXPECT_EQ(index.StartTimeUs(13), 15000000);
+  EXPECT_EQ(index.end_time_us(), 15000000);
+}
+
+TEST(SegmentIndexTest, SlidingWindowKeepsStartTimes) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+  // Segment 10 left the window, 13 and 14 were appended.
+  index.Update(MakePlaylist(11, {6, 5, 3, 2}));
+
+  EXPECT_EQ(index.first_sequence(), 11);
+  EXPECT_EQ(index.end_sequence(), 15);
+  EXPECT_EQ(index.StartTimeUs(11), 4000000);
+  EXPECT_EQ(index.StartTimeUs(13), 15000000);
+  EXPECT_EQ(index.StartTimeUs(14), 18000000);
+  EXPECT_EQ(index.end_time_us(), 20000000);
+}
+
+TEST(SegmentIndexTest, ReloadListingFewerSegmentsTruncates) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+  index.Update(MakePlaylist(10, {4, 6}));
+
+  EXPECT_EQ(index.end_sequence(), 12);
+  EXPECT_EQ(index.end_time_us(), 10000000);
+}
+
+TEST(SegmentIndexTest, NoOverlapContinuesTheTimeline) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6}));
+  // The playlist skipped ahead past everything indexed, e.g. after a stall.
+  index.Update(MakePlaylist(20, {5, 5}));
+
+  EXPECT_EQ(index.first_sequence(), 20);
+  EXPECT_EQ(index.end_sequence(), 22);
+  EXPECT_EQ(index.StartTimeUs(20), 10000000);
+  EXPECT_EQ(index.end_time_us(), 20000000);
+}
+
+TEST(SegmentIndexTest, SequenceGoingBackwardsRestartsTheTimeline) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6}));
+  index.Update(MakePlaylist(5, {3, 3}));
+
+  EXPECT_EQ(index.first_sequence(), 5);
+  EXPECT_EQ(index.StartTimeUs(5), 0);
+  EXPECT_EQ(index.end_time_us(), 6000000);
+}
+
+TEST(SegmentIndexTest, LastKeptDurationMismatchRebuildsFromWindowStart) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+  // Same sequence numbers, but segment 12 now lasts 7 s.
+  index.Update(MakePlaylist(11, {6, 7, 3}));
+
+  EXPECT_EQ(index.first_sequence(), 11);
+  EXPECT_EQ(index.StartTimeUs(11), 4000000);
+  EXPECT_EQ(index.StartTimeUs(12), 10000000);
+  EXPECT_EQ(index.StartTimeUs(13), 17000000);
+  EXPECT_EQ(index.end_time_us(), 20000000);
+}
+
+TEST(SegmentIndexTest, OnlyTheLastKeptDurationIsChecked) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+  // Segment 11 changed but the last kept one, 12, did not: the old start
+  // times are taken over, since listed segments are not expected to change.
+  index.Update(MakePlaylist(10, {4, 9, 5, 2}));
+
+  EXPECT_EQ(index.StartTimeUs(12), 10000000);
+  EXPECT_EQ(index.StartTimeUs(13), 15000000);
+  EXPECT_EQ(index.end_time_us(), 17000000);
+}
+
+TEST(SegmentIndexTest, SequenceForTimeClampsToTheWindow) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6, 5}));
+  index.Update(MakePlaylist(11, {6, 5}));
+  // The window now covers [4 s, 15 s).
+
+  EXPECT_EQ(index.SequenceForTime(-1), 11);
+  EXPECT_EQ(index.SequenceForTime(0), 11);
+  EXPECT_EQ(index.SequenceForTime(4000000), 11);
+  EXPECT_EQ(index.SequenceForTime(9999999), 11);
+  EXPECT_EQ(index.SequenceForTime(10000000), 12);
+  EXPECT_EQ(index.SequenceForTime(14999999), 12);
+  EXPECT_EQ(index.SequenceForTime(15000000), index.end_sequence());
+  EXPECT_EQ(index.SequenceForTime(100000000), index.end_sequence());
+}
+
+TEST(SegmentIndexTest, StartTimeUsClampsToTheWindow) {
+  SegmentIndex index;
+  index.Update(MakePlaylist(10, {4, 6}));
+  EXPECT_EQ(index.StartTimeUs(3), 0);
+  EXPECT_EQ(index.StartTimeUs(50), 10000000);
+}
+
+TEST(SegmentIndexTest, EmptyIndex) {
+  SegmentIndex index;
+  EXPECT_EQ(index.StartTimeUs(0), 0);
+  EXPECT_EQ(index.end_time_us(), 0);
+  EXPECT_EQ(index.SequenceForTime(1000), 0);
+
+  index.Update(MakePlaylist(10, {4}));
+  index.Clear();
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(index.first_sequence(), 0);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,69 @@
+/*
+ * segment_parser.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_PARSER_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "base/errors.h"
+#include "media/foundation/media_frame.h"
+#include "media/foundation/media_meta.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+/**
+ * @brief Push parser for one HLS media segment.
+ *
+ * Bytes are appended as they arrive from the network and access units are
+ * dequeued as soon as they are complete, while the rest of the segment is
+ * still downloading.
+ */
+class SegmentParser {
+ public:
+  virtual ~SegmentParser() = default;
+
+  virtual status_t Append(const uint8_t* data, size_t size) = 0;
+  // Parses whatever is left; no more data follows.
+  virtual status_t Finish() = 0;
+
+  // True once the formats of all tracks in the segment are known.
+  virtual bool TracksReady() const = 0;
+  // Returns null until the format of |media_type| is usable.
+  virtual std::shared_ptr<media::MediaMeta> GetFormat(
+      media::MediaType media_type) const = 0;
+
+  /**
+   * @return OK with the next access unit of |media_type|, WOULD_BLOCK if none
+   * is complete yet, or ERROR_END_OF_STREAM once the segment is finished and
+   * drained.
+   */
+  virtual status_t DequeueAccessUnit(
+      media::MediaType media_type,
+      std::shared_ptr<media::MediaFrame>& access_unit) = 0;
+
+  /**
+   * @brief Container time at which the segment starts (tfdt for fMP4).
+   * @return -1 while unknown, or if the access unit timestamps are relative
+   * to the segment start.
+   */
+  virtual int64_t GetBaseMediaTimeUs() const { return -1; }
+
+  // True if video access units are length-prefixed NAL units (MP4 samples)
+  // rather than Annex B.
+  virtual bool HasLengthPrefixedNalUnits() const { return false; }
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_SEGMENT_PARSER_H_
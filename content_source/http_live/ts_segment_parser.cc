@@ -0,0 +1,305 @@
+/*
+ * ts_segment_parser.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/ts_segment_parser.h"
+
+#include <algorithm>
+
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_mimes.h"
+#include "media/modules/mpeg2ts/packet_source.h"
+#include "media/modules/mpeg2ts/ts_parser.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+
+namespace {
+
+constexpr size_t kTsPacketSize = 188;
+constexpr size_t kM2tsPacketSize = 192;
+constexpr size_t kTsSniffPacketCount = 5;
+constexpr size_t kMaxTsSyncOffset = kM2tsPacketSize - 1;
+constexpr size_t kTsSniffSize =
+    kMaxTsSyncOffset + kTsSniffPacketCount * kM2tsPacketSize;
+constexpr size_t kMaxTsPacketSpacing = 204;
+constexpr size_t kResyncProbeSize = kTsPacketSize + 512;
+constexpr size_t kResyncAdvance = 256;
+
+bool HasSyncPattern(const uint8_t* data,
+                    size_t size,
+                    size_t sync_offset,
+                    size_t packet_size) {
+  const size_t required =
+      sync_offset + (kTsSniffPacketCount - 1) * packet_size + 1;
+  if (size < required) {
+    return false;
+  }
+
+  for (size_t i = 0; i < kTsSniffPacketCount; ++i) {
+    if (data[sync_offset + i * packet_size] != 0x47) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SniffTsSegment(const uint8_t* data,
+                    size_t size,
+                    size_t* sync_offset,
+                    size_t* packet_stride) {
+  size = std::min(size, kTsSniffSize);
+  if (size < kTsPacketSize * kTsSniffPacketCount) {
+    return false;
+  }
+
+  for (size_t offset = 0; offset <= kMaxTsSyncOffset; ++offset) {
+    if (HasSyncPattern(data, size, offset, kTsPacketSize)) {
+      *sync_offset = offset;
+      *packet_stride = kTsPacketSize;
+      return true;
+    }
+
+    if (HasSyncPattern(data, size, offset, kM2tsPacketSize)) {
+      *sync_offset = offset;
+      *packet_stride = kM2tsPacketSize;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool LooksLikePacketStart(const uint8_t* data, size_t size, size_t candidate) {
+  if (candidate >= size || data[candidate] != 0x47) {
+    return false;
+  }
+
+  if (candidate + kTsPacketSize >= size) {
+    return true;
+  }
+
+  for (size_t delta = kTsPacketSize; delta <= kMaxTsPacketSpacing; ++delta) {
+    const size_t next = candidate + delta;
+    if (next < size && data[next] == 0x47) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool IsTsTrackFormatReady(const std::shared_ptr<media::MediaMeta>& format) {
+  if (!format || format->mime().empty()) {
+    return false;
+  }
+
+  if (format->mime() == media::MEDIA_MIMETYPE_VIDEO_AVC) {
+    return format->private_data() && format->width() > 0 &&
+           format->height() > 0;
+  }
+
+  if (format->mime() == media::MEDIA_MIMETYPE_AUDIO_AAC) {
+    return format->private_data() && format->sample_rate() > 0;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+TsSegmentParser::TsSegmentParser()
+    : parser_(std::make_unique<media::mpeg2ts::TSParser>()) {}
+
+TsSegmentParser::~TsSegmentParser() = default;
+
+status_t TsSegmentParser::Append(const uint8_t* data, size_t size) {
+  if (eos_signaled_) {
+    return media::ERROR_END_OF_STREAM;
+  }
+  pending_.insert(pending_.end(), data, data + size);
+
+  if (!sniffed_) {
+    if (pending_.size() < kTsSniffSize) {
+      return OK;
+    }
+    size_t sync_offset = 0;
+    if (!SniffTsSegment(pending_.data(), pending_.size(), &sync_offset,
+                        &packet_stride_)) {
+      return media::ERROR_UNSUPPORTED;
+    }
+    pending_.erase(pending_.begin(),
+                   pending_.begin() + static_cast<ptrdiff_t>(sync_offset));
+    pending_offset_ = static_cast<int64_t>(sync_offset);
+    sniffed_ = true;
+  }
+
+  status_t err = ParseBuffered(false);
+  MaybeAddTracks();
+  return err;
+}
+
+status_t TsSegmentParser::Finish() {
+  if (!sniffed_) {
+    // Segment shorter than the sniff window.
+    size_t sync_offset = 0;
+    if (!SniffTsSegment(pending_.data(), pending_.size(), &sync_offset,
+                        &packet_stride_)) {
+      return media::ERROR_UNSUPPORTED;
+    }
+    pending_.erase(pending_.begin(),
+                   pending_.begin() + static_cast<ptrdiff_t>(sync_offset));
+    pending_offset_ = static_cast<int64_t>(sync_offset);
+    sniffed_ = true;
+  }
+
+  status_t err = ParseBuffered(true);
+  SignalParserEOS(err == OK ? static_cast<status_t>(media::ERROR_END_OF_STREAM)
+                            : err);
+  pending_.clear();
+  MaybeAddTracks();
+
+  if (err != OK) {
+    return err;
+  }
+  return audio_source_ || video_source_
+             ? static_cast<status_t>(OK)
+             : static_cast<status_t>(media::ERROR_UNSUPPORTED);
+}
+
+bool TsSegmentParser::TracksReady() const {
+  const bool has_audio = parser_->GetSource(media::mpeg2ts::TSParser::AUDIO) !=
+                         nullptr;
+  const bool has_video = parser_->GetSource(media::mpeg2ts::TSParser::VIDEO) !=
+                         nullptr;
+  return (has_audio || has_video) && has_audio == (audio_source_ != nullptr) &&
+         has_video == (video_source_ != nullptr);
+}
+
+std::shared_ptr<media::MediaMeta> TsSegmentParser::GetFormat(
+    media::MediaType media_type) const {
+  auto source = GetSource(media_type);
+  return source ? source->GetFormat() : nullptr;
+}
+
+status_t TsSegmentParser::DequeueAccessUnit(
+    media::MediaType media_type,
+    std::shared_ptr<media::MediaFrame>& access_unit) {
+  auto source = GetSource(media_type);
+  if (!source) {
+    return eos_signaled_ ? static_cast<status_t>(media::ERROR_END_OF_STREAM)
+                         : static_cast<status_t>(WOULD_BLOCK);
+  }
+
+  for (;;) {
+    status_t final_result = OK;
+    if (!source->HasBufferAvailable(&final_result)) {
+      return final_result == OK ? static_cast<status_t>(WOULD_BLOCK)
+                                : final_result;
+    }
+    status_t err = source->DequeueAccessUnit(access_unit);
+    if (err == media::INFO_DISCONTINUITY) {
+      continue;
+    }
+    return err;
+  }
+}
+
+std::shared_ptr<media::mpeg2ts::PacketSource> TsSegmentParser::GetSource(
+    media::MediaType media_type) const {
+  switch (media_type) {
+    case media::MediaType::AUDIO:
+      return audio_source_;
+    case media::MediaType::VIDEO:
+      return video_source_;
+    default:
+      return nullptr;
+  }
+}
+
+// Feeds the complete packets in pending_ to the TS parser. Without |flush| a
+// full resync probe is kept buffered so packet boundaries are judged the same
+// way whether or not the rest of the segment has arrived.
+status_t TsSegmentParser::ParseBuffered(bool flush) {
+  size_t pos = 0;
+  status_t err = OK;
+
+  while (!eos_signaled_) {
+    const size_t available = pending_.size() - pos;
+    if (available < (flush ? kTsPacketSize : kResyncProbeSize)) {
+      break;
+    }
+
+    const uint8_t* probe = pending_.data() + pos;
+    const size_t probe_size = std::min(available, kResyncProbeSize);
+    bool fed = false;
+    for (size_t candidate = 0; candidate + kTsPacketSize <= probe_size;
+         ++candidate) {
+      if (!LooksLikePacketStart(probe, probe_size, candidate)) {
+        continue;
+      }
+
+      const int64_t packet_offset =
+          pending_offset_ + static_cast<int64_t>(pos + candidate);
+      media::mpeg2ts::TSParser::SyncEvent event(packet_offset);
+      err = parser_->FeedTSPacket(probe + candidate, kTsPacketSize, &event);
+      if (err == media::ERROR_MALFORMED) {
+        pos += candidate + 1;
+        err = OK;
+      } else {
+        pos += candidate + packet_stride_;
+      }
+      fed = true;
+      break;
+    }
+
+    if (err != OK) {
+      SignalParserEOS(err);
+      break;
+    }
+    if (!fed) {
+      if (probe_size < kResyncProbeSize) {
+        // Trailing garbage at the end of the segment.
+        pos = pending_.size();
+        break;
+      }
+      pos += kResyncAdvance;
+    }
+  }
+
+  pos = std::min(pos, pending_.size());
+  pending_.erase(pending_.begin(),
+                 pending_.begin() + static_cast<ptrdiff_t>(pos));
+  pending_offset_ += static_cast<int64_t>(pos);
+  return err;
+}
+
+void TsSegmentParser::SignalParserEOS(status_t result) {
+  if (!eos_signaled_) {
+    parser_->SignalEOS(result);
+    eos_signaled_ = true;
+  }
+}
+
+void TsSegmentParser::MaybeAddTracks() {
+  for (auto type :
+       {media::mpeg2ts::TSParser::AUDIO, media::mpeg2ts::TSParser::VIDEO}) {
+    auto& track = type == media::mpeg2ts::TSParser::AUDIO ? audio_source_
+                                                          : video_source_;
+    if (track) {
+      continue;
+    }
+    auto source = parser_->GetSource(type);
+    if (source && IsTsTrackFormatReady(source->GetFormat())) {
+      track = std::move(source);
+    }
+  }
+}
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,75 @@
+/*
+ * ts_segment_parser.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVP_CONTENT_SOURCE_HTTP_LIVE_TS_SEGMENT_PARSER_H_
+#define AVP_CONTENT_SOURCE_HTTP_LIVE_TS_SEGMENT_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "content_source/http_live/segment_parser.h"
+
+namespace ave {
+namespace media {
+namespace mpeg2ts {
+class PacketSource;
+class TSParser;
+}  // namespace mpeg2ts
+}  // namespace media
+
+namespace player {
+namespace http_live {
+
+/**
+ * @brief SegmentParser for MPEG-TS (and M2TS) segments.
+ *
+ * Every complete transport packet is handed to the TS parser as soon as it
+ * is appended; only the unparsed tail of the input is kept. Timestamps are
+ * relative to the start of the segment.
+ */
+class TsSegmentParser : public SegmentParser {
+ public:
+  TsSegmentParser();
+  ~TsSegmentParser() override;
+
+  status_t Append(const uint8_t* data, size_t size) override;
+  // Also signals end of stream to the elementary stream sources.
+  status_t Finish() override;
+
+  // True once every elementary stream listed in the PMT has a usable format.
+  bool TracksReady() const override;
+  std::shared_ptr<media::MediaMeta> GetFormat(
+      media::MediaType media_type) const override;
+  status_t DequeueAccessUnit(
+      media::MediaType media_type,
+      std::shared_ptr<media::MediaFrame>& access_unit) override;
+
+ private:
+  std::shared_ptr<media::mpeg2ts::PacketSource> GetSource(
+      media::MediaType media_type) const;
+  status_t ParseBuffered(bool flush);
+  void SignalParserEOS(status_t result);
+  void MaybeAddTracks();
+
+  std::unique_ptr<media::mpeg2ts::TSParser> parser_;
+  std::shared_ptr<media::mpeg2ts::PacketSource> audio_source_;
+  std::shared_ptr<media::mpeg2ts::PacketSource> video_source_;
+  std::vector<uint8_t> pending_;
+  // Segment offset of pending_[0].
+  int64_t pending_offset_ = 0;
+  size_t packet_stride_ = 0;
+  bool sniffed_ = false;
+  bool eos_signaled_ = false;
+};
+
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
+
+#endif  // AVP_CONTENT_SOURCE_HTTP_LIVE_TS_SEGMENT_PARSER_H_
@@ -0,0 +1,305 @@
+/*
+ * ts_segment_parser_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "content_source/http_live/ts_segment_parser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "media/foundation/media_errors.h"
+#include "media/foundation/media_frame.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+namespace http_live {
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr size_t kTsPacketSize = 188;
+constexpr uint16_t kPmtPid = 0x100;
+constexpr uint16_t kAudioPid = 0x101;
+constexpr uint8_t kStreamTypeAacAdts = 0x0f;
+constexpr int64_t kPtsWrap = int64_t{1} << 33;
+// 1024 samples at 48 kHz, in 90 kHz ticks and in microseconds. Converted
+// timestamps are truncated, so consecutive frames differ by the duration
+// give or take 1 us.
+constexpr int64_t kFrameTicks = 1920;
+constexpr int64_t kFrameDurationUs = 21333;
+
+uint32_t Crc32Mpeg(const Bytes& data) {
+  uint32_t crc = 0xffffffff;
+  for (uint8_t byte : data) {
+    crc ^= static_cast<uint32_t>(byte) << 24;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void Put16(Bytes* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void Put32(Bytes* out, uint32_t value) {
+  Put16(out, value >> 16);
+  Put16(out, value & 0xffff);
+}
+
+// Writes one transport packet. Payloads shorter than a packet are padded
+// with adaptation field stuffing, which is not part of the payload.
+void PutPacket(Bytes* out,
+               uint16_t pid,
+               bool payload_start,
+               uint8_t continuity_counter,
+               const uint8_t* payload,
+               size_t size) {
+  out->push_back(0x47);
+  Put16(out, (payload_start ? 0x4000 : 0) | pid);
+  if (size + 4 == kTsPacketSize) {
+    out->push_back(0x10 | (continuity_counter & 0x0f));
+  } else {
+    out->push_back(0x30 | (continuity_counter & 0x0f));
+    const size_t field_size = kTsPacketSize - 4 - size - 1;
+    out->push_back(static_cast<uint8_t>(field_size));
+    if (field_size > 0) {
+      out->push_back(0x00);
+      out->insert(out->end(), field_size - 1, 0xff);
+    }
+  }
+  out->insert(out->end(), payload, payload + size);
+}
+
+// A PSI section in a single packet, filled up with 0xff.
+void PutSection(Bytes* out, uint16_t pid, Bytes section) {
+  Put32(&section, Crc32Mpeg(section));
+  Bytes payload = {0x00};  // pointer_field
+  payload.insert(payload.end(), section.begin(), section.end());
+  payload.resize(kTsPacketSize - 4, 0xff);
+  PutPacket(out, pid, true, 0, payload.data(), payload.size());
+}
+
+void PutPat(Bytes* out) {
+  Bytes section = {0x00};  // table_id
+  Put16(&section, 0xb000 | 13);
+  Put16(&section, 1);  // transport_stream_id
+  section.insert(section.end(), {0xc1, 0x00, 0x00});
+  Put16(&section, 1);  // program_number
+  Put16(&section, 0xe000 | kPmtPid);
+  PutSection(out, 0, section);
+}
+
+void PutPmt(Bytes* out) {
+  Bytes section = {0x02};  // table_id
+  Put16(&section, 0xb000 | 18);
+  Put16(&section, 1);  // program_number
+  section.insert(section.end(), {0xc1, 0x00, 0x00});
+  Put16(&section, 0xe000 | kAudioPid);  // PCR_PID
+  Put16(&section, 0xf000);              // program_info_length
+  section.push_back(kStreamTypeAacAdts);
+  Put16(&section, 0xe000 | kAudioPid);
+  Put16(&section, 0xf000);  // ES_info_length
+  PutSection(out, kPmtPid, section);
+}
+
+uint8_t PayloadByte(size_t frame, size_t index) {
+  return static_cast<uint8_t>(frame * 37 + index * 7 + 1);
+}
+
+// One AAC-LC frame, 48 kHz stereo, behind a 7 byte ADTS header.
+Bytes MakeAdtsFrame(size_t frame, size_t payload_size) {
+  const size_t frame_length = payload_size + 7;
+  Bytes adts = {
+      0xff,
+      0xf1,
+      static_cast<uint8_t>((1 << 6) | (3 << 2)),
+      static_cast<uint8_t>((2 << 6) | ((frame_length >> 11) & 0x03)),
+      static_cast<uint8_t>(frame_length >> 3),
+      static_cast<uint8_t>(((frame_length & 0x07) << 5) | 0x1f),
+      0xfc,
+  };
+  for (size_t i = 0; i < payload_size; ++i) {
+    adts.push_back(PayloadByte(frame, i));
+  }
+  return adts;
+}
+
+Bytes MakePes(int64_t pts, const Bytes& es) {
+  pts &= kPtsWrap - 1;
+  Bytes pes = {0x00, 0x00, 0x01, 0xc0};
+  Put16(&pes, static_cast<uint32_t>(es.size() + 8));
+  pes.insert(pes.end(), {0x80, 0x80, 0x05});
+  pes.push_back(static_cast<uint8_t>(0x21 | ((pts >> 29) & 0x0e)));
+  pes.push_back(static_cast<uint8_t>(pts >> 22));
+  pes.push_back(static_cast<uint8_t>(((pts >> 14) & 0xfe) | 0x01));
+  pes.push_back(static_cast<uint8_t>(pts >> 7));
+  pes.push_back(static_cast<uint8_t>(((pts << 1) & 0xfe) | 0x01));
+  pes.insert(pes.end(), es.begin(), es.end());
+  return pes;
+}
+
+struct SegmentOptions {
+  int64_t first_pts = 900000;
+  size_t frame_count = 6;
+  size_t payload_size = 400;
+  // Frame whose second packet is lost, or -1.
+  int lost_packet_frame = -1;
+};
+
+// PAT, PMT, then one ADTS frame per PES. Each PES spans several packets.
+Bytes MakeSegment(const SegmentOptions& options) {
+  Bytes out;
+  PutPat(&out);
+  PutPmt(&out);
+  uint8_t continuity_counter = 0;
+  for (size_t frame = 0; frame < options.frame_count; ++frame) {
+    const Bytes pes =
+        MakePes(options.first_pts + static_cast<int64_t>(frame) * kFrameTicks,
+                MakeAdtsFrame(frame, options.payload_size));
+    size_t packet = 0;
+    for (size_t offset = 0; offset < pes.size(); ++packet) {
+      const size_t size = std::min(kTsPacketSize - 4, pes.size() - offset);
+      if (static_cast<int>(frame) == options.lost_packet_frame &&
+          packet == 1) {
+        // Dropped on the way: the counter still advances.
+        ++continuity_counter;
+      } else {
+        PutPacket(&out, kAudioPid, offset == 0, continuity_counter++,
+                  pes.data() + offset, size);
+      }
+      offset += size;
+    }
+  }
+  return out;
+}
+
+int64_t FrameTimeUs(const std::shared_ptr<media::MediaFrame>& frame) {
+  const auto* info = frame->audio_info();
+  return info && info->pts.IsFinite() ? info->pts.us() : -1;
+}
+
+std::vector<std::shared_ptr<media::MediaFrame>> DrainFrames(
+    TsSegmentParser* parser) {
+  std::vector<std::shared_ptr<media::MediaFrame>> frames;
+  for (;;) {
+    std::shared_ptr<media::MediaFrame> frame;
+    if (parser->DequeueAccessUnit(media::MediaType::AUDIO, frame) != OK) {
+      return frames;
+    }
+    frames.push_back(frame);
+  }
+}
+
+// Appends |segment| in pieces of the given sizes, cycling through them.
+std::vector<std::shared_ptr<media::MediaFrame>> ParseInPieces(
+    const Bytes& segment,
+    const std::vector<size_t>& piece_sizes) {
+  TsSegmentParser parser;
+  size_t offset = 0;
+  for (size_t i = 0; offset < segment.size(); ++i) {
+    const size_t size =
+        std::min(piece_sizes[i % piece_sizes.size()], segment.size() - offset);
+    EXPECT_EQ(parser.Append(segment.data() + offset, size), OK)
+        << "offset " << offset;
+    offset += size;
+  }
+  EXPECT_EQ(parser.Finish(), OK);
+  EXPECT_TRUE(parser.TracksReady());
+  return DrainFrames(&parser);
+}
+
+// The ADTS header may or may not be stripped; the frame ends with the raw
+// payload either way.
+void ExpectPayload(const std::shared_ptr<media::MediaFrame>& frame,
+                   size_t index,
+                   size_t payload_size) {
+  ASSERT_GE(frame->size(), payload_size) << "frame " << index;
+  const uint8_t* payload = frame->data() + frame->size() - payload_size;
+  for (size_t i = 0; i < payload_size; ++i) {
+    ASSERT_EQ(payload[i], PayloadByte(index, i))
+        << "frame " << index << " byte " << i;
+  }
+}
+
+TEST(TsSegmentParserTest, ReassemblesPesSpanningPackets) {
+  SegmentOptions options;
+  auto frames = ParseInPieces(MakeSegment(options), {64 * 1024});
+  ASSERT_EQ(frames.size(), options.frame_count);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ExpectPayload(frames[i], i, options.payload_size);
+  }
+  for (size_t i = 1; i < frames.size(); ++i) {
+    EXPECT_NEAR(FrameTimeUs(frames[i]) - FrameTimeUs(frames[i - 1]),
+                kFrameDurationUs, 1)
+        << "frame " << i;
+  }
+}
+
+TEST(TsSegmentParserTest, PacketsSplitAcrossAppendsParseTheSame) {
+  SegmentOptions options;
+  const Bytes segment = MakeSegment(options);
+  auto whole = ParseInPieces(segment, {segment.size()});
+  ASSERT_EQ(whole.size(), options.frame_count);
+
+  // Piece sizes that cut packets, the sniff window and PES headers at
+  // different places.
+  for (const auto& pieces : std::vector<std::vector<size_t>>{
+           {1}, {7, 181}, {187}, {189, 3}, {500}}) {
+    auto split = ParseInPieces(segment, pieces);
+    ASSERT_EQ(split.size(), whole.size()) << "first piece " << pieces[0];
+    for (size_t i = 0; i < split.size(); ++i) {
+      EXPECT_EQ(FrameTimeUs(split[i]), FrameTimeUs(whole[i]))
+          << "first piece " << pieces[0] << " frame " << i;
+      ExpectPayload(split[i], i, options.payload_size);
+    }
+  }
+}
+
+TEST(TsSegmentParserTest, ContinuityGapDropsOnlyTheDamagedPes) {
+  SegmentOptions options;
+  options.lost_packet_frame = 2;
+  auto frames = ParseInPieces(MakeSegment(options), {1000});
+  ASSERT_EQ(frames.size(), options.frame_count - 1);
+
+  // Frames 0, 1, 3, 4, 5 survive with their own payload and timing.
+  const size_t expected[] = {0, 1, 3, 4, 5};
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ExpectPayload(frames[i], expected[i], options.payload_size);
+  }
+  EXPECT_NEAR(FrameTimeUs(frames[2]) - FrameTimeUs(frames[1]),
+              2 * kFrameDurationUs, 1);
+}
+
+TEST(TsSegmentParserTest, TimestampsStayMonotonicAcrossPtsWrap) {
+  SegmentOptions options;
+  // The third frame's PTS wraps past 2^33.
+  options.first_pts = kPtsWrap - 2 * kFrameTicks - 100;
+  auto frames = ParseInPieces(MakeSegment(options), {1000});
+  ASSERT_EQ(frames.size(), options.frame_count);
+  for (size_t i = 1; i < frames.size(); ++i) {
+    EXPECT_NEAR(FrameTimeUs(frames[i]) - FrameTimeUs(frames[i - 1]),
+                kFrameDurationUs, 1)
+        << "frame " << i;
+  }
+}
+
+TEST(TsSegmentParserTest, RejectsNonTsData) {
+  TsSegmentParser parser;
+  Bytes garbage(4096, 0x11);
+  EXPECT_EQ(parser.Append(garbage.data(), garbage.size()),
+            media::ERROR_UNSUPPORTED);
+}
+
+}  // namespace
+}  // namespace http_live
+}  // namespace player
+}  // namespace ave
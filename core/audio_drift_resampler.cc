@@ -0,0 +1,115 @@
+/*
+ * audio_drift_resampler.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "audio_drift_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ave {
+namespace player {
+
+AudioDriftResampler::AudioDriftResampler(SampleFormat format, int channels)
+    : format_(format),
+      channels_(std::max(channels, 1)),
+      previous_(static_cast<size_t>(channels_), 0.0f) {}
+
+size_t AudioDriftResampler::MaxOutputFrames(size_t input_frames,
+                                            double ratio) {
+  return static_cast<size_t>(
+             std::ceil(static_cast<double>(input_frames) * ratio)) +
+         2;
+}
+
+size_t AudioDriftResampler::frame_size() const {
+  const size_t sample_size = format_ == SampleFormat::kS16 ? 2 : 4;
+  return sample_size * static_cast<size_t>(channels_);
+}
+
+float AudioDriftResampler::SampleAt(const uint8_t* input,
+                                    int64_t frame,
+                                    int channel) const {
+  if (frame < 0) {
+    return previous_[static_cast<size_t>(channel)];
+  }
+  const size_t index = static_cast<size_t>(frame) * channels_ + channel;
+  if (format_ == SampleFormat::kS16) {
+    int16_t sample = 0;
+    std::memcpy(&sample, input + index * 2, sizeof(sample));
+    return static_cast<float>(sample);
+  }
+  float sample = 0;
+  std::memcpy(&sample, input + index * 4, sizeof(sample));
+  return sample;
+}
+
+void AudioDriftResampler::Store(uint8_t* output,
+                                size_t frame,
+                                int channel,
+                                float value) const {
+  const size_t index = frame * channels_ + channel;
+  if (format_ == SampleFormat::kS16) {
+    const auto sample = static_cast<int16_t>(
+        std::clamp(std::lround(value), -32768L, 32767L));
+    std::memcpy(output + index * 2, &sample, sizeof(sample));
+    return;
+  }
+  std::memcpy(output + index * 4, &value, sizeof(value));
+}
+
+size_t AudioDriftResampler::Process(const uint8_t* input,
+                                    size_t input_frames,
+                                    double ratio,
+                                    uint8_t* output) {
+  if (input_frames == 0) {
+    return 0;
+  }
+  if (ratio <= 0) {
+    ratio = 1.0;
+  }
+  if (!has_previous_) {
+    // Start on the first input frame.
+    for (int c = 0; c < channels_; ++c) {
+      previous_[static_cast<size_t>(c)] = SampleAt(input, 0, c);
+    }
+    has_previous_ = true;
+    position_ = 1.0;
+  }
+
+  // Interpolate between frames -1 .. input_frames - 1; position_ counts
+  // from frame -1.
+  const double step = 1.0 / ratio;
+  const double end = static_cast<double>(input_frames);
+  size_t written = 0;
+  while (position_ < end) {
+    const auto base = static_cast<int64_t>(position_);
+    const auto weight = static_cast<float>(position_ - base);
+    for (int c = 0; c < channels_; ++c) {
+      const float a = SampleAt(input, base - 1, c);
+      const float b = weight > 0 ? SampleAt(input, base, c) : a;
+      Store(output, written, c, a + (b - a) * weight);
+    }
+    written++;
+    position_ += step;
+  }
+
+  position_ -= end;
+  for (int c = 0; c < channels_; ++c) {
+    previous_[static_cast<size_t>(c)] =
+        SampleAt(input, static_cast<int64_t>(input_frames) - 1, c);
+  }
+  return written;
+}
+
+void AudioDriftResampler::Reset() {
+  has_previous_ = false;
+  position_ = 0;
+}
+
+}  // namespace player
+}  // namespace ave
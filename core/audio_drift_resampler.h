@@ -0,0 +1,73 @@
+/*
+ * audio_drift_resampler.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_AUDIO_DRIFT_RESAMPLER_H_H_
+#define AVE_AVP_AUDIO_DRIFT_RESAMPLER_H_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Resamples interleaved PCM by ratios close to 1, to play audio a
+ * few hundred ppm faster or slower than the device clock.
+ *
+ * Linear interpolation; at the ratios drift correction needs the error is
+ * far below the noise floor. The interpolation position is carried from
+ * one buffer to the next, so consecutive buffers resample as one stream.
+ * Not thread safe.
+ */
+class AudioDriftResampler {
+ public:
+  enum class SampleFormat {
+    kS16,
+    kFloat,
+  };
+
+  AudioDriftResampler(SampleFormat format, int channels);
+
+  /**
+   * @brief Upper bound of the output frames for |input_frames| at |ratio|.
+   */
+  static size_t MaxOutputFrames(size_t input_frames, double ratio);
+
+  /**
+   * @brief Resamples |input_frames| frames from |input| into |output|.
+   * @param ratio Output frames per input frame; > 1 stretches the audio.
+   * @return Frames written to |output|, at most MaxOutputFrames().
+   */
+  size_t Process(const uint8_t* input,
+                 size_t input_frames,
+                 double ratio,
+                 uint8_t* output);
+
+  // Forgets the carried position, e.g. after a flush.
+  void Reset();
+
+  size_t frame_size() const;
+
+ private:
+  float SampleAt(const uint8_t* input, int64_t frame, int channel) const;
+  void Store(uint8_t* output, size_t frame, int channel, float value) const;
+
+  const SampleFormat format_;
+  const int channels_;
+
+  // Last input frame of the previous buffer, frame -1 of the next one.
+  std::vector<float> previous_;
+  bool has_previous_ = false;
+  // Position of the next output frame, in input frames from frame -1.
+  double position_ = 0;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_AUDIO_DRIFT_RESAMPLER_H_H_ */
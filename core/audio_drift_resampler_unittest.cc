@@ -0,0 +1,100 @@
+/*
+ * audio_drift_resampler_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "audio_drift_resampler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+// Resamples |input| of |channels| float channels in |chunk| frame buffers.
+std::vector<float> ResampleFloat(const std::vector<float>& input,
+                                 int channels,
+                                 size_t chunk,
+                                 double ratio) {
+  AudioDriftResampler resampler(AudioDriftResampler::SampleFormat::kFloat,
+                                channels);
+  const size_t frames = input.size() / channels;
+  std::vector<float> output;
+  for (size_t start = 0; start < frames; start += chunk) {
+    const size_t count = std::min(chunk, frames - start);
+    std::vector<float> out(
+        AudioDriftResampler::MaxOutputFrames(count, ratio) * channels);
+    const size_t written = resampler.Process(
+        reinterpret_cast<const uint8_t*>(input.data() + start * channels),
+        count, ratio, reinterpret_cast<uint8_t*>(out.data()));
+    EXPECT_LE(written, AudioDriftResampler::MaxOutputFrames(count, ratio));
+    output.insert(output.end(), out.begin(), out.begin() + written * channels);
+  }
+  return output;
+}
+
+}  // namespace
+
+TEST(AudioDriftResamplerTest, UnitRatioPassesSamplesThrough) {
+  std::vector<float> input;
+  for (int i = 0; i < 1000; ++i) {
+    input.push_back(static_cast<float>(i));
+    input.push_back(static_cast<float>(-i));
+  }
+  const auto output = ResampleFloat(input, 2, 160, 1.0);
+  // The last input frame is held back for the next buffer.
+  ASSERT_EQ(output.size(), input.size() - 2);
+  EXPECT_EQ(std::memcmp(output.data(), input.data(),
+                        output.size() * sizeof(float)),
+            0);
+}
+
+TEST(AudioDriftResamplerTest, StretchesAcrossBuffers) {
+  constexpr double kRatio = 1.0005;
+  std::vector<float> ramp;
+  for (int i = 0; i < 48000; ++i) {
+    ramp.push_back(static_cast<float>(i));
+  }
+  const auto output = ResampleFloat(ramp, 1, 441, kRatio);
+  // 500 ppm longer, less the held back frame.
+  EXPECT_NEAR(static_cast<double>(output.size()), 48000 * kRatio - 1, 1);
+  // Linear interpolation of a ramp is exact, buffer boundaries included.
+  for (size_t k = 0; k < output.size(); ++k) {
+    ASSERT_NEAR(output[k], k / kRatio, 0.02) << "at frame " << k;
+  }
+}
+
+TEST(AudioDriftResamplerTest, ShrinksS16) {
+  constexpr double kRatio = 0.999;
+  AudioDriftResampler resampler(AudioDriftResampler::SampleFormat::kS16, 1);
+  EXPECT_EQ(resampler.frame_size(), 2u);
+  std::vector<int16_t> input(10000, 1200);
+  std::vector<int16_t> output(
+      AudioDriftResampler::MaxOutputFrames(input.size(), kRatio));
+  size_t written = resampler.Process(
+      reinterpret_cast<const uint8_t*>(input.data()), input.size(), kRatio,
+      reinterpret_cast<uint8_t*>(output.data()));
+  EXPECT_NEAR(static_cast<double>(written), 10000 * kRatio - 1, 1);
+  for (size_t k = 0; k < written; ++k) {
+    ASSERT_EQ(output[k], 1200);
+  }
+
+  // After a reset the next buffer starts over at its first frame.
+  resampler.Reset();
+  input.assign(100, -7);
+  written = resampler.Process(reinterpret_cast<const uint8_t*>(input.data()),
+                              input.size(), 1.0,
+                              reinterpret_cast<uint8_t*>(output.data()));
+  EXPECT_EQ(written, 99u);
+  EXPECT_EQ(output[0], -7);
+}
+
+}  // namespace player
+}  // namespace ave
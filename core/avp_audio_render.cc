@@ -224,6 +224,9 @@ void AVPAudioRender::Flush() {
     audio_track_started_ = false;
     last_position_log_time_us_ = 0;
     last_played_frames_ = 0;
+    if (drift_resampler_) {
+      drift_resampler_->Reset();
+    }
 
     if (audio_track_) {
       audio_track_->Flush();
@@ -311,7 +314,7 @@ uint64_t AVPAudioRender::RenderFrameInternal(
   // correctly revert the consumption if the write fails entirely.
   bool consumed_frame_this_call = false;
   if (!cached_frame_) {
-    cached_frame_ = frame;
+    cached_frame_ = ResampleForDriftLocked(frame);
     consumed = true;
     consumed_frame_this_call = true;
     AVE_LOG(LS_INFO) << "RenderFrameInternal[AUDIO]: consumed new frame, "
@@ -599,6 +602,8 @@ void AVPAudioRender::DestroyAudioTrack() {
     audio_track_.reset();
     AVE_LOG(LS_INFO) << "Audio track destroyed";
   }
+  // The next track may have another sample format.
+  drift_resampler_.reset();
 }
 
 bool AVPAudioRender::HasAudioFormatChanged(
@@ -875,6 +880,57 @@ void AVPAudioRender::UpdateCompressedSyncAnchorLocked(
   last_played_frames_ = played_frames;
 }
 
+std::shared_ptr<media::MediaFrame> AVPAudioRender::ResampleForDriftLocked(
+    const std::shared_ptr<media::MediaFrame>& frame) {
+  if (!master_stream_ || !GetAVSyncController() ||
+      IsCompressedOutputLocked()) {
+    return frame;
+  }
+  const double ratio = GetAVSyncController()->GetAudioResampleRatio();
+  if (ratio == 1.0 && !drift_resampler_) {
+    return frame;
+  }
+
+  if (!drift_resampler_) {
+    AudioDriftResampler::SampleFormat format;
+    if (current_audio_config_.format == media::AUDIO_FORMAT_PCM_16_BIT) {
+      format = AudioDriftResampler::SampleFormat::kS16;
+    } else if (current_audio_config_.format ==
+               media::AUDIO_FORMAT_PCM_FLOAT) {
+      format = AudioDriftResampler::SampleFormat::kFloat;
+    } else {
+      // Packed 24 bit PCM plays uncorrected.
+      return frame;
+    }
+    drift_resampler_ = std::make_unique<AudioDriftResampler>(
+        format, ChannelLayoutToChannelCount(
+                    current_audio_config_.channel_layout));
+    if (!drift_frame_pool_) {
+      drift_frame_pool_ = MediaFramePool::Create(media::MediaType::AUDIO);
+    }
+    AVE_LOG(LS_INFO) << "Audio drift correction started, ratio=" << ratio;
+  }
+
+  // Once started the resampler keeps running, also at ratio 1, so that
+  // the carried interpolation position stays continuous.
+  const size_t frame_size = drift_resampler_->frame_size();
+  const size_t input_frames = frame->size() / frame_size;
+  if (input_frames == 0) {
+    return frame;
+  }
+  auto resampled = drift_frame_pool_->Acquire(
+      AudioDriftResampler::MaxOutputFrames(input_frames, ratio) * frame_size);
+  const size_t output_frames = drift_resampler_->Process(
+      frame->data(), input_frames, ratio, resampled->base());
+  resampled->setRange(0, output_frames * frame_size);
+  auto* resampled_info = resampled->audio_info();
+  AVE_CHECK(resampled_info != nullptr);
+  // Same media span: the pts and duration anchor the clock.
+  *resampled_info = *frame->audio_info();
+  resampled_info->samples_per_channel = static_cast<int64_t>(output_frames);
+  return resampled;
+}
+
 bool AVPAudioRender::SupportsPlaybackRateChange() const {
   // This is a placeholder implementation
   // In a real implementation, you would check the audio track's capabilities
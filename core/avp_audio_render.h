@@ -11,7 +11,9 @@
 #include <memory>
 #include <mutex>
 
+#include "audio_drift_resampler.h"
 #include "avp_render.h"
+#include "common/media_frame_pool.h"
 #include "media/audio/audio_device.h"
 #include "media/audio/audio_track.h"
 #include "media/foundation/media_frame.h"
@@ -179,6 +181,14 @@ class AVPAudioRender : public AVPRender {
       REQUIRES(mutex_);
   void OnCompressedPositionPoll(int32_t generation);
 
+  /**
+   * @brief Resamples a PCM frame by the drift correction ratio of the sync
+   * controller, if it asks for one.
+   * @return The frame to write: |frame| itself when nothing is corrected.
+   */
+  std::shared_ptr<media::MediaFrame> ResampleForDriftLocked(
+      const std::shared_ptr<media::MediaFrame>& frame) REQUIRES(mutex_);
+
   /**
    * @brief Calculates the delay for the next audio frame based on real playback
    * latency.
@@ -193,6 +203,10 @@ class AVPAudioRender : public AVPRender {
   float playback_rate_ GUARDED_BY(mutex_);
   std::shared_ptr<media::MediaFrame> cached_frame_ GUARDED_BY(mutex_);
 
+  // Drift correction; created once the sync controller asks to resample.
+  std::unique_ptr<AudioDriftResampler> drift_resampler_ GUARDED_BY(mutex_);
+  std::shared_ptr<MediaFramePool> drift_frame_pool_ GUARDED_BY(mutex_);
+
   // Audio format tracking
   media::audio_config_t current_audio_config_ GUARDED_BY(mutex_);
   bool format_initialized_ GUARDED_BY(mutex_);
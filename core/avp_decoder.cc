@@ -8,17 +8,23 @@
 #include <unistd.h>
 
 #include <strings.h>
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <memory>
 
 #include "base/checks.h"
 #include "base/logging.h"
+#include "base/time_utils.h"
+#include "media/audio/channel_layout.h"
 #include "media/codec/codec_id.h"
 #include "media/foundation/aac_utils.h"
 #include "media/foundation/media_errors.h"
 #include "media/foundation/media_meta.h"
 #include "media/foundation/media_mimes.h"
 
+#include "api/demuxer/demuxer.h"
+
 #include "message_def.h"
 
 namespace ave {
@@ -26,16 +32,123 @@ namespace player {
 
 using ave::media::CodecId;
 
+namespace {
+
+// Bytes per sample of decoded PCM as described by its codec id or sample
+// width, 0 if neither says.
+size_t PcmSampleSize(CodecId codec_id, int bits_per_sample) {
+  switch (codec_id) {
+    case CodecId::AVE_CODEC_ID_PCM_S16LE:
+    case CodecId::AVE_CODEC_ID_PCM_S16BE:
+      return 2;
+    case CodecId::AVE_CODEC_ID_PCM_S24LE:
+    case CodecId::AVE_CODEC_ID_PCM_S24BE:
+      return 3;
+    case CodecId::AVE_CODEC_ID_PCM_F32LE:
+    case CodecId::AVE_CODEC_ID_PCM_F32BE:
+      return 4;
+    default:
+      return bits_per_sample > 0 ? bits_per_sample / 8 : 0;
+  }
+}
+
+// A frame over the data of |buffer| that holds a reference to it, so the
+// memory stays valid however long the frame is kept.
+std::shared_ptr<MediaFrame> WrapOutputBuffer(
+    const std::shared_ptr<CodecBuffer>& buffer) {
+  struct Holder {
+    std::shared_ptr<CodecBuffer> buffer;
+    std::shared_ptr<MediaFrame> frame;
+  };
+  auto holder = std::make_shared<Holder>();
+  holder->buffer = buffer;
+  holder->frame = MediaFrame::CreateSharedAsWrap(buffer->data(),
+                                                 buffer->size(),
+                                                 MediaType::VIDEO);
+  return std::shared_ptr<MediaFrame>(holder, holder->frame.get());
+}
+
+}  // namespace
+
+// Returns a codec output buffer to the codec once the render is done with
+// the frame. The render fires the event when it renders or drops the frame;
+// entries discarded by a render flush or stop are released on destruction.
+class AVPDecoder::OutputBufferRelease : public RenderEvent {
+ public:
+  OutputBufferRelease(std::shared_ptr<Codec> decoder,
+                      size_t index,
+                      bool surface_mode,
+                      std::shared_ptr<OutputBufferState> state)
+      : decoder_(std::move(decoder)),
+        index_(index),
+        surface_mode_(surface_mode),
+        state_(std::move(state)),
+        generation_(state_->generation.load()) {
+    if (!surface_mode_) {
+      state_->outstanding.fetch_add(1);
+    }
+  }
+
+  ~OutputBufferRelease() override { Release(false); }
+
+  void OnRenderEvent(bool render) override { Release(render); }
+
+ private:
+  void Release(bool render) {
+    if (!decoder_) {
+      return;
+    }
+    if (generation_ == state_->generation.load()) {
+      // Surface mode: render=true causes the codec to blit the decoded
+      // frame to the ANativeWindow at this exact moment.
+      decoder_->ReleaseOutputBuffer(index_, surface_mode_ && render);
+    }
+    decoder_.reset();
+    if (!surface_mode_) {
+      state_->outstanding.fetch_sub(1);
+      std::shared_ptr<Message> notify;
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        notify = std::move(state_->returned_notify);
+      }
+      if (notify) {
+        notify->post();
+      }
+    }
+  }
+
+  std::shared_ptr<Codec> decoder_;
+  const size_t index_;
+  const bool surface_mode_;
+  const std::shared_ptr<OutputBufferState> state_;
+  const uint32_t generation_;
+};
+
 AVPDecoder::AVPDecoder(std::shared_ptr<CodecFactory> codec_factory,
                        std::shared_ptr<Message> notify,
                        std::shared_ptr<ContentSource> source,
                        std::shared_ptr<AVPRender> render)
     : AVPDecoderBase(notify, source, render),
       codec_factory_(std::move(codec_factory)),
-      is_audio_(false) {}
+      is_audio_(false),
+      direct_input_(false),
+      output_sample_size_(0),
+      input_eos_(false),
+      waiting_for_input_(false),
+      input_notify_armed_(false),
+      input_wait_generation_(0),
+      input_starved_(false),
+      input_stall_start_us_(0),
+      waiting_for_render_(false),
+      render_wait_generation_(0),
+      skip_to_sync_frame_(false),
+      seen_sync_frame_(false),
+      resync_pts_us_(std::numeric_limits<int64_t>::min()),
+      output_state_(std::make_shared<OutputBufferState>()) {}
 
 AVPDecoder::~AVPDecoder() {
   if (decoder_) {
+    output_state_->generation.fetch_add(1);
     decoder_->Stop();
     decoder_->Release();
   }
@@ -52,6 +165,8 @@ void AVPDecoder::OnConfigure(const std::shared_ptr<MediaMeta>& format) {
                    << static_cast<int>(format->stream_type());
 
   is_audio_ = !strncasecmp("audio/", mime.c_str(), 6);
+  direct_input_ = source_->SupportsDirectRead(is_audio_ ? MediaType::AUDIO
+                                                        : MediaType::VIDEO);
   auto codec_id = ave::media::MimeToCodecId(mime.c_str());
 
   if (codec_id == CodecId::AVE_CODEC_ID_NONE) {
@@ -138,44 +253,99 @@ void AVPDecoder::OnStart() {
   }
 
   AVE_LOG(LS_INFO) << "AVPDecoder::OnStart: codec started, requesting input";
+  paused_ = false;
   OnRequestInputBuffers();
 }
 
 void AVPDecoder::OnPause() {
   AVE_LOG(LS_VERBOSE) << "onPause";
-  if (decoder_) {
-    decoder_->Stop();
-  }
+  // The codec keeps running, so the frames the render holds stay backed by
+  // their output buffers. Input buffers are parked until resume instead;
+  // output stops once the paused render queue fills up.
+  paused_ = true;
+  ++input_wait_generation_;
+  waiting_for_input_ = false;
+  input_notify_armed_ = false;
+  EndInputStall();
 }
 
 void AVPDecoder::OnResume() {
   AVE_LOG(LS_VERBOSE) << "onResume";
   if (decoder_) {
-    status_t err = decoder_->Start();
-    if (err != ave::OK) {
-      ReportError(err);
-      return;
-    }
+    paused_ = false;
     OnRequestInputBuffers();
+    FeedStarvedInput();
   }
 }
 
 void AVPDecoder::OnFlush() {
   AVE_LOG(LS_VERBOSE) << "onFlush";
+  ReturnOutputBuffers();
   if (decoder_) {
     decoder_->Flush();
   }
   input_packet_queue_.clear();
+  input_eos_ = false;
+  skip_to_sync_frame_ = false;
+  resync_pts_us_ = std::numeric_limits<int64_t>::min();
+  // A seek pending across the flush is superseded by the one that follows.
+  seek_preroll_.Reset();
+  CancelInputWait();
+}
+
+void AVPDecoder::OnSeek(int64_t seek_time_us,
+                        SeekMode seek_mode,
+                        int64_t request_time_us) {
+  AVE_LOG(LS_VERBOSE) << "onSeek seek_time_us=" << seek_time_us
+                      << ", mode=" << seek_mode;
+  seeks_.fetch_add(1);
+  // The source lands on the sync sample before the target; decode from
+  // there and drop what comes before it. Output from before the seek was
+  // flushed ahead of this message.
+  seek_preroll_.Start(seek_mode == SEEK_CLOSEST ? seek_time_us : -1,
+                      request_time_us);
 }
 
 void AVPDecoder::OnShutdown() {
   AVE_LOG(LS_VERBOSE) << "onShutdown";
+  ReturnOutputBuffers();
   if (decoder_) {
     decoder_->Stop();
     decoder_->Release();
     decoder_.reset();
   }
   input_packet_queue_.clear();
+  input_eos_ = false;
+  CancelInputWait();
+}
+
+AVPDecoder::OutputStats AVPDecoder::GetOutputStats() const {
+  OutputStats stats;
+  stats.zero_copy_frames = output_state_->zero_copy_frames.load();
+  stats.copied_frames = output_state_->copied_frames.load();
+  stats.outstanding_buffers = output_state_->outstanding.load();
+  stats.render_queue_waits = render_queue_waits_.load();
+  return stats;
+}
+
+AVPDecoder::SeekStats AVPDecoder::GetSeekStats() const {
+  SeekStats stats;
+  stats.seeks = seeks_.load();
+  stats.preroll_dropped_frames = preroll_dropped_frames_.load();
+  stats.trimmed_audio_samples = trimmed_audio_samples_.load();
+  stats.last_seek_to_first_frame_us = last_seek_to_first_frame_us_.load();
+  return stats;
+}
+
+AVPDecoder::InputStats AVPDecoder::GetInputStats() const {
+  InputStats stats;
+  stats.stalls = input_stalls_.load();
+  stats.stall_time_us = input_stall_time_us_.load();
+  stats.notified_wakeups = input_notified_wakeups_.load();
+  stats.polled_wakeups = input_polled_wakeups_.load();
+  stats.skipped_frames = input_skipped_frames_.load();
+  stats.sync_frame_jumps = input_sync_frame_jumps_.load();
+  return stats;
 }
 
 /////////////////////
@@ -183,6 +353,10 @@ void AVPDecoder::OnShutdown() {
 bool AVPDecoder::DoRequestInputBuffers() {
   AVE_LOG(LS_INFO) << "DoRequestInputBuffers: is_audio=" << is_audio_
                    << ", current_queue_size=" << input_packet_queue_.size();
+  if (direct_input_) {
+    // Nothing to dequeue ahead; access units are read as buffers come in.
+    return false;
+  }
   status_t err = OK;
   while (err == OK) {
     std::shared_ptr<MediaFrame> packet;
@@ -196,6 +370,7 @@ bool AVPDecoder::DoRequestInputBuffers() {
       if (err == media::ERROR_END_OF_STREAM) {
         // TODO: send EOS
         AVE_LOG(LS_INFO) << "End of stream reached";
+        input_eos_ = true;
       } else {
         ReportError(err);
       }
@@ -203,13 +378,50 @@ bool AVPDecoder::DoRequestInputBuffers() {
     }
     input_packet_queue_.push_back(packet);
   }
-  bool should_retry = (err == WOULD_BLOCK) && (source_->FeedMoreESData() == OK);
+  // Sources that post when data arrives need no re-request; the others are
+  // polled.
+  bool should_retry = (err == WOULD_BLOCK) &&
+                      (source_->FeedMoreESData() == OK) && !ArmInputNotify();
   AVE_LOG(LS_INFO) << "DoRequestInputBuffers done: queued="
                    << input_packet_queue_.size()
                    << ", should_retry=" << should_retry;
   return should_retry;
 }
 
+// Size of the ADTS header in front of an AAC payload, 0 if it has none.
+size_t AVPDecoder::AdtsHeaderSize(const std::shared_ptr<MediaFrame>& packet,
+                                  const uint8_t* data,
+                                  size_t size) const {
+  if (!is_audio_ || !packet ||
+      packet->mime() != media::MEDIA_MIMETYPE_AUDIO_AAC || size < 7) {
+    return 0;
+  }
+  media::ADTSHeader adts_header{};
+  if (media::ParseADTSHeader(data, size, &adts_header) != OK) {
+    return 0;
+  }
+  const size_t adts_header_size = adts_header.protection_absent ? 7 : 9;
+  return size > adts_header_size ? adts_header_size : 0;
+}
+
+// Passes the PTS from the input packet so the codec can stamp output frames,
+// and for audio the sample description, for codecs that carry it over.
+void AVPDecoder::SetInputFormat(const std::shared_ptr<MediaFrame>& packet,
+                                std::shared_ptr<CodecBuffer>& buffer) const {
+  auto meta = media::MediaMeta::CreatePtr(
+      is_audio_ ? MediaType::AUDIO : MediaType::VIDEO,
+      media::MediaMeta::FormatType::kSample);
+  auto pkt_pts = packet->pts();
+  meta->SetPts(pkt_pts);
+  const auto* audio = is_audio_ ? packet->audio_info() : nullptr;
+  if (audio && audio->sample_rate_hz > 0) {
+    meta->SetSampleRate(audio->sample_rate_hz);
+    meta->SetChannelLayout(audio->channel_layout);
+    meta->SetBitsPerSample(audio->bits_per_sample);
+  }
+  buffer->format() = meta;
+}
+
 void AVPDecoder::FillCodecBuffer(std::shared_ptr<CodecBuffer>& buffer) {
   if (input_packet_queue_.empty()) {
     return;
@@ -220,31 +432,96 @@ void AVPDecoder::FillCodecBuffer(std::shared_ptr<CodecBuffer>& buffer) {
   const uint8_t* packet_data = packet->data();
   size_t packet_size = packet->size();
 
-  if (is_audio_ && packet &&
-      packet->mime() == media::MEDIA_MIMETYPE_AUDIO_AAC && packet_size >= 7) {
-    media::ADTSHeader adts_header{};
-    if (media::ParseADTSHeader(packet_data, packet_size, &adts_header) == OK) {
-      const size_t adts_header_size = adts_header.protection_absent ? 7 : 9;
-      if (packet_size > adts_header_size) {
-        packet_data += adts_header_size;
-        packet_size -= adts_header_size;
-        AVE_LOG(LS_INFO)
-            << "FillCodecBuffer: stripped ADTS header, payload_size="
-            << packet_size;
-      }
-    }
+  const size_t adts_header_size =
+      AdtsHeaderSize(packet, packet_data, packet_size);
+  if (adts_header_size > 0) {
+    packet_data += adts_header_size;
+    packet_size -= adts_header_size;
+    AVE_LOG(LS_INFO) << "FillCodecBuffer: stripped ADTS header, payload_size="
+                     << packet_size;
   }
 
+  if (packet_size > buffer->capacity()) {
+    // Too big for any input buffer the codec offers; what is cut off is lost
+    // and the codec gets to conceal it.
+    AVE_LOG(LS_ERROR) << "FillCodecBuffer: access unit of " << packet_size
+                      << " bytes truncated to the input buffer capacity "
+                      << buffer->capacity();
+    packet_size = buffer->capacity();
+  }
   buffer->SetRange(0, packet_size);
   memcpy(buffer->data(), packet_data, packet_size);
 
-  // Pass the PTS from input packet so the codec can stamp output frames
-  auto meta = media::MediaMeta::CreatePtr(
-      is_audio_ ? MediaType::AUDIO : MediaType::VIDEO,
-      media::MediaMeta::FormatType::kSample);
-  auto pkt_pts = packet->pts();
-  meta->SetPts(pkt_pts);
-  buffer->format() = meta;
+  SetInputFormat(packet, buffer);
+}
+
+status_t AVPDecoder::ReadIntoCodecBuffer(std::shared_ptr<CodecBuffer>& buffer,
+                                         std::shared_ptr<MediaFrame>* packet) {
+  const size_t capacity = buffer->capacity();
+  buffer->SetRange(0, capacity);
+
+  size_t size = 0;
+  status_t err = source_->DequeueAccessUnitInto(
+      is_audio_ ? MediaType::AUDIO : MediaType::VIDEO, buffer->data(),
+      capacity, *packet, &size);
+  if (err != OK) {
+    buffer->SetRange(0, 0);
+    return err;
+  }
+
+  // The ADTS header is skipped by the range rather than moved out.
+  const size_t adts_header_size =
+      AdtsHeaderSize(*packet, buffer->data(), size);
+  buffer->SetRange(adts_header_size, size - adts_header_size);
+
+  SetInputFormat(*packet, buffer);
+  return OK;
+}
+
+bool AVPDecoder::ShouldSkipInput(const std::shared_ptr<MediaFrame>& packet) {
+  if (is_audio_ || !avp_render_ || !packet) {
+    return false;
+  }
+
+  const uint32_t flags = packet->flags();
+  const bool sync = (flags & ACCESS_UNIT_FLAG_SYNC) != 0;
+  seen_sync_frame_ |= sync;
+  if (skip_to_sync_frame_) {
+    if (!sync) {
+      input_skipped_frames_.fetch_add(1);
+      return true;
+    }
+    skip_to_sync_frame_ = false;
+    resync_pts_us_ = packet->pts().IsFinite() ? packet->pts().us() : 0;
+    AVE_LOG(LS_INFO) << "ShouldSkipInput: resuming at sync frame, pts="
+                     << resync_pts_us_;
+    return false;
+  }
+
+  int64_t late_us = 0;
+  int64_t pts_us = 0;
+  if (!avp_render_->GetVideoLateness(&late_us, &pts_us) ||
+      pts_us < resync_pts_us_) {
+    return false;
+  }
+
+  // Sustained overload: skipping droppable frames was not enough. Decoding
+  // restarts at the next sync frame instead of falling further behind.
+  if (late_us > kSkipToSyncFrameLateUs && seen_sync_frame_ && !sync) {
+    AVE_LOG(LS_WARNING) << "ShouldSkipInput: video " << late_us
+                        << "us late, skipping to the next sync frame";
+    skip_to_sync_frame_ = true;
+    input_sync_frame_jumps_.fetch_add(1);
+    input_skipped_frames_.fetch_add(1);
+    return true;
+  }
+
+  if (late_us > kSkipDroppableLateUs &&
+      (flags & ACCESS_UNIT_FLAG_DROPPABLE) != 0) {
+    input_skipped_frames_.fetch_add(1);
+    return true;
+  }
+  return false;
 }
 
 /************* CodecCallback event handler *************/
@@ -257,6 +534,11 @@ void AVPDecoder::HandleAnInputBuffer(size_t index) {
     return;
   }
 
+  if (paused_) {
+    starved_input_indices_.push_back(index);
+    return;
+  }
+
   std::shared_ptr<CodecBuffer> codec_buffer;
   decoder_->GetInputBuffer(index, codec_buffer);
   if (codec_buffer == nullptr) {
@@ -265,19 +547,59 @@ void AVPDecoder::HandleAnInputBuffer(size_t index) {
     return;
   }
 
-  // Refill packet queue before filling the codec buffer
-  OnRequestInputBuffers();
+  if (direct_input_) {
+    std::shared_ptr<MediaFrame> packet;
+    status_t err = OK;
+    do {
+      err = ReadIntoCodecBuffer(codec_buffer, &packet);
+    } while (err == OK && ShouldSkipInput(packet));
+    if (err == NO_MEMORY && packet != nullptr) {
+      // Larger than the codec buffer; the copy path strips what it can and
+      // truncates the rest rather than stopping playback.
+      AVE_LOG(LS_WARNING) << "HandleAnInputBuffer: access unit of "
+                          << packet->size() << " bytes does not fit "
+                          << codec_buffer->capacity() << ", copying it";
+      input_packet_queue_.push_back(packet);
+      FillCodecBuffer(codec_buffer);
+      err = OK;
+    }
+    if (err == WOULD_BLOCK) {
+      source_->FeedMoreESData();
+      // No data yet; wait for it so we don't send an empty (EOS) buffer
+      WaitForInputData(index);
+      return;
+    }
+    if (err == media::ERROR_END_OF_STREAM) {
+      // TODO: send EOS
+      AVE_LOG(LS_INFO) << "End of stream reached";
+      input_eos_ = true;
+      return;
+    }
+    if (err != OK) {
+      AVE_LOG(LS_ERROR) << "HandleAnInputBuffer: read failed: " << err;
+      ReportError(err);
+      return;
+    }
+  } else {
+    // Refill packet queue before filling the codec buffer
+    OnRequestInputBuffers();
 
-  if (input_packet_queue_.empty()) {
-    // No data yet; schedule a retry so we don't send an empty (EOS) buffer
-    auto retry_msg =
-        std::make_shared<Message>(kWhatRetryInputBuffer, shared_from_this());
-    retry_msg->setInt32(kIndex, static_cast<int32_t>(index));
-    retry_msg->post(5 * 1000LL);  // 5 ms
-    return;
-  }
+    // Video the render is too late for is dropped before decoding.
+    while (!input_packet_queue_.empty() &&
+           ShouldSkipInput(input_packet_queue_.front())) {
+      input_packet_queue_.pop_front();
+    }
 
-  FillCodecBuffer(codec_buffer);
+    if (input_packet_queue_.empty()) {
+      if (!input_eos_) {
+        // No data yet; wait for it so we don't send an empty (EOS) buffer
+        WaitForInputData(index);
+      }
+      return;
+    }
+
+    FillCodecBuffer(codec_buffer);
+  }
 
   AVE_LOG(LS_INFO) << "HandleAnInputBuffer: queuing buffer index=" << index
                    << ", size=" << codec_buffer->size();
@@ -287,6 +609,90 @@ void AVPDecoder::HandleAnInputBuffer(size_t index) {
     ReportError(err);
     return;
   }
+  EndInputStall();
+}
+
+void AVPDecoder::WaitForInputData(size_t index) {
+  starved_input_indices_.push_back(index);
+  if (!input_starved_) {
+    input_starved_ = true;
+    input_stall_start_us_ = base::TimeMicros();
+    input_stalls_.fetch_add(1);
+  }
+  if (waiting_for_input_) {
+    return;
+  }
+  waiting_for_input_ = true;
+  if (ArmInputNotify()) {
+    return;
+  }
+
+  // The source cannot tell when data arrives; poll it.
+  auto retry_msg =
+      std::make_shared<Message>(kWhatRetryInputBuffer, shared_from_this());
+  retry_msg->setInt32(kGeneration, input_wait_generation_);
+  retry_msg->post(kInputPollIntervalUs);
+}
+
+bool AVPDecoder::ArmInputNotify() {
+  if (input_notify_armed_) {
+    return true;
+  }
+  auto notify =
+      std::make_shared<Message>(kWhatInputDataAvailable, shared_from_this());
+  notify->setInt32(kGeneration, input_wait_generation_);
+  if (source_->RequestDataAvailableNotify(
+          is_audio_ ? MediaType::AUDIO : MediaType::VIDEO, notify) != OK) {
+    return false;
+  }
+  input_notify_armed_ = true;
+  return true;
+}
+
+void AVPDecoder::OnInputWakeup(const std::shared_ptr<Message>& msg,
+                               bool notified) {
+  int32_t generation = 0;
+  AVE_CHECK(msg->findInt32(kGeneration, &generation));
+  if (generation != input_wait_generation_) {
+    return;
+  }
+  waiting_for_input_ = false;
+  if (notified) {
+    input_notify_armed_ = false;
+    input_notified_wakeups_.fetch_add(1);
+  } else {
+    input_polled_wakeups_.fetch_add(1);
+  }
+  FeedStarvedInput();
+}
+
+void AVPDecoder::FeedStarvedInput() {
+  std::deque<size_t> indices;
+  indices.swap(starved_input_indices_);
+  while (!indices.empty() && !waiting_for_input_ && !paused_) {
+    const size_t index = indices.front();
+    indices.pop_front();
+    HandleAnInputBuffer(index);
+  }
+  // Ran dry again; the rest keep waiting behind the buffer that did.
+  starved_input_indices_.insert(starved_input_indices_.end(), indices.begin(),
+                                indices.end());
+}
+
+void AVPDecoder::CancelInputWait() {
+  ++input_wait_generation_;
+  waiting_for_input_ = false;
+  input_notify_armed_ = false;
+  starved_input_indices_.clear();
+  EndInputStall();
+}
+
+void AVPDecoder::EndInputStall() {
+  if (!input_starved_) {
+    return;
+  }
+  input_starved_ = false;
+  input_stall_time_us_.fetch_add(base::TimeMicros() - input_stall_start_us_);
 }
 
 void AVPDecoder::HandleAnOutputBuffer(size_t index) {
@@ -310,11 +716,17 @@ void AVPDecoder::HandleAnOutputBuffer(size_t index) {
     return;
   }
 
+  if (DropPrerollOutput(index, buffer)) {
+    return;
+  }
+
   std::shared_ptr<media::MediaFrame> frame;
   // Surface mode: codec renders directly to ANativeWindow; buffer has no data.
   bool is_surface_mode =
       !is_audio_ && (buffer->data() == nullptr || buffer->size() == 0);
-  bool already_released = false;
+  // Buffer mode video is handed to the render without a copy; the render
+  // returns the buffer through the release hook.
+  const bool zero_copy = !is_audio_ && !is_surface_mode;
 
   if (is_audio_) {
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer[AUDIO]: copying buffer, "
@@ -340,7 +752,8 @@ void AVPDecoder::HandleAnOutputBuffer(size_t index) {
     // so the audio decoder is never starved of output slots while the render
     // queue drains at AAudio's pace.
     decoder_->ReleaseOutputBuffer(index, false);
-    already_released = true;
+    output_state_->copied_frames.fetch_add(1);
+    TrimPrerollAudio(frame);
     auto* ai = frame ? frame->audio_info() : nullptr;
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer[AUDIO]: copied+released, "
                      << "pts=" << (ai ? ai->pts.us_or(-1) : -1)
@@ -360,10 +773,8 @@ void AVPDecoder::HandleAnOutputBuffer(size_t index) {
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer: surface mode video frame, pts="
                      << (frame ? frame->pts().us_or(-1) : -1);
   } else {
-    // Buffer mode: copy the YUV pixel data from the codec buffer, then
-    // immediately release the codec buffer so the OutputThread is unblocked.
-    frame = media::MediaFrame::CreateSharedAsCopy(
-        buffer->data(), buffer->size(), MediaType::VIDEO);
+    // Buffer mode: the frame references the YUV data in the codec buffer.
+    frame = WrapOutputBuffer(buffer);
     if (buffer->format() && buffer->format()->sample_info()) {
       const auto& vinfo = buffer->format()->sample_info()->video();
       frame->SetWidth(vinfo.width);
@@ -374,42 +785,208 @@ void AVPDecoder::HandleAnOutputBuffer(size_t index) {
         frame->SetPts(vinfo.pts);
       }
     }
-    // Data is copied into the frame — release the codec buffer immediately.
-    decoder_->ReleaseOutputBuffer(index, false);
-    already_released = true;
+    output_state_->zero_copy_frames.fetch_add(1);
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer: buffer mode video frame, pts="
                      << (frame ? frame->pts().us_or(-1) : -1)
                      << ", size=" << (frame ? frame->size() : 0);
   }
 
+  // Frames still backed by a codec buffer carry the hook that returns it.
+  const bool holds_buffer = is_surface_mode || zero_copy;
   if (avp_render_) {
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer: calling RenderFrame, "
                      << "is_audio=" << is_audio_
                      << ", surface_mode=" << is_surface_mode
-                     << ", already_released=" << already_released;
-    auto decoder = decoder_;
-    avp_render_->RenderFrame(frame, [decoder, index, is_surface_mode,
-                                     already_released](bool rendered) {
-      if (!already_released) {
-        // Surface mode: render=true causes the codec to blit the decoded
-        // frame to the ANativeWindow at this exact moment.
-        decoder->ReleaseOutputBuffer(index, is_surface_mode && rendered);
-      }
-      // Buffer mode: already released immediately after data copy above.
-    });
+                     << ", holds_buffer=" << holds_buffer;
+    std::unique_ptr<RenderEvent> release;
+    if (holds_buffer) {
+      release = std::make_unique<OutputBufferRelease>(
+          decoder_, index, is_surface_mode, output_state_);
+    }
+    avp_render_->RenderFrame(frame, std::move(release));
+    OnFrameQueued();
     AVE_LOG(LS_INFO) << "HandleAnOutputBuffer: queuing frame to render, "
                      << "surface_mode=" << is_surface_mode
                      << ", pts=" << (frame ? frame->pts().us_or(-1) : -1);
+  } else if (holds_buffer) {
+    decoder_->ReleaseOutputBuffer(index, false);
+  }
+}
+
+bool AVPDecoder::CanRenderOutput() const {
+  // Surface mode frames are not counted; the codec renders those itself.
+  return !avp_render_->IsQueueFull() &&
+         output_state_->outstanding.load() < kMaxOutstandingOutputBuffers;
+}
+
+bool AVPDecoder::DeferOutputBuffer(size_t index) {
+  if (!avp_render_ || (pending_output_indices_.empty() && CanRenderOutput())) {
+    return false;
+  }
+  pending_output_indices_.push_back(index);
+  WaitForRenderQueue();
+  return true;
+}
+
+void AVPDecoder::WaitForRenderQueue() {
+  if (waiting_for_render_) {
+    return;
+  }
+  waiting_for_render_ = true;
+  auto msg = std::make_shared<Message>(kWhatRenderQueueSpace,
+                                       shared_from_this());
+  msg->setInt32(kGeneration, render_wait_generation_);
+  bool armed = false;
+  if (avp_render_->IsQueueFull()) {
+    armed = avp_render_->NotifyWhenQueueHasSpace([msg]() { msg->post(); });
   } else {
-    if (!already_released) {
-      decoder_->ReleaseOutputBuffer(index, false);
+    // The render holds all the codec buffers it may; the next one it gives
+    // back posts |msg|.
+    std::lock_guard<std::mutex> lock(output_state_->mutex);
+    if (output_state_->outstanding.load() >= kMaxOutstandingOutputBuffers) {
+      output_state_->returned_notify = msg;
+      armed = true;
     }
   }
+  if (armed) {
+    render_queue_waits_.fetch_add(1);
+  } else {
+    // Drained in the meantime.
+    msg->post();
+  }
+}
+
+void AVPDecoder::OnRenderQueueSpace(const std::shared_ptr<Message>& msg) {
+  int32_t generation = 0;
+  AVE_CHECK(msg->findInt32(kGeneration, &generation));
+  if (generation != render_wait_generation_) {
+    return;
+  }
+  waiting_for_render_ = false;
+  while (!pending_output_indices_.empty()) {
+    if (!CanRenderOutput()) {
+      WaitForRenderQueue();
+      return;
+    }
+    const size_t index = pending_output_indices_.front();
+    pending_output_indices_.pop_front();
+    HandleAnOutputBuffer(index);
+  }
+}
+
+void AVPDecoder::CancelRenderWait() {
+  pending_output_indices_.clear();
+  waiting_for_render_ = false;
+  render_wait_generation_++;
+  std::lock_guard<std::mutex> lock(output_state_->mutex);
+  output_state_->returned_notify.reset();
+}
+
+void AVPDecoder::ReturnOutputBuffers() {
+  // Frames still queued reference the buffers; the codec must not get them
+  // back before their release hooks ran. Flushing the render fires them
+  // synchronously.
+  if (avp_render_ && output_state_->outstanding.load() != 0) {
+    avp_render_->Flush();
+    if (output_state_->outstanding.load() != 0) {
+      AVE_LOG(LS_WARNING) << "ReturnOutputBuffers: "
+                          << output_state_->outstanding.load()
+                          << " output buffers still held by the render";
+    }
+  }
+  // Indices waiting for render queue space go back with the rest.
+  CancelRenderWait();
+  // Hooks of frames the sink still holds, or that fire while the codec
+  // reclaims the buffers, must not release them again. Bumped before the
+  // codec call, not after it.
+  output_state_->generation.fetch_add(1);
+}
+
+bool AVPDecoder::DropPrerollOutput(size_t index,
+                                   const std::shared_ptr<CodecBuffer>& buffer) {
+  if (seek_preroll_.target_us() < 0 || !buffer->format() ||
+      !buffer->format()->sample_info()) {
+    return false;
+  }
+  auto* info = buffer->format()->sample_info();
+  int64_t pts_us = -1;
+  int64_t end_us = -1;
+  if (is_audio_) {
+    const auto& audio = info->audio();
+    pts_us = audio.pts.us_or(-1);
+    const size_t frame_size = PcmFrameSize(
+        audio.codec_id, audio.channel_layout, audio.bits_per_sample);
+    if (pts_us >= 0 && frame_size > 0 && audio.sample_rate_hz > 0) {
+      end_us = pts_us + static_cast<int64_t>(buffer->size() / frame_size) *
+                            1000000 / audio.sample_rate_hz;
+    }
+  } else {
+    const auto& video = info->video();
+    pts_us = video.pts.IsMinusInfinity() ? -1 : video.pts.us();
+    end_us = pts_us;
+  }
+  // Without a timestamp there is nothing to compare; let it through.
+  if (is_audio_ ? !seek_preroll_.DropAudio(pts_us, end_us)
+                : !seek_preroll_.DropVideo(pts_us)) {
+    return false;
+  }
+
+  // Surface mode too: released without rendering it to the surface.
+  decoder_->ReleaseOutputBuffer(index, false);
+  preroll_dropped_frames_.fetch_add(1);
+  AVE_LOG(LS_VERBOSE) << "dropped preroll " << (is_audio_ ? "audio" : "video")
+                      << " pts=" << pts_us
+                      << " target=" << seek_preroll_.target_us();
+  return true;
+}
+
+size_t AVPDecoder::PcmFrameSize(CodecId codec_id,
+                                media::ChannelLayout channel_layout,
+                                int bits_per_sample) const {
+  size_t sample_size = PcmSampleSize(codec_id, bits_per_sample);
+  if (sample_size == 0) {
+    sample_size = output_sample_size_;
+  }
+  return ChannelLayoutToChannelCount(channel_layout) * sample_size;
+}
+
+void AVPDecoder::TrimPrerollAudio(const std::shared_ptr<MediaFrame>& frame) {
+  if (seek_preroll_.target_us() < 0 || !frame) {
+    return;
+  }
+  auto* audio = frame->audio_info();
+  const size_t frame_size =
+      audio ? PcmFrameSize(audio->codec_id, audio->channel_layout,
+                           audio->bits_per_sample)
+            : 0;
+  const int64_t pts_us = audio ? audio->pts.us_or(-1) : -1;
+  const size_t trim = seek_preroll_.TakeAudioTrim(
+      frame_size > 0 ? pts_us : -1, audio ? audio->sample_rate_hz : 0,
+      frame_size > 0 ? frame->size() / frame_size : 0);
+  if (trim == 0) {
+    return;
+  }
+  frame->setRange(frame->data() - frame->base() + trim * frame_size,
+                  frame->size() - trim * frame_size);
+  audio->pts = base::Timestamp::Micros(
+      pts_us + static_cast<int64_t>(trim) * 1000000 / audio->sample_rate_hz);
+  trimmed_audio_samples_.fetch_add(trim);
+}
+
+void AVPDecoder::OnFrameQueued() {
+  const int64_t latency_us = seek_preroll_.OnFrameQueued(base::TimeMicros());
+  if (latency_us >= 0) {
+    last_seek_to_first_frame_us_.store(latency_us);
+  }
 }
 
 void AVPDecoder::HandleAnOutputFormatChanged(
     const std::shared_ptr<MediaMeta>& format) {
   if (is_audio_) {
+    // Output buffers that do not describe their samples are in this format.
+    output_sample_size_ =
+        format && format->bits_per_sample() > 0 ? format->bits_per_sample() / 8
+                                                : 0;
     auto notify = notify_->dup();
     notify->setInt32(kWhat, kWhatAudioOutputFormatChanged);
     // TODO: Fix MediaMeta inheritance issue
@@ -482,7 +1059,14 @@ void AVPDecoder::onMessageReceived(const std::shared_ptr<Message>& msg) {
     case kWhatOutputBufferAvailable: {
       int32_t index = 0;
       AVE_CHECK(msg->findInt32("index", &index));
-      HandleAnOutputBuffer(index);
+      if (!DeferOutputBuffer(index)) {
+        HandleAnOutputBuffer(index);
+      }
+      break;
+    }
+
+    case kWhatRenderQueueSpace: {
+      OnRenderQueueSpace(msg);
       break;
     }
 
@@ -499,10 +1083,20 @@ void AVPDecoder::onMessageReceived(const std::shared_ptr<Message>& msg) {
       break;
     }
 
+    case kWhatInputDataAvailable: {
+      OnInputWakeup(msg, true);
+      break;
+    }
+
     case kWhatRetryInputBuffer: {
-      int32_t index = 0;
-      AVE_CHECK(msg->findInt32(kIndex, &index));
-      HandleAnInputBuffer(static_cast<size_t>(index));
+      OnInputWakeup(msg, false);
+      break;
+    }
+
+    case kWhatRequestInputBuffers: {
+      // The packet queue retry of AVPDecoderBase polls the source too.
+      input_polled_wakeups_.fetch_add(1);
+      AVPDecoderBase::onMessageReceived(msg);
       break;
     }
 
@@ -8,10 +8,16 @@
 #ifndef AVP_DECODER_H
 #define AVP_DECODER_H
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <list>
+#include <mutex>
 
+#include "media/audio/channel_layout.h"
 #include "media/codec/codec.h"
 #include "media/codec/codec_factory.h"
+#include "media/codec/codec_id.h"
 #include "media/foundation/handler.h"
 #include "media/foundation/media_meta.h"
 
@@ -19,6 +25,7 @@
 
 #include "avp_decoder_base.h"
 #include "avp_render.h"
+#include "seek_preroll.h"
 
 using ave::media::Codec;
 using ave::media::CodecBuffer;
@@ -55,6 +62,68 @@ class AVPDecoder : public AVPDecoderBase, public CodecCallback {
                       std::shared_ptr<AVPRender> render);
   ~AVPDecoder() override;
 
+  struct OutputStats {
+    // Video frames handed to the render still backed by the codec buffer.
+    uint64_t zero_copy_frames = 0;
+    // Frames copied out of the codec buffer: audio.
+    uint64_t copied_frames = 0;
+    // Codec output buffers currently held by the render.
+    size_t outstanding_buffers = 0;
+    // Times output was held back because the render queue was full or the
+    // render held kMaxOutstandingOutputBuffers codec buffers.
+    uint64_t render_queue_waits = 0;
+  };
+
+  // Thread safe.
+  OutputStats GetOutputStats() const;
+
+  // Codec output buffers that may be held by the render at once. Past it,
+  // output waits until the render gives one back, so the codec keeps
+  // buffers to decode into.
+  static constexpr size_t kMaxOutstandingOutputBuffers = 4;
+
+  struct InputStats {
+    // Times the decoder ran out of input, and the time spent without it.
+    uint64_t stalls = 0;
+    int64_t stall_time_us = 0;
+    // Wakeups to retry input: on the data-available notify of the source,
+    // and on the poll timers (input buffer and packet queue retries) for
+    // sources that cannot notify. Sampled over an interval they give the
+    // wakeup rate.
+    uint64_t notified_wakeups = 0;
+    uint64_t polled_wakeups = 0;
+    // Video access units skipped undecoded because the render was late, and
+    // the times input jumped ahead to the next sync frame.
+    uint64_t skipped_frames = 0;
+    uint64_t sync_frame_jumps = 0;
+  };
+
+  // Thread safe.
+  InputStats GetInputStats() const;
+
+  struct SeekStats {
+    uint64_t seeks = 0;
+    // Output decoded from the sync sample up to a SEEK_CLOSEST target and
+    // dropped without reaching the render, and the audio samples trimmed
+    // off the frame that straddles the target.
+    uint64_t preroll_dropped_frames = 0;
+    uint64_t trimmed_audio_samples = 0;
+    // From SignalSeek() to the first frame after it queued to the render,
+    // for the last seek that got one.
+    int64_t last_seek_to_first_frame_us = -1;
+  };
+
+  // Thread safe.
+  SeekStats GetSeekStats() const;
+
+  // Retry interval for input from sources without a data-available notify.
+  static constexpr int64_t kInputPollIntervalUs = 5 * 1000;
+
+  // Render lateness beyond which droppable video access units are skipped
+  // at input, and beyond which input jumps to the next sync frame.
+  static constexpr int64_t kSkipDroppableLateUs = 50 * 1000;
+  static constexpr int64_t kSkipToSyncFrameLateUs = 500 * 1000;
+
  protected:
   void onMessageReceived(const std::shared_ptr<Message>& msg) override;
 
@@ -66,8 +135,12 @@ class AVPDecoder : public AVPDecoderBase, public CodecCallback {
     kWhatDecodingFormatChange = 'fmtC',
     kWhatDecodingError = 'ddEr',
     kWhatFrameRendered = 'frRd',
-    // retry when no input data was available
+    // the source has data for the input buffers waiting on it
+    kWhatInputDataAvailable = 'inDA',
+    // retry when no input data was available and the source cannot notify
     kWhatRetryInputBuffer = 'retI',
+    // the render can take the output held back
+    kWhatRenderQueueSpace = 'rqSp',
   };
 
   void OnConfigure(const std::shared_ptr<MediaMeta>& format) override;
@@ -78,10 +151,49 @@ class AVPDecoder : public AVPDecoderBase, public CodecCallback {
   void OnPause() override;
   void OnResume() override;
   void OnFlush() override;
+  void OnSeek(int64_t seek_time_us,
+              SeekMode seek_mode,
+              int64_t request_time_us) override;
   void OnShutdown() override;
   bool DoRequestInputBuffers() override;
 
   void FillCodecBuffer(std::shared_ptr<CodecBuffer>& buffer);
+  size_t AdtsHeaderSize(const std::shared_ptr<MediaFrame>& packet,
+                        const uint8_t* data,
+                        size_t size) const;
+  void SetInputFormat(const std::shared_ptr<MediaFrame>& packet,
+                      std::shared_ptr<CodecBuffer>& buffer) const;
+  // Has the source read the next access unit straight into |buffer|.
+  status_t ReadIntoCodecBuffer(std::shared_ptr<CodecBuffer>& buffer,
+                               std::shared_ptr<MediaFrame>* packet);
+  // Whether to drop video |packet| undecoded, going by the render lateness.
+  bool ShouldSkipInput(const std::shared_ptr<MediaFrame>& packet);
+  // Parks input buffer |index| until the source has data for it.
+  void WaitForInputData(size_t index);
+  // Has the source post kWhatInputDataAvailable once it has data. Returns
+  // false if it cannot, and the caller has to poll.
+  bool ArmInputNotify();
+  void OnInputWakeup(const std::shared_ptr<Message>& msg, bool notified);
+  // Hands the parked input buffers to HandleAnInputBuffer() again, in order,
+  // until one finds no data.
+  void FeedStarvedInput();
+  // Drops the parked input buffers; the codec took them back.
+  void CancelInputWait();
+  void EndInputStall();
+  // Whether the render can take another output frame: its queue has room
+  // and it holds fewer than kMaxOutstandingOutputBuffers codec buffers.
+  bool CanRenderOutput() const;
+  // Holds output buffer |index| back while the render cannot take it, or
+  // while earlier ones are held, to keep them in order.
+  bool DeferOutputBuffer(size_t index);
+  void WaitForRenderQueue();
+  void OnRenderQueueSpace(const std::shared_ptr<Message>& msg);
+  // Drops the held output buffers; the codec took them back.
+  void CancelRenderWait();
+  // Has the render give back the codec buffers it holds and disarms the
+  // hooks of any it keeps, before the codec reclaims them on flush or
+  // shutdown.
+  void ReturnOutputBuffers();
 
   // CodecCallback
   void OnInputBufferAvailable(size_t index) override;
@@ -94,6 +206,34 @@ class AVPDecoder : public AVPDecoderBase, public CodecCallback {
   void HandleAnOutputBuffer(size_t index);
   void HandleAnOutputFormatChanged(const std::shared_ptr<MediaMeta>& format);
   void HandleAnCodecError(status_t err);
+  // Releases output buffer |index| unrendered if it ends before the preroll
+  // target.
+  bool DropPrerollOutput(size_t index,
+                         const std::shared_ptr<CodecBuffer>& buffer);
+  // Bytes per sample frame of decoded PCM, or 0 if the sample format is not
+  // known. Preroll audio is then neither dropped nor trimmed.
+  size_t PcmFrameSize(media::CodecId codec_id,
+                      media::ChannelLayout channel_layout,
+                      int bits_per_sample) const;
+  // Cuts the samples before the preroll target off the front of |frame|.
+  void TrimPrerollAudio(const std::shared_ptr<MediaFrame>& frame);
+  void OnFrameQueued();
+
+  // Shared with the release hooks of frames still held by the render, which
+  // may outlive the decoder.
+  struct OutputBufferState {
+    std::atomic<size_t> outstanding{0};
+    // Bumped by flush and shutdown; buffers of an older generation were
+    // already reclaimed by the codec and must not be released again.
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint64_t> zero_copy_frames{0};
+    std::atomic<uint64_t> copied_frames{0};
+    std::mutex mutex;
+    // Posted by the next buffer the render gives back, while output waits
+    // for one. Guarded by |mutex|.
+    std::shared_ptr<Message> returned_notify;
+  };
+  class OutputBufferRelease;
 
   std::shared_ptr<CodecFactory> codec_factory_;
   std::shared_ptr<Codec> decoder_;
@@ -101,7 +241,55 @@ class AVPDecoder : public AVPDecoderBase, public CodecCallback {
   std::string codec_name_;
 
   bool is_audio_;
+  // The source reads access units into the codec input buffers; otherwise
+  // they are dequeued ahead into input_packet_queue_ and copied.
+  bool direct_input_;
   std::list<std::shared_ptr<MediaFrame>> input_packet_queue_;
+  // Bytes per sample of the codec output format, 0 until it reports one.
+  size_t output_sample_size_;
+  // The source returned end of stream; input buffers are no longer filled.
+  bool input_eos_;
+
+  // Input buffers that found no data or came in while paused, in the order
+  // the codec offered them.
+  std::deque<size_t> starved_input_indices_;
+  // A data-available notify or poll is pending for them.
+  bool waiting_for_input_;
+  // The source holds a data-available notify of the current generation.
+  bool input_notify_armed_;
+  // Bumped to drop wakeups that were pending across a flush or pause.
+  int32_t input_wait_generation_;
+  bool input_starved_;
+  int64_t input_stall_start_us_;
+  std::atomic<uint64_t> input_stalls_{0};
+  std::atomic<int64_t> input_stall_time_us_{0};
+  std::atomic<uint64_t> input_notified_wakeups_{0};
+  std::atomic<uint64_t> input_polled_wakeups_{0};
+
+  // Output buffers held back for the render queue, in codec order. Holding
+  // them stalls the codec, which in turn stops taking input.
+  std::deque<size_t> pending_output_indices_;
+  bool waiting_for_render_;
+  // Bumped to drop queue space notifications pending across a flush.
+  int32_t render_wait_generation_;
+  std::atomic<uint64_t> render_queue_waits_{0};
+
+  // Video input is skipped up to the next sync frame.
+  bool skip_to_sync_frame_;
+  // The stream marks sync frames; without them there is nothing to jump to.
+  bool seen_sync_frame_;
+  // Lateness the render reports for frames before the last jump is stale.
+  int64_t resync_pts_us_;
+  std::atomic<uint64_t> input_skipped_frames_{0};
+  std::atomic<uint64_t> input_sync_frame_jumps_{0};
+
+  // Preroll target and first-frame timing of the last seek.
+  SeekPreroll seek_preroll_;
+  std::atomic<uint64_t> seeks_{0};
+  std::atomic<uint64_t> preroll_dropped_frames_{0};
+  std::atomic<uint64_t> trimmed_audio_samples_{0};
+  std::atomic<int64_t> last_seek_to_first_frame_us_{-1};
+  const std::shared_ptr<OutputBufferState> output_state_;
 };
 
 }  // namespace player
@@ -11,6 +11,7 @@
 
 #include "base/checks.h"
 #include "base/logging.h"
+#include "base/time_utils.h"
 #include "media/foundation/message.h"
 #include "message_def.h"
 
@@ -83,6 +84,14 @@ void AVPDecoderBase::Flush() {
   msg->post();
 }
 
+void AVPDecoderBase::SignalSeek(int64_t seek_time_us, SeekMode seek_mode) {
+  auto msg(std::make_shared<Message>(kWhatSeek, shared_from_this()));
+  msg->setInt64(kSeekToUs, seek_time_us);
+  msg->setInt32(kSeekMode, seek_mode);
+  msg->setInt64(kTimeUs, base::TimeMicros());
+  msg->post();
+}
+
 void AVPDecoderBase::Shutdown() {
   auto msg(std::make_shared<Message>(kWhatShutdown, shared_from_this()));
   msg->post();
@@ -173,6 +182,16 @@ void AVPDecoderBase::onMessageReceived(const std::shared_ptr<Message>& msg) {
       OnFlush();
       break;
     }
+    case kWhatSeek: {
+      int64_t seek_time_us = 0;
+      int32_t seek_mode = 0;
+      int64_t request_time_us = 0;
+      AVE_CHECK(msg->findInt64(kSeekToUs, &seek_time_us));
+      AVE_CHECK(msg->findInt32(kSeekMode, &seek_mode));
+      AVE_CHECK(msg->findInt64(kTimeUs, &request_time_us));
+      OnSeek(seek_time_us, static_cast<SeekMode>(seek_mode), request_time_us);
+      break;
+    }
     case kWhatShutdown: {
       OnShutdown();
       // Unblock ShutdownSync() caller if this was a synchronous shutdown.
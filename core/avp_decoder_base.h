@@ -41,6 +41,13 @@ class AVPDecoderBase : public Handler {
   void Pause();
   void Resume();
   void Flush();
+  /**
+   * @brief Tells the decoder the source is seeking to |seek_time_us|. With
+   * SEEK_CLOSEST, output before the target is decoded but not rendered and
+   * audio is trimmed to the target sample. Post it after Flush(), which
+   * drops a pending seek along with the output decoded before it.
+   */
+  void SignalSeek(int64_t seek_time_us, SeekMode seek_mode);
   void Shutdown();
   /// Synchronous shutdown: blocks until OnShutdown() has fully executed on
   /// the decoder looper thread (codec stopped, buffers cleared). Safe to call
@@ -59,6 +66,7 @@ class AVPDecoderBase : public Handler {
     kWhatPause = 'paus',
     kWhatResume = 'resu',
     kWhatFlush = 'flus',
+    kWhatSeek = 'seek',
     kWhatShutdown = 'shuD',
 
     // internal input buffer event
@@ -74,6 +82,10 @@ class AVPDecoderBase : public Handler {
   virtual void OnPause() = 0;
   virtual void OnResume() = 0;
   virtual void OnFlush() = 0;
+  // |request_time_us| is when SignalSeek() was called.
+  virtual void OnSeek(int64_t seek_time_us,
+                      SeekMode seek_mode,
+                      int64_t request_time_us) {}
   virtual void OnShutdown() = 0;
 
   // run in handler thread
@@ -7,18 +7,30 @@
 
 #include "avp_decoder.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
 
-#include "base/test/mock_task_runner_factory.h"
+#include "api/demuxer/demuxer.h"
+#include "media/audio/channel_layout.h"
 #include "media/codec/codec_factory.h"
+#include "media/codec/codec_id.h"
 #include "media/codec/test/dummy_codec_factory.h"
+#include "media/foundation/media_errors.h"
 #include "media/foundation/media_frame.h"
 #include "media/foundation/media_meta.h"
+#include "media/foundation/media_mimes.h"
 #include "test/gtest.h"
 
 #include "avp_render.h"
+#include "mock_task_runner_factory.h"
 
-using ave::base::MockTaskRunnerFactory;
 using ave::media::MediaFrame;
 using ave::media::MediaMeta;
 using ave::media::MediaType;
@@ -27,12 +39,23 @@ using ave::media::test::DummyCodecFactory;
 namespace ave {
 namespace player {
 
+namespace {
+
+// Serves queued packets and records each access unit read: with direct read
+// on, what DequeueAccessUnitInto() left in the codec buffer. Optionally posts
+// a data-available notify when a packet is added.
 class MockContentSource : public ContentSource {
  public:
-  MockContentSource() = default;
+  struct Read {
+    status_t err;
+    size_t capacity;
+    std::vector<uint8_t> data;
+  };
+
+  explicit MockContentSource(bool direct_read) : direct_read_(direct_read) {}
   ~MockContentSource() override = default;
 
-  void SetNotify(Notify* notify) override { notify_ = notify; }
+  void SetNotify(Notify* /* notify */) override {}
   void Prepare() override {}
   void Start() override {}
   void Stop() override {}
@@ -40,157 +63,274 @@ class MockContentSource : public ContentSource {
   void Resume() override {}
 
   status_t DequeueAccessUnit(
-      MediaType track_type,
+      MediaType /* track_type */,
       std::shared_ptr<MediaFrame>& access_unit) override {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (packets_.empty()) {
-      return WOULD_BLOCK;
+      return eos_ ? media::ERROR_END_OF_STREAM : WOULD_BLOCK;
     }
     access_unit = packets_.front();
     packets_.pop();
+    if (!direct_read_) {
+      reads_.push_back(Read{OK, 0,
+                            std::vector<uint8_t>(
+                                access_unit->data(),
+                                access_unit->data() + access_unit->size())});
+      cv_.notify_all();
+    }
     return OK;
   }
 
-  std::shared_ptr<MediaMeta> GetFormat() override { return format_; }
-  status_t GetDuration(int64_t* duration_us) override {
-    return INVALID_OPERATION;
+  status_t RequestDataAvailableNotify(
+      MediaType /* track_type */,
+      std::shared_ptr<media::Message> notify) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!notify_on_data_) {
+      return INVALID_OPERATION;
+    }
+    if (!packets_.empty() || eos_) {
+      notify->post();
+      return OK;
+    }
+    data_available_notify_ = std::move(notify);
+    return OK;
+  }
+
+  // Nothing to parse; packets come in through AddPacket().
+  status_t FeedMoreESData() override { return OK; }
+
+  bool SupportsDirectRead(MediaType /* track_type */) const override {
+    return direct_read_;
+  }
+
+  status_t DequeueAccessUnitInto(MediaType track_type,
+                                 uint8_t* buffer,
+                                 size_t capacity,
+                                 std::shared_ptr<MediaFrame>& access_unit,
+                                 size_t* size) override {
+    status_t err = ContentSource::DequeueAccessUnitInto(
+        track_type, buffer, capacity, access_unit, size);
+    if (err == WOULD_BLOCK) {
+      return err;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Read read{err, capacity, {}};
+    if (err == OK) {
+      read.data.assign(buffer, buffer + *size);
+    }
+    reads_.push_back(std::move(read));
+    cv_.notify_all();
+    return err;
   }
-  size_t GetTrackCount() const override { return 1; }
-  std::shared_ptr<MediaMeta> GetTrackInfo(size_t track_index) const override {
-    return format_;
+
+  std::shared_ptr<MediaMeta> GetFormat() override { return nullptr; }
+
+  status_t SeekTo(int64_t /* seek_time_us */, SeekMode /* mode */) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_ = {};
+    data_available_notify_.reset();
+    return OK;
   }
-  status_t SelectTrack(size_t track_index, bool select) override {
-    return INVALID_OPERATION;
+
+  void EnableDataAvailableNotify() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notify_on_data_ = true;
   }
-  status_t SeekTo(int64_t seek_time_us, SeekMode mode) override {
-    return INVALID_OPERATION;
+
+  void AddPacket(std::shared_ptr<MediaFrame> packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_.push(std::move(packet));
+    if (data_available_notify_) {
+      data_available_notify_->post();
+      data_available_notify_.reset();
+    }
+  }
+
+  void SignalEos() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    eos_ = true;
   }
-  bool IsStreaming() const override { return false; }
-  status_t FeedMoreESData() override { return OK; }
 
-  void AddPacket(std::shared_ptr<MediaFrame> packet) { packets_.push(packet); }
+  // Waits until |count| reads other than WOULD_BLOCK were made.
+  bool WaitForReads(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(5),
+                        [this, count]() { return reads_.size() >= count; });
+  }
 
-  void SetFormat(std::shared_ptr<MediaMeta> format) { format_ = format; }
+  std::vector<Read> reads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reads_;
+  }
 
  private:
-  Notify* notify_ = nullptr;
+  const bool direct_read_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
   std::queue<std::shared_ptr<MediaFrame>> packets_;
-  std::shared_ptr<MediaMeta> format_;
+  bool eos_ = false;
+  bool notify_on_data_ = false;
+  std::shared_ptr<media::Message> data_available_notify_;
+  std::vector<Read> reads_;
 };
 
-class MockAVPRender : public AVPRender {
+class FixedClockAVSyncController : public IAVSyncController {
  public:
-  MockAVPRender() : AVPRender(nullptr, nullptr) {}
-  ~MockAVPRender() override = default;
-
-  void RenderFrame(
-      std::shared_ptr<media::MediaFrame> frame,
-      std::unique_ptr<RenderEvent> render_event = nullptr) override {
-    rendered_frames_.push_back(frame);
-    if (render_event) {
-      render_event->OnRenderEvent(true);
-    }
-  }
-
-  void Start() override {}
-  void Stop() override {}
+  void UpdateAnchor(int64_t /* media_pts_us */,
+                    int64_t /* sys_time_us */,
+                    int64_t /* max_media_time_us */) override {}
+  int64_t GetMasterClock() const override { return master_clock_us_.load(); }
+  void SetPlaybackRate(float /* rate */) override {}
+  float GetPlaybackRate() const override { return 1.0f; }
   void Pause() override {}
   void Resume() override {}
-  void Flush() override {}
+  void Reset() override {}
+  void SetClockType(ClockType type) override { clock_type_ = type; }
+  ClockType GetClockType() const override { return clock_type_; }
 
-  const std::vector<std::shared_ptr<media::MediaFrame>>& GetRenderedFrames()
-      const {
-    return rendered_frames_;
-  }
+  void SetMasterClock(int64_t clock_us) { master_clock_us_.store(clock_us); }
+
+ private:
+  std::atomic<int64_t> master_clock_us_{0};
+  ClockType clock_type_ = ClockType::kSystem;
+};
 
-  void ClearRenderedFrames() { rendered_frames_.clear(); }
+class TestAVPRender : public AVPRender {
+ public:
+  TestAVPRender(base::TaskRunnerFactory* task_runner_factory,
+                IAVSyncController* avsync_controller)
+      : AVPRender(task_runner_factory, avsync_controller) {}
 
  protected:
-  uint64_t RenderFrameInternal(std::shared_ptr<media::MediaFrame>& frame,
+  uint64_t RenderFrameInternal(std::shared_ptr<media::MediaFrame>& /* frame */,
                                bool& consumed) override {
+    consumed = true;
     return 0;
   }
-
- private:
-  std::vector<std::shared_ptr<media::MediaFrame>> rendered_frames_;
 };
 
+std::vector<uint8_t> MakePayload(size_t size, uint8_t seed) {
+  std::vector<uint8_t> payload(size);
+  for (size_t i = 0; i < size; ++i) {
+    // Stays clear of 0xFF so no payload reads as an ADTS header.
+    payload[i] = static_cast<uint8_t>((seed + i * 7) % 0xF0);
+  }
+  return payload;
+}
+
+std::shared_ptr<MediaFrame> CreatePacket(const std::vector<uint8_t>& payload,
+                                         int64_t pts_us) {
+  auto packet = MediaFrame::CreateShared(payload.size(), MediaType::AUDIO);
+  if (!payload.empty()) {
+    std::memcpy(packet->data(), payload.data(), payload.size());
+  }
+  packet->setRange(0, payload.size());
+  packet->SetPts(base::Timestamp::Micros(pts_us));
+  return packet;
+}
+
+// |samples| of 16-bit stereo at 48 kHz.
+std::shared_ptr<MediaFrame> CreatePcmPacket(size_t samples, int64_t pts_us) {
+  auto packet = CreatePacket(MakePayload(samples * 4, 0), pts_us);
+  auto* audio_info = packet->audio_info();
+  audio_info->codec_id = media::CodecId::AVE_CODEC_ID_PCM_S16LE;
+  audio_info->sample_rate_hz = 48000;
+  audio_info->channel_layout = media::CHANNEL_LAYOUT_STEREO;
+  audio_info->bits_per_sample = 16;
+  audio_info->pts = base::Timestamp::Micros(pts_us);
+  audio_info->duration =
+      base::TimeDelta::Micros(static_cast<int64_t>(samples) * 1000000 / 48000);
+  return packet;
+}
+
+std::shared_ptr<MediaFrame> CreateVideoPacket(int64_t pts_us, uint32_t flags) {
+  auto packet = MediaFrame::CreateShared(16, MediaType::VIDEO);
+  auto payload = MakePayload(16, static_cast<uint8_t>(pts_us / 1000));
+  std::memcpy(packet->data(), payload.data(), payload.size());
+  packet->setRange(0, payload.size());
+  packet->SetPts(base::Timestamp::Micros(pts_us));
+  packet->video_info()->pts = base::Timestamp::Micros(pts_us);
+  packet->setFlags(flags);
+  return packet;
+}
+
+}  // namespace
+
 class AVPDecoderTest : public ::testing::Test {
  protected:
   void SetUp() override {
     task_runner_factory_ = std::make_unique<MockTaskRunnerFactory>();
     codec_factory_ = std::make_shared<DummyCodecFactory>();
-    content_source_ = std::make_shared<MockContentSource>();
-    render_ = std::make_unique<MockAVPRender>();
+    render_ = std::make_shared<TestAVPRender>(task_runner_factory_.get(),
+                                              &avsync_controller_);
+    render_->Start();
     notify_ = std::make_shared<Message>();
   }
 
   void TearDown() override {
     if (decoder_) {
-      decoder_->Shutdown();
+      decoder_->ShutdownSync();
+      decoder_.reset();
     }
+    render_->Stop();
+  }
+
+  void CreateDecoder(bool direct_read) {
+    content_source_ = std::make_shared<MockContentSource>(direct_read);
+    decoder_ = std::make_shared<AVPDecoder>(codec_factory_, notify_,
+                                            content_source_, render_);
   }
 
-  std::shared_ptr<AVPDecoder> CreateDecoder() {
-    return std::make_shared<AVPDecoder>(codec_factory_, notify_,
-                                        content_source_, render_.get());
+  void StartDecoder(const std::shared_ptr<MediaMeta>& format) {
+    decoder_->Init();
+    decoder_->Configure(format);
+    decoder_->Start();
+  }
+
+  // Has the render check a video frame of |pts_us| against the master clock,
+  // so that it reports the lateness ShouldSkipInput() goes by.
+  void ReportVideoLateness(int64_t clock_us, int64_t pts_us) {
+    avsync_controller_.SetMasterClock(clock_us);
+    render_->RenderFrame(CreateVideoPacket(pts_us, 0));
+    task_runner_factory_->runner()->RunDueTasks();
   }
 
   std::shared_ptr<MediaMeta> CreateAudioFormat() {
-    auto format = std::make_shared<MediaMeta>();
-    format->setMime("audio/aac");
-    format->setInt32("sample_rate", 44100);
-    format->setInt32("channel_count", 2);
+    auto format =
+        MediaMeta::CreatePtr(MediaType::AUDIO, MediaMeta::FormatType::kTrack);
+    format->SetMime(media::MEDIA_MIMETYPE_AUDIO_AAC);
+    format->SetSampleRate(44100);
+    format->SetChannelLayout(media::CHANNEL_LAYOUT_STEREO);
     return format;
   }
 
   std::shared_ptr<MediaMeta> CreateVideoFormat() {
-    auto format = std::make_shared<MediaMeta>();
-    format->setMime("video/avc");
-    format->setInt32("width", 1920);
-    format->setInt32("height", 1080);
+    auto format =
+        MediaMeta::CreatePtr(MediaType::VIDEO, MediaMeta::FormatType::kTrack);
+    format->SetMime(media::MEDIA_MIMETYPE_VIDEO_AVC);
+    format->SetWidth(1920);
+    format->SetHeight(1080);
     return format;
   }
 
-  std::shared_ptr<MediaFrame> CreatePacket(const uint8_t* data,
-                                           size_t size,
-                                           int64_t pts = 0) {
-    auto packet = MediaFrame::CreateShared(size);
-    if (data && size > 0) {
-      memcpy(packet->data(), data, size);
-    }
-    packet->setPts(pts);
-    packet->setRange(0, size);
-    return packet;
-  }
-
   std::unique_ptr<MockTaskRunnerFactory> task_runner_factory_;
+  FixedClockAVSyncController avsync_controller_;
   std::shared_ptr<DummyCodecFactory> codec_factory_;
-  std::shared_ptr<MockContentSource> content_source_;
-  std::unique_ptr<MockAVPRender> render_;
+  std::shared_ptr<TestAVPRender> render_;
   std::shared_ptr<Message> notify_;
+  std::shared_ptr<MockContentSource> content_source_;
   std::shared_ptr<AVPDecoder> decoder_;
 };
 
 TEST_F(AVPDecoderTest, CreateAndDestroy) {
-  decoder_ = CreateDecoder();
+  CreateDecoder(false);
   EXPECT_NE(decoder_, nullptr);
 }
 
 TEST_F(AVPDecoderTest, ConfigureAudio) {
-  decoder_ = CreateDecoder();
-  auto format = CreateAudioFormat();
-  content_source_->SetFormat(format);
-
-  decoder_->Init();
-  decoder_->Configure(format);
-  decoder_->Start();
-
-  // Add some test packets
-  uint8_t test_data[] = {0x00, 0x01, 0x02, 0x03};
-  auto packet = CreatePacket(test_data, sizeof(test_data), 1000);
-  content_source_->AddPacket(packet);
-
-  // Let the decoder process
+  CreateDecoder(false);
+  StartDecoder(CreateAudioFormat());
+  content_source_->AddPacket(CreatePacket(MakePayload(4, 0), 1000));
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
   decoder_->Pause();
@@ -199,20 +339,9 @@ TEST_F(AVPDecoderTest, ConfigureAudio) {
 }
 
 TEST_F(AVPDecoderTest, ConfigureVideo) {
-  decoder_ = CreateDecoder();
-  auto format = CreateVideoFormat();
-  content_source_->SetFormat(format);
-
-  decoder_->Init();
-  decoder_->Configure(format);
-  decoder_->Start();
-
-  // Add some test packets
-  uint8_t test_data[] = {0x00, 0x01, 0x02, 0x03};
-  auto packet = CreatePacket(test_data, sizeof(test_data), 1000);
-  content_source_->AddPacket(packet);
-
-  // Let the decoder process
+  CreateDecoder(false);
+  StartDecoder(CreateVideoFormat());
+  content_source_->AddPacket(CreatePacket(MakePayload(4, 0), 1000));
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
   decoder_->Pause();
@@ -221,35 +350,183 @@ TEST_F(AVPDecoderTest, ConfigureVideo) {
 }
 
 TEST_F(AVPDecoderTest, HandleEndOfStream) {
-  decoder_ = CreateDecoder();
-  auto format = CreateAudioFormat();
-  content_source_->SetFormat(format);
+  CreateDecoder(true);
+  StartDecoder(CreateAudioFormat());
+  content_source_->SignalEos();
+
+  ASSERT_TRUE(content_source_->WaitForReads(1));
+  EXPECT_EQ(content_source_->reads()[0].err, media::ERROR_END_OF_STREAM);
+}
+
+TEST_F(AVPDecoderTest, ErrorHandling) {
+  CreateDecoder(false);
+  auto invalid_format =
+      MediaMeta::CreatePtr(MediaType::AUDIO, MediaMeta::FormatType::kTrack);
+  invalid_format->SetMime("invalid/mime");
 
   decoder_->Init();
-  decoder_->Configure(format);
-  decoder_->Start();
+  decoder_->Configure(invalid_format);
+  // An unknown codec is reported, not crashed on.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
 
-  // Add EOS packet
-  auto eos_packet = CreatePacket(nullptr, 0, 0);
-  eos_packet->setFlags(MediaFrame::FLAG_END_OF_STREAM);
-  content_source_->AddPacket(eos_packet);
+TEST_F(AVPDecoderTest, SourceThatNotifiesIsNotPolled) {
+  CreateDecoder(false);
+  content_source_->EnableDataAvailableNotify();
+  StartDecoder(CreateAudioFormat());
 
-  // Let the decoder process
+  // Starved with a notify armed: nothing re-requests input in the meantime.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const auto payload = MakePayload(16, 1);
+  content_source_->AddPacket(CreatePacket(payload, 0));
+  ASSERT_TRUE(content_source_->WaitForReads(1));
+  EXPECT_EQ(content_source_->reads()[0].data, payload);
+
+  const auto stats = decoder_->GetInputStats();
+  EXPECT_EQ(stats.polled_wakeups, 0u);
+  EXPECT_GE(stats.notified_wakeups, 1u);
 }
 
-TEST_F(AVPDecoderTest, ErrorHandling) {
-  decoder_ = CreateDecoder();
+TEST_F(AVPDecoderTest, ReadsAccessUnitsStraightIntoCodecBuffers) {
+  CreateDecoder(true);
+  const std::vector<std::vector<uint8_t>> payloads = {
+      MakePayload(16, 1), MakePayload(300, 2), MakePayload(7, 3)};
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    content_source_->AddPacket(CreatePacket(payloads[i], i * 23220));
+  }
+  StartDecoder(CreateAudioFormat());
 
-  // Try to configure with invalid format
-  auto invalid_format = std::make_shared<MediaMeta>();
-  invalid_format->setMime("invalid/mime");
+  ASSERT_TRUE(content_source_->WaitForReads(payloads.size()));
+  const auto reads = content_source_->reads();
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    EXPECT_EQ(reads[i].err, OK) << "packet " << i;
+    EXPECT_EQ(reads[i].data, payloads[i]) << "packet " << i;
+  }
+}
 
-  decoder_->Init();
-  decoder_->Configure(invalid_format);
+TEST_F(AVPDecoderTest, OversizedAccessUnitIsCopiedAndDecodingGoesOn) {
+  CreateDecoder(true);
+  content_source_->AddPacket(CreatePacket(MakePayload(16, 1), 0));
+  StartDecoder(CreateAudioFormat());
+  ASSERT_TRUE(content_source_->WaitForReads(1));
+  const size_t capacity = content_source_->reads()[0].capacity;
+
+  // One byte more than the codec input buffers hold, then one that fits.
+  const auto next = MakePayload(16, 3);
+  content_source_->AddPacket(CreatePacket(MakePayload(capacity + 1, 2), 23220));
+  content_source_->AddPacket(CreatePacket(next, 46440));
+
+  // The oversized unit goes through the copy path instead of stopping
+  // playback, and the next one is read directly again.
+  ASSERT_TRUE(content_source_->WaitForReads(3));
+  const auto reads = content_source_->reads();
+  EXPECT_EQ(reads[1].err, NO_MEMORY);
+  EXPECT_EQ(reads[2].err, OK);
+  EXPECT_EQ(reads[2].data, next);
+}
+
+TEST_F(AVPDecoderTest, SeekClosestDropsPrerollAndTrimsTheStraddlingFrame) {
+  CreateDecoder(true);
+  StartDecoder(CreateAudioFormat());
+  // The source landed on the sync sample at 0 for a target of 25 ms.
+  decoder_->SignalSeek(25000, SeekMode::SEEK_CLOSEST);
+  // 10 ms frames: 0 and 10 ms end before the target, 20 ms straddles it.
+  for (int64_t pts_us = 0; pts_us < 50000; pts_us += 10000) {
+    content_source_->AddPacket(CreatePcmPacket(480, pts_us));
+  }
+
+  AVPDecoder::SeekStats stats;
+  for (int i = 0; i < 500; ++i) {
+    stats = decoder_->GetSeekStats();
+    if (stats.trimmed_audio_samples > 0) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(stats.seeks, 1u);
+  EXPECT_EQ(stats.preroll_dropped_frames, 2u);
+  // 5 ms at 48 kHz.
+  EXPECT_EQ(stats.trimmed_audio_samples, 240u);
+}
+
+TEST_F(AVPDecoderTest, SkipsDroppableVideoWhenTheRenderIsLate) {
+  // Late past kSkipDroppableLateUs but not kSkipToSyncFrameLateUs.
+  ReportVideoLateness(200000, 0);
+  int64_t late_us = 0;
+  int64_t pts_us = 0;
+  ASSERT_TRUE(render_->GetVideoLateness(&late_us, &pts_us));
+  ASSERT_GT(late_us, AVPDecoder::kSkipDroppableLateUs);
+  ASSERT_LT(late_us, AVPDecoder::kSkipToSyncFrameLateUs);
+
+  CreateDecoder(true);
+  content_source_->AddPacket(CreateVideoPacket(0, ACCESS_UNIT_FLAG_SYNC));
+  content_source_->AddPacket(CreateVideoPacket(33000, 0));
+  content_source_->AddPacket(
+      CreateVideoPacket(66000, ACCESS_UNIT_FLAG_DROPPABLE));
+  content_source_->AddPacket(
+      CreateVideoPacket(100000, ACCESS_UNIT_FLAG_DROPPABLE));
+  // Read only once the decision on the one before is made.
+  content_source_->AddPacket(CreateVideoPacket(133000, 0));
+  StartDecoder(CreateVideoFormat());
+
+  ASSERT_TRUE(content_source_->WaitForReads(5));
+  const auto stats = decoder_->GetInputStats();
+  EXPECT_EQ(stats.skipped_frames, 2u);
+  EXPECT_EQ(stats.sync_frame_jumps, 0u);
+}
+
+TEST_F(AVPDecoderTest, JumpsToTheNextSyncFrameWhenTheRenderFallsFarBehind) {
+  ReportVideoLateness(1000000, 0);
+  int64_t late_us = 0;
+  int64_t pts_us = 0;
+  ASSERT_TRUE(render_->GetVideoLateness(&late_us, &pts_us));
+  ASSERT_GT(late_us, AVPDecoder::kSkipToSyncFrameLateUs);
+
+  CreateDecoder(true);
+  // The sync frame is decoded; from the next frame on, everything up to the
+  // following sync frame is skipped, droppable or not.
+  content_source_->AddPacket(CreateVideoPacket(0, ACCESS_UNIT_FLAG_SYNC));
+  content_source_->AddPacket(CreateVideoPacket(33000, 0));
+  content_source_->AddPacket(
+      CreateVideoPacket(66000, ACCESS_UNIT_FLAG_DROPPABLE));
+  content_source_->AddPacket(CreateVideoPacket(100000, 0));
+  content_source_->AddPacket(
+      CreateVideoPacket(133000, ACCESS_UNIT_FLAG_SYNC));
+  // Lateness reported for frames before the sync frame no longer counts, so
+  // decoding resumes there.
+  content_source_->AddPacket(CreateVideoPacket(166000, 0));
+  content_source_->AddPacket(CreateVideoPacket(200000, 0));
+  StartDecoder(CreateVideoFormat());
+
+  ASSERT_TRUE(content_source_->WaitForReads(7));
+  const auto stats = decoder_->GetInputStats();
+  EXPECT_EQ(stats.skipped_frames, 3u);
+  EXPECT_EQ(stats.sync_frame_jumps, 1u);
+}
 
-  // Should handle error gracefully
-  EXPECT_TRUE(true);  // If we get here without crash, it's good
+TEST(ContentSourceTest, AccessUnitThatDoesNotFitIsHandedOver) {
+  MockContentSource source(true);
+  const auto first = MakePayload(100, 1);
+  const auto second = MakePayload(10, 2);
+  source.AddPacket(CreatePacket(first, 0));
+  source.AddPacket(CreatePacket(second, 1000));
+
+  std::vector<uint8_t> buffer(100);
+  std::shared_ptr<MediaFrame> access_unit;
+  size_t size = 0;
+  ASSERT_EQ(source.DequeueAccessUnitInto(MediaType::AUDIO, buffer.data(), 50,
+                                         access_unit, &size),
+            NO_MEMORY);
+  ASSERT_NE(access_unit, nullptr);
+  EXPECT_EQ(std::vector<uint8_t>(access_unit->data(),
+                                 access_unit->data() + access_unit->size()),
+            first);
+
+  ASSERT_EQ(source.DequeueAccessUnitInto(MediaType::AUDIO, buffer.data(), 100,
+                                         access_unit, &size),
+            OK);
+  EXPECT_EQ(std::vector<uint8_t>(buffer.begin(), buffer.begin() + size),
+            second);
 }
 
 }  // namespace player
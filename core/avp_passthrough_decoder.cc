@@ -209,7 +209,8 @@ bool AVPPassthroughDecoder::IsDoneFetching() const {
   // Back-pressure: stop fetching when the render queue is near full.
   // This prevents queue overflow that would cause oldest audio frames to be
   // dropped, breaking the passthrough pacing anchor in the audio renderer.
-  if (avp_render_ && avp_render_->QueueSize() >= kMaxPassthroughQueueFrames) {
+  if (avp_render_ && (avp_render_->QueueSize() >= kMaxPassthroughQueueFrames ||
+                      avp_render_->IsQueueFull())) {
     return true;
   }
   return false;
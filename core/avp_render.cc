@@ -7,15 +7,35 @@
 
 #include "avp_render.h"
 
+#include <utility>
+
 #include "base/logging.h"
 #include "base/task_util/default_task_runner_factory.h"
+#include "base/time_utils.h"
 
 namespace ave {
 namespace player {
 
 namespace {
 constexpr int64_t kVideoDropThresholdUs = 100000;
+
+// Presentation time of |frame|, or |unknown_us| if it has none.
+int64_t FramePtsUs(const std::shared_ptr<media::MediaFrame>& frame,
+                   int64_t unknown_us) {
+  if (frame->stream_type() == media::MediaType::AUDIO) {
+    auto* audio_info = frame->audio_info();
+    if (audio_info && audio_info->pts.IsFinite()) {
+      return audio_info->pts.us();
+    }
+  } else if (frame->stream_type() == media::MediaType::VIDEO) {
+    auto* video_info = frame->video_info();
+    if (video_info && video_info->pts.IsFinite()) {
+      return video_info->pts.us();
+    }
+  }
+  return unknown_us;
 }
+}  // namespace
 
 AVPRender::AVPRender(base::TaskRunnerFactory* task_runner_factory,
                      IAVSyncController* avsync_controller)
@@ -32,6 +52,13 @@ AVPRender::AVPRender(base::TaskRunnerFactory* task_runner_factory,
 
 AVPRender::~AVPRender() {
   Stop();
+  std::unique_ptr<RenderClock::Timer> timer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer = std::move(render_timer_);
+  }
+  // Waits out a callback still posting to the task runner.
+  timer.reset();
 }
 
 void AVPRender::RenderFrame(std::shared_ptr<media::MediaFrame> frame,
@@ -56,8 +83,10 @@ void AVPRender::RenderFrame(std::shared_ptr<media::MediaFrame> frame,
     return;
   }
 
-  // Check queue size to prevent memory overflow
-  if (frame_queue_.size() >= kMaxQueueSize) {
+  // Producers hold off on IsQueueFull(); bound the memory of those that
+  // do not.
+  if (frame_queue_.size() >= queue_limits_.max_frames ||
+      (!frame_queue_.empty() && queued_bytes_ >= queue_limits_.max_bytes)) {
     if (frame->stream_type() == media::MediaType::AUDIO) {
       // For audio: reject the incoming frame (preserve playback order).
       // Fire the render_event so the producer's byte-accounting stays correct.
@@ -72,13 +101,17 @@ void AVPRender::RenderFrame(std::shared_ptr<media::MediaFrame> frame,
     // Release the oldest frame's codec buffer via its callback.
     AVE_LOG(LS_WARNING) << "Frame queue full, dropping oldest frame";
     ReleaseFrame(frame_queue_.front(), false);
-    frame_queue_.pop();
+    PopFrameLocked();
   }
 
   // Add frame to queue
   bool was_empty = frame_queue_.empty();
   auto stream_type = frame->stream_type();
-  frame_queue_.push(QueueEntry{std::move(frame), std::move(render_event)});
+  const size_t bytes = frame->size();
+  const int64_t pts_us = FramePtsUs(frame, -1);
+  frame_queue_.push(QueueEntry{std::move(frame), std::move(render_event),
+                               bytes, pts_us});
+  queued_bytes_ += bytes;
 
   AVE_LOG(LS_INFO) << "RenderFrame: enqueued "
                    << (stream_type == media::MediaType::AUDIO ? "AUDIO"
@@ -107,6 +140,117 @@ size_t AVPRender::QueueSize() const {
   return frame_queue_.size();
 }
 
+void AVPRender::SetQueueLimits(const QueueLimits& limits) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_limits_ = limits;
+  if (queue_space_callback_ && !IsQueueFullLocked()) {
+    std::exchange(queue_space_callback_, nullptr)();
+  }
+}
+
+AVPRender::QueueLimits AVPRender::GetQueueLimits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_limits_;
+}
+
+AVPRender::QueueDepth AVPRender::GetQueueDepth() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  QueueDepth depth;
+  depth.frames = frame_queue_.size();
+  depth.bytes = queued_bytes_;
+  if (!frame_queue_.empty() && frame_queue_.front().pts_us >= 0 &&
+      frame_queue_.back().pts_us > frame_queue_.front().pts_us) {
+    depth.duration_us =
+        frame_queue_.back().pts_us - frame_queue_.front().pts_us;
+  }
+  return depth;
+}
+
+bool AVPRender::IsQueueFull() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return IsQueueFullLocked();
+}
+
+bool AVPRender::NotifyWhenQueueHasSpace(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!IsQueueFullLocked()) {
+    return false;
+  }
+  queue_space_callback_ = std::move(callback);
+  return true;
+}
+
+bool AVPRender::IsQueueFullLocked() const {
+  if (frame_queue_.empty()) {
+    return false;
+  }
+  if (frame_queue_.size() >= queue_limits_.max_frames ||
+      queued_bytes_ >= queue_limits_.max_bytes) {
+    return true;
+  }
+  const int64_t first_pts_us = frame_queue_.front().pts_us;
+  const int64_t last_pts_us = frame_queue_.back().pts_us;
+  return first_pts_us >= 0 && last_pts_us >= 0 &&
+         last_pts_us - first_pts_us >= queue_limits_.max_duration_us;
+}
+
+void AVPRender::PopFrameLocked() {
+  queued_bytes_ -= frame_queue_.front().bytes;
+  frame_queue_.pop();
+  if (queue_space_callback_ && !IsQueueFullLocked()) {
+    std::exchange(queue_space_callback_, nullptr)();
+  }
+}
+
+void AVPRender::ClearQueueLocked() {
+  while (!frame_queue_.empty()) {
+    frame_queue_.pop();
+  }
+  queued_bytes_ = 0;
+  if (queue_space_callback_) {
+    std::exchange(queue_space_callback_, nullptr)();
+  }
+}
+
+void AVPRender::SetRenderClock(std::shared_ptr<RenderClock> clock) {
+  std::unique_ptr<RenderClock::Timer> old_timer;
+  std::lock_guard<std::mutex> lock(mutex_);
+  old_timer = std::move(render_timer_);
+  if (clock) {
+    render_timer_ = clock->CreateTimer([this]() {
+      task_runner_->PostTask([this, generation = timer_generation_.load()]() {
+        OnRenderTask(generation);
+      });
+    });
+  }
+  // A pending deadline of the old timer is lost; reschedule on the new one.
+  if (running_ && !paused_ && !frame_queue_.empty()) {
+    ScheduleNextFrame();
+  }
+}
+
+void AVPRender::SetVsyncSource(std::shared_ptr<VsyncSource> vsync_source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  frame_pacer_ = vsync_source
+                     ? std::make_unique<FramePacer>(std::move(vsync_source))
+                     : nullptr;
+}
+
+FramePacer::Stats AVPRender::GetPacingStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_pacer_ ? frame_pacer_->GetStats() : FramePacer::Stats();
+}
+
+bool AVPRender::GetVideoLateness(int64_t* late_us, int64_t* pts_us) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!has_video_lateness_) {
+    return false;
+  }
+  *late_us = video_late_us_;
+  *pts_us = video_late_pts_us_;
+  return true;
+}
+
 void AVPRender::Start() {
   std::lock_guard<std::mutex> lock(mutex_);
   if (!running_) {
@@ -126,11 +270,15 @@ void AVPRender::Stop() {
     running_ = false;
     paused_ = false;
     update_generation_++;
-
-    // Clear the frame queue
-    while (!frame_queue_.empty()) {
-      frame_queue_.pop();
+    has_video_lateness_ = false;
+    if (render_timer_) {
+      render_timer_->Cancel();
+    }
+    if (frame_pacer_) {
+      frame_pacer_->Reset();
     }
+
+    ClearQueueLocked();
   }
 }
 
@@ -139,6 +287,9 @@ void AVPRender::Pause() {
   if (running_ && !paused_) {
     paused_ = true;
     update_generation_++;
+    if (render_timer_) {
+      render_timer_->Cancel();
+    }
   }
 }
 
@@ -157,11 +308,15 @@ void AVPRender::Resume() {
 void AVPRender::Flush() {
   std::lock_guard<std::mutex> lock(mutex_);
   update_generation_++;
-
-  // Clear the frame queue
-  while (!frame_queue_.empty()) {
-    frame_queue_.pop();
+  has_video_lateness_ = false;
+  if (render_timer_) {
+    render_timer_->Cancel();
+  }
+  if (frame_pacer_) {
+    frame_pacer_->Reset();
   }
+
+  ClearQueueLocked();
 }
 
 void AVPRender::ScheduleNextFrame(uint32_t delay_us) {
@@ -179,6 +334,12 @@ void AVPRender::ScheduleNextFrame(uint32_t delay_us) {
   AVE_LOG(LS_INFO) << "ScheduleNextFrame: delay=" << delay_us
                    << "us, generation=" << update_generation_
                    << ", queue_size=" << frame_queue_.size();
+  if (render_timer_ && delay_us > 0) {
+    // Moves the one pending deadline; nothing is left behind to go stale.
+    timer_generation_.store(update_generation_);
+    render_timer_->ArmAt(base::TimeMicros() + delay_us);
+    return;
+  }
   // Schedule the task with delay
   task_runner_->PostDelayedTask(
       [this, update_generation = update_generation_]() {
@@ -192,18 +353,7 @@ void AVPRender::ScheduleNextFrame(uint32_t delay_us) {
 int64_t AVPRender::CalculateRenderLateUs(
     const std::shared_ptr<media::MediaFrame>& frame) {
   // Calculate render delay based on frame PTS and current timestamp
-  int64_t frame_pts_us = 0;
-  if (frame->stream_type() == media::MediaType::AUDIO) {
-    auto* audio_info = frame->audio_info();
-    if (audio_info && audio_info->pts.IsFinite()) {
-      frame_pts_us = audio_info->pts.us();
-    }
-  } else if (frame->stream_type() == media::MediaType::VIDEO) {
-    auto* video_info = frame->video_info();
-    if (video_info && video_info->pts.IsFinite()) {
-      frame_pts_us = video_info->pts.us();
-    }
-  }
+  const int64_t frame_pts_us = FramePtsUs(frame, 0);
 
   int64_t current_timestamp_us = 0;
   if (avsync_controller_) {
@@ -247,19 +397,47 @@ void AVPRender::OnRenderTask(int64_t update_generation) {
     next_render_delay_us = RenderFrameInternal(frame, consumed);
     if (consumed) {
       ReleaseFrame(entry, true);
-      frame_queue_.pop();
+      PopFrameLocked();
       frames_rendered_count_++;
     }
   } else {
     // For video/subtitle, use original logic with drop frame behavior
     // Calculate delay within mutex lock
     int64_t late_us = sync_enabled_ ? CalculateRenderLateUs(frame) : 0;
-    if (sync_enabled_ && late_us > kVideoDropThresholdUs &&
-        frames_rendered_count_ > 0) {
-      // too late, drop the frame (only after at least one frame was rendered)
+    if (sync_enabled_ && frame->stream_type() == media::MediaType::VIDEO) {
+      auto* video_info = frame->video_info();
+      has_video_lateness_ = true;
+      video_late_us_ = late_us;
+      video_late_pts_us_ = video_info && video_info->pts.IsFinite()
+                               ? video_info->pts.us()
+                               : 0;
+    }
+    // With a vsync source the frame goes to the sink half a refresh period
+    // before its slot, rather than as soon as it is due.
+    bool paced = false;
+    FramePacer::Decision pacing;
+    int64_t now_us = 0;
+    if (frame_pacer_ && sync_enabled_ &&
+        frame->stream_type() == media::MediaType::VIDEO &&
+        frames_rendered_count_ > 0 && late_us <= kVideoDropThresholdUs) {
+      const float rate = avsync_controller_->GetPlaybackRate();
+      now_us = base::TimeMicros();
+      const int64_t due_us =
+          now_us - (rate > 0 ? static_cast<int64_t>(late_us / rate) : late_us);
+      paced = frame_pacer_->Schedule(FramePtsUs(frame, 0), due_us, rate,
+                                     &pacing);
+    }
+
+    if (sync_enabled_ && ((late_us > kVideoDropThresholdUs &&
+                           frames_rendered_count_ > 0) ||
+                          (paced && pacing.drop))) {
+      // too late (only after at least one frame was rendered), or its
+      // refresh slot went to the previous frame: drop it
       ReleaseFrame(entry, false);
-      frame_queue_.pop();
-    } else if (late_us > -5000 || frames_rendered_count_ == 0) {
+      PopFrameLocked();
+    } else if (paced && pacing.submit_us > now_us) {
+      next_render_delay_us = pacing.submit_us - now_us;
+    } else if (paced || late_us > -5000 || frames_rendered_count_ == 0) {
       // Render if: not too early, OR this is the very first frame ever
       // (first frame may arrive "late" due to codec startup latency while
       // the audio clock has already advanced; always display first frame)
@@ -271,7 +449,7 @@ void AVPRender::OnRenderTask(int64_t update_generation) {
       RenderFrameInternal(frame, consumed);
       if (consumed) {
         ReleaseFrame(entry, true);
-        frame_queue_.pop();
+        PopFrameLocked();
         frames_rendered_count_++;
       }
     } else {
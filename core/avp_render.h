@@ -8,6 +8,8 @@
 #ifndef AVE_AVP_AVP_RENDER_H_H_
 #define AVE_AVP_AVP_RENDER_H_H_
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <queue>
 
@@ -17,6 +19,10 @@
 #include "base/thread_annotation.h"
 #include "media/foundation/media_frame.h"
 
+#include "frame_pacer.h"
+#include "render_clock.h"
+#include "vsync_source.h"
+
 namespace ave {
 namespace player {
 
@@ -101,6 +107,59 @@ class AVPRender {
    */
   size_t QueueSize() const EXCLUDES(mutex_);
 
+  /**
+   * @brief Bounds of the render queue. Producers should stop queueing once
+   *        any of them is reached; see IsQueueFull(). A frame is always
+   *        accepted into an empty queue, whatever its size.
+   */
+  struct QueueLimits {
+    size_t max_frames = 100;
+    // Payload bytes of the queued frames.
+    size_t max_bytes = 64 * 1024 * 1024;
+    // Span between the first and last queued presentation times.
+    int64_t max_duration_us = 2 * 1000 * 1000;
+  };
+
+  /**
+   * @brief Current depth of the render queue, for diagnostics.
+   */
+  struct QueueDepth {
+    size_t frames = 0;
+    size_t bytes = 0;
+    int64_t duration_us = 0;
+  };
+
+  void SetQueueLimits(const QueueLimits& limits) EXCLUDES(mutex_);
+  QueueLimits GetQueueLimits() const EXCLUDES(mutex_);
+  QueueDepth GetQueueDepth() const EXCLUDES(mutex_);
+
+  /**
+   * @brief Whether the queue reached one of its limits. Frames queued
+   *        beyond max_frames or max_bytes regardless are dropped: the
+   *        incoming one for audio, the oldest for video.
+   */
+  bool IsQueueFull() const EXCLUDES(mutex_);
+
+  /**
+   * @brief Arms a one-shot callback for when the queue is no longer full.
+   *        It runs on the render thread, or on the thread that flushes or
+   *        stops the render, with the render lock held: it must not call
+   *        back into the render.
+   * @return False, without arming, if the queue has room already.
+   */
+  bool NotifyWhenQueueHasSpace(std::function<void()> callback)
+      EXCLUDES(mutex_);
+
+  /**
+   * @brief Reports how late the last video frame checked against the master
+   *        clock was. Lets the decoder skip input while the render is behind.
+   * @param late_us How late the frame was, negative if early.
+   * @param pts_us Presentation time of the frame.
+   * @return False if no frame was checked since start or the last flush.
+   */
+  bool GetVideoLateness(int64_t* late_us, int64_t* pts_us) const
+      EXCLUDES(mutex_);
+
   /**
    * @brief Starts the renderer.
    */
@@ -126,6 +185,24 @@ class AVPRender {
    */
   virtual void Flush() EXCLUDES(mutex_);
 
+  /**
+   * @brief Wakes the renderer for frame deadlines from |clock| instead of a
+   *        delayed task per frame. Null goes back to delayed tasks.
+   */
+  void SetRenderClock(std::shared_ptr<RenderClock> clock) EXCLUDES(mutex_);
+
+  /**
+   * @brief Paces video frames to the refresh slots of |vsync_source|, see
+   *        FramePacer. Null shows frames as soon as they are due.
+   */
+  void SetVsyncSource(std::shared_ptr<VsyncSource> vsync_source)
+      EXCLUDES(mutex_);
+
+  /**
+   * @brief Frame pacing counts; all zero without a vsync source.
+   */
+  FramePacer::Stats GetPacingStats() const EXCLUDES(mutex_);
+
   /**
    * @brief Enables or disables A/V sync. When disabled, frames are rendered
    *        immediately without checking the master clock (useful for file
@@ -141,6 +218,9 @@ class AVPRender {
   struct QueueEntry {
     std::shared_ptr<media::MediaFrame> frame;
     std::unique_ptr<RenderEvent> render_event;
+    // Taken when queued; the audio render trims frames it partly wrote.
+    size_t bytes = 0;
+    int64_t pts_us = -1;
   };
 
   /**
@@ -205,6 +285,12 @@ class AVPRender {
    */
   void ReleaseFrame(QueueEntry& entry, bool render) REQUIRES(mutex_);
 
+  // Removes the front entry and runs the queue space callback once the
+  // queue has room.
+  void PopFrameLocked() REQUIRES(mutex_);
+  void ClearQueueLocked() REQUIRES(mutex_);
+  bool IsQueueFullLocked() const REQUIRES(mutex_);
+
   /**
    * @brief Calculates render delay for a frame.
    * @param frame The media frame to calculate delay for.
@@ -222,10 +308,21 @@ class AVPRender {
   // dropping for the very first frame, which may arrive late due to codec
   // startup latency while the audio clock has already advanced.
   size_t frames_rendered_count_ GUARDED_BY(mutex_) = 0;
-
-  static constexpr size_t kMaxQueueSize = 100;  // Prevent memory overflow
-                                                // Frame queue management
+  // Lateness of the last video frame checked, for GetVideoLateness().
+  bool has_video_lateness_ GUARDED_BY(mutex_) = false;
+  int64_t video_late_us_ GUARDED_BY(mutex_) = 0;
+  int64_t video_late_pts_us_ GUARDED_BY(mutex_) = 0;
+
+  std::unique_ptr<FramePacer> frame_pacer_ GUARDED_BY(mutex_);
+  std::unique_ptr<RenderClock::Timer> render_timer_ GUARDED_BY(mutex_);
+  // Generation the timer was last armed for; read on the clock thread,
+  // which must not wait for mutex_.
+  std::atomic<int64_t> timer_generation_{0};
+
+  QueueLimits queue_limits_ GUARDED_BY(mutex_);
   std::queue<QueueEntry> frame_queue_ GUARDED_BY(mutex_);
+  size_t queued_bytes_ GUARDED_BY(mutex_) = 0;
+  std::function<void()> queue_space_callback_ GUARDED_BY(mutex_);
 };
 
 }  // namespace player
@@ -316,6 +316,79 @@ TEST_F(AVPRenderTest, RenderFrameLate) {
   EXPECT_EQ(renderer_->GetRenderCount(), 1);
 }
 
+TEST_F(AVPRenderTest, ReportsVideoLateness) {
+  renderer_->Start();
+  int64_t late_us = 0;
+  int64_t pts_us = 0;
+  EXPECT_FALSE(renderer_->GetVideoLateness(&late_us, &pts_us));
+
+  avsync_controller_->SetCurrentTime(2000000);
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 1970000));
+  TriggerTaskRunner();
+  ASSERT_TRUE(renderer_->GetVideoLateness(&late_us, &pts_us));
+  EXPECT_EQ(late_us, 30000);
+  EXPECT_EQ(pts_us, 1970000);
+
+  // Too late to render: dropped, and still reported.
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 1800000));
+  TriggerTaskRunner();
+  ASSERT_TRUE(renderer_->GetVideoLateness(&late_us, &pts_us));
+  EXPECT_EQ(late_us, 200000);
+  EXPECT_EQ(renderer_->GetRenderCount(), 1);
+
+  renderer_->Flush();
+  EXPECT_FALSE(renderer_->GetVideoLateness(&late_us, &pts_us));
+}
+
+TEST_F(AVPRenderTest, QueueDepthAndLimits) {
+  renderer_->Start();
+  renderer_->Pause();
+  AVPRender::QueueLimits limits;
+  limits.max_bytes = 3 * 1024;
+  limits.max_duration_us = 1000000;
+  renderer_->SetQueueLimits(limits);
+
+  int space_notifies = 0;
+  EXPECT_FALSE(renderer_->NotifyWhenQueueHasSpace(
+      [&space_notifies]() { space_notifies++; }));
+
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 1000000));
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 1040000));
+  auto depth = renderer_->GetQueueDepth();
+  EXPECT_EQ(depth.frames, 2u);
+  EXPECT_EQ(depth.bytes, 2048u);
+  EXPECT_EQ(depth.duration_us, 40000);
+  EXPECT_FALSE(renderer_->IsQueueFull());
+
+  // Full by bytes.
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 1080000));
+  EXPECT_TRUE(renderer_->IsQueueFull());
+  EXPECT_TRUE(renderer_->NotifyWhenQueueHasSpace(
+      [&space_notifies]() { space_notifies++; }));
+
+  // Draining one frame makes room and fires the callback once.
+  avsync_controller_->SetCurrentTime(1000000);
+  renderer_->Resume();
+  TriggerTaskRunner();
+  EXPECT_EQ(renderer_->GetRenderCount(), 1);
+  EXPECT_EQ(space_notifies, 1);
+  EXPECT_FALSE(renderer_->IsQueueFull());
+
+  // Full by duration.
+  renderer_->Pause();
+  limits.max_bytes = 64 * 1024;
+  renderer_->SetQueueLimits(limits);
+  renderer_->RenderFrame(CreateTestFrame(media::MediaType::VIDEO, 2040000));
+  EXPECT_EQ(renderer_->GetQueueDepth().duration_us, 1000000);
+  EXPECT_TRUE(renderer_->IsQueueFull());
+
+  renderer_->Flush();
+  depth = renderer_->GetQueueDepth();
+  EXPECT_EQ(depth.frames, 0u);
+  EXPECT_EQ(depth.bytes, 0u);
+  EXPECT_FALSE(renderer_->IsQueueFull());
+}
+
 TEST_F(AVPRenderTest, AudioFrameRendering) {
   renderer_->Start();
   avsync_controller_->SetCurrentTime(1000000);
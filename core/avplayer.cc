@@ -377,6 +377,7 @@ status_t AvPlayer::InstantiateDecoder(
                                                      sync_controller_.get());
     video_render_->SetSink(video_render_sink_);
     video_render_->SetSyncEnabled(sync_enabled_);
+    video_render_->SetRenderClock(RenderClock::Default());
     decoder = AVPDecoderFactory::CreateDecoder(codec_factory_, notify, source_,
                                                video_render_, format,
                                                video_render_sink_);
@@ -504,7 +505,12 @@ void AvPlayer::OnStart(int64_t start_us, SeekMode seek_mode) {
 
   // Create sync controller if needed
   if (!sync_controller_) {
-    sync_controller_ = std::make_shared<AVSyncControllerImpl>();
+    auto sync_controller = std::make_shared<AVSyncControllerImpl>();
+    // Filter audio anchor jitter out of the clock video is timed by.
+    AVSyncControllerImpl::SmoothingConfig smoothing;
+    smoothing.enabled = true;
+    sync_controller->SetSmoothing(smoothing);
+    sync_controller_ = std::move(sync_controller);
   }
 
   // Instantiate decoders immediately based on current track info (NuPlayer
@@ -668,15 +674,15 @@ void AvPlayer::OnResume() {
 }
 
 void AvPlayer::OnSeek(int64_t seek_to_us, SeekMode seek_mode) {
-  if (source_) {
-    PerformSeek(seek_to_us, seek_mode);
-  }
   if (audio_decoder_) {
     audio_decoder_->Flush();
   }
   if (video_decoder_) {
     video_decoder_->Flush();
   }
+  // After the flush, so output decoded before the seek is not taken for the
+  // new position.
+  PerformSeek(seek_to_us, seek_mode);
   if (audio_render_) {
     audio_render_->Flush();
   }
@@ -740,6 +746,17 @@ void AvPlayer::PerformSeek(int64_t seek_time_us, SeekMode seek_mode) {
 
   previous_seek_time_us_ = seek_time_us;
   source_->SeekTo(seek_time_us, seek_mode);
+  // The decoders are flushed already, or have not decoded anything yet.
+  SignalDecoderSeek(seek_time_us, seek_mode);
+}
+
+void AvPlayer::SignalDecoderSeek(int64_t seek_time_us, SeekMode seek_mode) {
+  if (audio_decoder_) {
+    audio_decoder_->SignalSeek(seek_time_us, seek_mode);
+  }
+  if (video_decoder_) {
+    video_decoder_->SignalSeek(seek_time_us, seek_mode);
+  }
 }
 
 void AvPlayer::PerformDecoderFlush(FlushCommand audio, FlushCommand video) {
@@ -274,6 +274,7 @@ AVE_EXPORT class AvPlayer : public Player,
   // New methods for improved state management
   void ProcessDeferredActions();
   void PerformSeek(int64_t seek_time_us, SeekMode seek_mode);
+  void SignalDecoderSeek(int64_t seek_time_us, SeekMode seek_mode);
   void PerformDecoderFlush(FlushCommand audio, FlushCommand video);
   void PerformReset();
   void PerformScanSources();
@@ -5,6 +5,7 @@
  * Distributed under terms of the GPLv2 license.
  */
 #include <algorithm>
+#include <cmath>
 
 #include "base/time_utils.h"
 
@@ -13,15 +14,7 @@
 namespace ave {
 namespace player {
 
-AVSyncControllerImpl::AVSyncControllerImpl()
-    : anchor_media_pts_us_(0),
-      anchor_sys_time_us_(0),
-      max_media_time_us_(-1),
-      paused_(false),
-      pause_sys_time_us_(0),
-      pause_media_pts_us_(0),
-      playback_rate_(1.0f),
-      clock_type_(ClockType::kAudio) {}
+AVSyncControllerImpl::AVSyncControllerImpl() = default;
 
 AVSyncControllerImpl::~AVSyncControllerImpl() = default;
 
@@ -29,11 +22,121 @@ int64_t AVSyncControllerImpl::GetCurrentSystemTimeUs() const {
   return base::TimeMicros();
 }
 
+double AVSyncControllerImpl::AdvanceAnchorExact(const ClockState& state,
+                                                int64_t now_us) {
+  int64_t delta = now_us - state.anchor_sys_time_us;
+  if (delta < 0) {
+    delta = 0;
+  }
+  return static_cast<double>(state.anchor_media_pts_us) +
+         state.anchor_media_fraction_us +
+         static_cast<double>(delta) * state.playback_rate *
+             (1.0 + state.rate_correction);
+}
+
+int64_t AVSyncControllerImpl::AdvanceAnchor(const ClockState& state,
+                                            int64_t now_us) {
+  return std::llround(AdvanceAnchorExact(state, now_us));
+}
+
+void AVSyncControllerImpl::RestartLineLocked(double media_us,
+                                             int64_t sys_time_us) {
+  state_.anchor_media_pts_us = std::llround(media_us);
+  state_.anchor_media_fraction_us =
+      media_us - static_cast<double>(state_.anchor_media_pts_us);
+  state_.anchor_sys_time_us = sys_time_us;
+}
+
+void AVSyncControllerImpl::SetAnchorLocked(int64_t media_pts_us,
+                                           int64_t sys_time_us) {
+  RestartLineLocked(static_cast<double>(media_pts_us), sys_time_us);
+  if (state_.paused) {
+    // If paused, update pause anchor as well
+    state_.pause_media_pts_us = media_pts_us;
+    state_.pause_sys_time_us = sys_time_us;
+  }
+  filter_.last_sys_time_us = sys_time_us;
+  // Keep running at the learned drift; the phase starts over.
+  ApplyCorrectionLocked(filter_.drift);
+}
+
+void AVSyncControllerImpl::FilterAnchorLocked(int64_t media_pts_us,
+                                              int64_t sys_time_us) {
+  double smoothed_us = AdvanceAnchorExact(state_, sys_time_us);
+  if (state_.clock_type == ClockType::kAudio) {
+    smoothed_us = std::min(smoothed_us,
+                           static_cast<double>(state_.max_media_time_us));
+  }
+  const int64_t error_us = media_pts_us - std::llround(smoothed_us);
+  smoothing_stats_.anchors++;
+  smoothing_stats_.last_error_us = error_us;
+
+  if (error_us > smoothing_.resync_threshold_us) {
+    smoothing_stats_.resyncs++;
+    SetAnchorLocked(media_pts_us, sys_time_us);
+    return;
+  }
+  if (error_us < -smoothing_.resync_threshold_us) {
+    // Burst writes; as without smoothing, never step the clock back.
+    return;
+  }
+
+  // Critically damped PI loop with natural frequency 1 / time constant.
+  const double tau_us =
+      static_cast<double>(std::max<int64_t>(smoothing_.time_constant_us, 1));
+  const int64_t elapsed_us =
+      filter_.last_sys_time_us > 0
+          ? std::clamp<int64_t>(sys_time_us - filter_.last_sys_time_us, 0,
+                                smoothing_.time_constant_us)
+          : 0;
+  filter_.last_sys_time_us = sys_time_us;
+  const double max_slew = smoothing_.max_slew;
+  filter_.drift = std::clamp(
+      filter_.drift + static_cast<double>(error_us) *
+                          static_cast<double>(elapsed_us) / (tau_us * tau_us),
+      -max_slew, max_slew);
+
+  // Restart the line where the clock is now, so it never jumps. The
+  // fraction is kept: rounding at every anchor would bias the loop.
+  RestartLineLocked(smoothed_us, sys_time_us);
+  ApplyCorrectionLocked(std::clamp(
+      filter_.drift + 2.0 * static_cast<double>(error_us) / tau_us, -max_slew,
+      max_slew));
+}
+
+void AVSyncControllerImpl::ApplyCorrectionLocked(double correction) {
+  if (DriftCompensatingLocked()) {
+    // Anchors ahead mean the audio plays fast: stretch it.
+    state_.rate_correction = 0;
+    state_.resample_ratio = 1.0 + correction;
+  } else {
+    state_.rate_correction = correction;
+    state_.resample_ratio = 1.0;
+  }
+}
+
+void AVSyncControllerImpl::RebaseLocked() {
+  if (state_.max_media_time_us == -1 || state_.paused) {
+    return;
+  }
+  const int64_t now_us = GetCurrentSystemTimeUs();
+  RestartLineLocked(AdvanceAnchorExact(state_, now_us), now_us);
+}
+
 void AVSyncControllerImpl::UpdateAnchor(int64_t media_pts_us,
                                         int64_t sys_time_us,
                                         int64_t max_media_time_us) {
   std::lock_guard<std::mutex> lock(mutex_);
 
+  if (smoothing_.enabled && state_.max_media_time_us != -1 &&
+      !state_.paused) {
+    FilterAnchorLocked(media_pts_us, sys_time_us);
+    state_.max_media_time_us = std::max(
+        {media_pts_us, max_media_time_us, state_.max_media_time_us});
+    PublishLocked();
+    return;
+  }
+
   // Guard against the master clock going backwards.  Audio writes happen in
   // bursts (e.g. flushing an empty AAudio buffer at startup or after a stall).
   // Each burst write calls UpdateAnchor with media_pts_us = write_pts -
@@ -41,71 +144,44 @@ void AVSyncControllerImpl::UpdateAnchor(int64_t media_pts_us,
   // next burst arrives its proposed media_pts_us may be lower than the current
   // clock. Skip the anchor update in that case; only update max_media_time so
   // the end-of-stream clamp stays accurate.
-  if (max_media_time_us_ != -1 && !paused_) {
-    const int64_t now_us = GetCurrentSystemTimeUs();
-    int64_t current_delta = now_us - anchor_sys_time_us_;
-    if (current_delta < 0) {
-      current_delta = 0;
-    }
+  if (state_.max_media_time_us != -1 && !state_.paused) {
     const int64_t current_clock =
-        std::min(anchor_media_pts_us_ +
-                     static_cast<int64_t>(static_cast<float>(current_delta) *
-                                          playback_rate_),
-                 max_media_time_us_);
+        std::min(AdvanceAnchor(state_, GetCurrentSystemTimeUs()),
+                 state_.max_media_time_us);
     if (media_pts_us < current_clock) {
       // New anchor would move the clock backwards — skip anchor update.
-      max_media_time_us_ =
-          std::max({media_pts_us, max_media_time_us, max_media_time_us_});
+      state_.max_media_time_us = std::max(
+          {media_pts_us, max_media_time_us, state_.max_media_time_us});
+      PublishLocked();
       return;
     }
   }
 
-  anchor_media_pts_us_ = media_pts_us;
-  anchor_sys_time_us_ = sys_time_us;
-  max_media_time_us_ =
-      std::max({media_pts_us, max_media_time_us, max_media_time_us_});
-  if (paused_) {
-    // If paused, update pause anchor as well
-    pause_media_pts_us_ = media_pts_us;
-    pause_sys_time_us_ = sys_time_us;
-  }
+  SetAnchorLocked(media_pts_us, sys_time_us);
+  state_.max_media_time_us =
+      std::max({media_pts_us, max_media_time_us, state_.max_media_time_us});
+  PublishLocked();
 }
 
 int64_t AVSyncControllerImpl::GetMasterClock() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  const ClockState state = snapshot_.Load();
 
-  if (max_media_time_us_ == -1) {
+  if (state.max_media_time_us == -1) {
     return 0;
   }
 
-  if (clock_type_ == ClockType::kSystem) {
+  if (state.clock_type == ClockType::kSystem) {
     // For system clock, return elapsed time since start
-    const int64_t now_us = GetCurrentSystemTimeUs();
-    int64_t delta = now_us - anchor_sys_time_us_;
-    if (delta < 0) {
-      delta = 0;
-    }
-    return anchor_media_pts_us_ +
-           static_cast<int64_t>(static_cast<float>(delta) * playback_rate_);
+    return AdvanceAnchor(state, GetCurrentSystemTimeUs());
   }
 
   // For audio clock (default)
-  if (paused_) {
-    return pause_media_pts_us_;
-  }
-
-  // Get current system time in microseconds
-  const int64_t now_us = GetCurrentSystemTimeUs();
-  int64_t delta = now_us - anchor_sys_time_us_;
-  if (delta < 0) {
-    delta = 0;
+  if (state.paused) {
+    return state.pause_media_pts_us;
   }
 
-  const int64_t current_media_time =
-      anchor_media_pts_us_ +
-      static_cast<int64_t>(static_cast<float>(delta) * playback_rate_);
-
-  return std::min(current_media_time, max_media_time_us_);
+  return std::min(AdvanceAnchor(state, GetCurrentSystemTimeUs()),
+                  state.max_media_time_us);
 }
 
 void AVSyncControllerImpl::SetPlaybackRate(float rate) {
@@ -113,61 +189,81 @@ void AVSyncControllerImpl::SetPlaybackRate(float rate) {
   if (rate < 0.0f) {
     rate = 0.0f;  // Clamp to non-negative
   }
-  playback_rate_ = rate;
+  state_.playback_rate = rate;
+  PublishLocked();
 }
 
 float AVSyncControllerImpl::GetPlaybackRate() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return playback_rate_;
+  return snapshot_.Load().playback_rate;
 }
 
 void AVSyncControllerImpl::SetClockType(ClockType type) {
   std::lock_guard<std::mutex> lock(mutex_);
-  clock_type_ = type;
+  RebaseLocked();
+  state_.clock_type = type;
+  // Drift compensation moves between the clock and the audio.
+  ApplyCorrectionLocked(smoothing_.enabled ? filter_.drift : 0);
+  PublishLocked();
 }
 
 IAVSyncController::ClockType AVSyncControllerImpl::GetClockType() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return clock_type_;
+  return snapshot_.Load().clock_type;
 }
 
 void AVSyncControllerImpl::Pause() {
   std::lock_guard<std::mutex> lock(mutex_);
-  if (!paused_) {
+  if (!state_.paused) {
     // Record the pause anchor
-    pause_sys_time_us_ = GetCurrentSystemTimeUs();
-    int64_t delta = pause_sys_time_us_ - anchor_sys_time_us_;
-    if (delta < 0) {
-      delta = 0;
-    }
-    pause_media_pts_us_ =
-        anchor_media_pts_us_ +
-        static_cast<int64_t>(static_cast<float>(delta) * playback_rate_);
-    paused_ = true;
+    state_.pause_sys_time_us = GetCurrentSystemTimeUs();
+    state_.pause_media_pts_us =
+        AdvanceAnchor(state_, state_.pause_sys_time_us);
+    state_.paused = true;
+    PublishLocked();
   }
 }
 
 void AVSyncControllerImpl::Resume() {
   std::lock_guard<std::mutex> lock(mutex_);
-  if (paused_) {
-    const int64_t now_us = GetCurrentSystemTimeUs();
+  if (state_.paused) {
     // Adjust anchor to account for pause duration
-    anchor_sys_time_us_ = now_us;
-    anchor_media_pts_us_ = pause_media_pts_us_;
-    paused_ = false;
+    RestartLineLocked(static_cast<double>(state_.pause_media_pts_us),
+                      GetCurrentSystemTimeUs());
+    state_.paused = false;
+    // The pause is not an anchor interval.
+    filter_.last_sys_time_us = 0;
+    PublishLocked();
   }
 }
 
 void AVSyncControllerImpl::Reset() {
   std::lock_guard<std::mutex> lock(mutex_);
-  anchor_media_pts_us_ = 0;
-  anchor_sys_time_us_ = 0;
-  max_media_time_us_ = -1;
-  paused_ = false;
-  pause_sys_time_us_ = 0;
-  pause_media_pts_us_ = 0;
-  playback_rate_ = 1.0f;
-  clock_type_ = ClockType::kAudio;
+  state_ = ClockState();
+  // The drift belongs to the audio device and outlives a seek.
+  filter_.last_sys_time_us = 0;
+  PublishLocked();
+}
+
+double AVSyncControllerImpl::GetAudioResampleRatio() const {
+  return snapshot_.Load().resample_ratio;
+}
+
+void AVSyncControllerImpl::SetSmoothing(const SmoothingConfig& config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RebaseLocked();
+  smoothing_ = config;
+  if (!smoothing_.enabled) {
+    filter_ = FilterState();
+  }
+  ApplyCorrectionLocked(filter_.drift);
+  PublishLocked();
+}
+
+AVSyncControllerImpl::SmoothingStats AVSyncControllerImpl::GetSmoothingStats()
+    const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SmoothingStats stats = smoothing_stats_;
+  stats.drift_ppm = filter_.drift * 1e6;
+  return stats;
 }
 
 }  // namespace player
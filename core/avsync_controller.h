@@ -10,15 +10,52 @@
 #include <cstdint>
 #include <mutex>
 #include "api/player_interface.h"
+#include "base/thread_annotation.h"
+
+#include "seqlock.h"
 
 namespace ave {
 namespace player {
 
 /**
  * @brief Implementation of IAVSyncController. Maintains the master media clock.
+ *
+ * Writers serialize on a mutex and publish the clock state through a
+ * seqlock; GetMasterClock() and the other getters read that snapshot and
+ * never block, however often the audio render moves the anchor.
+ *
+ * With smoothing enabled, anchors steer the clock through a second order
+ * phase-locked loop instead of moving it: the clock stays continuous and
+ * its speed is corrected by at most SmoothingConfig::max_slew, so anchor
+ * jitter does not reach video timing. The integral term of the loop learns
+ * the drift between the anchors and the system clock. With drift
+ * compensation and ClockType::kSystem the clock keeps system time and the
+ * loop output becomes the resample ratio the audio render plays at.
  */
 class AVSyncControllerImpl : public IAVSyncController {
  public:
+  struct SmoothingConfig {
+    bool enabled = false;
+    // Time the loop takes to settle an anchor error.
+    int64_t time_constant_us = 2000000;
+    // Largest clock speed (or resample ratio) correction, as a fraction.
+    double max_slew = 0.005;
+    // Anchors further ahead than this are discontinuities and move the
+    // clock at once; ones further behind are ignored.
+    int64_t resync_threshold_us = 50000;
+    // With ClockType::kSystem, correct the audio instead of the clock.
+    bool drift_compensation = false;
+  };
+
+  struct SmoothingStats {
+    uint64_t anchors = 0;
+    uint64_t resyncs = 0;
+    // Last anchor minus the smoothed clock at its time.
+    int64_t last_error_us = 0;
+    // Anchor rate minus system rate, in parts per million.
+    double drift_ppm = 0;
+  };
+
   AVSyncControllerImpl();
   ~AVSyncControllerImpl() override;
 
@@ -69,6 +106,19 @@ class AVSyncControllerImpl : public IAVSyncController {
    */
   void Reset() override;
 
+  /**
+   * @copydoc IAVSyncController::GetAudioResampleRatio
+   */
+  double GetAudioResampleRatio() const override;
+
+  /**
+   * @brief Enables or reconfigures anchor smoothing. Takes effect at the
+   *        next anchor; disabling drops any correction in progress.
+   */
+  void SetSmoothing(const SmoothingConfig& config);
+
+  SmoothingStats GetSmoothingStats() const;
+
  protected:
   /**
    * @brief Get current system time in microseconds.
@@ -78,15 +128,67 @@ class AVSyncControllerImpl : public IAVSyncController {
   virtual int64_t GetCurrentSystemTimeUs() const;
 
  private:
+  struct ClockState {
+    int64_t anchor_media_pts_us = 0;
+    // Sub-microsecond part of the anchor, in [-0.5, 0.5].
+    double anchor_media_fraction_us = 0;
+    int64_t anchor_sys_time_us = 0;
+    int64_t max_media_time_us = -1;
+    int64_t pause_sys_time_us = 0;
+    int64_t pause_media_pts_us = 0;
+    float playback_rate = 1.0f;
+    // Smoothing correction of the clock speed, as a fraction.
+    double rate_correction = 0;
+    double resample_ratio = 1.0;
+    ClockType clock_type = ClockType::kAudio;
+    bool paused = false;
+  };
+
+  // Loop state only the writers need.
+  struct FilterState {
+    // System time of the last anchor fed to the loop, 0 before the first.
+    int64_t last_sys_time_us = 0;
+    // Integral term: the estimated anchor drift, as a fraction.
+    double drift = 0;
+  };
+
+  // Media time of the anchor of |state| advanced to |now_us|, unclamped.
+  static double AdvanceAnchorExact(const ClockState& state, int64_t now_us);
+  static int64_t AdvanceAnchor(const ClockState& state, int64_t now_us);
+
+  // Starts the anchor line at |media_us| at |sys_time_us|.
+  void RestartLineLocked(double media_us, int64_t sys_time_us)
+      REQUIRES(mutex_);
+
+  // Anchors |media_pts_us| at |sys_time_us|, moving the clock at once.
+  void SetAnchorLocked(int64_t media_pts_us, int64_t sys_time_us)
+      REQUIRES(mutex_);
+
+  // Feeds an anchor to the loop of a running, smoothed clock.
+  void FilterAnchorLocked(int64_t media_pts_us, int64_t sys_time_us)
+      REQUIRES(mutex_);
+
+  // Applies |correction| to the clock speed or to the resample ratio.
+  void ApplyCorrectionLocked(double correction) REQUIRES(mutex_);
+
+  // Restarts the anchor line at the current clock, so that a correction
+  // change applies from now on.
+  void RebaseLocked() REQUIRES(mutex_);
+
+  bool DriftCompensatingLocked() const REQUIRES(mutex_) {
+    return smoothing_.drift_compensation &&
+           state_.clock_type == ClockType::kSystem;
+  }
+
+  void PublishLocked() REQUIRES(mutex_) { snapshot_.Store(state_); }
+
+  // Serializes writers and the smoothing getters.
   mutable std::mutex mutex_;
-  int64_t anchor_media_pts_us_;
-  int64_t anchor_sys_time_us_;
-  int64_t max_media_time_us_;
-  bool paused_;
-  int64_t pause_sys_time_us_;
-  int64_t pause_media_pts_us_;
-  float playback_rate_;
-  ClockType clock_type_;
+  ClockState state_ GUARDED_BY(mutex_);
+  SmoothingConfig smoothing_ GUARDED_BY(mutex_);
+  FilterState filter_ GUARDED_BY(mutex_);
+  SmoothingStats smoothing_stats_ GUARDED_BY(mutex_);
+  SeqLock<ClockState> snapshot_;
 };
 
 }  // namespace player
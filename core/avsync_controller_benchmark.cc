@@ -0,0 +1,157 @@
+/*
+ * avsync_controller_benchmark.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// Times GetMasterClock() on reader threads while a writer thread keeps
+// moving the anchor, as the audio render does. A mutex guarded copy of
+// the same clock math runs under the same load for comparison.
+//
+//   avsync_controller_benchmark [readers] [milliseconds] [update_interval_us]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/time_utils.h"
+#include "player/avsync_controller.h"
+
+namespace {
+
+using ave::player::AVSyncControllerImpl;
+
+// The clock math of AVSyncControllerImpl behind one mutex, as readers saw
+// it before the snapshot was published through a seqlock.
+class MutexClock {
+ public:
+  int64_t GetMasterClock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now_us = ave::base::TimeMicros();
+    int64_t media_us = anchor_media_pts_us_ + (now_us - anchor_sys_time_us_);
+    if (max_media_time_us_ >= 0) {
+      media_us = std::min(media_us, max_media_time_us_);
+    }
+    return media_us;
+  }
+
+  void UpdateAnchor(int64_t media_pts_us,
+                    int64_t sys_time_us,
+                    int64_t max_media_time_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    anchor_media_pts_us_ = media_pts_us;
+    anchor_sys_time_us_ = sys_time_us;
+    max_media_time_us_ = max_media_time_us;
+  }
+
+ private:
+  std::mutex mutex_;
+  int64_t anchor_media_pts_us_ = 0;
+  int64_t anchor_sys_time_us_ = 0;
+  int64_t max_media_time_us_ = -1;
+};
+
+int64_t NowNs() {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+struct Result {
+  uint64_t reads = 0;
+  uint64_t updates = 0;
+  // Read latency percentiles, from every 64th read.
+  double p50_ns = 0;
+  double p99_ns = 0;
+  double max_ns = 0;
+};
+
+template <typename Clock>
+Result Run(Clock& clock, int readers, int duration_ms, int interval_us) {
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> reads{0};
+  std::vector<std::vector<int64_t>> samples(readers);
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&, r]() {
+      uint64_t count = 0;
+      int64_t sink = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        if ((count & 63) == 0) {
+          const int64_t start_ns = NowNs();
+          sink += clock.GetMasterClock();
+          samples[r].push_back(NowNs() - start_ns);
+        } else {
+          sink += clock.GetMasterClock();
+        }
+        count++;
+      }
+      reads += count + (sink == 42 ? 1 : 0);
+    });
+  }
+
+  uint64_t updates = 0;
+  const int64_t end_us = ave::base::TimeMicros() + duration_ms * 1000LL;
+  for (int64_t now_us = ave::base::TimeMicros(); now_us < end_us; now_us = ave::base::TimeMicros()) {
+    clock.UpdateAnchor(now_us, now_us, now_us + 100000);
+    updates++;
+    if (interval_us > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+    }
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int64_t> all;
+  for (const auto& reader_samples : samples) {
+    all.insert(all.end(), reader_samples.begin(), reader_samples.end());
+  }
+  std::sort(all.begin(), all.end());
+  Result result;
+  result.reads = reads.load();
+  result.updates = updates;
+  if (!all.empty()) {
+    result.p50_ns = static_cast<double>(all[all.size() / 2]);
+    result.p99_ns = static_cast<double>(all[all.size() * 99 / 100]);
+    result.max_ns = static_cast<double>(all.back());
+  }
+  return result;
+}
+
+void Print(const char* name, const Result& result, int duration_ms) {
+  std::printf(
+      "%-8s %10.2f Mreads/s  %9llu updates  p50 %6.0f ns  p99 %7.0f ns  "
+      "max %9.0f ns\n",
+      name, static_cast<double>(result.reads) / duration_ms / 1000.0,
+      static_cast<unsigned long long>(result.updates), result.p50_ns,
+      result.p99_ns, result.max_ns);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int readers = argc > 1 ? std::atoi(argv[1]) : 4;
+  const int duration_ms = argc > 2 ? std::atoi(argv[2]) : 1000;
+  // 0 updates the anchor back to back, the worst case for readers.
+  const int interval_us = argc > 3 ? std::atoi(argv[3]) : 0;
+  std::printf("%d readers, %d ms, anchor update every %d us\n", readers,
+              duration_ms, interval_us);
+
+  AVSyncControllerImpl seqlock_clock;
+  seqlock_clock.UpdateAnchor(ave::base::TimeMicros(), ave::base::TimeMicros(), -1);
+  Print("seqlock", Run(seqlock_clock, readers, duration_ms, interval_us),
+        duration_ms);
+
+  MutexClock mutex_clock;
+  Print("mutex", Run(mutex_clock, readers, duration_ms, interval_us),
+        duration_ms);
+  return 0;
+}
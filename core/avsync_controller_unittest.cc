@@ -7,7 +7,13 @@
 #include "player/avsync_controller.h"
 
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
 #include <thread>
+#include <vector>
+
+#include "player/seqlock.h"
 
 namespace ave {
 namespace player {
@@ -38,6 +44,25 @@ class MockAVSyncController : public AVSyncControllerImpl {
  private:
   int64_t current_time_us_;
 };
+
+// Deterministic anchor jitter in [-amplitude_us, amplitude_us].
+class Jitter {
+ public:
+  explicit Jitter(int64_t amplitude_us) : amplitude_us_(amplitude_us) {}
+
+  int64_t Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<int64_t>((state_ >> 33) % (2 * amplitude_us_ + 1)) -
+           amplitude_us_;
+  }
+
+ private:
+  const int64_t amplitude_us_;
+  uint64_t state_ = 1;
+};
+
+constexpr int64_t kAnchorIntervalUs = 20000;
+constexpr int64_t kStartTimeUs = 1000000;
 }  // namespace
 
 class AVSyncControllerTest : public ::testing::Test {
@@ -356,5 +381,184 @@ TEST_F(AVSyncControllerTest, ThreadSafety) {
   EXPECT_GE(controller_->GetPlaybackRate(), 0.0f);
 }
 
+TEST_F(AVSyncControllerTest, SmoothingFiltersAnchorJitter) {
+  AVSyncControllerImpl::SmoothingConfig config;
+  config.enabled = true;
+  controller_->SetSmoothing(config);
+  Jitter jitter(8000);
+
+  int64_t last_clock = 0;
+  int64_t max_error_us = 0;
+  int64_t max_step_us = 0;
+  for (int64_t elapsed = 0; elapsed <= 20000000; elapsed += 1000) {
+    const int64_t now = kStartTimeUs + elapsed;
+    controller_->SetCurrentTime(now);
+    if (elapsed % kAnchorIntervalUs == 0) {
+      const int64_t heard = elapsed + jitter.Next();
+      controller_->UpdateAnchor(heard, now, elapsed + 500000);
+    }
+    const int64_t clock = controller_->GetMasterClock();
+    if (elapsed > 0) {
+      EXPECT_GE(clock, last_clock);
+      max_step_us = std::max(max_step_us, clock - last_clock);
+    }
+    if (elapsed >= 10000000) {
+      max_error_us = std::max(max_error_us, std::abs(clock - elapsed));
+    }
+    last_clock = clock;
+  }
+
+  // Raw anchors are up to 8 ms off; the smoothed clock stays close to the
+  // true position and never runs more than max_slew fast.
+  EXPECT_LT(max_error_us, 2500);
+  EXPECT_LE(max_step_us, 1000 + 1000 * config.max_slew + 1);
+  const auto stats = controller_->GetSmoothingStats();
+  EXPECT_EQ(stats.anchors, 1000u);
+  EXPECT_EQ(stats.resyncs, 0u);
+  EXPECT_LT(std::abs(stats.drift_ppm), 500);
+}
+
+TEST_F(AVSyncControllerTest, SmoothingLearnsAnchorDrift) {
+  AVSyncControllerImpl::SmoothingConfig config;
+  config.enabled = true;
+  controller_->SetSmoothing(config);
+
+  // The audio device plays 300 ppm fast.
+  int64_t last_error_us = 0;
+  for (int64_t elapsed = 0; elapsed <= 60000000;
+       elapsed += kAnchorIntervalUs) {
+    const int64_t now = kStartTimeUs + elapsed;
+    const int64_t heard = elapsed + elapsed * 300 / 1000000;
+    controller_->SetCurrentTime(now);
+    controller_->UpdateAnchor(heard, now, heard + 500000);
+    last_error_us = controller_->GetMasterClock() - heard;
+  }
+
+  EXPECT_NEAR(controller_->GetSmoothingStats().drift_ppm, 300, 15);
+  EXPECT_LE(std::abs(last_error_us), 50);
+  EXPECT_DOUBLE_EQ(controller_->GetAudioResampleRatio(), 1.0);
+}
+
+TEST_F(AVSyncControllerTest, SmoothingResyncsOnForwardJumps) {
+  AVSyncControllerImpl::SmoothingConfig config;
+  config.enabled = true;
+  controller_->SetSmoothing(config);
+  controller_->SetCurrentTime(kStartTimeUs);
+  controller_->UpdateAnchor(0, kStartTimeUs, 500000);
+
+  controller_->SetCurrentTime(kStartTimeUs + 100000);
+  controller_->UpdateAnchor(1100000, kStartTimeUs + 100000, 1600000);
+  EXPECT_EQ(controller_->GetMasterClock(), 1100000);
+
+  // Far behind: ignored, as without smoothing.
+  controller_->UpdateAnchor(900000, kStartTimeUs + 100000, 1600000);
+  EXPECT_EQ(controller_->GetMasterClock(), 1100000);
+
+  const auto stats = controller_->GetSmoothingStats();
+  EXPECT_EQ(stats.anchors, 2u);
+  EXPECT_EQ(stats.resyncs, 1u);
+  EXPECT_EQ(stats.last_error_us, -200000);
+}
+
+TEST_F(AVSyncControllerTest, DriftCompensationResamplesAudio) {
+  AVSyncControllerImpl::SmoothingConfig config;
+  config.enabled = true;
+  config.drift_compensation = true;
+  controller_->SetSmoothing(config);
+  controller_->SetClockType(IAVSyncController::ClockType::kSystem);
+
+  // The audio device plays 300 ppm fast; the render resamples by the
+  // ratio, so the heard position advances at 1.0003 / ratio.
+  double heard = 0;
+  for (int64_t elapsed = 0; elapsed <= 60000000;
+       elapsed += kAnchorIntervalUs) {
+    const int64_t now = kStartTimeUs + elapsed;
+    controller_->SetCurrentTime(now);
+    controller_->UpdateAnchor(static_cast<int64_t>(heard), now,
+                              static_cast<int64_t>(heard) + 500000);
+    // The clock stays on system time.
+    EXPECT_NEAR(controller_->GetMasterClock(), elapsed, 1);
+    heard += kAnchorIntervalUs * 1.0003 /
+             controller_->GetAudioResampleRatio();
+  }
+
+  EXPECT_NEAR(controller_->GetAudioResampleRatio(), 1.0003, 0.00002);
+  EXPECT_NEAR(heard, 60000000 + kAnchorIntervalUs, 100);
+
+  // Without drift compensation the clock follows the audio again.
+  config.drift_compensation = false;
+  controller_->SetSmoothing(config);
+  EXPECT_DOUBLE_EQ(controller_->GetAudioResampleRatio(), 1.0);
+}
+
+TEST(SeqLockTest, ReadersNeverSeeTornValues) {
+  struct Value {
+    int64_t a = 0;
+    int64_t b = 0;
+    int64_t c = 0;
+  };
+  SeqLock<Value> seqlock;
+  std::atomic<bool> done{false};
+  std::atomic<int64_t> torn{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        const Value value = seqlock.Load();
+        if (value.b != -value.a || value.c != value.a * 3) {
+          torn++;
+        }
+      }
+    });
+  }
+  for (int64_t i = 1; i <= 200000; ++i) {
+    Value value;
+    value.a = i;
+    value.b = -i;
+    value.c = i * 3;
+    seqlock.Store(value);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(seqlock.Load().a, 200000);
+}
+
+TEST_F(AVSyncControllerTest, ConcurrentReadsFollowAnchor) {
+  controller_->SetCurrentTime(1000000);
+  constexpr int64_t kUpdates = 100000;
+  std::atomic<bool> done{false};
+  std::atomic<int64_t> backwards{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&]() {
+      int64_t last = 0;
+      while (!done.load()) {
+        const int64_t clock = controller_->GetMasterClock();
+        if (clock < last || clock > kUpdates) {
+          backwards++;
+        }
+        last = clock;
+      }
+    });
+  }
+  // Mock time stands still, so the clock is the anchor pts.
+  for (int64_t pts = 1; pts <= kUpdates; ++pts) {
+    controller_->UpdateAnchor(pts, 1000000, pts);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(backwards.load(), 0);
+  EXPECT_EQ(controller_->GetMasterClock(), kUpdates);
+}
+
 }  // namespace player
 }  // namespace ave
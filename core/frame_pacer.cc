@@ -0,0 +1,115 @@
+/*
+ * frame_pacer.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "frame_pacer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace ave {
+namespace player {
+
+namespace {
+
+// Beyond this many slots off the cadence the stream jumped (seek, pts
+// discontinuity) rather than slipped; not counted.
+constexpr int64_t kMaxCadenceSlipSlots = 8;
+
+// |value| wrapped into [-0.5, 0.5).
+double WrapHalf(double value) {
+  return value - std::floor(value + 0.5);
+}
+
+}  // namespace
+
+FramePacer::FramePacer(std::shared_ptr<VsyncSource> vsync_source)
+    : vsync_source_(std::move(vsync_source)) {}
+
+bool FramePacer::Schedule(int64_t pts_us,
+                          int64_t due_us,
+                          float rate,
+                          Decision* decision) {
+  const VsyncTiming timing =
+      vsync_source_ ? vsync_source_->GetTiming() : VsyncTiming();
+  if (timing.period_us <= 0) {
+    return false;
+  }
+  if (has_last_ && pts_us == last_pts_us_ &&
+      timing.period_us == timing_.period_us) {
+    // The render checks the same frame again until it is submitted.
+    *decision = last_decision_;
+    return true;
+  }
+  if (timing.period_us != timing_.period_us) {
+    Reset();
+  }
+  timing_ = timing;
+
+  const double position = static_cast<double>(due_us - timing.reference_us) /
+                          static_cast<double>(timing.period_us);
+  if (!locked_) {
+    // Put the first frame a quarter slot from the rounding boundary; with
+    // two due times per slot pair, as for 24 fps on 60 Hz, both then keep
+    // a quarter slot of margin.
+    const double fraction = position - std::floor(position);
+    const double early = WrapHalf(0.25 - fraction);
+    const double late = WrapHalf(0.75 - fraction);
+    rounding_offset_ = std::abs(early) < std::abs(late) ? early : late;
+    locked_ = true;
+  }
+
+  const int64_t slot = SlotIndex(position);
+  Decision result;
+  result.slot_us = timing.reference_us + slot * timing.period_us;
+  // Any time within the slot before it shows the frame at it.
+  result.submit_us = result.slot_us - timing.period_us / 2;
+  stats_.frames++;
+
+  if (has_last_) {
+    const double step =
+        rate > 0 ? static_cast<double>(pts_us - last_pts_us_) / rate /
+                       static_cast<double>(timing.period_us)
+                 : 0;
+    const int64_t expected = SlotIndex(last_position_ + step) - last_slot_;
+    const int64_t actual = slot - last_slot_;
+    if (pts_us > last_pts_us_ &&
+        std::llabs(actual - expected) <= kMaxCadenceSlipSlots) {
+      if (actual > expected) {
+        stats_.repeated_slots += actual - expected;
+      } else {
+        stats_.skipped_slots += expected - actual;
+      }
+    }
+    result.drop = slot <= last_slot_;
+  }
+
+  if (result.drop) {
+    stats_.dropped_frames++;
+  } else {
+    last_slot_ = slot;
+  }
+  has_last_ = true;
+  last_pts_us_ = pts_us;
+  last_position_ = position;
+  last_decision_ = result;
+  *decision = result;
+  return true;
+}
+
+void FramePacer::Reset() {
+  locked_ = false;
+  rounding_offset_ = 0;
+  has_last_ = false;
+}
+
+int64_t FramePacer::SlotIndex(double position) const {
+  return static_cast<int64_t>(std::floor(position + rounding_offset_ + 0.5));
+}
+
+}  // namespace player
+}  // namespace ave
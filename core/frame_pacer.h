@@ -0,0 +1,91 @@
+/*
+ * frame_pacer.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_FRAME_PACER_H_H_
+#define AVE_AVP_FRAME_PACER_H_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "vsync_source.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Snaps video frames to display refresh slots.
+ *
+ * Each frame goes to the vsync slot nearest to the time it is due. The
+ * rounding is offset, by at most a quarter period, so that due times sit
+ * away from the slot boundaries: clock jitter then cannot flip a frame
+ * between two slots, and a frame rate that does not divide the refresh
+ * rate keeps a steady cadence, e.g. 3:2 for 24 fps on 60 Hz. The offset
+ * is chosen at the first frame and kept until Reset() or a refresh rate
+ * change.
+ *
+ * A frame is given the number of slots the pts step to the next one calls
+ * for. Slots a frame holds beyond that, because the next one came late, are
+ * counted as repeated; slots it loses, because the next one came early or
+ * two frames fell into one slot, as skipped. Not thread safe.
+ */
+class FramePacer {
+ public:
+  struct Decision {
+    // Hand the frame to the sink at this time to show it at slot_us.
+    int64_t submit_us = 0;
+    int64_t slot_us = 0;
+    // The slot is already taken by the previous frame.
+    bool drop = false;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t dropped_frames = 0;
+    uint64_t repeated_slots = 0;
+    uint64_t skipped_slots = 0;
+  };
+
+  explicit FramePacer(std::shared_ptr<VsyncSource> vsync_source);
+
+  /**
+   * @brief Picks the slot of a frame. Calling again for the same |pts_us|
+   *        returns the same decision.
+   * @param due_us base::TimeMicros() time the frame is due by the clock.
+   * @param rate Playback rate, to turn pts steps into display time.
+   * @return False if the display timing is unknown; pace by |due_us|.
+   */
+  bool Schedule(int64_t pts_us, int64_t due_us, float rate, Decision* decision);
+
+  // Forgets the previous frames, e.g. after a flush.
+  void Reset();
+
+  Stats GetStats() const { return stats_; }
+
+ private:
+  int64_t SlotIndex(double position) const;
+
+  const std::shared_ptr<VsyncSource> vsync_source_;
+
+  VsyncTiming timing_;
+  // Added to slot positions before rounding; 0 until locked.
+  double rounding_offset_ = 0;
+  bool locked_ = false;
+
+  // Last frame scheduled, and the slot of the last one not dropped.
+  bool has_last_ = false;
+  int64_t last_pts_us_ = 0;
+  double last_position_ = 0;
+  int64_t last_slot_ = 0;
+  Decision last_decision_;
+
+  Stats stats_;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_FRAME_PACER_H_H_ */
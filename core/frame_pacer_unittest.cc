@@ -0,0 +1,128 @@
+/*
+ * frame_pacer_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "frame_pacer.h"
+
+#include <memory>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+constexpr int64_t k60HzPeriodUs = 16667;
+
+// Slots held by each frame, from the slot times of consecutive frames.
+std::vector<int64_t> SlotSpans(const std::vector<int64_t>& slot_us) {
+  std::vector<int64_t> spans;
+  for (size_t i = 1; i < slot_us.size(); ++i) {
+    spans.push_back((slot_us[i] - slot_us[i - 1]) / k60HzPeriodUs);
+  }
+  return spans;
+}
+
+}  // namespace
+
+class FramePacerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    vsync_ = std::make_shared<SimulatedVsyncSource>(k60HzPeriodUs, 1000);
+    pacer_ = std::make_unique<FramePacer>(vsync_);
+  }
+
+  // Paces |frames| frames at |fps|, with the due times off by |jitter_us|
+  // alternately early and late. Returns the slot times.
+  std::vector<int64_t> Pace(int fps, int frames, int64_t jitter_us = 0) {
+    std::vector<int64_t> slots;
+    for (int i = 0; i < frames; ++i) {
+      const int64_t pts_us = i * 1000000LL / fps;
+      const int64_t jitter = (i % 2 == 0) ? jitter_us : -jitter_us;
+      FramePacer::Decision decision;
+      EXPECT_TRUE(pacer_->Schedule(pts_us, 500000 + pts_us + jitter, 1.0f,
+                                   &decision));
+      EXPECT_FALSE(decision.drop);
+      EXPECT_LT(decision.submit_us, decision.slot_us);
+      slots.push_back(decision.slot_us);
+    }
+    return slots;
+  }
+
+  std::shared_ptr<SimulatedVsyncSource> vsync_;
+  std::unique_ptr<FramePacer> pacer_;
+};
+
+TEST_F(FramePacerTest, UnknownRefreshIsNotPaced) {
+  vsync_->SetTiming(0, 0);
+  FramePacer::Decision decision;
+  EXPECT_FALSE(pacer_->Schedule(0, 1000, 1.0f, &decision));
+}
+
+TEST_F(FramePacerTest, ThreeTwoCadenceFor24On60) {
+  const auto spans = SlotSpans(Pace(24, 48, 2000));
+  for (size_t i = 1; i < spans.size(); ++i) {
+    EXPECT_EQ(spans[i - 1] + spans[i], 5) << "at frame " << i;
+    EXPECT_TRUE(spans[i] == 2 || spans[i] == 3);
+  }
+  const auto stats = pacer_->GetStats();
+  EXPECT_EQ(stats.frames, 48u);
+  EXPECT_EQ(stats.repeated_slots, 0u);
+  EXPECT_EQ(stats.skipped_slots, 0u);
+}
+
+TEST_F(FramePacerTest, EvenCadenceFor30On60) {
+  for (int64_t span : SlotSpans(Pace(30, 30, 3000))) {
+    EXPECT_EQ(span, 2);
+  }
+  EXPECT_EQ(pacer_->GetStats().repeated_slots, 0u);
+}
+
+TEST_F(FramePacerTest, SameFrameGetsSameDecision) {
+  FramePacer::Decision first;
+  FramePacer::Decision again;
+  ASSERT_TRUE(pacer_->Schedule(0, 100000, 1.0f, &first));
+  ASSERT_TRUE(pacer_->Schedule(0, 104000, 1.0f, &again));
+  EXPECT_EQ(first.slot_us, again.slot_us);
+  EXPECT_EQ(pacer_->GetStats().frames, 1u);
+}
+
+TEST_F(FramePacerTest, CountsRepeatedAndSkippedSlots) {
+  FramePacer::Decision decision;
+  // 30 fps: two slots per frame. Frame 1 comes a slot late, so frame 0 is
+  // shown one slot longer and frame 1 one slot shorter.
+  ASSERT_TRUE(pacer_->Schedule(0, 100000, 1.0f, &decision));
+  ASSERT_TRUE(pacer_->Schedule(33333, 133333 + k60HzPeriodUs, 1.0f,
+                               &decision));
+  ASSERT_TRUE(pacer_->Schedule(66667, 166667, 1.0f, &decision));
+  auto stats = pacer_->GetStats();
+  EXPECT_EQ(stats.repeated_slots, 1u);
+  EXPECT_EQ(stats.skipped_slots, 1u);
+  EXPECT_EQ(stats.dropped_frames, 0u);
+
+  // Frame 3 lands in the slot of frame 2 and is dropped.
+  ASSERT_TRUE(pacer_->Schedule(100000, 166667 + 2000, 1.0f, &decision));
+  EXPECT_TRUE(decision.drop);
+  stats = pacer_->GetStats();
+  EXPECT_EQ(stats.dropped_frames, 1u);
+  EXPECT_EQ(stats.skipped_slots, 3u);
+}
+
+TEST_F(FramePacerTest, ResetAfterFlush) {
+  Pace(24, 10);
+  pacer_->Reset();
+  // A seek back does not count as a cadence slip.
+  Pace(24, 10);
+  const auto stats = pacer_->GetStats();
+  EXPECT_EQ(stats.frames, 20u);
+  EXPECT_EQ(stats.repeated_slots, 0u);
+  EXPECT_EQ(stats.skipped_slots, 0u);
+}
+
+}  // namespace player
+}  // namespace ave
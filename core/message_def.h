@@ -28,6 +28,7 @@ static const char* kParameters = "parameters";
 static const char* kSeekToUs = "seek_to_us";
 static const char* kSeekMode = "seek_mode";
 static const char* kGeneration = "generation";
+static const char* kTimeUs = "time_us";
 }  // namespace player
 }  // namespace ave
 
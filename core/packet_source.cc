@@ -56,8 +56,15 @@ size_t PacketSource::GetAvailableBufferCount(status_t* result) {
 }
 
 status_t PacketSource::QueueAccessunit(std::shared_ptr<MediaFrame> packet) {
-  std::lock_guard<std::mutex> l(lock_);
-  packets_.push(std::move(packet));
+  std::shared_ptr<Message> notify;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    packets_.push(std::move(packet));
+    notify.swap(data_available_notify_);
+  }
+  if (notify) {
+    notify->post();
+  }
   return ave::OK;
 }
 
@@ -76,5 +83,19 @@ status_t PacketSource::DequeueAccessUnit(std::shared_ptr<MediaFrame>& packet) {
   return ave::OK;
 }
 
+void PacketSource::SetDataAvailableNotify(std::shared_ptr<Message> notify) {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (packets_.empty()) {
+      data_available_notify_ = std::move(notify);
+      return;
+    }
+    data_available_notify_.reset();
+  }
+  if (notify) {
+    notify->post();
+  }
+}
+
 }  // namespace player
 }  // namespace ave
@@ -17,6 +17,7 @@
 #include "media/foundation/media_frame.h"
 #include "media/foundation/media_meta.h"
 #include "media/foundation/media_utils.h"
+#include "media/foundation/message.h"
 
 namespace ave {
 namespace player {
@@ -24,6 +25,7 @@ namespace player {
 using ave::media::MediaFrame;
 using ave::media::MediaMeta;
 using ave::media::MediaType;
+using ave::media::Message;
 
 class PacketSource {
  public:
@@ -48,11 +50,16 @@ class PacketSource {
   status_t QueueAccessunit(std::shared_ptr<MediaFrame> packet);
   status_t DequeueAccessUnit(std::shared_ptr<MediaFrame>& packet);
 
+  // Posts |notify| once the next access unit is queued, or right away if one
+  // is already waiting. Replaces a notify that has not been posted yet.
+  void SetDataAvailableNotify(std::shared_ptr<Message> notify);
+
  private:
   mutable std::mutex lock_;
   std::condition_variable condition_;
   std::shared_ptr<MediaMeta> format_ GUARDED_BY(lock_);
   std::queue<std::shared_ptr<MediaFrame>> packets_ /*GUARDED_BY(lock_)*/;
+  std::shared_ptr<Message> data_available_notify_ GUARDED_BY(lock_);
 
   AVE_DISALLOW_COPY_AND_ASSIGN(PacketSource);
 };
@@ -0,0 +1,306 @@
+/*
+ * render_clock.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "render_clock.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include "base/logging.h"
+#include "base/thread_annotation.h"
+#include "base/time_utils.h"
+
+namespace ave {
+namespace player {
+
+class RenderClock::State {
+ public:
+  State();
+  ~State();
+
+  uint64_t AddEntry(std::function<void()> callback) EXCLUDES(mutex_);
+  JitterStats GetJitterStats() const EXCLUDES(mutex_);
+  void Arm(uint64_t id, int64_t deadline_us) EXCLUDES(mutex_);
+  void Remove(uint64_t id, bool wait) EXCLUDES(mutex_);
+  void Stop() EXCLUDES(mutex_);
+  void Loop() EXCLUDES(mutex_);
+
+ private:
+  struct Entry {
+    std::function<void()> callback;
+    // -1 while disarmed.
+    int64_t deadline_us = -1;
+  };
+
+  void Disarm(uint64_t id) REQUIRES(mutex_);
+  // Points the wakeup at the earliest deadline.
+  void UpdateWakeupLocked() REQUIRES(mutex_);
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t next_id_ GUARDED_BY(mutex_) = 1;
+  std::map<uint64_t, Entry> entries_ GUARDED_BY(mutex_);
+  // (deadline_us, id) of the armed timers.
+  std::set<std::pair<int64_t, uint64_t>> deadlines_ GUARDED_BY(mutex_);
+  // Timer whose callback is running, 0 if none.
+  uint64_t firing_id_ GUARDED_BY(mutex_) = 0;
+  bool stopping_ GUARDED_BY(mutex_) = false;
+  std::thread::id thread_id_ GUARDED_BY(mutex_);
+
+  uint64_t wakeups_ GUARDED_BY(mutex_) = 0;
+  int64_t max_jitter_us_ GUARDED_BY(mutex_) = 0;
+  std::array<int64_t, kJitterWindow> jitter_us_ GUARDED_BY(mutex_) = {};
+
+  // -1 when the condition variable is used instead.
+  int timer_fd_ = -1;
+};
+
+RenderClock::Timer::~Timer() {
+  clock_->Remove(id_, true /* wait */);
+}
+
+void RenderClock::Timer::ArmAt(int64_t deadline_us) {
+  clock_->Arm(id_, deadline_us);
+}
+
+void RenderClock::Timer::Cancel() {
+  clock_->Remove(id_, false /* wait */);
+}
+
+std::shared_ptr<RenderClock> RenderClock::Default() {
+  // Never destroyed, so renderers torn down at exit still find it.
+  static auto* clock = new std::shared_ptr<RenderClock>(Create());
+  return *clock;
+}
+
+std::shared_ptr<RenderClock> RenderClock::Create() {
+  return std::shared_ptr<RenderClock>(new RenderClock());
+}
+
+RenderClock::RenderClock() : state_(std::make_shared<State>()) {
+  thread_ = std::thread([state = state_]() { state->Loop(); });
+}
+
+RenderClock::~RenderClock() {
+  state_->Stop();
+  if (thread_.get_id() == std::this_thread::get_id()) {
+    // The last timer went away in its own callback; the thread finishes on
+    // its reference to the state.
+    thread_.detach();
+  } else if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::unique_ptr<RenderClock::Timer> RenderClock::CreateTimer(
+    std::function<void()> callback) {
+  const uint64_t id = state_->AddEntry(std::move(callback));
+  return std::unique_ptr<Timer>(new Timer(shared_from_this(), id));
+}
+
+RenderClock::JitterStats RenderClock::GetJitterStats() const {
+  return state_->GetJitterStats();
+}
+
+void RenderClock::Arm(uint64_t id, int64_t deadline_us) {
+  state_->Arm(id, deadline_us);
+}
+
+void RenderClock::Remove(uint64_t id, bool wait) {
+  state_->Remove(id, wait);
+}
+
+RenderClock::State::State() {
+#if defined(__linux__)
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (timer_fd_ < 0) {
+    AVE_LOG(LS_WARNING) << "timerfd_create failed, errno=" << errno
+                        << ", waking on a condition variable";
+  }
+#endif
+}
+
+RenderClock::State::~State() {
+#if defined(__linux__)
+  if (timer_fd_ >= 0) {
+    close(timer_fd_);
+  }
+#endif
+}
+
+uint64_t RenderClock::State::AddEntry(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t id = next_id_++;
+  entries_[id].callback = std::move(callback);
+  return id;
+}
+
+RenderClock::JitterStats RenderClock::State::GetJitterStats() const {
+  std::vector<int64_t> samples;
+  JitterStats stats;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.wakeups = wakeups_;
+    stats.max_us = max_jitter_us_;
+    const size_t count =
+        static_cast<size_t>(std::min<uint64_t>(wakeups_, kJitterWindow));
+    samples.assign(jitter_us_.begin(), jitter_us_.begin() + count);
+  }
+  if (samples.empty()) {
+    return stats;
+  }
+  auto percentile = [&samples](size_t percent) {
+    auto it = samples.begin() + (samples.size() - 1) * percent / 100;
+    std::nth_element(samples.begin(), it, samples.end());
+    return *it;
+  };
+  stats.p50_us = percentile(50);
+  stats.p99_us = percentile(99);
+  return stats;
+}
+
+void RenderClock::State::Arm(uint64_t id, int64_t deadline_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+  Disarm(id);
+  it->second.deadline_us = deadline_us;
+  deadlines_.emplace(deadline_us, id);
+  UpdateWakeupLocked();
+}
+
+void RenderClock::State::Remove(uint64_t id, bool wait) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Disarm(id);
+  if (!wait) {
+    return;
+  }
+  entries_.erase(id);
+  if (thread_id_ != std::this_thread::get_id()) {
+    cv_.wait(lock, [this, id]() { return firing_id_ != id; });
+  }
+}
+
+void RenderClock::State::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = true;
+  UpdateWakeupLocked();
+}
+
+void RenderClock::State::Disarm(uint64_t id) {
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second.deadline_us < 0) {
+    return;
+  }
+  deadlines_.erase({it->second.deadline_us, id});
+  it->second.deadline_us = -1;
+}
+
+void RenderClock::State::UpdateWakeupLocked() {
+#if defined(__linux__)
+  if (timer_fd_ >= 0) {
+    itimerspec spec = {};
+    if (stopping_) {
+      spec.it_value.tv_nsec = 1;
+    } else if (!deadlines_.empty()) {
+      const int64_t delay_us =
+          deadlines_.begin()->first - base::TimeMicros();
+      if (delay_us > 0) {
+        spec.it_value.tv_sec = delay_us / 1000000;
+        spec.it_value.tv_nsec = (delay_us % 1000000) * 1000;
+      } else {
+        // A zero it_value would disarm the timer.
+        spec.it_value.tv_nsec = 1;
+      }
+    }
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+    return;
+  }
+#endif
+  cv_.notify_all();
+}
+
+void RenderClock::State::Loop() {
+#if defined(__linux__)
+  // The default 50 us slack is a good part of the jitter budget.
+  prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+  std::unique_lock<std::mutex> lock(mutex_);
+  thread_id_ = std::this_thread::get_id();
+  while (!stopping_) {
+#if defined(__linux__)
+    if (timer_fd_ >= 0) {
+      lock.unlock();
+      uint64_t expirations = 0;
+      const ssize_t ret = read(timer_fd_, &expirations, sizeof(expirations));
+      lock.lock();
+      if (ret < 0 && errno != EINTR && errno != EAGAIN) {
+        AVE_LOG(LS_ERROR) << "timerfd read failed, errno=" << errno;
+        break;
+      }
+    } else
+#endif
+    {
+      if (deadlines_.empty()) {
+        cv_.wait(lock);
+      } else {
+        const int64_t delay_us =
+            deadlines_.begin()->first - base::TimeMicros();
+        if (delay_us > 0) {
+          cv_.wait_for(lock, std::chrono::microseconds(delay_us));
+        }
+      }
+    }
+    if (stopping_) {
+      break;
+    }
+
+    while (!deadlines_.empty()) {
+      const auto [deadline_us, id] = *deadlines_.begin();
+      const int64_t now_us = base::TimeMicros();
+      if (deadline_us > now_us) {
+        break;
+      }
+      deadlines_.erase(deadlines_.begin());
+      auto& entry = entries_[id];
+      entry.deadline_us = -1;
+
+      const int64_t jitter_us = now_us - deadline_us;
+      jitter_us_[wakeups_ % kJitterWindow] = jitter_us;
+      wakeups_++;
+      max_jitter_us_ = std::max(max_jitter_us_, jitter_us);
+
+      // Copied: the timer may be destroyed from its own callback.
+      auto callback = entry.callback;
+      firing_id_ = id;
+      lock.unlock();
+      callback();
+      lock.lock();
+      firing_id_ = 0;
+      cv_.notify_all();
+    }
+    UpdateWakeupLocked();
+  }
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,93 @@
+/*
+ * render_clock.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_RENDER_CLOCK_H_H_
+#define AVE_AVP_RENDER_CLOCK_H_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief One thread that wakes renderers at their frame deadlines.
+ *
+ * Each renderer owns a Timer with a single pending deadline. Re-arming moves
+ * that deadline instead of queueing another closure, so nothing piles up
+ * when frames are rescheduled, paused or flushed. The thread sleeps on a
+ * timerfd (a condition variable where there is none) set to the earliest
+ * deadline across all timers, and runs the callbacks of the due ones.
+ *
+ * Callbacks run on the clock thread and are shared by every renderer of
+ * the process, so they should only hand the frame off, e.g. post to the
+ * renderer's task runner. Deadlines are in base::TimeMicros() time.
+ */
+class RenderClock : public std::enable_shared_from_this<RenderClock> {
+ public:
+  class Timer {
+   public:
+    // Cancels the timer, waiting for its callback if it is running.
+    ~Timer();
+
+    // Runs the callback at |deadline_us|, replacing any pending deadline.
+    void ArmAt(int64_t deadline_us);
+    void Cancel();
+
+   private:
+    friend class RenderClock;
+    Timer(std::shared_ptr<RenderClock> clock, uint64_t id)
+        : clock_(std::move(clock)), id_(id) {}
+
+    const std::shared_ptr<RenderClock> clock_;
+    const uint64_t id_;
+  };
+
+  struct JitterStats {
+    uint64_t wakeups = 0;
+    // How late callbacks ran against their deadlines, over the last
+    // kJitterWindow of them.
+    int64_t p50_us = 0;
+    int64_t p99_us = 0;
+    int64_t max_us = 0;
+  };
+
+  static constexpr size_t kJitterWindow = 1024;
+
+  // The clock shared by all renderers of the process.
+  static std::shared_ptr<RenderClock> Default();
+
+  static std::shared_ptr<RenderClock> Create();
+  ~RenderClock();
+
+  std::unique_ptr<Timer> CreateTimer(std::function<void()> callback);
+
+  JitterStats GetJitterStats() const;
+
+ private:
+  // What the clock thread works on. The thread holds a reference of its own,
+  // so a clock destroyed from a timer callback, which detaches the thread,
+  // leaves it intact until the thread is done with it.
+  class State;
+
+  RenderClock();
+
+  void Arm(uint64_t id, int64_t deadline_us);
+  void Remove(uint64_t id, bool wait);
+
+  const std::shared_ptr<State> state_;
+  std::thread thread_;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_RENDER_CLOCK_H_H_ */
@@ -0,0 +1,90 @@
+/*
+ * render_clock_benchmark.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+// Measures how late RenderClock callbacks run against their deadlines. A
+// timer is re-armed one frame period ahead from each callback, as the
+// renderer does, optionally while busy threads oversubscribe the CPU. The
+// wakeup jitter is reported against the 1 ms p99 target.
+//
+//   render_clock_benchmark [frames] [period_us] [busy_threads]
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/time_utils.h"
+#include "render_clock.h"
+
+namespace {
+
+using ave::player::RenderClock;
+
+constexpr int64_t kTargetP99Us = 1000;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int frames = argc > 1 ? std::atoi(argv[1]) : 600;
+  // 60 fps by default.
+  const int64_t period_us = argc > 2 ? std::atoll(argv[2]) : 16667;
+  const int busy_threads = argc > 3 ? std::atoi(argv[3]) : 0;
+  std::printf("%d frames, %lld us period, %d busy threads\n", frames,
+              static_cast<long long>(period_us), busy_threads);
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> busy;
+  for (int i = 0; i < busy_threads; ++i) {
+    busy.emplace_back([&done]() {
+      volatile uint64_t spin = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        spin = spin + 1;
+      }
+    });
+  }
+
+  auto clock = RenderClock::Create();
+  std::mutex mutex;
+  std::condition_variable cv;
+  int fired = 0;
+  RenderClock::Timer* timer_ptr = nullptr;
+  auto timer = clock->CreateTimer([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (++fired < frames) {
+      timer_ptr->ArmAt(ave::base::TimeMicros() + period_us);
+    }
+    cv.notify_all();
+  });
+  timer_ptr = timer.get();
+  timer->ArmAt(ave::base::TimeMicros() + period_us);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return fired >= frames; });
+  }
+
+  done = true;
+  for (auto& thread : busy) {
+    thread.join();
+  }
+
+  // The clock keeps the last RenderClock::kJitterWindow wakeups.
+  const auto stats = clock->GetJitterStats();
+  std::printf(
+      "%llu wakeups  p50 %6lld us  p99 %6lld us  max %6lld us  (p99 target "
+      "%lld us: %s)\n",
+      static_cast<unsigned long long>(stats.wakeups),
+      static_cast<long long>(stats.p50_us),
+      static_cast<long long>(stats.p99_us),
+      static_cast<long long>(stats.max_us),
+      static_cast<long long>(kTargetP99Us),
+      stats.p99_us <= kTargetP99Us ? "met" : "missed");
+  return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * render_clock_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "render_clock.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/time_utils.h"
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+void WaitUntil(const std::function<bool()>& done) {
+  for (int i = 0; i < 200 && !done(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+}  // namespace
+
+TEST(RenderClockTest, FiresAtDeadline) {
+  auto clock = RenderClock::Create();
+  std::atomic<int64_t> fired_us{-1};
+  auto timer = clock->CreateTimer([&]() { fired_us = base::TimeMicros(); });
+
+  const int64_t deadline_us = base::TimeMicros() + 20000;
+  timer->ArmAt(deadline_us);
+  WaitUntil([&]() { return fired_us >= 0; });
+
+  ASSERT_GE(fired_us, deadline_us);
+  EXPECT_EQ(clock->GetJitterStats().wakeups, 1u);
+}
+
+TEST(RenderClockTest, RearmReplacesDeadline) {
+  auto clock = RenderClock::Create();
+  std::atomic<int> fired{0};
+  auto timer = clock->CreateTimer([&]() { fired++; });
+
+  timer->ArmAt(base::TimeMicros() + 10000);
+  timer->ArmAt(base::TimeMicros() + 30000);
+  timer->ArmAt(base::TimeMicros() + 20000);
+  WaitUntil([&]() { return fired > 0; });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  EXPECT_EQ(fired, 1);
+}
+
+TEST(RenderClockTest, CancelAndDestroy) {
+  auto clock = RenderClock::Create();
+  std::atomic<int> fired{0};
+  auto cancelled = clock->CreateTimer([&]() { fired++; });
+  auto destroyed = clock->CreateTimer([&]() { fired++; });
+
+  cancelled->ArmAt(base::TimeMicros() + 10000);
+  destroyed->ArmAt(base::TimeMicros() + 10000);
+  cancelled->Cancel();
+  destroyed.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+  EXPECT_EQ(fired, 0);
+}
+
+TEST(RenderClockTest, OrdersTimersByDeadline) {
+  auto clock = RenderClock::Create();
+  std::mutex mutex;
+  std::vector<int> order;
+  std::vector<std::unique_ptr<RenderClock::Timer>> timers;
+  for (int i = 0; i < 3; ++i) {
+    timers.push_back(clock->CreateTimer([&, i]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(i);
+    }));
+  }
+
+  const int64_t now_us = base::TimeMicros();
+  timers[0]->ArmAt(now_us + 30000);
+  timers[1]->ArmAt(now_us + 10000);
+  timers[2]->ArmAt(now_us + 20000);
+  WaitUntil([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return order.size() == 3;
+  });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 0}));
+}
+
+TEST(RenderClockTest, LastTimerDestroyedInItsCallback) {
+  auto clock = RenderClock::Create();
+  std::atomic<bool> fired{false};
+  std::unique_ptr<RenderClock::Timer> timer;
+  timer = clock->CreateTimer([&]() {
+    // Takes the clock down with it; the clock thread still unwinds.
+    timer.reset();
+    fired = true;
+  });
+  clock.reset();
+
+  timer->ArmAt(base::TimeMicros() + 5000);
+  WaitUntil([&]() { return fired.load(); });
+  EXPECT_TRUE(fired);
+  // Leaves the detached thread time to finish.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+}  // namespace player
+}  // namespace ave
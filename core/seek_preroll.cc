@@ -0,0 +1,66 @@
+/*
+ * seek_preroll.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "seek_preroll.h"
+
+#include <algorithm>
+
+namespace ave {
+namespace player {
+
+void SeekPreroll::Start(int64_t target_us, int64_t request_time_us) {
+  target_us_ = target_us;
+  request_time_us_ = request_time_us;
+}
+
+void SeekPreroll::Reset() {
+  target_us_ = -1;
+  request_time_us_ = -1;
+}
+
+bool SeekPreroll::DropVideo(int64_t pts_us) {
+  if (target_us_ < 0 || pts_us < 0) {
+    return false;
+  }
+  if (pts_us >= target_us_) {
+    target_us_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool SeekPreroll::DropAudio(int64_t pts_us, int64_t end_us) const {
+  if (target_us_ < 0 || pts_us < 0 || end_us < 0) {
+    return false;
+  }
+  return end_us <= target_us_;
+}
+
+size_t SeekPreroll::TakeAudioTrim(int64_t pts_us,
+                                  int sample_rate_hz,
+                                  size_t samples) {
+  const int64_t target_us = target_us_;
+  target_us_ = -1;
+  if (target_us < 0 || pts_us < 0 || pts_us >= target_us ||
+      sample_rate_hz <= 0) {
+    return 0;
+  }
+  return std::min(samples, static_cast<size_t>((target_us - pts_us) *
+                                               sample_rate_hz / 1000000));
+}
+
+int64_t SeekPreroll::OnFrameQueued(int64_t now_us) {
+  if (request_time_us_ < 0) {
+    return -1;
+  }
+  const int64_t latency_us = now_us - request_time_us_;
+  request_time_us_ = -1;
+  return latency_us;
+}
+
+}  // namespace player
+}  // namespace ave
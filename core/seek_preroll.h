@@ -0,0 +1,85 @@
+/*
+ * seek_preroll.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_SEEK_PREROLL_H_H_
+#define AVE_AVP_SEEK_PREROLL_H_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Decoder output handling after a seek.
+ *
+ * The source lands on the sync sample before a SEEK_CLOSEST target, so the
+ * decoder drops what comes out before the target, and trims the leading
+ * samples of the audio buffer that straddles it. It also measures the time
+ * from the seek request to the first frame queued after it.
+ *
+ * Output still in flight from before the seek must be flushed before
+ * Start(); anything passed in afterwards is taken to belong to the new
+ * position. Not thread safe.
+ */
+class SeekPreroll {
+ public:
+  SeekPreroll() = default;
+
+  /**
+   * @brief Starts a seek.
+   * @param target_us Media time output is dropped before; -1 for none.
+   * @param request_time_us base::TimeMicros() time the seek was requested.
+   */
+  void Start(int64_t target_us, int64_t request_time_us);
+
+  /**
+   * @brief Forgets the pending seek, e.g. when the decoder is flushed.
+   */
+  void Reset();
+
+  /**
+   * @brief Whether video output at |pts_us| is before the target. The
+   *        target is reached, and cleared, by the first frame that is not.
+   */
+  bool DropVideo(int64_t pts_us);
+
+  /**
+   * @brief Whether an audio buffer spanning [pts_us, end_us) ends at or
+   *        before the target.
+   */
+  bool DropAudio(int64_t pts_us, int64_t end_us) const;
+
+  /**
+   * @brief Number of samples to cut off the front of the first audio
+   *        buffer kept; clears the target.
+   * @param samples Samples in the buffer; the result is at most this.
+   */
+  size_t TakeAudioTrim(int64_t pts_us, int sample_rate_hz, size_t samples);
+
+  /**
+   * @brief Called when a frame is queued to the render.
+   * @return Time from the seek request to |now_us| for the first frame
+   *         after a seek, -1 otherwise.
+   */
+  int64_t OnFrameQueued(int64_t now_us);
+
+  int64_t target_us() const { return target_us_; }
+
+ private:
+  // Output before this media time is dropped; -1 once the target is reached
+  // or for seeks that do not ask for it.
+  int64_t target_us_ = -1;
+  // When the pending seek was requested, until its first frame is queued;
+  // -1 otherwise.
+  int64_t request_time_us_ = -1;
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_SEEK_PREROLL_H_H_ */
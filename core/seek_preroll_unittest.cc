@@ -0,0 +1,117 @@
+/*
+ * seek_preroll_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "seek_preroll.h"
+
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+
+}  // namespace
+
+TEST(SeekPrerollTest, DropsVideoBeforeTarget) {
+  SeekPreroll preroll;
+  preroll.Start(1000000, 0);
+
+  EXPECT_TRUE(preroll.DropVideo(960000));
+  EXPECT_TRUE(preroll.DropVideo(993333));
+  EXPECT_FALSE(preroll.DropVideo(1000000));
+  EXPECT_EQ(preroll.target_us(), -1);
+  // Reordered output after the target is not dropped any more.
+  EXPECT_FALSE(preroll.DropVideo(990000));
+}
+
+TEST(SeekPrerollTest, LetsOutputWithoutTimestampThrough) {
+  SeekPreroll preroll;
+  preroll.Start(1000000, 0);
+
+  EXPECT_FALSE(preroll.DropVideo(-1));
+  EXPECT_FALSE(preroll.DropAudio(-1, -1));
+  EXPECT_FALSE(preroll.DropAudio(900000, -1));
+  EXPECT_EQ(preroll.target_us(), 1000000);
+}
+
+TEST(SeekPrerollTest, TrimsAudioStraddlingTarget) {
+  SeekPreroll preroll;
+  preroll.Start(1000000, 0);
+
+  // Buffers ending at or before the target are dropped whole.
+  EXPECT_TRUE(preroll.DropAudio(960000, 980000));
+  EXPECT_TRUE(preroll.DropAudio(980000, 1000000));
+  // The one that straddles it loses 10 ms off the front.
+  EXPECT_FALSE(preroll.DropAudio(990000, 1010000));
+  EXPECT_EQ(preroll.TakeAudioTrim(990000, kSampleRate, 960), 480u);
+  EXPECT_EQ(preroll.target_us(), -1);
+  EXPECT_FALSE(preroll.DropAudio(1010000, 1030000));
+  EXPECT_EQ(preroll.TakeAudioTrim(1010000, kSampleRate, 960), 0u);
+}
+
+TEST(SeekPrerollTest, TrimIsBoundedByBuffer) {
+  SeekPreroll preroll;
+  preroll.Start(1000000, 0);
+  EXPECT_EQ(preroll.TakeAudioTrim(900000, kSampleRate, 960), 960u);
+
+  preroll.Start(1000000, 0);
+  EXPECT_EQ(preroll.TakeAudioTrim(900000, 0, 960), 0u);
+  EXPECT_EQ(preroll.target_us(), -1);
+}
+
+TEST(SeekPrerollTest, MeasuresFirstFrameOnce) {
+  SeekPreroll preroll;
+  EXPECT_EQ(preroll.OnFrameQueued(5000), -1);
+
+  preroll.Start(-1, 10000);
+  EXPECT_EQ(preroll.OnFrameQueued(35000), 25000);
+  EXPECT_EQ(preroll.OnFrameQueued(45000), -1);
+}
+
+// Replays the decoder's message order for a seek from 10 s back to 1 s:
+// output decoded before the seek is still coming out of the codec when the
+// player flushes and then signals the seek.
+TEST(SeekPrerollTest, OutputBeforeFlushDoesNotReachNewTarget) {
+  SeekPreroll preroll;
+  // A previous seek is still pending when the new one is requested.
+  preroll.Start(9000000, 1000);
+
+  // Pre-seek output: this used to clear the new target and record the
+  // latency, as the seek was signalled ahead of the flush.
+  EXPECT_FALSE(preroll.DropVideo(10000000));
+  EXPECT_EQ(preroll.OnFrameQueued(2000), 1000);
+
+  // kWhatFlush, then kWhatSeek.
+  preroll.Reset();
+  EXPECT_EQ(preroll.target_us(), -1);
+  EXPECT_EQ(preroll.OnFrameQueued(3000), -1);
+  preroll.Start(1000000, 4000);
+
+  // Decoding restarts from the sync sample at 0.5 s.
+  EXPECT_TRUE(preroll.DropVideo(500000));
+  EXPECT_TRUE(preroll.DropVideo(966667));
+  EXPECT_FALSE(preroll.DropVideo(1000000));
+  EXPECT_EQ(preroll.OnFrameQueued(24000), 20000);
+}
+
+TEST(SeekPrerollTest, FlushDropsPendingAudioTarget) {
+  SeekPreroll preroll;
+  preroll.Start(1000000, 0);
+  preroll.Reset();
+
+  EXPECT_FALSE(preroll.DropAudio(500000, 520000));
+  EXPECT_EQ(preroll.TakeAudioTrim(500000, kSampleRate, 960), 0u);
+
+  preroll.Start(2000000, 0);
+  EXPECT_TRUE(preroll.DropAudio(1980000, 2000000));
+  EXPECT_EQ(preroll.TakeAudioTrim(1990000, kSampleRate, 960), 480u);
+}
+
+}  // namespace player
+}  // namespace ave
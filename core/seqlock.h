@@ -0,0 +1,83 @@
+/*
+ * seqlock.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_SEQLOCK_H_H_
+#define AVE_AVP_SEQLOCK_H_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Sequence lock around a small trivially copyable value.
+ *
+ * Load() never blocks or writes shared memory: it copies the value and
+ * retries if a Store() ran meanwhile, which only happens while one is in
+ * progress. Store() does not serialize writers; callers hold their own
+ * lock around it. The value is kept in relaxed atomic words so that torn
+ * reads, which are discarded, are not data races.
+ */
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SeqLock needs a trivially copyable value");
+
+ public:
+  explicit SeqLock(const T& value = T()) { Store(value); }
+
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  T Load() const {
+    std::array<uint64_t, kWords> words;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      for (size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+  void Store(const T& value) {
+    std::array<uint64_t, kWords> words = {};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    // Odd while the words are being replaced.
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> sequence_{0};
+  std::array<std::atomic<uint64_t>, kWords> words_{};
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_SEQLOCK_H_H_ */
@@ -0,0 +1,71 @@
+/*
+ * vsync_source.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef AVE_AVP_VSYNC_SOURCE_H_H_
+#define AVE_AVP_VSYNC_SOURCE_H_H_
+
+#include <cstdint>
+#include <mutex>
+
+#include "base/thread_annotation.h"
+
+namespace ave {
+namespace player {
+
+/**
+ * @brief Refresh timing of the display a video sink presents on.
+ */
+struct VsyncTiming {
+  // Refresh period, 0 if unknown.
+  int64_t period_us = 0;
+  // base::TimeMicros() time of one vsync; the others are whole periods
+  // away from it.
+  int64_t reference_us = 0;
+};
+
+/**
+ * @brief Reports the vsync timing of a display. Implemented by platforms
+ * that know it (Choreographer, DRM vblank events, ...). Thread safe.
+ */
+class VsyncSource {
+ public:
+  virtual ~VsyncSource() = default;
+
+  virtual VsyncTiming GetTiming() const = 0;
+};
+
+/**
+ * @brief Vsync source with a fixed, settable timing, for tests and for
+ * sinks that only know their refresh rate.
+ */
+class SimulatedVsyncSource : public VsyncSource {
+ public:
+  explicit SimulatedVsyncSource(int64_t period_us, int64_t reference_us = 0) {
+    timing_.period_us = period_us;
+    timing_.reference_us = reference_us;
+  }
+
+  VsyncTiming GetTiming() const override EXCLUDES(mutex_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timing_;
+  }
+
+  void SetTiming(int64_t period_us, int64_t reference_us) EXCLUDES(mutex_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timing_.period_us = period_us;
+    timing_.reference_us = reference_us;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  VsyncTiming timing_ GUARDED_BY(mutex_);
+};
+
+}  // namespace player
+}  // namespace ave
+
+#endif /* !AVE_AVP_VSYNC_SOURCE_H_H_ */
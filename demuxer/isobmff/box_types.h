@@ -62,6 +62,18 @@ constexpr uint32_t FOURCC_stco = FourCC('s', 't', 'c', 'o');
 constexpr uint32_t FOURCC_co64 = FourCC('c', 'o', '6', '4');
 constexpr uint32_t FOURCC_stss = FourCC('s', 't', 's', 's');
 
+// Movie fragment boxes (fragmented MP4 / CMAF)
+constexpr uint32_t FOURCC_mvex = FourCC('m', 'v', 'e', 'x');
+constexpr uint32_t FOURCC_trex = FourCC('t', 'r', 'e', 'x');
+constexpr uint32_t FOURCC_styp = FourCC('s', 't', 'y', 'p');
+constexpr uint32_t FOURCC_sidx = FourCC('s', 'i', 'd', 'x');
+constexpr uint32_t FOURCC_moof = FourCC('m', 'o', 'o', 'f');
+constexpr uint32_t FOURCC_mfhd = FourCC('m', 'f', 'h', 'd');
+constexpr uint32_t FOURCC_traf = FourCC('t', 'r', 'a', 'f');
+constexpr uint32_t FOURCC_tfhd = FourCC('t', 'f', 'h', 'd');
+constexpr uint32_t FOURCC_tfdt = FourCC('t', 'f', 'd', 't');
+constexpr uint32_t FOURCC_trun = FourCC('t', 'r', 'u', 'n');
+
 // Sample description entries
 constexpr uint32_t FOURCC_avc1 = FourCC('a', 'v', 'c', '1');
 constexpr uint32_t FOURCC_avc3 = FourCC('a', 'v', 'c', '3');
@@ -15,6 +15,7 @@
 #include "base/units/timestamp.h"
 #include "demuxer/isobmff/box_reader.h"
 #include "demuxer/isobmff/box_types.h"
+#include "demuxer/nal_unit_classifier.h"
 #include "media/audio/channel_layout.h"
 #include "media/codec/codec_id.h"
 #include "media/foundation/aac_utils.h"
@@ -66,11 +67,24 @@ status_t Mp4Source::Read(std::shared_ptr<MediaFrame>& frame,
 // ========== Mp4Demuxer ==========
 
 Mp4Demuxer::Mp4Demuxer(std::shared_ptr<ave::DataSource> data_source)
-    : Demuxer(std::move(data_source)) {
+    : Demuxer(std::move(data_source)),
+      mapped_source_(
+          std::dynamic_pointer_cast<MappedDataSource>(data_source_)) {
   AVE_LOG(LS_INFO) << "Mp4Demuxer created";
 }
 
 Mp4Demuxer::~Mp4Demuxer() {
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    if (!tracks_[i].frame_pool) {
+      continue;
+    }
+    auto stats = tracks_[i].frame_pool->GetStats();
+    AVE_LOG(LS_INFO) << "Mp4Demuxer track " << i
+                     << " frame pool: acquired=" << stats.acquired
+                     << ", reused=" << stats.reused
+                     << ", allocated=" << stats.allocated
+                     << ", oversized=" << stats.oversized;
+  }
   AVE_LOG(LS_INFO) << "Mp4Demuxer destroyed";
 }
 
@@ -702,6 +716,8 @@ status_t Mp4Demuxer::ParseVideoSampleEntry(off64_t offset,
   track->meta->SetCodec(codec_id);
   if (mime) {
     track->meta->SetMime(mime);
+    track->nal_stream =
+        NalStreamInfoFromConfig(NalCodecFromMime(mime), nullptr, 0);
   }
   track->meta->SetWidth(width);
   track->meta->SetHeight(height);
@@ -732,6 +748,8 @@ status_t Mp4Demuxer::ParseVideoSampleEntry(off64_t offset,
                                  avcc_size) == avcc_size) {
           track->meta->SetPrivateData(static_cast<uint32_t>(avcc_size),
                                       avcc_data.data());
+          track->nal_stream = NalStreamInfoFromConfig(
+              NalCodec::kH264, avcc_data.data(), avcc_data.size());
           AVE_LOG(LS_INFO) << "avcC: " << avcc_size << " bytes";
         }
       }
@@ -743,6 +761,8 @@ status_t Mp4Demuxer::ParseVideoSampleEntry(off64_t offset,
                                  hvcc_size) == hvcc_size) {
           track->meta->SetPrivateData(static_cast<uint32_t>(hvcc_size),
                                       hvcc_data.data());
+          track->nal_stream = NalStreamInfoFromConfig(
+              NalCodec::kHevc, hvcc_data.data(), hvcc_data.size());
           AVE_LOG(LS_INFO) << "hvcC: " << hvcc_size << " bytes";
         }
       }
@@ -976,7 +996,116 @@ status_t Mp4Demuxer::ReadSample(size_t track_index,
   }
 
   auto& track = tracks_[track_index];
+  isobmff::SampleInfo info;
+  status_t err = PrepareSampleLocked(track, options, &info);
+  if (err != OK) {
+    return err;
+  }
+
+  frame = WrapMappedSampleLocked(track, info);
+  if (!frame) {
+    // Take a MediaFrame from the track pool and read sample data
+    frame = AcquireFrameLocked(track, info, info.size);
+    if (!frame) {
+      return NO_MEMORY;
+    }
+
+    ssize_t bytes_read =
+        data_source_->ReadAt(info.offset, frame->data(), info.size);
+    if (bytes_read < 0 || static_cast<uint32_t>(bytes_read) != info.size) {
+      return ERROR_IO;
+    }
+    frame->setRange(0, info.size);
+  }
+  MarkAccessUnit(track, info, frame->data(), info.size, frame.get());
+
+  track.current_sample++;
+
+  return OK;
+}
+
+// Same as ReadSample(), with the payload read into the caller's buffer (a
+// codec input buffer) instead of a pooled frame, so it is copied only once
+// on its way from the data source to the decoder.
+status_t Mp4Demuxer::ReadSampleInto(size_t track_index,
+                                    uint8_t* buffer,
+                                    size_t capacity,
+                                    std::shared_ptr<MediaFrame>& frame,
+                                    size_t* size,
+                                    const MediaSource::ReadOptions* options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (track_index >= tracks_.size() || buffer == nullptr || size == nullptr) {
+    return BAD_VALUE;
+  }
+
+  auto& track = tracks_[track_index];
+  isobmff::SampleInfo info;
+  status_t err = PrepareSampleLocked(track, options, &info);
+  if (err != OK) {
+    return err;
+  }
+  if (info.size > capacity) {
+    AVE_LOG(LS_WARNING) << "Mp4Demuxer: sample " << track.current_sample
+                        << " of " << info.size
+                        << " bytes does not fit a buffer of " << capacity;
+    return NO_MEMORY;
+  }
+
+  ssize_t bytes_read = data_source_->ReadAt(info.offset, buffer, info.size);
+  if (bytes_read < 0 || static_cast<uint32_t>(bytes_read) != info.size) {
+    return ERROR_IO;
+  }
+
+  // The frame carries the timing only.
+  frame = AcquireFrameLocked(track, info, 0);
+  if (!frame) {
+    return NO_MEMORY;
+  }
+  MarkAccessUnit(track, info, buffer, info.size, frame.get());
+  *size = info.size;
+
+  track.current_sample++;
+
+  return OK;
+}
+
+// Adjacent samples are merged into one range.
+status_t Mp4Demuxer::GetNextSampleRanges(
+    size_t track_index,
+    size_t count,
+    std::vector<std::pair<off64_t, size_t>>* ranges) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (track_index >= tracks_.size() || ranges == nullptr) {
+    return BAD_VALUE;
+  }
+
+  auto& track = tracks_[track_index];
+  const uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(
+      track.sample_table->CountSamples(),
+      static_cast<uint64_t>(track.current_sample) + count));
+  for (uint32_t index = track.current_sample; index < end; ++index) {
+    isobmff::SampleInfo info;
+    status_t err = track.sample_table->GetSampleInfo(index, &info);
+    if (err != OK) {
+      return err;
+    }
+    if (!ranges->empty() &&
+        ranges->back().first + static_cast<off64_t>(ranges->back().second) ==
+            info.offset) {
+      ranges->back().second += info.size;
+    } else {
+      ranges->emplace_back(info.offset, info.size);
+    }
+  }
+  return OK;
+}
 
+status_t Mp4Demuxer::PrepareSampleLocked(
+    Track& track,
+    const MediaSource::ReadOptions* options,
+    isobmff::SampleInfo* info) {
   // Handle seek
   if (options) {
     int64_t seek_time_us = 0;
@@ -1010,35 +1139,81 @@ status_t Mp4Demuxer::ReadSample(size_t track_index,
     return ERROR_END_OF_STREAM;
   }
 
-  SampleInfo info;
-  status_t err = track.sample_table->GetSampleInfo(track.current_sample, &info);
-  if (err != OK) {
-    return err;
-  }
+  return track.sample_table->GetSampleInfo(track.current_sample, info);
+}
 
-  // Create MediaFrame and read sample data
-  frame = MediaFrame::CreateShared(info.size, track.media_type);
+std::shared_ptr<MediaFrame> Mp4Demuxer::AcquireFrameLocked(
+    Track& track,
+    const isobmff::SampleInfo& info,
+    size_t capacity) {
+  if (!track.frame_pool) {
+    track.frame_pool = MediaFramePool::Create(track.media_type);
+  }
+  auto frame = track.frame_pool->Acquire(capacity);
   if (!frame) {
-    return NO_MEMORY;
+    return nullptr;
   }
+  StampFrame(track, info, frame.get());
+  return frame;
+}
 
-  ssize_t bytes_read =
-      data_source_->ReadAt(info.offset, frame->data(), info.size);
-  if (bytes_read < 0 || static_cast<uint32_t>(bytes_read) != info.size) {
-    return ERROR_IO;
+std::shared_ptr<MediaFrame> Mp4Demuxer::WrapMappedSampleLocked(
+    const Track& track,
+    const isobmff::SampleInfo& info) {
+  if (!mapped_source_ || info.size == 0) {
+    return nullptr;
+  }
+  auto view = mapped_source_->GetView(info.offset, info.size);
+  if (!view) {
+    return nullptr;
+  }
+
+  struct Holder {
+    std::shared_ptr<const uint8_t> view;
+    std::shared_ptr<MediaFrame> frame;
+  };
+  auto holder = std::make_shared<Holder>();
+  holder->view = std::move(view);
+  // The mapping is read-only; nothing downstream writes into packet data.
+  holder->frame = MediaFrame::CreateSharedAsWrap(
+      const_cast<uint8_t*>(holder->view.get()), info.size, track.media_type);
+  if (!holder->frame) {
+    return nullptr;
   }
-  frame->setRange(0, info.size);
+  StampFrame(track, info, holder->frame.get());
+  return std::shared_ptr<MediaFrame>(holder, holder->frame.get());
+}
 
-  // Set timestamps
+void Mp4Demuxer::StampFrame(const Track& track,
+                            const isobmff::SampleInfo& info,
+                            MediaFrame* frame) {
   frame->SetPts(base::Timestamp::Micros(info.pts_us));
   frame->SetDts(base::Timestamp::Micros(info.dts_us));
   frame->SetDuration(base::TimeDelta::Micros(info.duration_us));
   frame->SetCodec(track.meta->codec());
   frame->SetStreamType(track.media_type);
+}
 
-  track.current_sample++;
-
-  return OK;
+// Video samples are marked for decoders that skip frames when late: H.264
+// and HEVC from their slice headers, other codecs from the sync sample
+// table.
+void Mp4Demuxer::MarkAccessUnit(const Track& track,
+                                const isobmff::SampleInfo& info,
+                                const uint8_t* data,
+                                size_t size,
+                                MediaFrame* frame) {
+  if (track.media_type != media::MediaType::VIDEO) {
+    return;
+  }
+  uint32_t flags = 0;
+  if (track.nal_stream.codec != NalCodec::kNone) {
+    flags = ClassifyAccessUnit(track.nal_stream, data, size);
+  } else if (info.is_sync) {
+    flags = ACCESS_UNIT_FLAG_SYNC;
+  }
+  if (flags != 0) {
+    frame->setFlags(frame->flags() | flags);
+  }
 }
 
 }  // namespace player
@@ -10,11 +10,15 @@
 
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "api/demuxer/demuxer.h"
 #include "base/data_source/data_source.h"
+#include "common/mapped_data_source.h"
+#include "common/media_frame_pool.h"
 #include "demuxer/isobmff/sample_table.h"
+#include "demuxer/nal_unit_classifier.h"
 #include "media/foundation/media_frame.h"
 #include "media/foundation/media_meta.h"
 #include "media/foundation/media_source.h"
@@ -38,6 +42,17 @@ class Mp4Demuxer : public Demuxer {
                           size_t track_index) override;
   std::shared_ptr<MediaSource> GetTrack(size_t track_index) override;
   const char* name() override;
+  bool SupportsReadSampleInto() const override { return true; }
+  status_t ReadSampleInto(size_t track_index,
+                          uint8_t* buffer,
+                          size_t capacity,
+                          std::shared_ptr<MediaFrame>& frame,
+                          size_t* size,
+                          const MediaSource::ReadOptions* options) override;
+  status_t GetNextSampleRanges(
+      size_t track_index,
+      size_t count,
+      std::vector<std::pair<off64_t, size_t>>* ranges) override;
 
   // Called by factory after construction.
   status_t Init();
@@ -52,6 +67,10 @@ class Mp4Demuxer : public Demuxer {
     int64_t duration_us = 0;
     uint32_t current_sample = 0;  // read cursor
     media::MediaType media_type = media::MediaType::UNKNOWN;
+    // Recycles sample frames once downstream releases them.
+    std::shared_ptr<MediaFramePool> frame_pool;
+    // Set for H.264 and HEVC, whose samples are length-prefixed NAL units.
+    NalStreamInfo nal_stream;
   };
 
   struct TrakParseContext {
@@ -85,7 +104,32 @@ class Mp4Demuxer : public Demuxer {
   status_t ReadSample(size_t track_index,
                       std::shared_ptr<MediaFrame>& frame,
                       const MediaSource::ReadOptions* options);
-
+  // Applies the seek in |options| and looks up the sample at the cursor.
+  status_t PrepareSampleLocked(Track& track,
+                               const MediaSource::ReadOptions* options,
+                               isobmff::SampleInfo* info);
+  // Takes a frame from the track pool and stamps the sample timing on it.
+  std::shared_ptr<MediaFrame> AcquireFrameLocked(
+      Track& track,
+      const isobmff::SampleInfo& info,
+      size_t capacity);
+  // Wraps the sample in place in the mapped source, or returns nullptr if it
+  // cannot be viewed. The frame keeps the mapping alive.
+  std::shared_ptr<MediaFrame> WrapMappedSampleLocked(
+      const Track& track,
+      const isobmff::SampleInfo& info);
+  static void StampFrame(const Track& track,
+                         const isobmff::SampleInfo& info,
+                         MediaFrame* frame);
+  // Sets the ACCESS_UNIT_FLAG_* of a video sample on |frame|.
+  static void MarkAccessUnit(const Track& track,
+                             const isobmff::SampleInfo& info,
+                             const uint8_t* data,
+                             size_t size,
+                             MediaFrame* frame);
+
+  // |data_source_| when it can hand out views, so samples are not copied.
+  std::shared_ptr<MappedDataSource> mapped_source_;
   std::shared_ptr<MediaMeta> source_format_;
   std::vector<Track> tracks_;
   std::mutex mutex_;
@@ -0,0 +1,192 @@
+/*
+ * nal_unit_classifier.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "demuxer/nal_unit_classifier.h"
+
+#include "api/demuxer/demuxer.h"
+#include "media/foundation/media_mimes.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+// H.264 nal_unit_type: 1-5 are coded slices, 5 those of an IDR picture.
+constexpr uint8_t kH264NalSliceFirst = 1;
+constexpr uint8_t kH264NalIdrSlice = 5;
+
+// HEVC nal_unit_type: 0-31 are VCL units, 16-18 BLA and 19-20 IDR pictures.
+// Below 16, even types are sub-layer non-reference pictures: no picture of
+// the same sub-layer refers to them, but higher sub-layers still may.
+constexpr uint8_t kHevcNalVclLast = 31;
+constexpr uint8_t kHevcNalBlaFirst = 16;
+constexpr uint8_t kHevcNalIdrLast = 20;
+constexpr uint8_t kHevcNalNonReferenceLast = 14;
+
+struct SliceSummary {
+  bool has_slice = false;
+  bool has_reference = false;
+  bool sync = false;
+};
+
+template <typename Visitor>
+void ForEachAnnexBNalUnit(const uint8_t* data, size_t size, Visitor&& visit) {
+  // Start of the current NAL unit, past its start code.
+  size_t start = size;
+  size_t pos = 0;
+  while (pos + 3 <= size) {
+    if (data[pos] != 0 || data[pos + 1] != 0 || data[pos + 2] != 1) {
+      ++pos;
+      continue;
+    }
+    if (start < pos) {
+      visit(data + start, pos - start);
+    }
+    pos += 3;
+    start = pos;
+  }
+  if (start < size) {
+    visit(data + start, size - start);
+  }
+}
+
+template <typename Visitor>
+bool ForEachLengthPrefixedNalUnit(const uint8_t* data,
+                                  size_t size,
+                                  size_t nal_length_size,
+                                  Visitor&& visit) {
+  if (nal_length_size < 1 || nal_length_size > 4) {
+    return false;
+  }
+  size_t pos = 0;
+  while (pos < size) {
+    if (size - pos < nal_length_size) {
+      return false;
+    }
+    size_t nal_size = 0;
+    for (size_t i = 0; i < nal_length_size; ++i) {
+      nal_size = (nal_size << 8) | data[pos + i];
+    }
+    pos += nal_length_size;
+    if (nal_size > size - pos) {
+      return false;
+    }
+    visit(data + pos, nal_size);
+    pos += nal_size;
+  }
+  return true;
+}
+
+void VisitH264NalUnit(const uint8_t* nal, size_t size, SliceSummary* summary) {
+  if (size < 1) {
+    return;
+  }
+  const uint8_t type = nal[0] & 0x1f;
+  if (type < kH264NalSliceFirst || type > kH264NalIdrSlice) {
+    return;
+  }
+  summary->has_slice = true;
+  if ((nal[0] >> 5) & 0x03) {
+    summary->has_reference = true;
+  }
+  if (type == kH264NalIdrSlice) {
+    summary->sync = true;
+  }
+}
+
+void VisitHevcNalUnit(const uint8_t* nal,
+                      size_t size,
+                      int max_temporal_id,
+                      SliceSummary* summary) {
+  if (size < 2) {
+    return;
+  }
+  const uint8_t type = (nal[0] >> 1) & 0x3f;
+  if (type > kHevcNalVclLast) {
+    return;
+  }
+  summary->has_slice = true;
+  const int temporal_id = (nal[1] & 0x07) - 1;
+  if (type > kHevcNalNonReferenceLast || type % 2 != 0 ||
+      max_temporal_id < 0 || temporal_id != max_temporal_id) {
+    summary->has_reference = true;
+  }
+  if (type >= kHevcNalBlaFirst && type <= kHevcNalIdrLast) {
+    summary->sync = true;
+  }
+}
+
+}  // namespace
+
+NalCodec NalCodecFromMime(const std::string& mime) {
+  if (mime == media::MEDIA_MIMETYPE_VIDEO_AVC) {
+    return NalCodec::kH264;
+  }
+  if (mime == media::MEDIA_MIMETYPE_VIDEO_HEVC) {
+    return NalCodec::kHevc;
+  }
+  return NalCodec::kNone;
+}
+
+NalStreamInfo NalStreamInfoFromConfig(NalCodec codec,
+                                      const uint8_t* config,
+                                      size_t size) {
+  NalStreamInfo stream;
+  stream.codec = codec;
+  stream.format = NalFormat::kLengthPrefixed;
+  // Both records start with configurationVersion 1; lengthSizeMinusOne is
+  // in the low bits of byte 4 (avcC) or byte 21 (hvcC), and byte 21 of hvcC
+  // also carries numTemporalLayers, 0 if unknown.
+  if (config == nullptr || size < 1 || config[0] != 1) {
+    return stream;
+  }
+  if (codec == NalCodec::kH264 && size >= 5) {
+    stream.nal_length_size = (config[4] & 0x03) + 1;
+  } else if (codec == NalCodec::kHevc && size >= 23) {
+    stream.nal_length_size = (config[21] & 0x03) + 1;
+    stream.max_temporal_id = ((config[21] >> 3) & 0x07) - 1;
+  }
+  return stream;
+}
+
+uint32_t ClassifyAccessUnit(const NalStreamInfo& stream,
+                            const uint8_t* data,
+                            size_t size) {
+  if (stream.codec == NalCodec::kNone || data == nullptr) {
+    return 0;
+  }
+
+  SliceSummary summary;
+  auto visit = [&stream, &summary](const uint8_t* nal, size_t nal_size) {
+    if (stream.codec == NalCodec::kH264) {
+      VisitH264NalUnit(nal, nal_size, &summary);
+    } else {
+      VisitHevcNalUnit(nal, nal_size, stream.max_temporal_id, &summary);
+    }
+  };
+  if (stream.format == NalFormat::kAnnexB) {
+    ForEachAnnexBNalUnit(data, size, visit);
+  } else if (!ForEachLengthPrefixedNalUnit(data, size, stream.nal_length_size,
+                                           visit)) {
+    return 0;
+  }
+
+  if (!summary.has_slice) {
+    return 0;
+  }
+  uint32_t flags = 0;
+  if (summary.sync) {
+    flags |= ACCESS_UNIT_FLAG_SYNC;
+  }
+  if (!summary.has_reference) {
+    flags |= ACCESS_UNIT_FLAG_DROPPABLE;
+  }
+  return flags;
+}
+
+}  // namespace player
+}  // namespace ave
@@ -0,0 +1,68 @@
+/*
+ * nal_unit_classifier.h
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#ifndef DEMUXER_NAL_UNIT_CLASSIFIER_H_
+#define DEMUXER_NAL_UNIT_CLASSIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ave {
+namespace player {
+
+enum class NalCodec {
+  kNone,
+  kH264,
+  kHevc,
+};
+
+// How the NAL units of an access unit are delimited.
+enum class NalFormat {
+  // Annex B start codes, as carried in MPEG-2 TS.
+  kAnnexB,
+  // Big-endian length prefixes, as carried in MP4 samples.
+  kLengthPrefixed,
+};
+
+struct NalStreamInfo {
+  NalCodec codec = NalCodec::kNone;
+  NalFormat format = NalFormat::kAnnexB;
+  // Size of the length prefixes of a kLengthPrefixed stream.
+  size_t nal_length_size = 4;
+  // HEVC only: highest TemporalId of the stream, -1 if unknown.
+  int max_temporal_id = -1;
+};
+
+NalCodec NalCodecFromMime(const std::string& mime);
+
+// Length-prefixed stream described by an avcC or hvcC record; 4 byte
+// prefixes and unknown temporal layers if |config| is not one.
+NalStreamInfo NalStreamInfoFromConfig(NalCodec codec,
+                                      const uint8_t* config,
+                                      size_t size);
+
+/**
+ * @brief Returns the ACCESS_UNIT_FLAG_* of an H.264 or HEVC access unit,
+ * from the headers of its slice NAL units.
+ *
+ * The NAL units are delimited as |stream| says; a length prefix is never
+ * mistaken for a start code. An H.264 access unit whose slices all have
+ * nal_ref_idc 0 is droppable. An HEVC one is droppable only when its slices
+ * are sub-layer non-reference pictures of the highest TemporalId, so HEVC
+ * is never droppable when the temporal layers are unknown. An IDR or BLA
+ * picture is a sync point. Returns 0 when nothing can be told, including
+ * for truncated data.
+ */
+uint32_t ClassifyAccessUnit(const NalStreamInfo& stream,
+                            const uint8_t* data,
+                            size_t size);
+
+}  // namespace player
+}  // namespace ave
+
+#endif  // DEMUXER_NAL_UNIT_CLASSIFIER_H_
@@ -0,0 +1,146 @@
+/*
+ * nal_unit_classifier_unittest.cc
+ * Copyright (C) 2026 youfa <vsyfar@gmail.com>
+ *
+ * Distributed under terms of the GPLv2 license.
+ */
+
+#include "demuxer/nal_unit_classifier.h"
+
+#include <vector>
+
+#include "api/demuxer/demuxer.h"
+#include "test/gtest.h"
+
+namespace ave {
+namespace player {
+
+namespace {
+
+// HEVC NAL unit header of |type| at |temporal_id|.
+std::vector<uint8_t> HevcNal(uint8_t type, int temporal_id) {
+  return {static_cast<uint8_t>(type << 1),
+          static_cast<uint8_t>(temporal_id + 1), 0xaf, 0x01};
+}
+
+std::vector<uint8_t> LengthPrefixed(const std::vector<uint8_t>& nal,
+                                    size_t nal_length_size) {
+  std::vector<uint8_t> out;
+  for (size_t i = nal_length_size; i > 0; --i) {
+    out.push_back(static_cast<uint8_t>(nal.size() >> (8 * (i - 1))));
+  }
+  out.insert(out.end(), nal.begin(), nal.end());
+  return out;
+}
+
+std::vector<uint8_t> AnnexB(const std::vector<uint8_t>& nal) {
+  std::vector<uint8_t> out = {0, 0, 0, 1};
+  out.insert(out.end(), nal.begin(), nal.end());
+  return out;
+}
+
+// hvcC record up to byte 22, with numTemporalLayers and 4-byte prefixes.
+std::vector<uint8_t> Hvcc(uint8_t num_temporal_layers) {
+  std::vector<uint8_t> hvcc(23, 0);
+  hvcc[0] = 1;
+  hvcc[21] = static_cast<uint8_t>((num_temporal_layers << 3) | 0x03);
+  return hvcc;
+}
+
+NalStreamInfo LengthPrefixedStream(NalCodec codec, size_t nal_length_size) {
+  NalStreamInfo stream;
+  stream.codec = codec;
+  stream.format = NalFormat::kLengthPrefixed;
+  stream.nal_length_size = nal_length_size;
+  return stream;
+}
+
+uint32_t Classify(const NalStreamInfo& stream,
+                  const std::vector<uint8_t>& data) {
+  return ClassifyAccessUnit(stream, data.data(), data.size());
+}
+
+}  // namespace
+
+TEST(NalUnitClassifierTest, LengthPrefixIsNotTakenForStartCode) {
+  // A 4-byte prefix of 0x1xx reads as 00 00 01 xx, one of 1 as 00 00 00 01.
+  std::vector<uint8_t> idr(0x1f0, 0x80);
+  idr[0] = 0x65;  // nal_ref_idc 3, IDR slice
+  std::vector<uint8_t> data = LengthPrefixed(idr, 4);
+  ASSERT_EQ(data[2], 0x01);
+  EXPECT_EQ(Classify(LengthPrefixedStream(NalCodec::kH264, 4), data),
+            ACCESS_UNIT_FLAG_SYNC);
+
+  // A one-byte non-reference slice, then a reference slice.
+  data = LengthPrefixed({0x01}, 4);
+  ASSERT_EQ(data[3], 0x01);
+  auto slice = LengthPrefixed({0x41, 0x9a, 0x00}, 4);
+  data.insert(data.end(), slice.begin(), slice.end());
+  EXPECT_EQ(Classify(LengthPrefixedStream(NalCodec::kH264, 4), data), 0u);
+}
+
+TEST(NalUnitClassifierTest, H264DroppableWithoutReferenceSlices) {
+  const NalStreamInfo stream = LengthPrefixedStream(NalCodec::kH264, 2);
+  EXPECT_EQ(Classify(stream, LengthPrefixed({0x01, 0x9a, 0x00}, 2)),
+            ACCESS_UNIT_FLAG_DROPPABLE);
+  EXPECT_EQ(Classify(stream, LengthPrefixed({0x41, 0x9a, 0x00}, 2)), 0u);
+
+  NalStreamInfo annex_b;
+  annex_b.codec = NalCodec::kH264;
+  EXPECT_EQ(Classify(annex_b, AnnexB({0x01, 0x9a, 0x00})),
+            ACCESS_UNIT_FLAG_DROPPABLE);
+  EXPECT_EQ(Classify(annex_b, AnnexB({0x65, 0x88, 0x80})),
+            ACCESS_UNIT_FLAG_SYNC);
+}
+
+TEST(NalUnitClassifierTest, TruncatedLengthPrefixedDataIsUnknown) {
+  std::vector<uint8_t> data = LengthPrefixed({0x01, 0x9a, 0x00}, 4);
+  data.pop_back();
+  EXPECT_EQ(Classify(LengthPrefixedStream(NalCodec::kH264, 4), data), 0u);
+}
+
+TEST(NalUnitClassifierTest, ReadsHevcConfig) {
+  const std::vector<uint8_t> hvcc = Hvcc(3);
+  const NalStreamInfo stream =
+      NalStreamInfoFromConfig(NalCodec::kHevc, hvcc.data(), hvcc.size());
+  EXPECT_EQ(stream.format, NalFormat::kLengthPrefixed);
+  EXPECT_EQ(stream.nal_length_size, 4u);
+  EXPECT_EQ(stream.max_temporal_id, 2);
+
+  const std::vector<uint8_t> unknown = Hvcc(0);
+  EXPECT_EQ(NalStreamInfoFromConfig(NalCodec::kHevc, unknown.data(),
+                                    unknown.size())
+                .max_temporal_id,
+            -1);
+}
+
+TEST(NalUnitClassifierTest, HevcDroppableOnlyAtHighestTemporalId) {
+  const std::vector<uint8_t> hvcc = Hvcc(3);
+  const NalStreamInfo stream =
+      NalStreamInfoFromConfig(NalCodec::kHevc, hvcc.data(), hvcc.size());
+  // TRAIL_N (0) is only left unreferenced by its own sub-layer.
+  EXPECT_EQ(Classify(stream, LengthPrefixed(HevcNal(0, 2), 4)),
+            ACCESS_UNIT_FLAG_DROPPABLE);
+  EXPECT_EQ(Classify(stream, LengthPrefixed(HevcNal(0, 1), 4)), 0u);
+  EXPECT_EQ(Classify(stream, LengthPrefixed(HevcNal(0, 0), 4)), 0u);
+  // TRAIL_R (1) is a reference at any TemporalId.
+  EXPECT_EQ(Classify(stream, LengthPrefixed(HevcNal(1, 2), 4)), 0u);
+  // IDR_W_RADL (19) is a sync point.
+  EXPECT_EQ(Classify(stream, LengthPrefixed(HevcNal(19, 0), 4)),
+            ACCESS_UNIT_FLAG_SYNC);
+}
+
+TEST(NalUnitClassifierTest, HevcNeverDroppableWithUnknownTemporalLayers) {
+  NalStreamInfo annex_b;
+  annex_b.codec = NalCodec::kHevc;
+  EXPECT_EQ(Classify(annex_b, AnnexB(HevcNal(0, 0))), 0u);
+
+  const std::vector<uint8_t> hvcc = Hvcc(0);
+  EXPECT_EQ(Classify(NalStreamInfoFromConfig(NalCodec::kHevc, hvcc.data(),
+                                             hvcc.size()),
+                     LengthPrefixed(HevcNal(0, 0), 4)),
+            0u);
+}
+
+}  // namespace player
+}  // namespace ave
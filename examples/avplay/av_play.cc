@@ -29,7 +29,7 @@ using ave::player::YuvFileVideoRender;
 void printHelp() {
   std::cout
       << "help:\n"
-         "  -f/--file <file>   : file to play\n"
+         "  -f/--file <file>   : file to play, - reads from stdin\n"
          "  -o/--output <base> : write video to <base>.yuv, play audio via\n"
          "                       ALSA/PulseAudio (no display needed)\n"
          "  -d/--duration <s>  : stop after <s> seconds (default: full)\n"
@@ -91,7 +91,8 @@ int main(int argc, char* argv[]) {
   ave::base::LogMessage::LogToDebug(ave::base::LogSeverity::LS_INFO);
 
   std::cout << "play file: " << filename << std::endl;
-  std::string url = std::string("file://") + filename;
+  std::string url = filename == "-" ? std::string("pipe://0")
+                                    : std::string("file://") + filename;
 
   std::shared_ptr<ExListener> listener(std::make_shared<ExListener>());
 